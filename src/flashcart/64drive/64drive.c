@@ -136,7 +136,6 @@ static flashcart_firmware_version_t d64_get_firmware_version (void) {
  */
 static flashcart_err_t d64_load_rom (char *rom_path, flashcart_progress_callback_t *progress) {
     FIL fil;
-    UINT br;
 
     if (f_open(&fil, strip_fs_prefix(rom_path), FA_READ) != FR_OK) {
         return FLASHCART_ERR_LOAD;
@@ -151,20 +150,7 @@ static flashcart_err_t d64_load_rom (char *rom_path, flashcart_progress_callback
         return FLASHCART_ERR_LOAD;
     }
 
-    size_t sdram_size = MiB(64);
-
-    size_t chunk_size = KiB(128);
-    for (unsigned int offset = 0; offset < sdram_size; offset += chunk_size) {
-        size_t block_size = MIN(sdram_size - offset, chunk_size);
-        if (f_read(&fil, (void *) (ROM_ADDRESS + offset), block_size, &br) != FR_OK) {
-            f_close(&fil);
-            return FLASHCART_ERR_LOAD;
-        }
-        if (progress) {
-            progress(f_tell(&fil) / (float) (f_size(&fil)));
-        }
-    }
-    if (f_tell(&fil) != rom_size) {
+    if (fatfs_load_to_cart(&fil, ROM_ADDRESS, rom_size, LOAD_MODE_DIRECT, progress)) {
         f_close(&fil);
         return FLASHCART_ERR_LOAD;
     }
@@ -369,6 +355,7 @@ static flashcart_t flashcart_d64 = {
     .load_rom = d64_load_rom,
     .load_file = d64_load_file,
     .load_save = d64_load_save,
+    .read_save = NULL,
     .load_64dd_ipl = NULL,
     .load_64dd_disk = NULL,
     .set_save_type = d64_set_save_type,
@@ -61,7 +61,6 @@ static bool ed64_vseries_has_feature (flashcart_features_t feature) {
 
 static flashcart_err_t ed64_vseries_load_rom (char *rom_path, flashcart_progress_callback_t *progress) {
     FIL fil;
-    UINT br;
 
     if (f_open(&fil, strip_fs_prefix(rom_path), FA_READ) != FR_OK) {
         return FLASHCART_ERR_LOAD;
@@ -78,18 +77,8 @@ static flashcart_err_t ed64_vseries_load_rom (char *rom_path, flashcart_progress
 
     size_t sdram_size = rom_size; // (MiB(64) - KiB(128));
 
-    size_t chunk_size = KiB(128);
-    for (unsigned int offset = 0; offset < sdram_size; offset += chunk_size) {
-        size_t block_size = MIN(sdram_size - offset, chunk_size);
-        if (f_read(&fil, (void *) (ROM_ADDRESS + offset), block_size, &br) != FR_OK) {
-            f_close(&fil);
-            return FLASHCART_ERR_LOAD;
-        }
-        if (progress) {
-            progress(f_tell(&fil) / (float) (f_size(&fil)));
-        }
-    }
-    if (f_tell(&fil) != sdram_size) {
+    // NOTE: LOAD_MODE_STAGED only adds an RDRAM bounce, the SD interface shares the PI with the DMA.
+    if (fatfs_load_to_cart(&fil, ROM_ADDRESS, sdram_size, LOAD_MODE_DIRECT, progress)) {
         f_close(&fil);
         return FLASHCART_ERR_LOAD;
     }
@@ -157,6 +146,7 @@ static flashcart_t flashcart_ed64_vseries = {
     .load_rom = ed64_vseries_load_rom,
     .load_file = ed64_vseries_load_file,
     .load_save = ed64_vseries_load_save,
+    .read_save = NULL,
     .load_64dd_ipl = NULL,
     .load_64dd_disk = NULL,
     .set_save_type = ed64_vseries_set_save_type,
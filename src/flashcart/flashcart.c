@@ -103,6 +103,7 @@ static flashcart_t *flashcart = &((flashcart_t) {
     .load_rom = dummy_load_rom,
     .load_file = dummy_load_file,
     .load_save = dummy_load_save,
+    .read_save = NULL,
     .load_64dd_ipl = NULL,
     .load_64dd_disk = NULL,
     .set_save_type = dummy_set_save_type,
@@ -110,6 +111,9 @@ static flashcart_t *flashcart = &((flashcart_t) {
     .set_next_boot_mode = NULL,
 });
 
+static flashcart_patch_callback_t *rom_patch = NULL;
+static void *rom_patch_context = NULL;
+
 #ifdef NDEBUG
     // HACK: libdragon mocks every debug function if NDEBUG flag is enabled.
     //       Code below reverts that and point to real function instead.
@@ -233,24 +237,42 @@ flashcart_firmware_version_t flashcart_get_firmware_version (void) {
  * @brief Load a ROM into the flashcart.
  * 
  * @param rom_path Path to the ROM file.
- * @param byte_swap Flag indicating whether to byte swap the ROM.
+ * @param byte_order Byte order of the ROM file.
  * @param progress Progress callback function.
  * @return flashcart_err_t Error code.
  */
-flashcart_err_t flashcart_load_rom (char *rom_path, bool byte_swap, flashcart_progress_callback_t *progress) {
+flashcart_err_t flashcart_load_rom (char *rom_path, flashcart_byte_order_t byte_order, flashcart_progress_callback_t *progress) {
     flashcart_err_t err;
 
     if (rom_path == NULL) {
         return FLASHCART_ERR_ARGS;
     }
 
-    cart_card_byteswap = byte_swap;
+    cart_card_byteswap = (byte_order == FLASHCART_BYTE_ORDER_BYTE_SWAPPED);
+    fatfs_set_load_byte_order(byte_order);
+    fatfs_set_load_patch(rom_patch, rom_patch_context);
     err = flashcart->load_rom(rom_path, progress);
+    fatfs_set_load_patch(NULL, NULL);
+    fatfs_set_load_byte_order(FLASHCART_BYTE_ORDER_BIG);
     cart_card_byteswap = false;
 
+    rom_patch = NULL;
+    rom_patch_context = NULL;
+
     return err;
 }
 
+/**
+ * @brief Patch the ROM data of the next flashcart_load_rom call while it is loaded.
+ * 
+ * @param patch Callback function, NULL to load the ROM unmodified.
+ * @param context Context passed to the callback.
+ */
+void flashcart_set_rom_patch (flashcart_patch_callback_t *patch, void *context) {
+    rom_patch = patch;
+    rom_patch_context = context;
+}
+
 /**
  * @brief Load a file into the flashcart.
  * 
@@ -268,13 +290,14 @@ flashcart_err_t flashcart_load_file (char *file_path, uint32_t rom_offset, uint3
 }
 
 /**
- * @brief Load a save file into the flashcart.
+ * @brief Set up a save file on the flashcart.
  * 
  * @param save_path Path to the save file.
  * @param save_type The save type.
+ * @param load Copy the save data to the flashcart.
  * @return flashcart_err_t Error code.
  */
-flashcart_err_t flashcart_load_save (char *save_path, flashcart_save_type_t save_type) {
+static flashcart_err_t setup_save (char *save_path, flashcart_save_type_t save_type, bool load) {
     flashcart_err_t err;
 
     if (save_type >= __FLASHCART_SAVE_TYPE_END) {
@@ -302,7 +325,7 @@ flashcart_err_t flashcart_load_save (char *save_path, flashcart_save_type_t save
         return FLASHCART_ERR_LOAD;
     }
 
-    if ((err = flashcart->load_save(save_path)) != FLASHCART_OK) {
+    if (load && ((err = flashcart->load_save(save_path)) != FLASHCART_OK)) {
         return err;
     }
 
@@ -313,6 +336,54 @@ flashcart_err_t flashcart_load_save (char *save_path, flashcart_save_type_t save
     return flashcart->set_save_writeback(save_path);
 }
 
+/**
+ * @brief Load a save file into the flashcart.
+ * 
+ * @param save_path Path to the save file.
+ * @param save_type The save type.
+ * @return flashcart_err_t Error code.
+ */
+flashcart_err_t flashcart_load_save (char *save_path, flashcart_save_type_t save_type) {
+    return setup_save(save_path, save_type, true);
+}
+
+/**
+ * @brief Set up a save file the flashcart still holds, without copying it.
+ * 
+ * @param save_path Path to the save file.
+ * @param save_type The save type.
+ * @return flashcart_err_t Error code.
+ */
+flashcart_err_t flashcart_keep_save (char *save_path, flashcart_save_type_t save_type) {
+    return setup_save(save_path, save_type, false);
+}
+
+/**
+ * @brief Read back the save data held by the flashcart.
+ * 
+ * @param save_type The save type.
+ * @param buffer Output buffer.
+ * @param length Size of the buffer.
+ * @return flashcart_err_t Error code.
+ */
+flashcart_err_t flashcart_read_save (flashcart_save_type_t save_type, void *buffer, size_t length) {
+    flashcart_err_t err;
+
+    if ((save_type >= __FLASHCART_SAVE_TYPE_END) || (save_type == FLASHCART_SAVE_TYPE_NONE) || (length != SAVE_SIZE[save_type])) {
+        return FLASHCART_ERR_ARGS;
+    }
+
+    if (!flashcart->read_save) {
+        return FLASHCART_ERR_FUNCTION_NOT_SUPPORTED;
+    }
+
+    if ((err = flashcart->set_save_type(save_type)) != FLASHCART_OK) {
+        return err;
+    }
+
+    return flashcart->read_save(buffer, length);
+}
+
 /**
  * @brief Load the 64DD IPL into the flashcart.
  * 
@@ -375,3 +446,25 @@ flashcart_err_t flashcart_set_setting_u32 (uint32_t id, uint32_t value) {
     }
     return flashcart->set_setting_u32(id, value);
 }
+
+/**
+ * @brief Count the contiguous pieces a file occupies on the SD card.
+ * 
+ * @param path Path to the file.
+ * @return int Number of pieces, or -1 on error.
+ */
+int flashcart_get_file_fragments (char *path) {
+    FIL fil;
+
+    if (f_open(&fil, strip_fs_prefix(path), FA_READ) != FR_OK) {
+        return -1;
+    }
+
+    fatfs_fix_file_size(&fil);
+
+    int fragments = fatfs_get_file_extents(&fil, 0, f_size(&fil), NULL, 0);
+
+    f_close(&fil);
+
+    return fragments;
+}
@@ -8,8 +8,12 @@
 #define FLASHCART_H__
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
+/** @brief Files in more pieces than this are loaded through FatFs instead of multi-sector transfers */
+#define FLASHCART_FAST_LOAD_MAX_FRAGMENTS   (64)
+
 /** @brief Flashcart error enumeration */
 typedef enum {
     FLASHCART_OK, /**< No error */
@@ -48,6 +52,13 @@ typedef enum {
     __FLASHCART_SAVE_TYPE_END /**< End of save types */
 } flashcart_save_type_t;
 
+/** @brief ROM file byte order enumeration */
+typedef enum {
+    FLASHCART_BYTE_ORDER_BIG, /**< Big endian (.z64), loaded as is */
+    FLASHCART_BYTE_ORDER_BYTE_SWAPPED, /**< 16-bit byte swapped (.v64) */
+    FLASHCART_BYTE_ORDER_LITTLE, /**< 32-bit little endian (.n64) */
+} flashcart_byte_order_t;
+
 /** @brief Flashcart save type enumeration */
 typedef enum {
     /** @brief The flashcart will reboot into the menu on soft reboot (using the RESET button) */
@@ -74,6 +85,9 @@ typedef struct {
 /** @brief Flashcart progress callback type */
 typedef void flashcart_progress_callback_t (float progress);
 
+/** @brief ROM patch callback type, modifies ROM data at the given ROM offset before it reaches the cart */
+typedef void flashcart_patch_callback_t (uint8_t *buffer, uint32_t offset, size_t length, void *context);
+
 /** @brief Flashcart Structure */
 typedef struct {
     /** @brief The flashcart initialization function */
@@ -90,6 +104,8 @@ typedef struct {
     flashcart_err_t (*load_file) (char *file_path, uint32_t rom_offset, uint32_t file_offset);
     /** @brief The flashcart save file load function */
     flashcart_err_t (*load_save) (char *save_path);
+    /** @brief The flashcart save data read back function */
+    flashcart_err_t (*read_save) (void *buffer, size_t length);
     /** @brief The flashcart disk bios load function */
     flashcart_err_t (*load_64dd_ipl) (char *ipl_path, flashcart_progress_callback_t *progress);
     /** @brief The flashcart disk load function */
@@ -148,11 +164,24 @@ flashcart_firmware_version_t flashcart_get_firmware_version (void);
  * @brief Load a ROM onto the flashcart.
  * 
  * @param rom_path The path to the ROM file.
- * @param byte_swap Whether to byte swap the ROM.
+ * @param byte_order Byte order of the ROM file, converted to big endian while loading.
  * @param progress Callback function for progress updates.
  * @return flashcart_err_t Error code.
  */
-flashcart_err_t flashcart_load_rom (char *rom_path, bool byte_swap, flashcart_progress_callback_t *progress);
+flashcart_err_t flashcart_load_rom (char *rom_path, flashcart_byte_order_t byte_order, flashcart_progress_callback_t *progress);
+
+/**
+ * @brief Patch the ROM data of the next flashcart_load_rom call while it is loaded.
+ * 
+ * The ROM is then loaded through an RDRAM staging buffer on every flashcart,
+ * and the callback sees each chunk after byte order conversion. Data that
+ * bypasses the staging buffer (SC64 flash regions of ROMs larger than
+ * 64 MiB - 128 KiB) is not patched.
+ * 
+ * @param patch Callback function, NULL to load the ROM unmodified.
+ * @param context Context passed to the callback.
+ */
+void flashcart_set_rom_patch (flashcart_patch_callback_t *patch, void *context);
 
 /**
  * @brief Load a file onto the flashcart.
@@ -173,6 +202,30 @@ flashcart_err_t flashcart_load_file (char *file_path, uint32_t rom_offset, uint3
  */
 flashcart_err_t flashcart_load_save (char *save_path, flashcart_save_type_t save_type);
 
+/**
+ * @brief Set up a save file the flashcart still holds, without copying it again.
+ * 
+ * Does everything flashcart_load_save does (save type, writeback) except the
+ * copy, for when flashcart_read_save showed the data is already in place.
+ * 
+ * @param save_path The path to the save file.
+ * @param save_type The type of save.
+ * @return flashcart_err_t Error code.
+ */
+flashcart_err_t flashcart_keep_save (char *save_path, flashcart_save_type_t save_type);
+
+/**
+ * @brief Read back the save data the flashcart currently holds.
+ * 
+ * Sets the save type first. Not every flashcart can read back every save type.
+ * 
+ * @param save_type The type of save.
+ * @param buffer Output buffer, 8 byte aligned.
+ * @param length Size of the buffer, must be the size of the save type.
+ * @return flashcart_err_t Error code, FLASHCART_ERR_FUNCTION_NOT_SUPPORTED if the save can't be read back.
+ */
+flashcart_err_t flashcart_read_save (flashcart_save_type_t save_type, void *buffer, size_t length);
+
 /**
  * @brief Load the 64DD IPL (BIOS) onto the flashcart.
  * 
@@ -194,4 +247,15 @@ flashcart_err_t flashcart_set_next_boot_mode (flashcart_reboot_mode_t boot_mode)
 flashcart_err_t flashcart_get_setting_u32 (uint32_t id, uint32_t *value);
 flashcart_err_t flashcart_set_setting_u32 (uint32_t id, uint32_t value);
 
+/**
+ * @brief Count the contiguous pieces a file occupies on the SD card.
+ * 
+ * ROMs in more than FLASHCART_FAST_LOAD_MAX_FRAGMENTS pieces can't use the
+ * multi-sector load fast path.
+ * 
+ * @param path The path to the file.
+ * @return int Number of pieces, or -1 on error.
+ */
+int flashcart_get_file_fragments (char *path);
+
 #endif /* FLASHCART_H__ */
@@ -4,12 +4,25 @@
  * @ingroup flashcart
  */
 
+#include <malloc.h>
+#include <stdlib.h>
+
+#include <libcart/cart.h>
 #include <libdragon.h>
 
 #include "flashcart_utils.h"
 #include "utils/fs.h"
+#include "utils/byteswap.h"
 #include "utils/utils.h"
 
+#define LOAD_CHUNK_SIZE         (KiB(128))
+#define LOAD_STAGING_SIZE       (KiB(64))
+#define PI_ADDRESS_MASK         (0x1FFFFFFF)
+
+static flashcart_byte_order_t load_byte_order = FLASHCART_BYTE_ORDER_BIG;
+static flashcart_patch_callback_t *load_patch = NULL;
+static void *load_patch_context = NULL;
+
 /**
  * @brief Perform a DMA read operation from the PI (Peripheral Interface).
  * 
@@ -118,3 +131,246 @@ bool fatfs_get_file_sectors (char *path, uint32_t *address, address_type_t type,
 
     return error;
 }
+
+/**
+ * @brief Resolve a file range to contiguous runs of SD card sectors.
+ * 
+ * @param fil Pointer to the file object.
+ * @param offset Sector aligned offset of the range in the file.
+ * @param size Sector aligned size of the range.
+ * @param extents Array to store the runs, may be NULL to only count them.
+ * @param max_extents Size of the array, counting stops at max_extents + 1.
+ * @return int Number of runs, or -1 on error.
+ */
+int fatfs_get_file_extents (FIL *fil, FSIZE_t offset, size_t size, fatfs_extent_t *extents, int max_extents) {
+    FATFS *fs = fil->obj.fs;
+    FSIZE_t cluster_size = ((FSIZE_t) (fs->csize) * FS_SECTOR_SIZE);
+    FSIZE_t end = offset + size;
+    LBA_t next_sector = 0;
+    int count = 0;
+
+    for (FSIZE_t position = offset; position < end; ) {
+        // NOTE: Seeking into the middle of a sector makes FatFs resolve the cluster holding it
+        if (f_lseek(fil, position + (FS_SECTOR_SIZE / 2)) != FR_OK) {
+            return -1;
+        }
+
+        uint32_t cluster = fil->clust;
+
+        if ((cluster < 2) || (cluster >= fs->n_fatent)) {
+            return -1;
+        }
+
+        uint32_t cluster_offset = ((position % cluster_size) / FS_SECTOR_SIZE);
+        LBA_t sector = (fs->database + ((LBA_t) (fs->csize) * (cluster - 2)) + cluster_offset);
+        uint32_t sectors = MIN(fs->csize - cluster_offset, (end - position) / FS_SECTOR_SIZE);
+
+        if ((count == 0) || (sector != next_sector)) {
+            if (extents && (count == max_extents)) {
+                return (max_extents + 1);
+            }
+            if (extents) {
+                extents[count] = (fatfs_extent_t) { .sector = sector, .count = 0 };
+            }
+            count += 1;
+        }
+        if (extents) {
+            extents[count - 1].count += sectors;
+        }
+
+        next_sector = sector + sectors;
+        position += ((FSIZE_t) (sectors) * FS_SECTOR_SIZE);
+    }
+
+    return count;
+}
+
+/**
+ * @brief Load contiguous sector runs with multi-sector cart transfers.
+ * 
+ * @param fil Pointer to the file object, left at the end of the loaded range.
+ * @param start File offset of the first run.
+ * @param address Cart address to load to.
+ * @param extents Sector runs.
+ * @param count Number of runs.
+ * @param progress Progress callback function, may be NULL.
+ * @return true if an error occurred, false otherwise.
+ */
+static bool fatfs_load_extents (FIL *fil, FSIZE_t start, uint32_t address, fatfs_extent_t *extents, int count, flashcart_progress_callback_t *progress) {
+    uint32_t pi_address = (address & PI_ADDRESS_MASK);
+    uint32_t chunk_sectors = (LOAD_CHUNK_SIZE / FS_SECTOR_SIZE);
+    size_t loaded = 0;
+
+    for (int i = 0; i < count; i++) {
+        for (uint32_t done = 0; done < extents[i].count; ) {
+            uint32_t sectors = MIN(extents[i].count - done, chunk_sectors);
+            if (cart_card_rd_cart(pi_address + loaded, extents[i].sector + done, sectors)) {
+                return true;
+            }
+            done += sectors;
+            loaded += (sectors * FS_SECTOR_SIZE);
+            if (progress) {
+                progress((start + loaded) / (float) (f_size(fil)));
+            }
+        }
+    }
+
+    return (f_lseek(fil, start + loaded) != FR_OK);
+}
+
+/**
+ * @brief Load file data with the cart's own SD to SDRAM transfer.
+ * 
+ * @param fil Pointer to the file object.
+ * @param address Cart address to load to.
+ * @param size Number of bytes to load.
+ * @param progress Progress callback function, may be NULL.
+ * @return true if an error occurred, false otherwise.
+ */
+static bool fatfs_load_direct (FIL *fil, uint32_t address, size_t size, flashcart_progress_callback_t *progress) {
+    fatfs_extent_t extents[FLASHCART_FAST_LOAD_MAX_FRAGMENTS];
+    FSIZE_t start = f_tell(fil);
+    UINT br;
+
+    if (((start % FS_SECTOR_SIZE) == 0) && ((size % FS_SECTOR_SIZE) == 0)) {
+        int count = fatfs_get_file_extents(fil, start, size, extents, FLASHCART_FAST_LOAD_MAX_FRAGMENTS);
+
+        if ((count >= 0) && (count <= FLASHCART_FAST_LOAD_MAX_FRAGMENTS)) {
+            return fatfs_load_extents(fil, start, address, extents, count, progress);
+        }
+
+        debugf("Flashcart: File is in more than %d pieces, loading through FatFs\n", FLASHCART_FAST_LOAD_MAX_FRAGMENTS);
+
+        if (f_lseek(fil, start) != FR_OK) {
+            return true;
+        }
+    }
+
+    for (size_t offset = 0; offset < size; offset += LOAD_CHUNK_SIZE) {
+        size_t block_size = MIN(size - offset, LOAD_CHUNK_SIZE);
+        if ((f_read(fil, (void *) (address + offset), block_size, &br) != FR_OK) || (br != block_size)) {
+            return true;
+        }
+        if (progress) {
+            progress(f_tell(fil) / (float) (f_size(fil)));
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Load file data through an RDRAM bounce buffer.
+ * 
+ * Only used when the data has to change on the way: it is converted to big
+ * endian and patched in the buffer, then written to the cart with PI DMA.
+ * The SD card is driven over the PI as well, so the SD read of one chunk
+ * can't overlap the DMA of the previous one, and each chunk is written
+ * before the next is read.
+ * 
+ * @param fil Pointer to the file object.
+ * @param address Cart address to load to.
+ * @param size Number of bytes to load.
+ * @param progress Progress callback function, may be NULL.
+ * @return true if an error occurred, false otherwise.
+ */
+static bool fatfs_load_staged (FIL *fil, uint32_t address, size_t size, flashcart_progress_callback_t *progress) {
+    uint8_t *buffer;
+    bool error = false;
+    UINT br;
+
+    if (!(buffer = memalign(16, LOAD_STAGING_SIZE))) {
+        if ((load_byte_order == FLASHCART_BYTE_ORDER_LITTLE) || load_patch) {
+            return true;
+        }
+        return fatfs_load_direct(fil, address, size, progress);
+    }
+
+    uint32_t pi_address = (address & PI_ADDRESS_MASK);
+
+    // NOTE: Conversion happens here, the SD driver must deliver the file bytes as they are
+    bool byteswap = cart_card_byteswap;
+    cart_card_byteswap = false;
+
+    for (size_t offset = 0; offset < size; offset += LOAD_STAGING_SIZE) {
+        size_t block_size = MIN(size - offset, LOAD_STAGING_SIZE);
+        FSIZE_t file_offset = f_tell(fil);
+
+        if ((f_read(fil, buffer, block_size, &br) != FR_OK) || (br != block_size)) {
+            error = true;
+            break;
+        }
+
+        switch (load_byte_order) {
+            case FLASHCART_BYTE_ORDER_BYTE_SWAPPED:
+                byteswap_16(buffer, block_size);
+                break;
+            case FLASHCART_BYTE_ORDER_LITTLE:
+                byteswap_32(buffer, block_size);
+                break;
+            default:
+                break;
+        }
+
+        if (load_patch) {
+            load_patch(buffer, (uint32_t) (file_offset), block_size, load_patch_context);
+        }
+
+        pi_dma_write_data(buffer, (void *) (pi_address + offset), ALIGN(block_size, 2));
+
+        if (progress) {
+            progress(f_tell(fil) / (float) (f_size(fil)));
+        }
+    }
+
+    cart_card_byteswap = byteswap;
+
+    free(buffer);
+
+    return error;
+}
+
+/**
+ * @brief Set the byte order of the file data loaded by fatfs_load_to_cart.
+ * 
+ * @param byte_order Byte order of the file data.
+ */
+void fatfs_set_load_byte_order (flashcart_byte_order_t byte_order) {
+    load_byte_order = byte_order;
+}
+
+/**
+ * @brief Set a patch applied to the file data loaded by fatfs_load_to_cart.
+ * 
+ * @param patch Callback function, NULL to disable patching.
+ * @param context Context passed to the callback.
+ */
+void fatfs_set_load_patch (flashcart_patch_callback_t *patch, void *context) {
+    load_patch = patch;
+    load_patch_context = context;
+}
+
+/**
+ * @brief Load file data into cart memory.
+ * 
+ * @param fil Pointer to the file object, positioned at the data to load.
+ * @param address Cart address to load to.
+ * @param size Number of bytes to load.
+ * @param mode How the data reaches cart memory.
+ * @param progress Progress callback function, may be NULL.
+ * @return true if an error occurred, false otherwise.
+ */
+bool fatfs_load_to_cart (FIL *fil, uint32_t address, size_t size, load_mode_t mode, flashcart_progress_callback_t *progress) {
+    if ((load_byte_order == FLASHCART_BYTE_ORDER_LITTLE) || load_patch) {
+        mode = LOAD_MODE_STAGED;
+    }
+
+    switch (mode) {
+        case LOAD_MODE_STAGED:
+            return fatfs_load_staged(fil, address, size, progress);
+
+        case LOAD_MODE_DIRECT:
+        default:
+            return fatfs_load_direct(fil, address, size, progress);
+    }
+}
@@ -13,6 +13,8 @@
 
 #include <fatfs/ff.h>
 
+#include "flashcart.h"
+
 #define SAVE_WRITEBACK_MAX_SECTORS  (256)
 
 /**
@@ -23,6 +25,22 @@ typedef enum {
     ADDRESS_TYPE_PI,  /**< Peripheral Interface address type. */
 } address_type_t;
 
+/**
+ * @brief How file data reaches cart memory.
+ */
+typedef enum {
+    LOAD_MODE_DIRECT, /**< The cart DMAs SD sectors straight into its SDRAM. */
+    LOAD_MODE_STAGED, /**< Sectors bounce through RDRAM, for byte order conversion and patching. */
+} load_mode_t;
+
+/**
+ * @brief A run of consecutive SD card sectors.
+ */
+typedef struct {
+    uint32_t sector; /**< First sector. */
+    uint32_t count; /**< Number of sectors. */
+} fatfs_extent_t;
+
 /**
  * @brief Perform a DMA read operation from the PI (Peripheral Interface).
  * 
@@ -59,4 +77,58 @@ void fatfs_fix_file_size (FIL *fil);
  */
 bool fatfs_get_file_sectors (char *path, uint32_t *address, address_type_t address_type, uint32_t max_sectors);
 
+/**
+ * @brief Resolve a file range to contiguous runs of SD card sectors.
+ * 
+ * Moves the file read pointer.
+ * 
+ * @param fil Pointer to the file object.
+ * @param offset Sector aligned offset of the range in the file.
+ * @param size Sector aligned size of the range.
+ * @param extents Array to store the runs, may be NULL to only count them.
+ * @param max_extents Size of the array, counting stops at max_extents + 1.
+ * @return int Number of runs, or -1 on error.
+ */
+int fatfs_get_file_extents (FIL *fil, FSIZE_t offset, size_t size, fatfs_extent_t *extents, int max_extents);
+
+/**
+ * @brief Set the byte order of the file data loaded by fatfs_load_to_cart.
+ * 
+ * 16-bit swapped data is left to the SD driver (cart_card_byteswap) on direct
+ * loads, little endian data always goes through the staging buffer.
+ * 
+ * @param byte_order Byte order of the file data.
+ */
+void fatfs_set_load_byte_order (flashcart_byte_order_t byte_order);
+
+/**
+ * @brief Set a patch applied to the file data loaded by fatfs_load_to_cart.
+ * 
+ * Forces staged mode. The callback gets each staged chunk with its file
+ * offset, after byte order conversion.
+ * 
+ * @param patch Callback function, NULL to disable patching.
+ * @param context Context passed to the callback.
+ */
+void fatfs_set_load_patch (flashcart_patch_callback_t *patch, void *context);
+
+/**
+ * @brief Load file data into cart memory.
+ * 
+ * In direct mode a file made of few contiguous runs is loaded with one
+ * multi-sector cart transfer per run, anything more fragmented goes through
+ * f_read. Staged mode is a bounce path for data that has to change on the
+ * way: each chunk is read into an RDRAM buffer, converted to big endian and
+ * patched there, then written to the cart with PI DMA. It is never faster
+ * than direct mode, the SD card is driven over the PI too.
+ * 
+ * @param fil Pointer to the file object, positioned at the data to load.
+ * @param address Cart address to load to.
+ * @param size Number of bytes to load.
+ * @param mode How the data reaches cart memory.
+ * @param progress Progress callback function, may be NULL.
+ * @return true if an error occurred, false otherwise.
+ */
+bool fatfs_load_to_cart (FIL *fil, uint32_t address, size_t size, load_mode_t mode, flashcart_progress_callback_t *progress);
+
 #endif /* FLASHCART_UTILS_H__ */
@@ -380,18 +380,7 @@ static flashcart_err_t sc64_load_rom (char *rom_path, flashcart_progress_callbac
     size_t shadow_size = shadow_enabled ? MIN(rom_size - sdram_size, KiB(128)) : 0;
     size_t extended_size = extended_enabled ? rom_size - MiB(64) : 0;
 
-    size_t chunk_size = KiB(128);
-    for (unsigned int offset = 0; offset < sdram_size; offset += chunk_size) {
-        size_t block_size = MIN(sdram_size - offset, chunk_size);
-        if (f_read(&fil, (void *) (ROM_ADDRESS + offset), block_size, &br) != FR_OK) {
-            f_close(&fil);
-            return FLASHCART_ERR_LOAD;
-        }
-        if (progress) {
-            progress(f_tell(&fil) / (float) (f_size(&fil)));
-        }
-    }
-    if (f_tell(&fil) != sdram_size) {
+    if (fatfs_load_to_cart(&fil, ROM_ADDRESS, sdram_size, LOAD_MODE_DIRECT, progress)) {
         f_close(&fil);
         return FLASHCART_ERR_LOAD;
     }
@@ -534,9 +523,36 @@ static flashcart_err_t sc64_load_save (char *save_path) {
     return FLASHCART_OK;
 }
 
+static flashcart_err_t sc64_read_save (void *buffer, size_t length) {
+    void *address = NULL;
+    uint32_t value;
+
+    if (sc64_ll_get_config(CFG_ID_SAVE_TYPE, &value) != SC64_OK) {
+        return FLASHCART_ERR_INT;
+    }
+
+    switch ((sc64_save_type_t) (value)) {
+        case SAVE_TYPE_EEPROM_4KBIT:
+        case SAVE_TYPE_EEPROM_16KBIT:
+            address = (void *) (EEPROM_ADDRESS);
+            break;
+        case SAVE_TYPE_SRAM_256KBIT:
+        case SAVE_TYPE_SRAM_BANKED:
+        case SAVE_TYPE_SRAM_1MBIT:
+            address = (void *) (SRAM_FLASHRAM_ADDRESS);
+            break;
+        // NOTE: FlashRAM only returns its data after a read mode command
+        default:
+            return FLASHCART_ERR_FUNCTION_NOT_SUPPORTED;
+    }
+
+    pi_dma_read_data(address, buffer, length);
+
+    return FLASHCART_OK;
+}
+
 static flashcart_err_t sc64_load_64dd_ipl (char *ipl_path, flashcart_progress_callback_t *progress) {
     FIL fil;
-    UINT br;
 
     if (f_open(&fil, strip_fs_prefix(ipl_path), FA_READ) != FR_OK) {
         return FLASHCART_ERR_LOAD;
@@ -551,18 +567,7 @@ static flashcart_err_t sc64_load_64dd_ipl (char *ipl_path, flashcart_progress_ca
         return FLASHCART_ERR_LOAD;
     }
 
-    size_t chunk_size = KiB(128);
-    for (unsigned int offset = 0; offset < ipl_size; offset += chunk_size) {
-        size_t block_size = MIN(ipl_size - offset, chunk_size);
-        if (f_read(&fil, (void *) (IPL_ADDRESS + offset), block_size, &br) != FR_OK) {
-            f_close(&fil);
-            return FLASHCART_ERR_LOAD;
-        }
-        if (progress) {
-            progress(f_tell(&fil) / (float) (f_size(&fil)));
-        }
-    }
-    if (f_tell(&fil) != ipl_size) {
+    if (fatfs_load_to_cart(&fil, IPL_ADDRESS, ipl_size, LOAD_MODE_DIRECT, progress)) {
         f_close(&fil);
         return FLASHCART_ERR_LOAD;
     }
@@ -715,6 +720,7 @@ static flashcart_t flashcart_sc64 = {
     .load_rom = sc64_load_rom,
     .load_file = sc64_load_file,
     .load_save = sc64_load_save,
+    .read_save = sc64_read_save,
     .load_64dd_ipl = sc64_load_64dd_ipl,
     .load_64dd_disk = sc64_load_64dd_disk,
     .set_save_type = sc64_set_save_type,
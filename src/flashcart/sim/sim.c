@@ -0,0 +1,625 @@
+/**
+ * @file sim.c
+ * @brief Simulated flashcart functions implementation
+ * @ingroup flashcart
+ *
+ * Cart memory is backed by heap buffers and every transfer is charged to a
+ * simple throughput model, so the load paths can be exercised and timed on a
+ * host. The FatFs volume comes from whatever disk I/O layer is linked in
+ * (see tools/sim for an image file backed one), which also charges the SD
+ * card transfers. ROMs go through fatfs_load_to_cart like on the real carts,
+ * the PI and cart SD transfers it makes are mapped onto the SDRAM region with
+ * sim_map_pi_address.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fatfs/ff.h>
+
+#include "utils/fs.h"
+#include "utils/utils.h"
+
+#include "../flashcart_utils.h"
+#include "sim.h"
+
+#define SDRAM_SIZE                  (MiB(64))
+#define SHADOW_SIZE                 (KiB(128))
+#define EXTENDED_SIZE               (MiB(14))
+#define SAVE_MAX_SIZE               (KiB(128))
+#define IPL_SIZE                    (MiB(4))
+
+#define CHUNK_SIZE                  (KiB(128))
+
+#define DEFAULT_SD_BYTES_PER_SECOND (MiB(20))
+#define DEFAULT_PI_BYTES_PER_SECOND (MiB(5))
+
+
+static const size_t SAVE_SIZE[__FLASHCART_SAVE_TYPE_END] = {
+    0,
+    512,
+    KiB(2),
+    KiB(32),
+    KiB(96),
+    KiB(128),
+    KiB(128),
+    KiB(128),
+};
+
+static const size_t REGION_SIZE[__SIM_REGION_END] = {
+    SDRAM_SIZE,
+    SHADOW_SIZE,
+    EXTENDED_SIZE,
+    SAVE_MAX_SIZE,
+    IPL_SIZE,
+};
+
+static struct {
+    uint8_t *regions[__SIM_REGION_END];
+    sim_config_t config;
+    sim_stats_t stats;
+    flashcart_save_type_t save_type;
+    char *writeback_path;
+    uint8_t *save_synced;
+    char *save_synced_path;
+    flashcart_reboot_mode_t boot_mode;
+} sim = {
+    .config = {
+        .sd_bytes_per_second = DEFAULT_SD_BYTES_PER_SECOND,
+        .pi_bytes_per_second = DEFAULT_PI_BYTES_PER_SECOND,
+    },
+};
+
+
+/**
+ * @brief Convert a transfer size to simulated microseconds.
+ *
+ * @param bytes Transfer size.
+ * @param bytes_per_second Throughput, 0 for infinitely fast.
+ * @return uint64_t Simulated duration.
+ */
+static uint64_t transfer_us (size_t bytes, uint32_t bytes_per_second) {
+    if (bytes_per_second == 0) {
+        return 0;
+    }
+    return ((uint64_t) (bytes) * 1000000) / bytes_per_second;
+}
+
+/**
+ * @brief Read from a file into cart memory, charging the PI transfer.
+ *
+ * @param fil Pointer to the file object.
+ * @param dst Destination inside one of the cart memory regions.
+ * @param size Number of bytes to read.
+ * @param br Pointer to store the number of bytes read.
+ * @return FRESULT FatFs result code.
+ */
+static FRESULT sim_read (FIL *fil, void *dst, size_t size, UINT *br) {
+    FRESULT res = f_read(fil, dst, size, br);
+
+    sim_add_transfer(0, *br);
+
+    return res;
+}
+
+/**
+ * @brief Read a file into a region in chunks, reporting progress.
+ *
+ * @param fil Pointer to the file object.
+ * @param dst Destination address.
+ * @param size Number of bytes to read.
+ * @param progress Progress callback function.
+ * @return true if all bytes were read, false otherwise.
+ */
+static bool sim_read_chunked (FIL *fil, uint8_t *dst, size_t size, flashcart_progress_callback_t *progress) {
+    UINT br;
+
+    for (size_t offset = 0; offset < size; offset += CHUNK_SIZE) {
+        size_t block_size = MIN(size - offset, CHUNK_SIZE);
+        if ((sim_read(fil, dst + offset, block_size, &br) != FR_OK) || (br != block_size)) {
+            return false;
+        }
+        if (progress) {
+            progress(f_tell(fil) / (float) (f_size(fil)));
+        }
+    }
+
+    return true;
+}
+
+static flashcart_firmware_version_t sim_get_firmware_version (void) {
+    flashcart_firmware_version_t version_info = {
+        .major = 1,
+        .minor = 0,
+        .revision = 0,
+    };
+
+    return version_info;
+}
+
+/**
+ * @brief Set which save file the synced copy matches.
+ *
+ * The synced copy holds the save data as the file on the SD card has it, so a
+ * writeback can skip the sectors that didn't change.
+ *
+ * @param save_path Path of the save file, NULL if the copy is out of date.
+ */
+static void sim_set_save_synced (const char *save_path) {
+    char *path = save_path ? strdup(save_path) : NULL;
+
+    free(sim.save_synced_path);
+    sim.save_synced_path = path;
+}
+
+/**
+ * @brief Initialize the simulated flashcart.
+ *
+ * @return flashcart_err_t Error code.
+ */
+static flashcart_err_t sim_init (void) {
+    for (int i = 0; i < __SIM_REGION_END; i++) {
+        if (!sim.regions[i] && !(sim.regions[i] = malloc(REGION_SIZE[i]))) {
+            return FLASHCART_ERR_INT;
+        }
+        memset(sim.regions[i], 0xFF, REGION_SIZE[i]);
+    }
+
+    if (!sim.save_synced && !(sim.save_synced = malloc(SAVE_MAX_SIZE))) {
+        return FLASHCART_ERR_INT;
+    }
+    sim_set_save_synced(NULL);
+
+    sim.save_type = FLASHCART_SAVE_TYPE_NONE;
+    sim.boot_mode = FLASHCART_REBOOT_MODE_MENU;
+    sim_reset_stats();
+
+    return FLASHCART_OK;
+}
+
+/**
+ * @brief Deinitialize the simulated flashcart.
+ *
+ * @return flashcart_err_t Error code.
+ */
+static flashcart_err_t sim_deinit (void) {
+    for (int i = 0; i < __SIM_REGION_END; i++) {
+        free(sim.regions[i]);
+        sim.regions[i] = NULL;
+    }
+
+    free(sim.writeback_path);
+    sim.writeback_path = NULL;
+
+    sim_set_save_synced(NULL);
+    free(sim.save_synced);
+    sim.save_synced = NULL;
+
+    return FLASHCART_OK;
+}
+
+/**
+ * @brief Check if the simulated flashcart has a specific feature.
+ *
+ * @param feature The feature to check.
+ * @return true if the feature is supported, false otherwise.
+ */
+static bool sim_has_feature (flashcart_features_t feature) {
+    switch (feature) {
+        case FLASHCART_FEATURE_64DD: return true;
+        case FLASHCART_FEATURE_SAVE_WRITEBACK: return true;
+        default: return false;
+    }
+}
+
+/**
+ * @brief Load a ROM into the simulated flashcart.
+ *
+ * Uses the SummerCart64 memory layout: SDRAM, then the flash shadow and
+ * extended regions for ROMs larger than 64 MiB - 128 KiB. Like on the
+ * SummerCart64, only the SDRAM part goes through fatfs_load_to_cart, so byte
+ * order conversion and patches don't apply to the flash regions.
+ *
+ * @param rom_path Path to the ROM file.
+ * @param progress Progress callback function.
+ * @return flashcart_err_t Error code.
+ */
+static flashcart_err_t sim_load_rom (char *rom_path, flashcart_progress_callback_t *progress) {
+    FIL fil;
+
+    if (f_open(&fil, strip_fs_prefix(rom_path), FA_READ) != FR_OK) {
+        return FLASHCART_ERR_LOAD;
+    }
+
+    fatfs_fix_file_size(&fil);
+
+    size_t rom_size = f_size(&fil);
+
+    if (rom_size > (SDRAM_SIZE + EXTENDED_SIZE)) {
+        f_close(&fil);
+        return FLASHCART_ERR_LOAD;
+    }
+
+    bool shadow_enabled = (rom_size > (SDRAM_SIZE - SHADOW_SIZE));
+    bool extended_enabled = (rom_size > SDRAM_SIZE);
+
+    size_t sdram_size = shadow_enabled ? (SDRAM_SIZE - SHADOW_SIZE) : rom_size;
+    size_t shadow_size = shadow_enabled ? MIN(rom_size - sdram_size, SHADOW_SIZE) : 0;
+    size_t extended_size = extended_enabled ? rom_size - SDRAM_SIZE : 0;
+
+    if (fatfs_load_to_cart(&fil, SIM_ROM_ADDRESS, sdram_size, LOAD_MODE_DIRECT, progress)) {
+        f_close(&fil);
+        return FLASHCART_ERR_LOAD;
+    }
+
+    if (
+        !sim_read_chunked(&fil, sim.regions[SIM_REGION_SHADOW], shadow_size, progress) ||
+        !sim_read_chunked(&fil, sim.regions[SIM_REGION_EXTENDED], extended_size, progress)
+    ) {
+        f_close(&fil);
+        return FLASHCART_ERR_LOAD;
+    }
+
+    if (f_close(&fil) != FR_OK) {
+        return FLASHCART_ERR_LOAD;
+    }
+
+    return FLASHCART_OK;
+}
+
+/**
+ * @brief Load a file into the simulated flashcart.
+ *
+ * @param file_path Path to the file.
+ * @param rom_offset ROM offset.
+ * @param file_offset File offset.
+ * @return flashcart_err_t Error code.
+ */
+static flashcart_err_t sim_load_file (char *file_path, uint32_t rom_offset, uint32_t file_offset) {
+    FIL fil;
+    UINT br;
+
+    if (f_open(&fil, strip_fs_prefix(file_path), FA_READ) != FR_OK) {
+        return FLASHCART_ERR_LOAD;
+    }
+
+    size_t file_size = f_size(&fil) - file_offset;
+
+    if ((rom_offset > SDRAM_SIZE) || (file_size > (SDRAM_SIZE - rom_offset))) {
+        f_close(&fil);
+        return FLASHCART_ERR_ARGS;
+    }
+
+    if (f_lseek(&fil, file_offset) != FR_OK) {
+        f_close(&fil);
+        return FLASHCART_ERR_LOAD;
+    }
+
+    if ((sim_read(&fil, sim.regions[SIM_REGION_SDRAM] + rom_offset, file_size, &br) != FR_OK) || (br != file_size)) {
+        f_close(&fil);
+        return FLASHCART_ERR_LOAD;
+    }
+
+    if (f_close(&fil) != FR_OK) {
+        return FLASHCART_ERR_LOAD;
+    }
+
+    return FLASHCART_OK;
+}
+
+static flashcart_err_t sim_load_save (char *save_path) {
+    FIL fil;
+    UINT br;
+
+    if (sim.save_type == FLASHCART_SAVE_TYPE_NONE) {
+        return FLASHCART_ERR_ARGS;
+    }
+
+    if (f_open(&fil, strip_fs_prefix(save_path), FA_READ) != FR_OK) {
+        return FLASHCART_ERR_LOAD;
+    }
+
+    size_t save_size = f_size(&fil);
+
+    if (save_size > SAVE_MAX_SIZE) {
+        f_close(&fil);
+        return FLASHCART_ERR_LOAD;
+    }
+
+    if (sim_read(&fil, sim.regions[SIM_REGION_SAVE], save_size, &br) != FR_OK) {
+        f_close(&fil);
+        return FLASHCART_ERR_LOAD;
+    }
+
+    if (f_close(&fil) != FR_OK) {
+        return FLASHCART_ERR_LOAD;
+    }
+
+    if (br != save_size) {
+        return FLASHCART_ERR_LOAD;
+    }
+
+    if (save_size == SAVE_SIZE[sim.save_type]) {
+        memcpy(sim.save_synced, sim.regions[SIM_REGION_SAVE], save_size);
+        sim_set_save_synced(save_path);
+    } else {
+        sim_set_save_synced(NULL);
+    }
+
+    return FLASHCART_OK;
+}
+
+/**
+ * @brief Read back the save region of the simulated flashcart.
+ *
+ * @param buffer Output buffer.
+ * @param length Number of bytes to read.
+ * @return flashcart_err_t Error code.
+ */
+static flashcart_err_t sim_read_save (void *buffer, size_t length) {
+    if (length > SAVE_MAX_SIZE) {
+        return FLASHCART_ERR_ARGS;
+    }
+
+    memcpy(buffer, sim.regions[SIM_REGION_SAVE], length);
+
+    sim_add_transfer(0, length);
+
+    return FLASHCART_OK;
+}
+
+static flashcart_err_t sim_load_64dd_ipl (char *ipl_path, flashcart_progress_callback_t *progress) {
+    FIL fil;
+
+    if (f_open(&fil, strip_fs_prefix(ipl_path), FA_READ) != FR_OK) {
+        return FLASHCART_ERR_LOAD;
+    }
+
+    size_t ipl_size = f_size(&fil);
+
+    if (ipl_size > IPL_SIZE) {
+        f_close(&fil);
+        return FLASHCART_ERR_LOAD;
+    }
+
+    if (!sim_read_chunked(&fil, sim.regions[SIM_REGION_IPL], ipl_size, progress)) {
+        f_close(&fil);
+        return FLASHCART_ERR_LOAD;
+    }
+
+    if (f_close(&fil) != FR_OK) {
+        return FLASHCART_ERR_LOAD;
+    }
+
+    return FLASHCART_OK;
+}
+
+static flashcart_err_t sim_load_64dd_disk (char *disk_path, flashcart_disk_parameters_t *disk_parameters) {
+    FIL fil;
+
+    // NOTE: Real carts only map the disk sectors here, the image itself is read on demand
+    if (f_open(&fil, strip_fs_prefix(disk_path), FA_READ) != FR_OK) {
+        return FLASHCART_ERR_LOAD;
+    }
+
+    if (f_close(&fil) != FR_OK) {
+        return FLASHCART_ERR_LOAD;
+    }
+
+    return FLASHCART_OK;
+}
+
+static flashcart_err_t sim_set_save_type (flashcart_save_type_t save_type) {
+    if (save_type >= __FLASHCART_SAVE_TYPE_END) {
+        return FLASHCART_ERR_ARGS;
+    }
+
+    sim.save_type = save_type;
+
+    return FLASHCART_OK;
+}
+
+static flashcart_err_t sim_set_save_writeback (char *save_path) {
+    free(sim.writeback_path);
+
+    if (!(sim.writeback_path = strdup(save_path))) {
+        return FLASHCART_ERR_INT;
+    }
+
+    return FLASHCART_OK;
+}
+
+static flashcart_err_t sim_set_bootmode (flashcart_reboot_mode_t boot_mode) {
+    sim.boot_mode = boot_mode;
+
+    return FLASHCART_OK;
+}
+
+
+static flashcart_t flashcart_sim = {
+    .init = sim_init,
+    .deinit = sim_deinit,
+    .has_feature = sim_has_feature,
+    .get_firmware_version = sim_get_firmware_version,
+    .load_rom = sim_load_rom,
+    .load_file = sim_load_file,
+    .load_save = sim_load_save,
+    .read_save = sim_read_save,
+    .load_64dd_ipl = sim_load_64dd_ipl,
+    .load_64dd_disk = sim_load_64dd_disk,
+    .set_save_type = sim_set_save_type,
+    .set_save_writeback = sim_set_save_writeback,
+    .set_next_boot_mode = sim_set_bootmode,
+    .get_setting_u32 = NULL,
+    .set_setting_u32 = NULL,
+};
+
+
+flashcart_t *sim_get_flashcart (void) {
+    return &flashcart_sim;
+}
+
+/**
+ * @brief Set the simulated SD and PI throughput.
+ *
+ * @param config New transfer rates, a rate of 0 makes that link free.
+ */
+void sim_set_config (const sim_config_t *config) {
+    sim.config = *config;
+}
+
+/**
+ * @brief Get the transfer counters.
+ *
+ * The simulated load time is sd_us + pi_us. SD and PI transfers never
+ * overlap on the console, the SD card is driven over the PI too.
+ *
+ * @param stats Pointer to store the counters.
+ */
+void sim_get_stats (sim_stats_t *stats) {
+    *stats = sim.stats;
+}
+
+/**
+ * @brief Reset the transfer counters.
+ */
+void sim_reset_stats (void) {
+    memset(&sim.stats, 0, sizeof(sim.stats));
+}
+
+/**
+ * @brief Get a simulated cart memory region.
+ *
+ * @param region The region.
+ * @param size Pointer to store the region size, may be NULL.
+ * @return uint8_t* Region contents, NULL before sim_init.
+ */
+uint8_t *sim_get_region (sim_region_t region, size_t *size) {
+    if (region >= __SIM_REGION_END) {
+        return NULL;
+    }
+    if (size) {
+        *size = REGION_SIZE[region];
+    }
+    return sim.regions[region];
+}
+
+/**
+ * @brief Get the save type set by the last flashcart_load_save.
+ *
+ * @return flashcart_save_type_t The save type.
+ */
+flashcart_save_type_t sim_get_save_type (void) {
+    return sim.save_type;
+}
+
+/**
+ * @brief Check if a save sector differs from what the writeback file holds.
+ *
+ * @param offset Sector offset in the save.
+ * @param length Sector length.
+ * @return true if the sector has to be written.
+ */
+static bool sim_save_sector_dirty (size_t offset, size_t length) {
+    return !sim.save_synced_path || strcmp(sim.save_synced_path, sim.writeback_path) || memcmp(sim.regions[SIM_REGION_SAVE] + offset, sim.save_synced + offset, length);
+}
+
+/**
+ * @brief Write the save region back to the writeback file, like the cart does after a game saves.
+ *
+ * Only the 512 byte sectors that changed since the save was loaded or last
+ * written back go to the SD card.
+ *
+ * @return flashcart_err_t Error code.
+ */
+flashcart_err_t sim_flush_save (void) {
+    FIL fil;
+    UINT bw;
+
+    size_t save_size = SAVE_SIZE[sim.save_type];
+
+    if (!sim.writeback_path || (save_size == 0)) {
+        return FLASHCART_ERR_ARGS;
+    }
+
+    if (f_open(&fil, strip_fs_prefix(sim.writeback_path), FA_WRITE | FA_OPEN_EXISTING) != FR_OK) {
+        return FLASHCART_ERR_LOAD;
+    }
+
+    size_t offset = 0;
+    while (offset < save_size) {
+        if (!sim_save_sector_dirty(offset, MIN(save_size - offset, FS_SECTOR_SIZE))) {
+            offset += FS_SECTOR_SIZE;
+            continue;
+        }
+
+        // Runs of changed sectors are written with a single call
+        size_t end = offset + FS_SECTOR_SIZE;
+        while ((end < save_size) && sim_save_sector_dirty(end, MIN(save_size - end, FS_SECTOR_SIZE))) {
+            end += FS_SECTOR_SIZE;
+        }
+        end = MIN(end, save_size);
+
+        if (
+            (f_lseek(&fil, offset) != FR_OK) ||
+            (f_write(&fil, sim.regions[SIM_REGION_SAVE] + offset, end - offset, &bw) != FR_OK) ||
+            (bw != (end - offset))
+        ) {
+            f_close(&fil);
+            sim_set_save_synced(NULL);
+            return FLASHCART_ERR_LOAD;
+        }
+
+        offset = end;
+    }
+
+    if (f_close(&fil) != FR_OK) {
+        sim_set_save_synced(NULL);
+        return FLASHCART_ERR_LOAD;
+    }
+
+    memcpy(sim.save_synced, sim.regions[SIM_REGION_SAVE], save_size);
+    sim_set_save_synced(sim.writeback_path);
+
+    return FLASHCART_OK;
+}
+
+/**
+ * @brief Map a PI address onto the simulated cart memory.
+ *
+ * Only SDRAM is mapped, the flash and save regions aren't reachable over the
+ * PI on the SummerCart64 either while a ROM is loaded.
+ *
+ * @param pi_address PI address, as passed to the PI DMA functions.
+ * @param length Number of bytes accessed.
+ * @return uint8_t* Host pointer to the cart memory, NULL if the range isn't mapped.
+ */
+uint8_t *sim_map_pi_address (uint32_t pi_address, size_t length) {
+    if (!sim.regions[SIM_REGION_SDRAM] || (pi_address < SIM_ROM_ADDRESS)) {
+        return NULL;
+    }
+
+    size_t offset = pi_address - SIM_ROM_ADDRESS;
+
+    if ((offset > SDRAM_SIZE) || (length > (SDRAM_SIZE - offset))) {
+        return NULL;
+    }
+
+    return sim.regions[SIM_REGION_SDRAM] + offset;
+}
+
+/**
+ * @brief Charge a transfer to the throughput model.
+ *
+ * @param sd_bytes Bytes read from or written to the SD card.
+ * @param pi_bytes Bytes moved over the PI.
+ */
+void sim_add_transfer (size_t sd_bytes, size_t pi_bytes) {
+    sim.stats.sd_bytes += sd_bytes;
+    sim.stats.sd_us += transfer_us(sd_bytes, sim.config.sd_bytes_per_second);
+    sim.stats.pi_bytes += pi_bytes;
+    sim.stats.pi_us += transfer_us(pi_bytes, sim.config.pi_bytes_per_second);
+}
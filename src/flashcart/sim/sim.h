@@ -0,0 +1,63 @@
+/**
+ * @file sim.h
+ * @brief Simulated flashcart for host-side testing
+ * @ingroup flashcart
+ */
+
+#ifndef FLASHCART_SIM_H__
+#define FLASHCART_SIM_H__
+
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../flashcart.h"
+
+
+/**
+ * @addtogroup sim
+ * @{
+ */
+
+/** @brief Simulated transfer rates. */
+typedef struct {
+    uint32_t sd_bytes_per_second; /**< SD card read/write throughput */
+    uint32_t pi_bytes_per_second; /**< PI DMA throughput into cart memory */
+} sim_config_t;
+
+/** @brief Transfer counters accumulated since the last sim_reset_stats(). */
+typedef struct {
+    uint64_t sd_bytes; /**< Bytes read from or written to the SD card */
+    uint64_t pi_bytes; /**< Bytes moved into cart memory */
+    uint64_t sd_us; /**< Simulated time spent on the SD card */
+    uint64_t pi_us; /**< Simulated time spent on PI DMA */
+} sim_stats_t;
+
+/** @brief Simulated cart memory regions. */
+typedef enum {
+    SIM_REGION_SDRAM, /**< ROM SDRAM, 64 MiB */
+    SIM_REGION_SHADOW, /**< Flash shadowing the last 128 KiB of SDRAM */
+    SIM_REGION_EXTENDED, /**< Flash holding ROM data past 64 MiB */
+    SIM_REGION_SAVE, /**< SRAM/FlashRAM/EEPROM backing storage */
+    SIM_REGION_IPL, /**< 64DD IPL area */
+    __SIM_REGION_END
+} sim_region_t;
+
+/** @brief PI address of the SDRAM region, where ROMs are loaded. */
+#define SIM_ROM_ADDRESS     (0x10000000)
+
+flashcart_t *sim_get_flashcart (void);
+
+void sim_set_config (const sim_config_t *config);
+void sim_get_stats (sim_stats_t *stats);
+void sim_reset_stats (void);
+uint8_t *sim_get_region (sim_region_t region, size_t *size);
+flashcart_save_type_t sim_get_save_type (void);
+flashcart_err_t sim_flush_save (void);
+uint8_t *sim_map_pi_address (uint32_t pi_address, size_t length);
+void sim_add_transfer (size_t sd_bytes, size_t pi_bytes);
+
+/** @} */ /* sim */
+
+
+#endif
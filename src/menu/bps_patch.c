@@ -0,0 +1,353 @@
+/**
+ * @file bps_patch.c
+ * @brief Streaming BPS patch decoder
+ * @ingroup menu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libdragon.h>
+#include <miniz.h>
+
+#include "bps_patch.h"
+#include "utils/utils.h"
+
+#define BPS_PATCH_BUFFER_SIZE   (16 * 1024)
+#define BPS_FOOTER_SIZE         (12)
+
+typedef enum {
+    BPS_SOURCE_READ,
+    BPS_TARGET_READ,
+    BPS_SOURCE_COPY,
+    BPS_TARGET_COPY,
+} bps_action_t;
+
+struct bps_patch_s {
+    FILE *patch;
+    uint32_t patch_size;
+    uint8_t patch_buffer[BPS_PATCH_BUFFER_SIZE];
+    uint32_t patch_buffer_offset;
+    uint32_t patch_buffer_length;
+    uint32_t patch_position;
+    uint32_t patch_crc;
+
+    patch_source_t source;
+
+    patch_target_reader_t *target_reader;
+    void *target_context;
+
+    uint32_t source_size;
+    uint32_t target_size;
+    uint32_t source_crc32;
+    uint32_t target_crc32;
+    uint32_t patch_crc32;
+    uint32_t target_crc;
+
+    uint32_t output_offset;
+    int64_t source_relative_offset;
+    int64_t target_relative_offset;
+    bps_action_t action;
+    uint32_t remaining;
+    bool error;
+};
+
+static uint32_t read_u32_le(const uint8_t *p) {
+    return ((uint32_t)p[0]) | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// The patch CRC covers everything but its own field, hashed as the file is read.
+static bool patch_refill(bps_patch_t *bps) {
+    bps->patch_buffer_offset += bps->patch_buffer_length;
+    size_t n = fread(bps->patch_buffer, 1, BPS_PATCH_BUFFER_SIZE, bps->patch);
+    if (n == 0) {
+        bps->patch_buffer_length = 0;
+        return false;
+    }
+    bps->patch_buffer_length = (uint32_t)n;
+
+    uint32_t crc_end = bps->patch_size - 4;
+    if (bps->patch_buffer_offset < crc_end) {
+        size_t crc_length = MIN((size_t)(crc_end - bps->patch_buffer_offset), n);
+        bps->patch_crc = (uint32_t)mz_crc32(bps->patch_crc, bps->patch_buffer, crc_length);
+    }
+    return true;
+}
+
+static bool patch_read(bps_patch_t *bps, uint8_t *data, size_t length) {
+    while (length > 0) {
+        if (bps->patch_position == bps->patch_buffer_offset + bps->patch_buffer_length) {
+            if (!patch_refill(bps)) {
+                return false;
+            }
+        }
+        uint32_t index = bps->patch_position - bps->patch_buffer_offset;
+        size_t n = MIN(length, (size_t)(bps->patch_buffer_length - index));
+        memcpy(data, bps->patch_buffer + index, n);
+        bps->patch_position += (uint32_t)n;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+static bool patch_read_number(bps_patch_t *bps, uint64_t *value) {
+    uint64_t data = 0;
+    uint64_t shift = 1;
+    while (true) {
+        uint8_t x;
+        if (!patch_read(bps, &x, 1)) {
+            return false;
+        }
+        data += (x & 0x7F) * shift;
+        if (x & 0x80) {
+            break;
+        }
+        if (shift > (1ULL << 48)) {
+            return false;
+        }
+        shift <<= 7;
+        data += shift;
+    }
+    *value = data;
+    return true;
+}
+
+static bool source_read(bps_patch_t *bps, int64_t offset, uint8_t *data, size_t length) {
+    if (offset < 0 || (uint64_t)offset + length > bps->source_size) {
+        return false;
+    }
+    return patch_source_read(&bps->source, offset, data, length);
+}
+
+// Copies can overlap their own output (runs), so bytes produced by this call are copied one at a time.
+static bool target_copy(bps_patch_t *bps, uint8_t *buffer, uint32_t start, size_t produced, size_t length) {
+    while (length > 0) {
+        uint32_t from = (uint32_t)bps->target_relative_offset;
+        if (from < start) {
+            size_t n = MIN(length, (size_t)(start - from));
+            if (!bps->target_reader || !bps->target_reader(bps->target_context, from, buffer + produced, n)) {
+                return false;
+            }
+            produced += n;
+            length -= n;
+            bps->target_relative_offset += n;
+        } else {
+            uint8_t *src = buffer + (from - start);
+            uint8_t *dst = buffer + produced;
+            for (size_t i = 0; i < length; i++) {
+                dst[i] = src[i];
+            }
+            bps->target_relative_offset += length;
+            length = 0;
+        }
+    }
+    return true;
+}
+
+static bool read_action(bps_patch_t *bps) {
+    if (bps->patch_position >= bps->patch_size - BPS_FOOTER_SIZE) {
+        return false;
+    }
+
+    uint64_t data;
+    if (!patch_read_number(bps, &data) || (data >> 2) >= UINT32_MAX) {
+        return false;
+    }
+    bps->action = (bps_action_t)(data & 3);
+    bps->remaining = (uint32_t)(data >> 2) + 1;
+
+    if (bps->action == BPS_SOURCE_COPY || bps->action == BPS_TARGET_COPY) {
+        uint64_t delta;
+        if (!patch_read_number(bps, &delta)) {
+            return false;
+        }
+        int64_t offset = (int64_t)(delta >> 1);
+        if (delta & 1) {
+            offset = -offset;
+        }
+        if (bps->action == BPS_SOURCE_COPY) {
+            bps->source_relative_offset += offset;
+        } else {
+            bps->target_relative_offset += offset;
+            if (bps->target_relative_offset < 0 || bps->target_relative_offset >= bps->output_offset) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bps_patch_t *bps_patch_open(const char *patch_path, const char *source_path, rom_endianness_t endianness) {
+    bps_patch_t *bps = calloc(1, sizeof(bps_patch_t));
+    if (!bps) {
+        return NULL;
+    }
+    bps->patch_crc = MZ_CRC32_INIT;
+    bps->target_crc = MZ_CRC32_INIT;
+
+    bps->patch = fopen(patch_path, "rb");
+    if (!bps->patch || !patch_source_open(&bps->source, source_path, endianness)) {
+        bps_patch_close(bps);
+        return NULL;
+    }
+
+    uint8_t footer[BPS_FOOTER_SIZE];
+    long patch_size;
+    if (
+        fseek(bps->patch, 0, SEEK_END) != 0 ||
+        (patch_size = ftell(bps->patch)) < 4 + 3 + BPS_FOOTER_SIZE ||
+        fseek(bps->patch, patch_size - BPS_FOOTER_SIZE, SEEK_SET) != 0 ||
+        fread(footer, 1, sizeof(footer), bps->patch) != sizeof(footer) ||
+        fseek(bps->patch, 0, SEEK_SET) != 0
+    ) {
+        bps_patch_close(bps);
+        return NULL;
+    }
+    bps->patch_size = (uint32_t)patch_size;
+    bps->source_crc32 = read_u32_le(footer);
+    bps->target_crc32 = read_u32_le(footer + 4);
+    bps->patch_crc32 = read_u32_le(footer + 8);
+
+    uint8_t magic[4];
+    uint64_t source_size;
+    uint64_t target_size;
+    uint64_t metadata_size;
+    if (
+        !patch_read(bps, magic, sizeof(magic)) ||
+        memcmp(magic, "BPS1", sizeof(magic)) != 0 ||
+        !patch_read_number(bps, &source_size) ||
+        !patch_read_number(bps, &target_size) ||
+        !patch_read_number(bps, &metadata_size) ||
+        source_size > UINT32_MAX ||
+        target_size > UINT32_MAX ||
+        metadata_size > bps->patch_size
+    ) {
+        debugf("BPS patch: invalid header in %s\n", patch_path);
+        bps_patch_close(bps);
+        return NULL;
+    }
+    bps->source_size = (uint32_t)source_size;
+    bps->target_size = (uint32_t)target_size;
+
+    // Metadata is free-form XML, nothing here needs it.
+    while (metadata_size > 0) {
+        uint8_t skip[64];
+        size_t n = MIN((size_t)metadata_size, sizeof(skip));
+        if (!patch_read(bps, skip, n)) {
+            bps_patch_close(bps);
+            return NULL;
+        }
+        metadata_size -= n;
+    }
+
+    return bps;
+}
+
+void bps_patch_close(bps_patch_t *bps) {
+    if (!bps) {
+        return;
+    }
+    if (bps->patch) {
+        fclose(bps->patch);
+    }
+    patch_source_close(&bps->source);
+    free(bps);
+}
+
+uint32_t bps_patch_source_size(const bps_patch_t *bps) {
+    return bps->source_size;
+}
+
+uint32_t bps_patch_target_size(const bps_patch_t *bps) {
+    return bps->target_size;
+}
+
+uint32_t bps_patch_source_crc32(const bps_patch_t *bps) {
+    return bps->source_crc32;
+}
+
+void bps_patch_set_source_window(bps_patch_t *bps, const uint8_t *window, uint32_t offset, size_t length) {
+    patch_source_set_window(&bps->source, window, offset, length);
+}
+
+void bps_patch_set_target_reader(bps_patch_t *bps, patch_target_reader_t *reader, void *context) {
+    bps->target_reader = reader;
+    bps->target_context = context;
+}
+
+bool bps_patch_decode(bps_patch_t *bps, uint8_t *buffer, size_t length) {
+    if (bps->error || length > bps->target_size - bps->output_offset) {
+        bps->error = true;
+        return false;
+    }
+
+    uint32_t start = bps->output_offset;
+    size_t produced = 0;
+    while (produced < length) {
+        if (bps->remaining == 0 && !read_action(bps)) {
+            bps->error = true;
+            return false;
+        }
+
+        size_t n = MIN((size_t)bps->remaining, length - produced);
+        bool ok = true;
+        switch (bps->action) {
+            case BPS_SOURCE_READ:
+                ok = source_read(bps, bps->output_offset, buffer + produced, n);
+                break;
+            case BPS_TARGET_READ:
+                ok = patch_read(bps, buffer + produced, n);
+                break;
+            case BPS_SOURCE_COPY:
+                ok = source_read(bps, bps->source_relative_offset, buffer + produced, n);
+                bps->source_relative_offset += n;
+                break;
+            case BPS_TARGET_COPY:
+                ok = target_copy(bps, buffer, start, produced, n);
+                break;
+        }
+        if (!ok) {
+            bps->error = true;
+            return false;
+        }
+
+        produced += n;
+        bps->output_offset += (uint32_t)n;
+        bps->remaining -= (uint32_t)n;
+    }
+
+    bps->target_crc = (uint32_t)mz_crc32(bps->target_crc, buffer, length);
+    return true;
+}
+
+bool bps_patch_finish(bps_patch_t *bps) {
+    if (
+        bps->error ||
+        bps->remaining != 0 ||
+        bps->output_offset != bps->target_size ||
+        bps->patch_position != bps->patch_size - BPS_FOOTER_SIZE
+    ) {
+        debugf("BPS patch: actions don't add up to the target\n");
+        return false;
+    }
+
+    // Pulls the rest of the hashed footer through the patch CRC.
+    uint8_t footer[8];
+    if (!patch_read(bps, footer, sizeof(footer))) {
+        return false;
+    }
+
+    if (bps->patch_crc != bps->patch_crc32) {
+        debugf("BPS patch: patch crc32 mismatch (%08lX expected %08lX)\n",
+            (unsigned long)bps->patch_crc, (unsigned long)bps->patch_crc32);
+        return false;
+    }
+    if (bps->target_crc != bps->target_crc32) {
+        debugf("BPS patch: target crc32 mismatch (%08lX expected %08lX)\n",
+            (unsigned long)bps->target_crc, (unsigned long)bps->target_crc32);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,85 @@
+/**
+ * @file bps_patch.h
+ * @brief Streaming BPS patch decoder
+ * @ingroup menu
+ */
+
+#ifndef BPS_PATCH_H__
+#define BPS_PATCH_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "patch_source.h"
+#include "rom_info.h"
+
+/** @brief Decoder state of an open BPS patch. */
+typedef struct bps_patch_s bps_patch_t;
+
+/**
+ * @brief Open a BPS patch and its source ROM.
+ *
+ * Reads the header and the checksums in the footer. The source ROM is read
+ * on demand and converted to big endian (.z64) on the way.
+ *
+ * @param patch_path Path of the .bps file
+ * @param source_path Path of the source ROM
+ * @param endianness Byte order of the source ROM file
+ * @return Decoder, or NULL if a file can't be read or isn't a BPS patch
+ */
+bps_patch_t *bps_patch_open(const char *patch_path, const char *source_path, rom_endianness_t endianness);
+
+/**
+ * @brief Close a BPS patch.
+ */
+void bps_patch_close(bps_patch_t *bps);
+
+/** @brief Size of the source ROM the patch applies to. */
+uint32_t bps_patch_source_size(const bps_patch_t *bps);
+
+/** @brief Size of the patched ROM. */
+uint32_t bps_patch_target_size(const bps_patch_t *bps);
+
+/** @brief CRC32 of the source ROM the patch applies to. */
+uint32_t bps_patch_source_crc32(const bps_patch_t *bps);
+
+/**
+ * @brief Serve source reads in a range from memory instead of the source file.
+ *
+ * @param bps Decoder
+ * @param window Big endian source data, must stay valid until replaced
+ * @param offset Source offset of the data
+ * @param length Length of the data, 0 to disable
+ */
+void bps_patch_set_source_window(bps_patch_t *bps, const uint8_t *window, uint32_t offset, size_t length);
+
+/**
+ * @brief Set where target data from earlier decode calls is read back from.
+ *
+ * Needed for TargetCopy actions that reach further back than the current
+ * bps_patch_decode call.
+ */
+void bps_patch_set_target_reader(bps_patch_t *bps, patch_target_reader_t *reader, void *context);
+
+/**
+ * @brief Produce the next bytes of the patched ROM.
+ *
+ * @param bps Decoder
+ * @param buffer Output buffer
+ * @param length Number of bytes, the target must have that many left
+ * @return true on success, false on malformed patches or read errors
+ */
+bool bps_patch_decode(bps_patch_t *bps, uint8_t *buffer, size_t length);
+
+/**
+ * @brief Check that the whole target was produced and matches the patch.
+ *
+ * Verifies the target and patch CRC32. The source CRC32 is left to the
+ * caller, which reads the source in order where the decoder doesn't.
+ *
+ * @return true if the patched ROM is complete and correct
+ */
+bool bps_patch_finish(bps_patch_t *bps);
+
+#endif /* BPS_PATCH_H__ */
@@ -4,8 +4,14 @@
  * @ingroup menu
  */
 
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <libdragon.h>
+#include <miniz.h>
+#include <mini.c/src/mini.h>
 #include "cart_load.h"
 #include "path.h"
 #include "rom_patch.h"
@@ -19,6 +25,35 @@
 #define EMU_LOCATION            "/menu/emulators"
 #endif
 
+#define LAST_ROM_FILE           "/menu/last_rom.ini"
+#define LAST_ROM_CART_ADDRESS   (0x10000000)
+#define LAST_ROM_MAX_SIZE       (MiB(64) - KiB(128))
+#define LAST_ROM_SAMPLES        (64)
+#define LAST_ROM_SAMPLE_SIZE    (512)
+
+#define LAST_SAVE_FILE          "/menu/last_save.ini"
+#define LAST_SAVE_MAX_SIZE      (KiB(128))
+#define LAST_SAVE_CHUNK_SIZE    (KiB(16))
+
+/** @brief What was in cart SDRAM after the last ROM load. */
+typedef struct {
+    char path[512];
+    int64_t size;
+    int64_t mtime;
+    char patch_profile[96];
+    flashcart_byte_order_t byte_order;
+    uint32_t fingerprint;
+} last_rom_t;
+
+/** @brief What was in cart save memory after the last save load. */
+typedef struct {
+    char path[512];
+    int64_t size;
+    int64_t mtime;
+    flashcart_save_type_t save_type;
+    uint32_t crc32;
+} last_save_t;
+
 /**
  * @brief Check if the 64DD is connected.
  * 
@@ -64,6 +99,358 @@ static flashcart_save_type_t convert_save_type (rom_save_type_t save_type) {
     }
 }
 
+/**
+ * @brief Describe a ROM file as it is about to be loaded.
+ * 
+ * @param menu Pointer to the menu structure.
+ * @param rom_path Path of the file that goes to SDRAM (the patched copy when patching).
+ * @param byte_order Byte order of the file.
+ * @param rom Pointer to store the description, without a fingerprint.
+ * @return true if the file could be described, false otherwise.
+ */
+static bool last_rom_describe (menu_t *menu, const char *rom_path, flashcart_byte_order_t byte_order, last_rom_t *rom) {
+    struct stat st;
+
+    if (stat(rom_path, &st) != 0) {
+        return false;
+    }
+
+    memset(rom, 0, sizeof(*rom));
+    snprintf(rom->path, sizeof(rom->path), "%s", rom_path);
+    rom->size = st.st_size;
+    rom->mtime = st.st_mtime;
+    if (menu->load.rom_info.settings.patches_enabled) {
+        snprintf(rom->patch_profile, sizeof(rom->patch_profile), "%s", menu->load.rom_info.settings.patch_profile);
+    }
+    rom->byte_order = byte_order;
+
+    return true;
+}
+
+/**
+ * @brief Hash evenly spaced samples of the ROM currently in cart SDRAM.
+ * 
+ * @param size Size of the loaded ROM.
+ * @return uint32_t CRC32 of the size and the samples.
+ */
+static uint32_t last_rom_fingerprint (int64_t size) {
+    uint8_t sample[LAST_ROM_SAMPLE_SIZE] __attribute__((aligned(16)));
+    uint32_t span = (uint32_t) (MIN(size, (int64_t) (LAST_ROM_MAX_SIZE)));
+    uint32_t crc = (uint32_t) mz_crc32(MZ_CRC32_INIT, (const uint8_t *) (&span), sizeof(span));
+
+    for (int i = 0; i < LAST_ROM_SAMPLES; i++) {
+        uint32_t offset = 0;
+        if (span > LAST_ROM_SAMPLE_SIZE) {
+            offset = (uint32_t) (((uint64_t) (span - LAST_ROM_SAMPLE_SIZE) * i) / (LAST_ROM_SAMPLES - 1)) & ~0x7;
+        }
+        uint32_t length = MIN(span - offset, (uint32_t) (LAST_ROM_SAMPLE_SIZE));
+        dma_read(sample, LAST_ROM_CART_ADDRESS + offset, length);
+        crc = (uint32_t) mz_crc32(crc, sample, length);
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Forget the last loaded ROM, before anything else is written to cart SDRAM.
+ * 
+ * @param menu Pointer to the menu structure.
+ */
+static void last_rom_clear (menu_t *menu) {
+    path_t *path = path_init(menu->storage_prefix, LAST_ROM_FILE);
+    remove(path_get(path));
+    path_free(path);
+}
+
+/**
+ * @brief Remember the ROM that was just loaded into cart SDRAM.
+ * 
+ * @param menu Pointer to the menu structure.
+ * @param rom Description of the loaded ROM.
+ */
+static void last_rom_save (menu_t *menu, last_rom_t *rom) {
+    path_t *path = path_init(menu->storage_prefix, LAST_ROM_FILE);
+    mini_t *ini = mini_create(path_get(path));
+
+    mini_set_string(ini, "last_rom", "path", rom->path);
+    mini_set_int(ini, "last_rom", "size", (int) (rom->size));
+    mini_set_int(ini, "last_rom", "mtime", (int) (rom->mtime));
+    mini_set_string(ini, "last_rom", "patch_profile", rom->patch_profile);
+    mini_set_int(ini, "last_rom", "byte_order", rom->byte_order);
+    mini_set_int(ini, "last_rom", "fingerprint", (int) (rom->fingerprint));
+    mini_save_safe(ini, MINI_FLAGS_SKIP_EMPTY_GROUPS);
+
+    mini_free(ini);
+    path_free(path);
+}
+
+/**
+ * @brief Check whether cart SDRAM still holds exactly the ROM about to be loaded.
+ * 
+ * Only ROMs that fit in SDRAM are considered: larger ones also need the
+ * flash regions enabled, which happens as part of the load.
+ * 
+ * @param menu Pointer to the menu structure.
+ * @param rom Description of the ROM about to be loaded.
+ * @return true if the load can be skipped, false otherwise.
+ */
+static bool last_rom_is_loaded (menu_t *menu, last_rom_t *rom) {
+    if (rom->size > LAST_ROM_MAX_SIZE) {
+        return false;
+    }
+
+    path_t *path = path_init(menu->storage_prefix, LAST_ROM_FILE);
+    mini_t *ini = file_exists(path_get(path)) ? mini_try_load_safe(path_get(path)) : NULL;
+    path_free(path);
+
+    if (!ini) {
+        return false;
+    }
+
+    bool match = (
+        (strcmp(mini_get_string(ini, "last_rom", "path", ""), rom->path) == 0) &&
+        (mini_get_int(ini, "last_rom", "size", -1) == rom->size) &&
+        (mini_get_int(ini, "last_rom", "mtime", -1) == (int) (rom->mtime)) &&
+        (strcmp(mini_get_string(ini, "last_rom", "patch_profile", ""), rom->patch_profile) == 0) &&
+        (mini_get_int(ini, "last_rom", "byte_order", -1) == (int) (rom->byte_order))
+    );
+    uint32_t fingerprint = (uint32_t) (mini_get_int(ini, "last_rom", "fingerprint", 0));
+
+    mini_free(ini);
+
+    return match && (last_rom_fingerprint(rom->size) == fingerprint);
+}
+
+/**
+ * @brief Describe the save file about to be loaded.
+ * 
+ * @param save_path Path to the save file.
+ * @param save_type The save type.
+ * @param save Pointer to store the description.
+ * @return true if the save file exists, false otherwise.
+ */
+static bool last_save_describe (const char *save_path, flashcart_save_type_t save_type, last_save_t *save) {
+    struct stat st;
+
+    if (stat(save_path, &st) != 0) {
+        return false;
+    }
+
+    memset(save, 0, sizeof(*save));
+    snprintf(save->path, sizeof(save->path), "%s", save_path);
+    save->size = st.st_size;
+    save->mtime = st.st_mtime;
+    save->save_type = save_type;
+
+    return true;
+}
+
+/**
+ * @brief Hash the save data the flashcart currently holds.
+ * 
+ * @param save Description of the save.
+ * @param crc Pointer to store the CRC32.
+ * @return true if the flashcart could read the save back, false otherwise.
+ */
+static bool last_save_cart_crc32 (last_save_t *save, uint32_t *crc) {
+    if ((save->size <= 0) || (save->size > LAST_SAVE_MAX_SIZE)) {
+        return false;
+    }
+
+    uint8_t *buffer = memalign(16, save->size);
+    if (!buffer) {
+        return false;
+    }
+
+    bool ok = (flashcart_read_save(save->save_type, buffer, save->size) == FLASHCART_OK);
+    if (ok) {
+        *crc = (uint32_t) (mz_crc32(MZ_CRC32_INIT, buffer, save->size));
+    }
+
+    free(buffer);
+
+    return ok;
+}
+
+/**
+ * @brief Hash the save file on the SD card.
+ * 
+ * @param save Description of the save.
+ * @param crc Pointer to store the CRC32.
+ * @return true if the whole file was read, false otherwise.
+ */
+static bool last_save_file_crc32 (last_save_t *save, uint32_t *crc) {
+    FILE *f = fopen(save->path, "rb");
+    if (!f) {
+        return false;
+    }
+
+    uint8_t *buffer = malloc(LAST_SAVE_CHUNK_SIZE);
+    int64_t total = 0;
+    size_t n;
+
+    *crc = MZ_CRC32_INIT;
+    while (buffer && ((n = fread(buffer, 1, LAST_SAVE_CHUNK_SIZE, f)) > 0)) {
+        *crc = (uint32_t) (mz_crc32(*crc, buffer, n));
+        total += n;
+    }
+
+    free(buffer);
+    fclose(f);
+
+    return buffer && (total == save->size);
+}
+
+/**
+ * @brief Forget the last loaded save, before the cart save memory is overwritten.
+ * 
+ * @param menu Pointer to the menu structure.
+ */
+static void last_save_clear (menu_t *menu) {
+    path_t *path = path_init(menu->storage_prefix, LAST_SAVE_FILE);
+    remove(path_get(path));
+    path_free(path);
+}
+
+/**
+ * @brief Write the description of the save the cart save memory holds.
+ * 
+ * @param menu Pointer to the menu structure.
+ * @param save Description of the save, with the CRC32 of its data.
+ */
+static void last_save_write (menu_t *menu, last_save_t *save) {
+    path_t *path = path_init(menu->storage_prefix, LAST_SAVE_FILE);
+    mini_t *ini = mini_create(path_get(path));
+
+    mini_set_string(ini, "last_save", "path", save->path);
+    mini_set_int(ini, "last_save", "size", (int) (save->size));
+    mini_set_int(ini, "last_save", "mtime", (int) (save->mtime));
+    mini_set_int(ini, "last_save", "save_type", save->save_type);
+    mini_set_int(ini, "last_save", "crc32", (int) (save->crc32));
+    mini_save_safe(ini, MINI_FLAGS_SKIP_EMPTY_GROUPS);
+
+    mini_free(ini);
+    path_free(path);
+}
+
+/**
+ * @brief Remember the save that was just loaded, if the flashcart reads it back intact.
+ * 
+ * Reading back is compared against the file, so a flashcart that returns
+ * something other than the loaded data never gets a load skipped.
+ * 
+ * @param menu Pointer to the menu structure.
+ * @param save Description of the loaded save.
+ */
+static void last_save_record (menu_t *menu, last_save_t *save) {
+    uint32_t file_crc;
+
+    if (!last_save_cart_crc32(save, &save->crc32) || !last_save_file_crc32(save, &file_crc) || (file_crc != save->crc32)) {
+        return;
+    }
+
+    last_save_write(menu, save);
+}
+
+/**
+ * @brief Check whether the cart save memory still holds exactly the save about to be loaded.
+ * 
+ * The save file is only trusted to be unchanged while its size and mtime
+ * are. Save writeback goes straight to the file sectors and leaves the
+ * mtime alone, but then also changes the cart contents and the hash. When
+ * the cart or the mtime no longer match the record, the file is hashed as
+ * well: if both still hold the same data the save is kept and the record
+ * updated.
+ * 
+ * @param menu Pointer to the menu structure.
+ * @param save Description of the save about to be loaded.
+ * @return true if the load can be skipped, false otherwise.
+ */
+static bool last_save_is_loaded (menu_t *menu, last_save_t *save) {
+    path_t *path = path_init(menu->storage_prefix, LAST_SAVE_FILE);
+    mini_t *ini = file_exists(path_get(path)) ? mini_try_load_safe(path_get(path)) : NULL;
+    path_free(path);
+
+    if (!ini) {
+        return false;
+    }
+
+    bool same_save = (
+        (strcmp(mini_get_string(ini, "last_save", "path", ""), save->path) == 0) &&
+        (mini_get_int(ini, "last_save", "size", -1) == save->size) &&
+        (mini_get_int(ini, "last_save", "save_type", -1) == (int) (save->save_type))
+    );
+    bool same_mtime = (mini_get_int(ini, "last_save", "mtime", -1) == (int) (save->mtime));
+    uint32_t crc = (uint32_t) (mini_get_int(ini, "last_save", "crc32", 0));
+
+    mini_free(ini);
+
+    if (!same_save || !last_save_cart_crc32(save, &save->crc32)) {
+        return false;
+    }
+
+    if (same_mtime && (save->crc32 == crc)) {
+        return true;
+    }
+
+    uint32_t file_crc;
+    if (!last_save_file_crc32(save, &file_crc) || (file_crc != save->crc32)) {
+        return false;
+    }
+
+    debugf("Cart load: %s changed, but matches save memory, updating the record\n", save->path);
+    last_save_write(menu, save);
+
+    return true;
+}
+
+/**
+ * @brief Load a save file, unless the flashcart still holds it from the previous launch.
+ * 
+ * @param menu Pointer to the menu structure.
+ * @param save_path Path to the save file.
+ * @param save_type The save type.
+ * @return flashcart_err_t Error code.
+ */
+static flashcart_err_t load_save (menu_t *menu, char *save_path, flashcart_save_type_t save_type) {
+    last_save_t last_save;
+    bool last_save_known = (
+        menu->settings.save_reload_skip_enabled &&
+        (save_type != FLASHCART_SAVE_TYPE_NONE) &&
+        last_save_describe(save_path, save_type, &last_save)
+    );
+
+    if (last_save_known && last_save_is_loaded(menu, &last_save)) {
+        debugf("Cart load: %s is already in save memory, skipping save load\n", save_path);
+        return flashcart_keep_save(save_path, save_type);
+    }
+
+    if (menu->settings.save_reload_skip_enabled) {
+        last_save_clear(menu);
+    }
+
+    flashcart_err_t err = flashcart_load_save(save_path, save_type);
+    if ((err == FLASHCART_OK) && last_save_known) {
+        last_save_record(menu, &last_save);
+    }
+
+    return err;
+}
+
+/**
+ * @brief Convert the ROM file endianness to the flashcart byte order.
+ * 
+ * @param endianness The ROM file endianness.
+ * @return flashcart_byte_order_t The flashcart byte order.
+ */
+static flashcart_byte_order_t convert_byte_order (rom_endianness_t endianness) {
+    switch (endianness) {
+        case ENDIANNESS_BYTE_SWAP: return FLASHCART_BYTE_ORDER_BYTE_SWAPPED;
+        case ENDIANNESS_LITTLE: return FLASHCART_BYTE_ORDER_LITTLE;
+        default: return FLASHCART_BYTE_ORDER_BIG;
+    }
+}
+
 /**
  * @brief Convert the cart load error code to a human-readable message.
  * 
@@ -105,15 +492,24 @@ cart_load_err_t cart_load_n64_rom_and_save (menu_t *menu, flashcart_progress_cal
     const char *rom_path_to_load = path_get(path);
     char patched_rom_path[512];
 
-    bool byte_swap = (menu->load.rom_info.endianness == ENDIANNESS_BYTE_SWAP);
+    flashcart_byte_order_t byte_order = convert_byte_order(menu->load.rom_info.endianness);
     flashcart_save_type_t save_type = convert_save_type(rom_info_get_save_type(&menu->load.rom_info));
 
+    rom_patch_stream_t *patch_stream = NULL;
+
     if (menu->load.rom_info.settings.patches_enabled) {
-        rom_patch_result_t patch_result = rom_patch_prepare_launch(menu, path_get(path), patched_rom_path, sizeof(patched_rom_path));
+        rom_patch_result_t patch_result;
+        if (menu->settings.rom_patch_on_load_enabled) {
+            patch_result = rom_patch_prepare_launch_streamed(menu, path_get(path), patched_rom_path, sizeof(patched_rom_path), &patch_stream, progress);
+        } else {
+            patch_result = rom_patch_prepare_launch(menu, path_get(path), patched_rom_path, sizeof(patched_rom_path), progress);
+        }
         switch (patch_result) {
             case ROM_PATCH_OK:
                 rom_path_to_load = patched_rom_path;
-                byte_swap = false; // Patched cache files are always generated as .z64 big-endian.
+                if (!patch_stream) {
+                    byte_order = FLASHCART_BYTE_ORDER_BIG; // Patched cache files are always generated as .z64 big-endian.
+                }
                 break;
             case ROM_PATCH_SKIPPED:
                 break;
@@ -132,10 +528,39 @@ cart_load_err_t cart_load_n64_rom_and_save (menu_t *menu, flashcart_progress_cal
         }
     }
 
-    menu->flashcart_err = flashcart_load_rom((char *)rom_path_to_load, byte_swap, progress);
-    if (menu->flashcart_err != FLASHCART_OK) {
-        path_free(path);
-        return CART_LOAD_ERR_ROM_LOAD_FAIL;
+    last_rom_t last_rom;
+    // NOTE: A ROM patched on load can't be told apart from the unpatched file it was read from
+    bool last_rom_known = menu->settings.rom_reload_skip_enabled && !patch_stream && last_rom_describe(menu, rom_path_to_load, byte_order, &last_rom);
+
+    if (last_rom_known && last_rom_is_loaded(menu, &last_rom)) {
+        debugf("Cart load: %s is already in SDRAM, skipping ROM load\n", rom_path_to_load);
+        if (progress) {
+            progress(1.0f);
+        }
+    } else {
+        if (menu->settings.rom_reload_skip_enabled) {
+            last_rom_clear(menu);
+        }
+
+        if (patch_stream) {
+            flashcart_set_rom_patch(rom_patch_stream_apply, patch_stream);
+        }
+        menu->flashcart_err = flashcart_load_rom((char *)rom_path_to_load, byte_order, progress);
+        rom_patch_result_t patch_result = (menu->flashcart_err == FLASHCART_OK) ? rom_patch_stream_finish(patch_stream) : ROM_PATCH_OK;
+        rom_patch_stream_free(patch_stream);
+        if (menu->flashcart_err != FLASHCART_OK) {
+            path_free(path);
+            return CART_LOAD_ERR_ROM_LOAD_FAIL;
+        }
+        if (patch_result != ROM_PATCH_OK) {
+            path_free(path);
+            return (patch_result == ROM_PATCH_INCOMPATIBLE) ? CART_LOAD_ERR_PATCH_INCOMPATIBLE : CART_LOAD_ERR_PATCH_FORMAT;
+        }
+
+        if (last_rom_known && (last_rom.size <= LAST_ROM_MAX_SIZE)) {
+            last_rom.fingerprint = last_rom_fingerprint(last_rom.size);
+            last_rom_save(menu, &last_rom);
+        }
     }
 
     path_ext_replace(path, "sav");
@@ -147,7 +572,7 @@ cart_load_err_t cart_load_n64_rom_and_save (menu_t *menu, flashcart_progress_cal
         path_push_subdir(path, SAVE_DIRECTORY_NAME);
     }
 
-    menu->flashcart_err = flashcart_load_save(path_get(path), save_type);
+    menu->flashcart_err = load_save(menu, path_get(path), save_type);
     if (menu->flashcart_err != FLASHCART_OK) {
         path_free(path);
         return CART_LOAD_ERR_SAVE_LOAD_FAIL;
@@ -191,6 +616,10 @@ cart_load_err_t cart_load_64dd_ipl_and_disk (menu_t *menu, flashcart_progress_ca
         return CART_LOAD_ERR_EXP_PAK_NOT_FOUND;
     }
 
+    if (menu->settings.rom_reload_skip_enabled) {
+        last_rom_clear(menu);
+    }
+
     path_t *path = path_init(menu->storage_prefix, DDIPL_LOCATION);
     flashcart_disk_parameters_t disk_parameters;
 
@@ -241,6 +670,10 @@ cart_load_err_t cart_load_64dd_ipl_and_disk (menu_t *menu, flashcart_progress_ca
  * @return cart_load_err_t Error code.
  */
 cart_load_err_t cart_load_emulator (menu_t *menu, cart_load_emu_type_t emu_type, flashcart_progress_callback_t progress) {
+    if (menu->settings.rom_reload_skip_enabled) {
+        last_rom_clear(menu);
+    }
+
     path_t *path = path_init(menu->storage_prefix, EMU_LOCATION);
 
     flashcart_save_type_t save_type = FLASHCART_SAVE_TYPE_NONE;
@@ -283,7 +716,7 @@ cart_load_err_t cart_load_emulator (menu_t *menu, cart_load_emu_type_t emu_type,
         return CART_LOAD_ERR_EMU_NOT_FOUND;
     }
 
-    menu->flashcart_err = flashcart_load_rom(path_get(path), false, progress);
+    menu->flashcart_err = flashcart_load_rom(path_get(path), FLASHCART_BYTE_ORDER_BIG, progress);
     if (menu->flashcart_err != FLASHCART_OK) {
         path_free(path);
         return CART_LOAD_ERR_EMU_LOAD_FAIL;
@@ -317,7 +750,7 @@ cart_load_err_t cart_load_emulator (menu_t *menu, cart_load_emu_type_t emu_type,
         path_push_subdir(path, SAVE_DIRECTORY_NAME);
     }
 
-    menu->flashcart_err = flashcart_load_save(path_get(path), save_type);
+    menu->flashcart_err = load_save(menu, path_get(path), save_type);
     if (menu->flashcart_err != FLASHCART_OK) {
         path_free(path);
         return CART_LOAD_ERR_SAVE_LOAD_FAIL;
@@ -0,0 +1,525 @@
+/**
+ * @file image_convert.c
+ * @brief Pixel format conversion kernels
+ * @ingroup menu
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "image_convert.h"
+#include "utils/utils.h"
+
+// 4x4 Bayer matrix scaled to the 3 bits dropped by RGB8 -> RGB5 truncation.
+static const uint8_t image_convert_bayer4[4][4] = {
+    { 0, 4, 1, 5 },
+    { 6, 2, 7, 3 },
+    { 1, 5, 0, 4 },
+    { 7, 3, 6, 2 },
+};
+
+static inline uint32_t image_convert_load_be32(const uint8_t *p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    value = __builtin_bswap32(value);
+#endif
+    return value;
+}
+
+static inline void image_convert_store_be32(uint16_t *p, uint32_t value) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Host builds: keep each 16-bit pixel in native order.
+    value = (value >> 16) | (value << 16);
+#endif
+    memcpy(p, &value, sizeof(value));
+}
+
+// Per-byte saturating add of thresholds below 0x80.
+static inline uint32_t image_convert_add_sat8(uint32_t x, uint32_t t) {
+    uint32_t high = x & 0x80808080u;
+    uint32_t sum = (x & 0x7F7F7F7Fu) + t;
+    uint32_t overflow = high & sum;
+    return (sum ^ high) | ((overflow >> 7) * 0xFFu);
+}
+
+static inline uint16_t image_convert_pixel(uint8_t r, uint8_t g, uint8_t b, uint8_t t) {
+    r = (r > (255 - t)) ? 255 : (r + t);
+    g = (g > (255 - t)) ? 255 : (g + t);
+    b = (b > (255 - t)) ? 255 : (b + t);
+    return ((r >> 3) << 11) | ((g >> 3) << 6) | ((b >> 3) << 1) | 1;
+}
+
+void image_convert_rgb8_to_rgba16_row_reference(uint16_t *dst, const uint8_t *src, int width, int y, bool dither) {
+    const uint8_t *thresholds = image_convert_bayer4[y & 3];
+    for (int x = 0; x < width; x++) {
+        uint8_t t = dither ? thresholds[x & 3] : 0;
+        dst[x] = image_convert_pixel(src[(x * 3) + 0], src[(x * 3) + 1], src[(x * 3) + 2], t);
+    }
+}
+
+void image_convert_rgb8_to_rgba16_row(uint16_t *dst, const uint8_t *src, int width, int y, bool dither) {
+    const uint8_t *thresholds = image_convert_bayer4[y & 3];
+
+    // Thresholds lined up with the RGBR GBRG BRGB byte layout of 4 pixels.
+    uint32_t t0 = 0, t1 = 0, t2 = 0;
+    if (dither) {
+        uint32_t a = thresholds[0], b = thresholds[1], c = thresholds[2], d = thresholds[3];
+        t0 = (a << 24) | (a << 16) | (a << 8) | b;
+        t1 = (b << 24) | (b << 16) | (c << 8) | c;
+        t2 = (c << 24) | (d << 16) | (d << 8) | d;
+    }
+
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        uint32_t w0 = image_convert_load_be32(src + 0);
+        uint32_t w1 = image_convert_load_be32(src + 4);
+        uint32_t w2 = image_convert_load_be32(src + 8);
+        src += 12;
+
+        if (dither) {
+            w0 = image_convert_add_sat8(w0, t0);
+            w1 = image_convert_add_sat8(w1, t1);
+            w2 = image_convert_add_sat8(w2, t2);
+        }
+
+        uint32_t p0 = ((w0 >> 16) & 0xF800) | ((w0 >> 13) & 0x07C0) | ((w0 >> 10) & 0x003E);
+        uint32_t p1 = ((w0 << 8) & 0xF800) | ((w1 >> 21) & 0x07C0) | ((w1 >> 18) & 0x003E);
+        uint32_t p2 = (w1 & 0xF800) | ((w1 << 3) & 0x07C0) | ((w2 >> 26) & 0x003E);
+        uint32_t p3 = ((w2 >> 8) & 0xF800) | ((w2 >> 5) & 0x07C0) | ((w2 >> 2) & 0x003E);
+
+        image_convert_store_be32(dst + 0, (p0 << 16) | p1 | 0x00010001u);
+        image_convert_store_be32(dst + 2, (p2 << 16) | p3 | 0x00010001u);
+        dst += 4;
+    }
+
+    for (; x < width; x++) {
+        uint8_t t = dither ? thresholds[x & 3] : 0;
+        *dst++ = image_convert_pixel(src[0], src[1], src[2], t);
+        src += 3;
+    }
+}
+
+bool image_convert_fit_size(int *width, int *height, int max_width, int max_height) {
+    if ((*width <= max_width) && (*height <= max_height)) {
+        return false;
+    }
+
+    // Compare the scale factors max_width / width and max_height / height.
+    if (((int64_t)max_width * *height) <= ((int64_t)max_height * *width)) {
+        *height = MAX(1, (int)(((int64_t)*height * max_width) / *width));
+        *width = max_width;
+    } else {
+        *width = MAX(1, (int)(((int64_t)*width * max_height) / *height));
+        *height = max_height;
+    }
+    return true;
+}
+
+bool image_convert_downscale_init(image_convert_downscale_t *ds, int src_width, int src_height, int dst_width, int dst_height) {
+    memset(ds, 0, sizeof(*ds));
+    if ((dst_width <= 0) || (dst_height <= 0) || (dst_width > src_width) || (dst_height > src_height) || (src_width > UINT16_MAX)) {
+        return false;
+    }
+
+    ds->src_width = src_width;
+    ds->src_height = src_height;
+    ds->dst_width = dst_width;
+    ds->dst_height = dst_height;
+    ds->sums = calloc(dst_width * 3, sizeof(uint32_t));
+    ds->x_map = malloc(src_width * sizeof(uint16_t));
+    ds->x_count = calloc(dst_width, sizeof(uint16_t));
+    ds->dst_row = malloc(dst_width * 3);
+    if (!ds->sums || !ds->x_map || !ds->x_count || !ds->dst_row) {
+        image_convert_downscale_free(ds);
+        return false;
+    }
+
+    for (int x = 0; x < src_width; x++) {
+        uint16_t dst_x = (uint16_t)(((uint32_t)x * dst_width) / src_width);
+        ds->x_map[x] = dst_x;
+        ds->x_count[dst_x]++;
+    }
+    return true;
+}
+
+void image_convert_downscale_free(image_convert_downscale_t *ds) {
+    free(ds->sums);
+    free(ds->x_map);
+    free(ds->x_count);
+    free(ds->dst_row);
+    memset(ds, 0, sizeof(*ds));
+}
+
+static void image_convert_downscale_emit(image_convert_downscale_t *ds, uint16_t *dst, size_t dst_stride, bool dither) {
+    if (ds->rows == 0) {
+        return;
+    }
+
+    uint32_t *sums = ds->sums;
+    uint8_t *out = ds->dst_row;
+    for (int x = 0; x < ds->dst_width; x++) {
+        uint32_t count = (uint32_t)ds->x_count[x] * ds->rows;
+        uint32_t round = count / 2;
+        out[0] = (uint8_t)((sums[0] + round) / count);
+        out[1] = (uint8_t)((sums[1] + round) / count);
+        out[2] = (uint8_t)((sums[2] + round) / count);
+        sums += 3;
+        out += 3;
+    }
+
+    uint16_t *dst_pixels = (uint16_t *)((uint8_t *)dst + (ds->dst_y * dst_stride));
+    image_convert_rgb8_to_rgba16_row(dst_pixels, ds->dst_row, ds->dst_width, ds->dst_y, dither);
+
+    memset(ds->sums, 0, ds->dst_width * 3 * sizeof(uint32_t));
+    ds->rows = 0;
+}
+
+static void image_convert_downscale_begin_row(image_convert_downscale_t *ds, int src_y, uint16_t *dst, size_t dst_stride, bool dither) {
+    int dst_y = (int)(((int64_t)src_y * ds->dst_height) / ds->src_height);
+    if (dst_y != ds->dst_y) {
+        image_convert_downscale_emit(ds, dst, dst_stride, dither);
+        ds->dst_y = dst_y;
+    }
+}
+
+void image_convert_downscale_push_row(image_convert_downscale_t *ds, const uint8_t *src, int src_y, uint16_t *dst, size_t dst_stride, bool dither) {
+    image_convert_downscale_begin_row(ds, src_y, dst, dst_stride, dither);
+
+    const uint16_t *x_map = ds->x_map;
+    uint32_t *sums = ds->sums;
+    for (int x = 0; x < ds->src_width; x++) {
+        uint32_t *sum = &sums[x_map[x] * 3];
+        sum[0] += src[0];
+        sum[1] += src[1];
+        sum[2] += src[2];
+        src += 3;
+    }
+    ds->rows++;
+}
+
+void image_convert_downscale_push_rgba16_row(image_convert_downscale_t *ds, const uint16_t *src, int src_y, uint16_t *dst, size_t dst_stride, bool dither) {
+    image_convert_downscale_begin_row(ds, src_y, dst, dst_stride, dither);
+
+    const uint16_t *x_map = ds->x_map;
+    uint32_t *sums = ds->sums;
+    for (int x = 0; x < ds->src_width; x++) {
+        uint32_t *sum = &sums[x_map[x] * 3];
+        uint16_t pixel = src[x];
+        uint32_t r = (pixel >> 11) & 0x1F;
+        uint32_t g = (pixel >> 6) & 0x1F;
+        uint32_t b = (pixel >> 1) & 0x1F;
+        sum[0] += (r << 3) | (r >> 2);
+        sum[1] += (g << 3) | (g >> 2);
+        sum[2] += (b << 3) | (b >> 2);
+    }
+    ds->rows++;
+}
+
+void image_convert_downscale_finish(image_convert_downscale_t *ds, uint16_t *dst, size_t dst_stride, bool dither) {
+    image_convert_downscale_emit(ds, dst, dst_stride, dither);
+}
+
+#define IMAGE_CONVERT_COLORS (1 << 15)
+
+// RGBA16 without the alpha bit, 5 bits per channel.
+#define IMAGE_CONVERT_RGB15(p)      ((p) >> 1)
+#define IMAGE_CONVERT_OPAQUE(p)     ((p) & 1)
+
+typedef struct {
+    uint16_t color;
+    uint16_t count;
+} image_convert_color_t;
+
+typedef struct {
+    int start;
+    int end;
+    uint32_t pixels;
+} image_convert_box_t;
+
+static int image_convert_sort_shift;
+
+static int image_convert_color_compare(const void *a, const void *b) {
+    int ca = (((const image_convert_color_t *)a)->color >> image_convert_sort_shift) & 0x1F;
+    int cb = (((const image_convert_color_t *)b)->color >> image_convert_sort_shift) & 0x1F;
+    return ca - cb;
+}
+
+static inline const uint16_t *image_convert_row(const uint16_t *src, size_t stride, int y) {
+    return (const uint16_t *)((const uint8_t *)src + (y * stride));
+}
+
+static inline uint8_t image_convert_gray4(uint16_t pixel) {
+    return (uint8_t)((pixel >> 12) & 0x0F);
+}
+
+int image_convert_rgba16_count_colors(const uint16_t *src, size_t src_stride, int width, int height, int limit) {
+    uint32_t *seen = calloc(IMAGE_CONVERT_COLORS / 32, sizeof(uint32_t));
+    if (!seen) {
+        return -1;
+    }
+
+    int count = 0;
+    bool transparent = false;
+    for (int y = 0; (y < height) && (count <= limit); y++) {
+        const uint16_t *row = image_convert_row(src, src_stride, y);
+        for (int x = 0; x < width; x++) {
+            uint16_t pixel = row[x];
+            if (!IMAGE_CONVERT_OPAQUE(pixel)) {
+                if (!transparent) {
+                    transparent = true;
+                    count++;
+                }
+                continue;
+            }
+            uint16_t color = IMAGE_CONVERT_RGB15(pixel);
+            uint32_t bit = 1u << (color & 31);
+            if (!(seen[color >> 5] & bit)) {
+                seen[color >> 5] |= bit;
+                if (++count > limit) {
+                    break;
+                }
+            }
+        }
+    }
+
+    free(seen);
+    return MIN(count, limit + 1);
+}
+
+bool image_convert_rgba16_is_gray(const uint16_t *src, size_t src_stride, int width, int height, bool *has_alpha) {
+    *has_alpha = false;
+    for (int y = 0; y < height; y++) {
+        const uint16_t *row = image_convert_row(src, src_stride, y);
+        for (int x = 0; x < width; x++) {
+            uint16_t pixel = row[x];
+            if (!IMAGE_CONVERT_OPAQUE(pixel)) {
+                *has_alpha = true;
+                continue;
+            }
+            uint16_t r = (pixel >> 11) & 0x1F;
+            uint16_t g = (pixel >> 6) & 0x1F;
+            uint16_t b = (pixel >> 1) & 0x1F;
+            if ((r != g) || (g != b)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Split the box holding the most pixels at its median along the widest channel.
+static bool image_convert_split_box(image_convert_color_t *colors, image_convert_box_t *boxes, int *box_count) {
+    int target = -1;
+    for (int i = 0; i < *box_count; i++) {
+        if ((boxes[i].end - boxes[i].start) < 2) {
+            continue;
+        }
+        if ((target < 0) || (boxes[i].pixels > boxes[target].pixels)) {
+            target = i;
+        }
+    }
+    if (target < 0) {
+        return false;
+    }
+
+    image_convert_box_t *box = &boxes[target];
+    int best_shift = 0;
+    int best_range = -1;
+    for (int shift = 0; shift <= 10; shift += 5) {
+        int low = 0x1F, high = 0;
+        for (int i = box->start; i < box->end; i++) {
+            int value = (colors[i].color >> shift) & 0x1F;
+            low = MIN(low, value);
+            high = MAX(high, value);
+        }
+        if ((high - low) > best_range) {
+            best_range = high - low;
+            best_shift = shift;
+        }
+    }
+
+    image_convert_sort_shift = best_shift;
+    qsort(&colors[box->start], box->end - box->start, sizeof(image_convert_color_t), image_convert_color_compare);
+
+    uint32_t half = box->pixels / 2;
+    uint32_t sum = 0;
+    int split = box->start + 1;
+    for (int i = box->start; i < (box->end - 1); i++) {
+        sum += colors[i].count;
+        split = i + 1;
+        if (sum >= half) {
+            break;
+        }
+    }
+
+    image_convert_box_t *upper = &boxes[(*box_count)++];
+    upper->start = split;
+    upper->end = box->end;
+    upper->pixels = 0;
+    for (int i = split; i < upper->end; i++) {
+        upper->pixels += colors[i].count;
+    }
+    box->end = split;
+    box->pixels -= upper->pixels;
+    return true;
+}
+
+int image_convert_rgba16_to_ci(const uint16_t *src, size_t src_stride, int width, int height,
+                               uint8_t *dst, size_t dst_stride, int bits, uint16_t *palette) {
+    int max_colors = 1 << bits;
+    uint16_t *histogram = calloc(IMAGE_CONVERT_COLORS, sizeof(uint16_t));
+    uint8_t *lookup = malloc(IMAGE_CONVERT_COLORS);
+    if (!histogram || !lookup) {
+        free(histogram);
+        free(lookup);
+        return -1;
+    }
+
+    bool transparent = false;
+    int distinct = 0;
+    for (int y = 0; y < height; y++) {
+        const uint16_t *row = image_convert_row(src, src_stride, y);
+        for (int x = 0; x < width; x++) {
+            uint16_t pixel = row[x];
+            if (!IMAGE_CONVERT_OPAQUE(pixel)) {
+                transparent = true;
+                continue;
+            }
+            uint16_t *count = &histogram[IMAGE_CONVERT_RGB15(pixel)];
+            if (*count == 0) {
+                distinct++;
+            }
+            if (*count < UINT16_MAX) {
+                (*count)++;
+            }
+        }
+    }
+
+    image_convert_color_t *colors = malloc(MAX(distinct, 1) * sizeof(image_convert_color_t));
+    if (!colors) {
+        free(histogram);
+        free(lookup);
+        return -1;
+    }
+    int n = 0;
+    for (int color = 0; color < IMAGE_CONVERT_COLORS; color++) {
+        if (histogram[color]) {
+            colors[n].color = (uint16_t)color;
+            colors[n].count = histogram[color];
+            n++;
+        }
+    }
+    free(histogram);
+
+    int first = transparent ? 1 : 0;
+    int available = max_colors - first;
+    image_convert_box_t boxes[256];
+    int box_count = 0;
+    if (n > 0) {
+        boxes[0] = (image_convert_box_t){ .start = 0, .end = n, .pixels = 0 };
+        for (int i = 0; i < n; i++) {
+            boxes[0].pixels += colors[i].count;
+        }
+        box_count = 1;
+        while ((box_count < available) && image_convert_split_box(colors, boxes, &box_count)) {
+        }
+    }
+
+    memset(palette, 0, max_colors * sizeof(uint16_t));
+    for (int b = 0; b < box_count; b++) {
+        uint32_t sum_r = 0, sum_g = 0, sum_b = 0;
+        uint32_t weight = 0;
+        for (int i = boxes[b].start; i < boxes[b].end; i++) {
+            uint32_t color = colors[i].color;
+            uint32_t count = colors[i].count;
+            sum_r += ((color >> 10) & 0x1F) * count;
+            sum_g += ((color >> 5) & 0x1F) * count;
+            sum_b += (color & 0x1F) * count;
+            weight += count;
+            lookup[color] = (uint8_t)(first + b);
+        }
+        uint32_t round = weight / 2;
+        uint16_t r = (uint16_t)((sum_r + round) / weight);
+        uint16_t g = (uint16_t)((sum_g + round) / weight);
+        uint16_t bl = (uint16_t)((sum_b + round) / weight);
+        palette[first + b] = (r << 11) | (g << 6) | (bl << 1) | 1;
+    }
+    free(colors);
+
+    for (int y = 0; y < height; y++) {
+        const uint16_t *row = image_convert_row(src, src_stride, y);
+        uint8_t *out = dst + (y * dst_stride);
+        for (int x = 0; x < width; x++) {
+            uint16_t pixel = row[x];
+            uint8_t index = IMAGE_CONVERT_OPAQUE(pixel) ? lookup[IMAGE_CONVERT_RGB15(pixel)] : 0;
+            if (bits == 8) {
+                out[x] = index;
+            } else if (x & 1) {
+                out[x >> 1] |= index;
+            } else {
+                out[x >> 1] = (uint8_t)(index << 4);
+            }
+        }
+    }
+    free(lookup);
+
+    return first + box_count;
+}
+
+void image_convert_rgba16_to_i4(const uint16_t *src, size_t src_stride, int width, int height, uint8_t *dst, size_t dst_stride) {
+    for (int y = 0; y < height; y++) {
+        const uint16_t *row = image_convert_row(src, src_stride, y);
+        uint8_t *out = dst + (y * dst_stride);
+        for (int x = 0; x < width; x++) {
+            uint8_t value = image_convert_gray4(row[x]);
+            if (x & 1) {
+                out[x >> 1] |= value;
+            } else {
+                out[x >> 1] = (uint8_t)(value << 4);
+            }
+        }
+    }
+}
+
+void image_convert_rgba16_to_ia8(const uint16_t *src, size_t src_stride, int width, int height, uint8_t *dst, size_t dst_stride) {
+    for (int y = 0; y < height; y++) {
+        const uint16_t *row = image_convert_row(src, src_stride, y);
+        uint8_t *out = dst + (y * dst_stride);
+        for (int x = 0; x < width; x++) {
+            uint16_t pixel = row[x];
+            out[x] = IMAGE_CONVERT_OPAQUE(pixel) ? (uint8_t)((image_convert_gray4(pixel) << 4) | 0x0F) : 0;
+        }
+    }
+}
+
+void image_convert_ci_to_rgba16_row(uint16_t *dst, const uint8_t *src, int width, int bits, const uint16_t *palette) {
+    if (bits == 8) {
+        for (int x = 0; x < width; x++) {
+            dst[x] = palette[src[x]];
+        }
+        return;
+    }
+    for (int x = 0; x < width; x++) {
+        uint8_t pair = src[x >> 1];
+        dst[x] = palette[(x & 1) ? (pair & 0x0F) : (pair >> 4)];
+    }
+}
+
+static inline uint16_t image_convert_gray_pixel(uint8_t i4, bool opaque) {
+    uint16_t v = (uint16_t)((i4 << 1) | (i4 >> 3));
+    return (v << 11) | (v << 6) | (v << 1) | (opaque ? 1 : 0);
+}
+
+void image_convert_i4_to_rgba16_row(uint16_t *dst, const uint8_t *src, int width) {
+    for (int x = 0; x < width; x++) {
+        uint8_t pair = src[x >> 1];
+        dst[x] = image_convert_gray_pixel((x & 1) ? (pair & 0x0F) : (pair >> 4), true);
+    }
+}
+
+void image_convert_ia8_to_rgba16_row(uint16_t *dst, const uint8_t *src, int width) {
+    for (int x = 0; x < width; x++) {
+        dst[x] = image_convert_gray_pixel(src[x] >> 4, (src[x] & 0x0F) >= 0x08);
+    }
+}
@@ -0,0 +1,174 @@
+/**
+ * @file image_convert.h
+ * @brief Pixel format conversion kernels
+ * @ingroup menu
+ */
+
+#ifndef IMAGE_CONVERT_H__
+#define IMAGE_CONVERT_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Streaming box filter downscaler.
+ *
+ * Source rows are pushed top to bottom and summed into per-column
+ * accumulators. Each source pixel contributes to exactly one destination
+ * pixel, which is written out as soon as its last source row arrives, so no
+ * full size buffer is ever needed.
+ */
+typedef struct {
+    int src_width;
+    int src_height;
+    int dst_width;
+    int dst_height;
+    int dst_y;              /**< Destination row being accumulated */
+    int rows;               /**< Source rows summed into dst_y so far */
+    uint32_t *sums;         /**< RGB sums, dst_width * 3 */
+    uint16_t *x_map;        /**< Destination column of each source column */
+    uint16_t *x_count;      /**< Source columns summed into each destination column */
+    uint8_t *dst_row;       /**< RGB8 staging row, dst_width * 3 */
+} image_convert_downscale_t;
+
+/**
+ * @brief Convert a row of packed RGB8 pixels to opaque RGBA16 (5551).
+ *
+ * Four pixels are converted per iteration from three 32-bit words. Neither
+ * buffer needs to be aligned.
+ *
+ * @param dst Destination row, @p width pixels.
+ * @param src Source row, @p width * 3 bytes.
+ * @param width Row width in pixels.
+ * @param y Row index, selects the dither pattern row.
+ * @param dither Apply 4x4 ordered dithering instead of truncating to 5 bits.
+ */
+void image_convert_rgb8_to_rgba16_row(uint16_t *dst, const uint8_t *src, int width, int y, bool dither);
+
+/**
+ * @brief Reference implementation of image_convert_rgb8_to_rgba16_row.
+ *
+ * Converts one pixel at a time and must produce identical output.
+ */
+void image_convert_rgb8_to_rgba16_row_reference(uint16_t *dst, const uint8_t *src, int width, int y, bool dither);
+
+/**
+ * @brief Fit a size inside a bounding box, keeping the aspect ratio.
+ *
+ * Sizes that already fit are returned unchanged; images are never enlarged.
+ *
+ * @param width Source width, replaced by the fitted width.
+ * @param height Source height, replaced by the fitted height.
+ * @param max_width Bounding box width.
+ * @param max_height Bounding box height.
+ * @return true if the size was reduced.
+ */
+bool image_convert_fit_size(int *width, int *height, int max_width, int max_height);
+
+/**
+ * @brief Allocate downscaler state.
+ *
+ * @return true on success, false when out of memory or the sizes are invalid.
+ */
+bool image_convert_downscale_init(image_convert_downscale_t *ds, int src_width, int src_height, int dst_width, int dst_height);
+
+/**
+ * @brief Release downscaler state.
+ */
+void image_convert_downscale_free(image_convert_downscale_t *ds);
+
+/**
+ * @brief Add a source RGB8 row.
+ *
+ * Rows must be pushed in increasing order. Completed destination rows are
+ * converted to RGBA16 and written to @p dst.
+ *
+ * @param ds Downscaler state.
+ * @param src Source row, src_width * 3 bytes.
+ * @param src_y Source row index.
+ * @param dst Destination RGBA16 pixels.
+ * @param dst_stride Destination stride in bytes.
+ * @param dither Dither the RGBA16 output.
+ */
+void image_convert_downscale_push_row(image_convert_downscale_t *ds, const uint8_t *src, int src_y, uint16_t *dst, size_t dst_stride, bool dither);
+
+/**
+ * @brief Add a source RGBA16 row.
+ *
+ * Like image_convert_downscale_push_row, for sources that are already
+ * RGBA16. Each channel is widened to 8 bits before it is summed; alpha is
+ * ignored and the output is opaque.
+ */
+void image_convert_downscale_push_rgba16_row(image_convert_downscale_t *ds, const uint16_t *src, int src_y, uint16_t *dst, size_t dst_stride, bool dither);
+
+/**
+ * @brief Write out the last destination row after the final source row.
+ */
+void image_convert_downscale_finish(image_convert_downscale_t *ds, uint16_t *dst, size_t dst_stride, bool dither);
+
+/**
+ * @brief Count the distinct RGBA16 values in an image, up to a limit.
+ *
+ * All transparent pixels count as one value.
+ *
+ * @return The number of distinct values, or limit + 1 if there are more, or -1 when out of memory.
+ */
+int image_convert_rgba16_count_colors(const uint16_t *src, size_t src_stride, int width, int height, int limit);
+
+/**
+ * @brief Check whether every opaque RGBA16 pixel is a shade of grey.
+ *
+ * @param has_alpha Set to true if any pixel is transparent.
+ */
+bool image_convert_rgba16_is_gray(const uint16_t *src, size_t src_stride, int width, int height, bool *has_alpha);
+
+/**
+ * @brief Quantize RGBA16 pixels to a CI8 or CI4 image with median cut.
+ *
+ * Images with few enough colours are converted losslessly. Otherwise colour
+ * space is split into boxes by pixel count along the widest channel, and
+ * each palette entry is the weighted average of its box. Transparent pixels
+ * all map to entry 0, which is then 0x0000.
+ *
+ * @param src Source RGBA16 pixels.
+ * @param src_stride Source stride in bytes.
+ * @param width Image width.
+ * @param height Image height.
+ * @param dst Destination indices, 4 bit indices are packed high nibble first.
+ * @param dst_stride Destination stride in bytes.
+ * @param bits Index size, 8 or 4.
+ * @param palette Receives up to 1 << bits RGBA16 entries.
+ * @return Number of palette entries used, or -1 when out of memory.
+ */
+int image_convert_rgba16_to_ci(const uint16_t *src, size_t src_stride, int width, int height,
+                               uint8_t *dst, size_t dst_stride, int bits, uint16_t *palette);
+
+/**
+ * @brief Convert grey RGBA16 pixels to I4, packed high nibble first.
+ */
+void image_convert_rgba16_to_i4(const uint16_t *src, size_t src_stride, int width, int height, uint8_t *dst, size_t dst_stride);
+
+/**
+ * @brief Convert grey RGBA16 pixels to IA8 (4 bit intensity, 4 bit alpha).
+ */
+void image_convert_rgba16_to_ia8(const uint16_t *src, size_t src_stride, int width, int height, uint8_t *dst, size_t dst_stride);
+
+/**
+ * @brief Expand a row of CI8 or CI4 indices to RGBA16.
+ *
+ * @param bits Index size, 8 or 4.
+ */
+void image_convert_ci_to_rgba16_row(uint16_t *dst, const uint8_t *src, int width, int bits, const uint16_t *palette);
+
+/**
+ * @brief Expand a row of I4 pixels to opaque RGBA16.
+ */
+void image_convert_i4_to_rgba16_row(uint16_t *dst, const uint8_t *src, int width);
+
+/**
+ * @brief Expand a row of IA8 pixels to RGBA16.
+ */
+void image_convert_ia8_to_rgba16_row(uint16_t *dst, const uint8_t *src, int width);
+
+#endif /* IMAGE_CONVERT_H__ */
@@ -0,0 +1,348 @@
+/**
+ * @file ips_patch.c
+ * @brief IPS patch records, applied to ROM data in memory
+ * @ingroup menu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libdragon.h>
+
+#include "ips_patch.h"
+#include "utils/utils.h"
+
+#define IPS_EOF_MARKER  (0x454F46) // "EOF"
+
+typedef struct {
+    uint32_t offset;
+    uint32_t length;
+    uint32_t data; // Payload offset in the patch data, or the fill byte of an RLE record.
+    uint32_t order;
+    bool rle;
+} ips_record_t;
+
+struct ips_patch_s {
+    ips_record_t *records;
+    size_t count;
+    size_t capacity;
+    uint8_t *data;
+    size_t data_size;
+    size_t max_data;
+    uint32_t max_length;
+    bool overlapping;
+    const ips_record_t **active;
+};
+
+static bool read_u16_be(FILE *f, uint16_t *out) {
+    uint8_t b[2];
+    if (fread(b, 1, sizeof(b), f) != sizeof(b)) {
+        return false;
+    }
+    *out = ((uint16_t)b[0] << 8) | ((uint16_t)b[1]);
+    return true;
+}
+
+static bool read_u24_be(FILE *f, uint32_t *out) {
+    uint8_t b[3];
+    if (fread(b, 1, sizeof(b), f) != sizeof(b)) {
+        return false;
+    }
+    *out = ((uint32_t)b[0] << 16) | ((uint32_t)b[1] << 8) | ((uint32_t)b[2]);
+    return true;
+}
+
+static bool add_record(ips_patch_t *ips, const ips_record_t *record) {
+    if (ips->count == ips->capacity) {
+        size_t capacity = ips->capacity ? ips->capacity * 2 : 256;
+        ips_record_t *records = realloc(ips->records, capacity * sizeof(ips_record_t));
+        if (!records) {
+            return false;
+        }
+        ips->records = records;
+        ips->capacity = capacity;
+    }
+    ips->records[ips->count++] = *record;
+    return true;
+}
+
+static int compare_records(const void *a, const void *b) {
+    const ips_record_t *ra = a;
+    const ips_record_t *rb = b;
+    if (ra->offset != rb->offset) {
+        return (ra->offset < rb->offset) ? -1 : 1;
+    }
+    return (ra->order < rb->order) ? -1 : (ra->order > rb->order);
+}
+
+static int compare_order(const void *a, const void *b) {
+    const ips_record_t *ra = *(const ips_record_t * const *)a;
+    const ips_record_t *rb = *(const ips_record_t * const *)b;
+    return (ra->order < rb->order) ? -1 : (ra->order > rb->order);
+}
+
+static void write_record(const ips_patch_t *ips, const ips_record_t *record, uint8_t *buffer, uint32_t offset, uint32_t end) {
+    uint32_t from = MAX(record->offset, offset);
+    uint32_t to = MIN(record->offset + record->length, end);
+    if (record->rle) {
+        memset(buffer + (from - offset), (int)record->data, to - from);
+    } else {
+        memcpy(buffer + (from - offset), ips->data + record->data + (from - record->offset), to - from);
+    }
+}
+
+ips_patch_t *ips_patch_create(size_t max_data) {
+    ips_patch_t *ips = calloc(1, sizeof(ips_patch_t));
+    if (ips) {
+        ips->max_data = max_data;
+    }
+    return ips;
+}
+
+void ips_patch_free(ips_patch_t *ips) {
+    if (!ips) {
+        return;
+    }
+    free(ips->active);
+    free(ips->records);
+    free(ips->data);
+    free(ips);
+}
+
+// Appends the whole patch file to the data, payloads are referenced in place.
+ips_patch_err_t ips_patch_add(ips_patch_t *ips, const char *ips_path, int64_t rom_size) {
+    FILE *f = fopen(ips_path, "rb");
+    if (!f) {
+        return IPS_PATCH_IO_ERROR;
+    }
+    long patch_size;
+    if (fseek(f, 0, SEEK_END) != 0 || (patch_size = ftell(f)) < 0 || fseek(f, 0, SEEK_SET) != 0) {
+        fclose(f);
+        return IPS_PATCH_IO_ERROR;
+    }
+    if (patch_size < 8) {
+        fclose(f);
+        return IPS_PATCH_FORMAT_ERROR;
+    }
+    if (ips->data_size + (size_t)patch_size > ips->max_data) {
+        debugf("IPS patch: %s is too large to hold in memory\n", ips_path);
+        fclose(f);
+        return IPS_PATCH_TOO_LARGE;
+    }
+
+    uint8_t *data = realloc(ips->data, ips->data_size + (size_t)patch_size);
+    if (!data) {
+        fclose(f);
+        return IPS_PATCH_TOO_LARGE;
+    }
+    ips->data = data;
+
+    uint8_t *patch = ips->data + ips->data_size;
+    size_t r = fread(patch, 1, (size_t)patch_size, f);
+    fclose(f);
+    if (r != (size_t)patch_size) {
+        return IPS_PATCH_IO_ERROR;
+    }
+
+    if (memcmp(patch, "PATCH", 5) != 0) {
+        return IPS_PATCH_FORMAT_ERROR;
+    }
+
+    size_t pos = 5;
+    while (true) {
+        if (pos + 3 > (size_t)patch_size) {
+            return IPS_PATCH_FORMAT_ERROR;
+        }
+        uint32_t offset = ((uint32_t)patch[pos] << 16) | ((uint32_t)patch[pos + 1] << 8) | patch[pos + 2];
+        if (offset == IPS_EOF_MARKER) {
+            break;
+        }
+        if (pos + 5 > (size_t)patch_size) {
+            return IPS_PATCH_FORMAT_ERROR;
+        }
+        uint32_t size = ((uint32_t)patch[pos + 3] << 8) | patch[pos + 4];
+
+        ips_record_t record = { .offset = offset, .order = (uint32_t)ips->count };
+        if (size == 0) {
+            if (pos + 8 > (size_t)patch_size) {
+                return IPS_PATCH_FORMAT_ERROR;
+            }
+            record.length = ((uint32_t)patch[pos + 5] << 8) | patch[pos + 6];
+            record.data = patch[pos + 7];
+            record.rle = true;
+            pos += 8;
+        } else {
+            if (pos + 5 + size > (size_t)patch_size) {
+                return IPS_PATCH_FORMAT_ERROR;
+            }
+            record.length = size;
+            record.data = (uint32_t)(ips->data_size + pos + 5);
+            pos += 5 + size;
+        }
+
+        if ((int64_t)record.offset + (int64_t)record.length > rom_size) {
+            debugf("IPS patch: write outside ROM bounds at %lu\n", (unsigned long)pos);
+            return IPS_PATCH_FORMAT_ERROR;
+        }
+        if (record.length > 0 && !add_record(ips, &record)) {
+            return IPS_PATCH_TOO_LARGE;
+        }
+    }
+
+    ips->data_size += (size_t)patch_size;
+    return IPS_PATCH_OK;
+}
+
+bool ips_patch_finish(ips_patch_t *ips) {
+    qsort(ips->records, ips->count, sizeof(ips_record_t), compare_records);
+
+    for (size_t i = 0; i < ips->count; i++) {
+        ips->max_length = MAX(ips->max_length, ips->records[i].length);
+        if (i > 0 && ips->records[i].offset < ips->records[i - 1].offset + ips->records[i - 1].length) {
+            ips->overlapping = true;
+        }
+    }
+    // Stacked or sloppy patches may write the same bytes twice, those records are applied in patch order.
+    if (ips->overlapping) {
+        ips->active = malloc(ips->count * sizeof(ips->active[0]));
+        if (!ips->active) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t ips_patch_record_count(const ips_patch_t *ips) {
+    return ips->count;
+}
+
+void ips_patch_apply(ips_patch_t *ips, uint8_t *buffer, uint32_t offset, size_t length) {
+    uint32_t end = offset + (uint32_t)length;
+
+    // Records without overlaps are sorted by end offset too, otherwise none reaches past the longest one.
+    size_t lo = 0;
+    size_t hi = ips->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        const ips_record_t *record = &ips->records[mid];
+        if (record->offset + (ips->overlapping ? ips->max_length : record->length) <= offset) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    size_t active = 0;
+    for (size_t i = lo; i < ips->count && ips->records[i].offset < end; i++) {
+        const ips_record_t *record = &ips->records[i];
+        if (record->offset + record->length <= offset) {
+            continue;
+        }
+        if (ips->overlapping) {
+            ips->active[active++] = record;
+        } else {
+            write_record(ips, record, buffer, offset, end);
+        }
+    }
+    if (active > 0) {
+        qsort(ips->active, active, sizeof(ips->active[0]), compare_order);
+        for (size_t i = 0; i < active; i++) {
+            write_record(ips, ips->active[i], buffer, offset, end);
+        }
+    }
+}
+
+bool ips_patch_apply_file(const char *target_path, const char *ips_path) {
+    FILE *patch = fopen(ips_path, "rb");
+    if (!patch) {
+        return false;
+    }
+    FILE *rom = fopen(target_path, "rb+");
+    if (!rom) {
+        fclose(patch);
+        return false;
+    }
+
+    char magic[5];
+    if (fread(magic, 1, sizeof(magic), patch) != sizeof(magic) || memcmp(magic, "PATCH", sizeof(magic)) != 0) {
+        fclose(rom);
+        fclose(patch);
+        return false;
+    }
+
+    long rom_size = -1;
+    if (fseek(rom, 0, SEEK_END) == 0) {
+        rom_size = ftell(rom);
+    }
+    uint8_t *buf = malloc(UINT16_MAX);
+    bool ok = (rom_size > 0) && buf;
+    while (ok) {
+        uint32_t offset = 0;
+        long pos_before = ftell(patch);
+        if (!read_u24_be(patch, &offset)) {
+            ok = false;
+            break;
+        }
+
+        if (offset == IPS_EOF_MARKER) {
+            break;
+        }
+
+        uint16_t size = 0;
+        if (!read_u16_be(patch, &size)) {
+            ok = false;
+            break;
+        }
+
+        if (size == 0) {
+            uint16_t rle_size = 0;
+            uint8_t value = 0;
+            if (!read_u16_be(patch, &rle_size) || fread(&value, 1, 1, patch) != 1) {
+                ok = false;
+                break;
+            }
+            if ((int64_t)offset + (int64_t)rle_size > rom_size) {
+                debugf("IPS patch: RLE write outside ROM bounds at %lu\n", (unsigned long)pos_before);
+                ok = false;
+                break;
+            }
+            if (fseek(rom, (long)offset, SEEK_SET) != 0) {
+                ok = false;
+                break;
+            }
+            uint8_t fill[256];
+            memset(fill, value, sizeof(fill));
+            uint32_t remaining = rle_size;
+            while (remaining > 0) {
+                uint32_t chunk = remaining > sizeof(fill) ? sizeof(fill) : remaining;
+                if (fwrite(fill, 1, chunk, rom) != chunk) {
+                    ok = false;
+                    break;
+                }
+                remaining -= chunk;
+            }
+        } else {
+            if ((int64_t)offset + (int64_t)size > rom_size) {
+                debugf("IPS patch: write outside ROM bounds at %lu\n", (unsigned long)pos_before);
+                ok = false;
+                break;
+            }
+            if (fread(buf, 1, size, patch) != size) {
+                ok = false;
+                break;
+            }
+            if (fseek(rom, (long)offset, SEEK_SET) != 0 || fwrite(buf, 1, size, rom) != size) {
+                ok = false;
+                break;
+            }
+        }
+    }
+
+    free(buf);
+    if (fclose(rom) != 0) {
+        ok = false;
+    }
+    fclose(patch);
+    return ok;
+}
@@ -0,0 +1,84 @@
+/**
+ * @file ips_patch.h
+ * @brief IPS patch records, applied to ROM data in memory
+ * @ingroup menu
+ */
+
+#ifndef IPS_PATCH_H__
+#define IPS_PATCH_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Result of adding an IPS file. */
+typedef enum {
+    IPS_PATCH_OK = 0,
+    IPS_PATCH_TOO_LARGE,
+    IPS_PATCH_IO_ERROR,
+    IPS_PATCH_FORMAT_ERROR,
+} ips_patch_err_t;
+
+/** @brief Records of one or more IPS files, sorted by offset. */
+typedef struct ips_patch_s ips_patch_t;
+
+/**
+ * @brief Create an empty record list.
+ *
+ * @param max_data Limit on the total size of the IPS files held in memory
+ * @return Record list, or NULL when out of memory
+ */
+ips_patch_t *ips_patch_create(size_t max_data);
+
+/**
+ * @brief Free a record list.
+ */
+void ips_patch_free(ips_patch_t *ips);
+
+/**
+ * @brief Read an IPS file into the record list.
+ *
+ * Files are applied in the order they're added, later records win where
+ * they write the same bytes.
+ *
+ * @param ips Record list
+ * @param ips_path Path of the .ips file
+ * @param rom_size Size of the ROM, records past its end are rejected
+ * @return IPS_PATCH_TOO_LARGE if the file doesn't fit the data limit or memory
+ */
+ips_patch_err_t ips_patch_add(ips_patch_t *ips, const char *ips_path, int64_t rom_size);
+
+/**
+ * @brief Sort the records once every file is added.
+ *
+ * @return false when out of memory
+ */
+bool ips_patch_finish(ips_patch_t *ips);
+
+/** @brief Number of records with data. */
+size_t ips_patch_record_count(const ips_patch_t *ips);
+
+/**
+ * @brief Apply the records to a range of big endian (.z64) ROM data.
+ *
+ * Ranges can be applied in any order and size.
+ *
+ * @param ips Finished record list
+ * @param buffer ROM data
+ * @param offset ROM offset of the data
+ * @param length Length of the data
+ */
+void ips_patch_apply(ips_patch_t *ips, uint8_t *buffer, uint32_t offset, size_t length);
+
+/**
+ * @brief Apply an IPS file to a ROM file in place, one record at a time.
+ *
+ * Seeks and writes for every record, for patches too large to hold in memory.
+ *
+ * @param target_path Path of the big endian ROM file
+ * @param ips_path Path of the .ips file
+ * @return true on success
+ */
+bool ips_patch_apply_file(const char *target_path, const char *ips_path);
+
+#endif
@@ -19,11 +19,15 @@
 #include "menu_state.h"
 #include "menu.h"
 #include "mp3_player.h"
+#include "native_image.h"
 #include "playtime.h"
 #include "png_decoder.h"
+#include "rom_digest.h"
+#include "rom_info.h"
 #include "screensaver.h"
 #include "settings.h"
 #include "sound.h"
+#include "thumb_store.h"
 #include "usb_comm.h"
 #include "virtual_pak.h"
 #include "utils/fs.h"
@@ -578,6 +582,19 @@ static void menu_init (boot_params_t *boot_params) {
     }
     menu->browser.sort_mode = (browser_sort_t)menu->settings.browser_sort_mode;
 
+    png_decoder_set_dither(menu->settings.image_dither_enabled);
+    ui_components_boxart_cache_set_budget((size_t)menu->settings.thumb_cache_kib * 1024);
+    native_image_set_compact_caches(menu->settings.compact_image_cache_enabled);
+
+    thumb_store_init(menu->storage_prefix);
+
+    rom_digest_init(menu->storage_prefix);
+    if (menu->settings.rom_hash_job_enabled) {
+        path_t *digest_root = path_init(menu->storage_prefix, "/");
+        rom_digest_job_start(path_get(digest_root));
+        path_free(digest_root);
+    }
+
     debugf("N64FlashcartMenu debugging...\n");
 }
 
@@ -596,6 +613,12 @@ static void menu_deinit (menu_t *menu) {
     playtime_save(&menu->playtime);
     playtime_free(&menu->playtime);
 
+    rom_info_identity_cache_flush();
+
+    rom_digest_deinit();
+
+    thumb_store_deinit();
+
     screensaver_deinit();
 
     path_free(menu->load.disk_slots.primary.disk_path);
@@ -685,6 +708,10 @@ void menu_run (boot_params_t *boot_params) {
         surface_t *display = display_try_get();
 
         if (display != NULL) {
+            // Once per displayed frame, the loop spins many more times while waiting for a buffer.
+            rom_digest_poll();
+            thumb_store_poll();
+
             actions_update(menu);
             screensaver_update_state(menu);
             screensaver_apply_fps_limit(menu);
@@ -0,0 +1,288 @@
+/**
+ * @file metadata_index.c
+ * @brief Cached existence index for metadata and boxart directories
+ * @ingroup menu
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <libdragon.h>
+
+#include "metadata_index.h"
+#include "utils/fs.h"
+#include "utils/hash.h"
+
+#define METADATA_INDEX_CACHE_SIZE   (32)
+#define METADATA_INDEX_PATH_MAX     (512)
+
+/** @brief Known metadata directory entry. */
+typedef struct {
+    const char *name;
+    bool is_directory;
+} metadata_index_known_t;
+
+// Bit positions in metadata_index_entry_t::known are indices into this table.
+static const metadata_index_known_t metadata_index_known[] = {
+    { "boxart_front.png", false },
+    { "boxart_back.png", false },
+    { "boxart_left.png", false },
+    { "boxart_right.png", false },
+    { "boxart_top.png", false },
+    { "boxart_bottom.png", false },
+    { "gamepak_front.png", false },
+    { "gamepak_back.png", false },
+    { "boxart_front.png.nimg", false },
+    { "boxart_back.png.nimg", false },
+    { "boxart_left.png.nimg", false },
+    { "boxart_right.png.nimg", false },
+    { "boxart_top.png.nimg", false },
+    { "boxart_bottom.png.nimg", false },
+    { "gamepak_front.png.nimg", false },
+    { "gamepak_back.png.nimg", false },
+    { "metadata.ini", false },
+    { "description.txt", false },
+    { "hook.txt", false },
+    { "why_play.txt", false },
+    { "vibe.txt", false },
+    { "notable.txt", false },
+    { "context.txt", false },
+    { "play_curator_note.txt", false },
+    { "tags.txt", false },
+    { "warnings.txt", false },
+    { "museum_card.txt", false },
+    { "trivia_museum.txt", false },
+    { "oddities.txt", false },
+    { "design_quirks.txt", false },
+    { "discovery_prompts.txt", false },
+    { "curator.txt", false },
+    { "museum.txt", false },
+    { "trivia.txt", false },
+    { "reception.txt", false },
+    { "manual", true },
+    { "homebrew", true },
+};
+
+#define METADATA_INDEX_KNOWN_COUNT  ((int)(sizeof(metadata_index_known) / sizeof(metadata_index_known[0])))
+
+_Static_assert(sizeof(metadata_index_known) / sizeof(metadata_index_known[0]) <= 64, "known entries must fit in a 64-bit mask");
+
+/** @brief Cached listing of a single directory. */
+typedef struct {
+    bool valid;
+    bool exists;                /**< Directory itself exists */
+    uint64_t key_hash;
+    char *path;
+    uint32_t last_used_tick;
+    uint64_t known;             /**< Bitmap of metadata_index_known entries present */
+    uint64_t short_subdirs;     /**< Bitmap of single-character [0-9A-Z] subdirectories */
+} metadata_index_entry_t;
+
+static metadata_index_entry_t metadata_index_cache[METADATA_INDEX_CACHE_SIZE];
+static uint32_t metadata_index_tick = 1;
+
+static int metadata_index_known_lookup(const char *name, bool is_directory) {
+    for (int i = 0; i < METADATA_INDEX_KNOWN_COUNT; i++) {
+        if ((metadata_index_known[i].is_directory == is_directory) &&
+            (strcasecmp(metadata_index_known[i].name, name) == 0)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int metadata_index_short_subdir_bit(const char *name) {
+    if (!name || name[0] == '\0' || name[1] != '\0') {
+        return -1;
+    }
+    char c = (char)toupper((unsigned char)name[0]);
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'Z') {
+        return 10 + (c - 'A');
+    }
+    return -1;
+}
+
+static void metadata_index_scan(metadata_index_entry_t *entry) {
+    entry->exists = false;
+    entry->known = 0;
+    entry->short_subdirs = 0;
+
+    dir_t info;
+    int result = dir_findfirst(entry->path, &info);
+    if (result != 0) {
+        // Either missing or empty; only a stat can tell them apart.
+        entry->exists = directory_exists(entry->path);
+        return;
+    }
+
+    entry->exists = true;
+    while (result == 0) {
+        bool is_directory = (info.d_type == DT_DIR);
+        int bit = is_directory ? metadata_index_short_subdir_bit(info.d_name) : -1;
+        if (bit >= 0) {
+            entry->short_subdirs |= (1ULL << bit);
+        } else {
+            int known = metadata_index_known_lookup(info.d_name, is_directory);
+            if (known >= 0) {
+                entry->known |= (1ULL << known);
+            }
+        }
+        result = dir_findnext(entry->path, &info);
+    }
+}
+
+static metadata_index_entry_t *metadata_index_get(const char *directory) {
+    if (!directory || directory[0] == '\0') {
+        return NULL;
+    }
+
+    uint64_t key_hash = fnv1a64_str(directory);
+    metadata_index_entry_t *empty = NULL;
+    metadata_index_entry_t *oldest = &metadata_index_cache[0];
+
+    for (int i = 0; i < METADATA_INDEX_CACHE_SIZE; i++) {
+        metadata_index_entry_t *entry = &metadata_index_cache[i];
+        if (!entry->valid) {
+            if (!empty) {
+                empty = entry;
+            }
+            continue;
+        }
+        if ((entry->key_hash == key_hash) && (strcmp(entry->path, directory) == 0)) {
+            entry->last_used_tick = ++metadata_index_tick;
+            return entry;
+        }
+        if (entry->last_used_tick < oldest->last_used_tick) {
+            oldest = entry;
+        }
+    }
+
+    metadata_index_entry_t *slot = empty ? empty : oldest;
+    free(slot->path);
+    memset(slot, 0, sizeof(*slot));
+    slot->path = strdup(directory);
+    if (!slot->path) {
+        return NULL;
+    }
+    slot->key_hash = key_hash;
+    slot->valid = true;
+    slot->last_used_tick = ++metadata_index_tick;
+    metadata_index_scan(slot);
+    return slot;
+}
+
+// Split "dir/name" into a NUL-terminated parent directory and a name pointer.
+static bool metadata_index_split(const char *path, char *parent, size_t parent_size, const char **name_out) {
+    size_t length = strlen(path);
+    while ((length > 0) && (path[length - 1] == '/')) {
+        length--;
+    }
+
+    const char *separator = NULL;
+    for (size_t i = 0; i < length; i++) {
+        if (path[i] == '/') {
+            separator = &path[i];
+        }
+    }
+    if (!separator) {
+        return false;
+    }
+
+    size_t parent_length = (size_t)(separator - path);
+    if ((parent_length > 0) && (path[parent_length - 1] == ':')) {
+        // Keep the separator for storage roots such as "sd:/".
+        parent_length++;
+    }
+    if ((parent_length == 0) || (parent_length >= parent_size)) {
+        return false;
+    }
+
+    memcpy(parent, path, parent_length);
+    parent[parent_length] = '\0';
+    *name_out = separator + 1;
+    return true;
+}
+
+bool metadata_index_directory_exists(const char *directory) {
+    if (!directory) {
+        return false;
+    }
+
+    char parent[METADATA_INDEX_PATH_MAX];
+    const char *name = NULL;
+    if (!metadata_index_split(directory, parent, sizeof(parent), &name)) {
+        return directory_exists((char *)directory);
+    }
+
+    char child[64];
+    size_t child_length = strcspn(name, "/");
+    if (child_length == 0 || child_length >= sizeof(child)) {
+        return directory_exists((char *)directory);
+    }
+    memcpy(child, name, child_length);
+    child[child_length] = '\0';
+
+    int bit = metadata_index_short_subdir_bit(child);
+    int known = (bit < 0) ? metadata_index_known_lookup(child, true) : -1;
+    if ((bit < 0) && (known < 0)) {
+        return directory_exists((char *)directory);
+    }
+
+    metadata_index_entry_t *entry = metadata_index_get(parent);
+    if (!entry) {
+        return directory_exists((char *)directory);
+    }
+    if (!entry->exists) {
+        return false;
+    }
+    if (bit >= 0) {
+        return (entry->short_subdirs & (1ULL << bit)) != 0;
+    }
+    return (entry->known & (1ULL << known)) != 0;
+}
+
+bool metadata_index_file_exists(const char *directory, const char *filename) {
+    if (!directory || !filename || filename[0] == '\0') {
+        return false;
+    }
+
+    int known = strchr(filename, '/') ? -1 : metadata_index_known_lookup(filename, false);
+    metadata_index_entry_t *entry = (known >= 0) ? metadata_index_get(directory) : NULL;
+    if (entry) {
+        return entry->exists && ((entry->known & (1ULL << known)) != 0);
+    }
+
+    char path[METADATA_INDEX_PATH_MAX];
+    size_t directory_length = strlen(directory);
+    bool has_separator = (directory_length > 0) && (directory[directory_length - 1] == '/');
+    if ((size_t)snprintf(path, sizeof(path), "%s%s%s", directory, has_separator ? "" : "/", filename) >= sizeof(path)) {
+        return false;
+    }
+    return file_exists(path);
+}
+
+bool metadata_index_path_exists(const char *path) {
+    if (!path) {
+        return false;
+    }
+
+    char parent[METADATA_INDEX_PATH_MAX];
+    const char *name = NULL;
+    if (!metadata_index_split(path, parent, sizeof(parent), &name)) {
+        return file_exists((char *)path);
+    }
+    return metadata_index_file_exists(parent, name);
+}
+
+void metadata_index_invalidate(void) {
+    for (int i = 0; i < METADATA_INDEX_CACHE_SIZE; i++) {
+        free(metadata_index_cache[i].path);
+        memset(&metadata_index_cache[i], 0, sizeof(metadata_index_cache[i]));
+    }
+}
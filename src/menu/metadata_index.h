@@ -0,0 +1,54 @@
+/**
+ * @file metadata_index.h
+ * @brief Cached existence index for metadata and boxart directories
+ * @ingroup menu
+ */
+
+#ifndef METADATA_INDEX_H__
+#define METADATA_INDEX_H__
+
+#include <stdbool.h>
+
+/**
+ * @brief Returns true when a directory exists.
+ *
+ * The answer comes from a single cached listing of the parent directory, so
+ * probing several sibling candidates (eg. region fallbacks under
+ * `menu/metadata/N/S/M`) costs one directory read instead of one stat each.
+ * Names the index does not track fall back to a regular stat.
+ *
+ * @param directory Full directory path including the storage prefix
+ * @return true when the directory exists
+ */
+bool metadata_index_directory_exists(const char *directory);
+
+/**
+ * @brief Returns true when a file exists inside a metadata directory.
+ *
+ * Known metadata filenames (boxart and gamepak images, their .nimg sidecars,
+ * metadata.ini and the text sidecars) are answered from a cached listing of
+ * the directory. Other filenames fall back to a regular stat.
+ *
+ * @param directory Full directory path including the storage prefix
+ * @param filename File name inside the directory (no path separators)
+ * @return true when the file exists
+ */
+bool metadata_index_file_exists(const char *directory, const char *filename);
+
+/**
+ * @brief Returns true when a file exists, splitting the path at the last '/'.
+ *
+ * @param path Full file path including the storage prefix
+ * @return true when the file exists
+ */
+bool metadata_index_path_exists(const char *path);
+
+/**
+ * @brief Drop all cached directory listings.
+ *
+ * Listings live for the whole session otherwise, so call this after the menu
+ * creates or deletes files and whenever the browser is re-entered.
+ */
+void metadata_index_invalidate(void);
+
+#endif /* METADATA_INDEX_H__ */
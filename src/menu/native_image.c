@@ -2,20 +2,32 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <miniz.h>
+
+#include "image_convert.h"
+#include "metadata_index.h"
 #include "native_image.h"
 #include "utils/fs.h"
+#include "utils/utils.h"
 
-#define NATIVE_IMAGE_MAGIC (0x4E494D47u)
+#define NATIVE_IMAGE_MAGIC (0x4E494D47u)         /* NIMG: RGBA16 pixels */
+#define NATIVE_IMAGE_COMPACT_MAGIC (0x4E494D43u) /* NIMC: format id and stride, then pixels and TLUT */
+#define NATIVE_IMAGE_BLOCK_MAGIC (0x4E494D32u)   /* NIM2: format id, stride and block rows, then TLUT and row blocks */
 #define NATIVE_IMAGE_MAX_DIM 1024
+#define NATIVE_IMAGE_MAX_BLOCK_SIZE (64 * 1024)
 
 typedef struct {
     uint32_t magic;
     uint32_t width;
     uint32_t height;
     uint32_t size;
+    tex_format_t format;
+    uint32_t stride;
+    uint32_t block_rows;
 } native_image_header_t;
 
 static native_image_error_t g_native_image_last_error = NATIVE_IMAGE_OK;
+static bool g_native_image_compact_caches = false;
 
 static uint32_t native_image_read_be32(const uint8_t *p) {
     return ((uint32_t)p[0] << 24)
@@ -54,6 +66,12 @@ const char *native_image_error_string(native_image_error_t err) {
             return "payload size mismatch";
         case NATIVE_IMAGE_ERR_READ_DATA_FAILED:
             return "payload read failed";
+        case NATIVE_IMAGE_ERR_UNSUPPORTED_FORMAT:
+            return "unsupported pixel format";
+        case NATIVE_IMAGE_ERR_DECOMPRESS_FAILED:
+            return "block decompression failed";
+        case NATIVE_IMAGE_ERR_CHECKSUM_MISMATCH:
+            return "block checksum mismatch";
         default:
             return "unknown error";
     }
@@ -79,87 +97,569 @@ static char *native_image_make_sidecar_path(const char *source_path, const char
     return path;
 }
 
-surface_t *native_image_load_rgba16_file(const char *path, int max_width, int max_height) {
-    if (!path) {
-        native_image_set_last_error(NATIVE_IMAGE_ERR_INVALID_ARGUMENT);
+static int native_image_palette_colors(tex_format_t format) {
+    switch (format) {
+        case FMT_CI8: return 256;
+        case FMT_CI4: return 16;
+        default: return 0;
+    }
+}
+
+size_t native_image_buffer_size(tex_format_t format, int height, int stride) {
+    return ((size_t)height * (size_t)stride) + (native_image_palette_colors(format) * sizeof(uint16_t));
+}
+
+int native_image_format_id(tex_format_t format) {
+    switch (format) {
+        case FMT_RGBA16: return NATIVE_IMAGE_FORMAT_RGBA16;
+        case FMT_CI8: return NATIVE_IMAGE_FORMAT_CI8;
+        case FMT_CI4: return NATIVE_IMAGE_FORMAT_CI4;
+        case FMT_I4: return NATIVE_IMAGE_FORMAT_I4;
+        case FMT_IA8: return NATIVE_IMAGE_FORMAT_IA8;
+        default: return -1;
+    }
+}
+
+bool native_image_format_from_id(uint32_t id, tex_format_t *format) {
+    switch (id) {
+        case NATIVE_IMAGE_FORMAT_RGBA16: *format = FMT_RGBA16; return true;
+        case NATIVE_IMAGE_FORMAT_CI8: *format = FMT_CI8; return true;
+        case NATIVE_IMAGE_FORMAT_CI4: *format = FMT_CI4; return true;
+        case NATIVE_IMAGE_FORMAT_I4: *format = FMT_I4; return true;
+        case NATIVE_IMAGE_FORMAT_IA8: *format = FMT_IA8; return true;
+        default: return false;
+    }
+}
+
+static bool native_image_format_kept(tex_format_t format, uint32_t load_flags) {
+    switch (format) {
+        case FMT_RGBA16: return true;
+        case FMT_CI8:
+        case FMT_CI4: return (load_flags & NATIVE_IMAGE_LOAD_PALETTE) != 0;
+        default: return (load_flags & NATIVE_IMAGE_LOAD_INTENSITY) != 0;
+    }
+}
+
+surface_t *native_image_alloc(tex_format_t format, int width, int height) {
+    surface_t *image = calloc(1, sizeof(surface_t));
+    if (!image) {
         return NULL;
     }
 
-    native_image_set_last_error(NATIVE_IMAGE_OK);
+    if (format == FMT_RGBA16) {
+        *image = surface_alloc(FMT_RGBA16, width, height);
+    } else {
+        int stride = ALIGN(TEX_FORMAT_PIX2BYTES(format, width), 8);
+        size_t size = native_image_buffer_size(format, height, stride);
+        void *buffer = malloc_uncached_aligned(64, size);
+        if (buffer) {
+            memset(buffer, 0, size);
+            *image = surface_make(buffer, format, width, height, stride);
+            image->flags |= SURFACE_FLAGS_OWNEDBUFFER;
+        }
+    }
 
-    FILE *f = fopen(path, "rb");
-    if (!f) {
-        native_image_set_last_error(NATIVE_IMAGE_ERR_OPEN_FAILED);
+    if (!image->buffer) {
+        free(image);
         return NULL;
     }
+    return image;
+}
 
-    uint8_t raw_header[sizeof(native_image_header_t)];
-    if (fread(raw_header, sizeof(raw_header), 1, f) != 1) {
-        fclose(f);
-        native_image_set_last_error(NATIVE_IMAGE_ERR_READ_HEADER_FAILED);
+uint16_t *native_image_get_palette(const surface_t *image) {
+    if (!image || !image->buffer || (native_image_palette_colors(surface_get_format(image)) == 0)) {
+        return NULL;
+    }
+    return (uint16_t *)((uint8_t *)image->buffer + ((size_t)image->height * image->stride));
+}
+
+void native_image_tlut_setup(const surface_t *image) {
+    uint16_t *palette = native_image_get_palette(image);
+    if (!palette) {
+        rdpq_mode_tlut(TLUT_NONE);
+        return;
+    }
+    rdpq_mode_tlut(TLUT_RGBA16);
+    rdpq_tex_upload_tlut(palette, 0, native_image_palette_colors(surface_get_format(image)));
+}
+
+static void native_image_free(surface_t *image) {
+    surface_free(image);
+    free(image);
+}
+
+static void native_image_expand_row(tex_format_t format, uint16_t *dst, const uint8_t *src, int width, const uint16_t *palette) {
+    switch (format) {
+        case FMT_CI8: image_convert_ci_to_rgba16_row(dst, src, width, 8, palette); break;
+        case FMT_CI4: image_convert_ci_to_rgba16_row(dst, src, width, 4, palette); break;
+        case FMT_I4: image_convert_i4_to_rgba16_row(dst, src, width); break;
+        case FMT_IA8: image_convert_ia8_to_rgba16_row(dst, src, width); break;
+        default: memcpy(dst, src, width * sizeof(uint16_t)); break;
+    }
+}
+
+surface_t *native_image_expand_rgba16(const surface_t *image) {
+    if (!image || !image->buffer) {
+        return NULL;
+    }
+
+    tex_format_t format = surface_get_format(image);
+    surface_t *out = native_image_alloc(FMT_RGBA16, image->width, image->height);
+    if (!out) {
+        return NULL;
+    }
+
+    const uint16_t *palette = native_image_get_palette(image);
+    for (int y = 0; y < image->height; y++) {
+        const uint8_t *src = (const uint8_t *)image->buffer + (y * image->stride);
+        uint16_t *dst = (uint16_t *)((uint8_t *)out->buffer + (y * out->stride));
+        native_image_expand_row(format, dst, src, image->width, palette);
+    }
+    return out;
+}
+
+surface_t *native_image_compact(const surface_t *image, uint32_t load_flags) {
+    if (!image || !image->buffer || (surface_get_format(image) != FMT_RGBA16)) {
+        return NULL;
+    }
+
+    const uint16_t *pixels = (const uint16_t *)image->buffer;
+    bool has_alpha = false;
+    if ((load_flags & NATIVE_IMAGE_LOAD_INTENSITY) &&
+        image_convert_rgba16_is_gray(pixels, image->stride, image->width, image->height, &has_alpha)) {
+        surface_t *out = native_image_alloc(has_alpha ? FMT_IA8 : FMT_I4, image->width, image->height);
+        if (out && has_alpha) {
+            image_convert_rgba16_to_ia8(pixels, image->stride, image->width, image->height, out->buffer, out->stride);
+        } else if (out) {
+            image_convert_rgba16_to_i4(pixels, image->stride, image->width, image->height, out->buffer, out->stride);
+        }
+        return out;
+    }
+
+    if (!(load_flags & NATIVE_IMAGE_LOAD_PALETTE)) {
+        return NULL;
+    }
+
+    int colors = image_convert_rgba16_count_colors(pixels, image->stride, image->width, image->height, 16);
+    if (colors < 0) {
+        return NULL;
+    }
+    tex_format_t format = (colors <= 16) ? FMT_CI4 : FMT_CI8;
+    surface_t *out = native_image_alloc(format, image->width, image->height);
+    if (!out) {
         return NULL;
     }
+    int bits = (format == FMT_CI4) ? 4 : 8;
+    if (image_convert_rgba16_to_ci(pixels, image->stride, image->width, image->height,
+                                   out->buffer, out->stride, bits, native_image_get_palette(out)) < 0) {
+        native_image_free(out);
+        return NULL;
+    }
+    return out;
+}
+
+void native_image_set_compact_caches(bool enabled) {
+    g_native_image_compact_caches = enabled;
+}
+
+bool native_image_compact_caches_enabled(void) {
+    return g_native_image_compact_caches;
+}
 
-    native_image_header_t header = {
+static native_image_error_t native_image_read_header(FILE *f, int max_width, int max_height, native_image_header_t *header) {
+    uint8_t raw_header[16];
+    if (fread(raw_header, sizeof(raw_header), 1, f) != 1) {
+        return NATIVE_IMAGE_ERR_READ_HEADER_FAILED;
+    }
+
+    *header = (native_image_header_t){
         .magic = native_image_read_be32(&raw_header[0]),
         .width = native_image_read_be32(&raw_header[4]),
         .height = native_image_read_be32(&raw_header[8]),
         .size = native_image_read_be32(&raw_header[12]),
+        .format = FMT_RGBA16,
+        .stride = 0,
+        .block_rows = 0,
     };
 
-    bool invalid = (header.magic != NATIVE_IMAGE_MAGIC)
-        || (header.width == 0) || (header.height == 0)
-        || (header.width > NATIVE_IMAGE_MAX_DIM) || (header.height > NATIVE_IMAGE_MAX_DIM)
-        || (max_width > 0 && (int)header.width > max_width)
-        || (max_height > 0 && (int)header.height > max_height);
+    if ((header->magic == NATIVE_IMAGE_COMPACT_MAGIC) || (header->magic == NATIVE_IMAGE_BLOCK_MAGIC)) {
+        uint8_t raw_extra[16];
+        size_t extra_size = (header->magic == NATIVE_IMAGE_BLOCK_MAGIC) ? 16 : 8;
+        if (fread(raw_extra, extra_size, 1, f) != 1) {
+            return NATIVE_IMAGE_ERR_READ_HEADER_FAILED;
+        }
+        if (!native_image_format_from_id(native_image_read_be32(&raw_extra[0]), &header->format)) {
+            return NATIVE_IMAGE_ERR_UNSUPPORTED_FORMAT;
+        }
+        header->stride = native_image_read_be32(&raw_extra[4]);
+        if (header->magic == NATIVE_IMAGE_BLOCK_MAGIC) {
+            header->block_rows = native_image_read_be32(&raw_extra[8]);
+        }
+    }
+
+    bool invalid = ((header->magic != NATIVE_IMAGE_MAGIC) && (header->magic != NATIVE_IMAGE_COMPACT_MAGIC) && (header->magic != NATIVE_IMAGE_BLOCK_MAGIC))
+        || (header->width == 0) || (header->height == 0)
+        || (header->width > NATIVE_IMAGE_MAX_DIM) || (header->height > NATIVE_IMAGE_MAX_DIM)
+        || (max_width > 0 && (int)header->width > max_width)
+        || (max_height > 0 && (int)header->height > max_height);
     if (invalid) {
-        fclose(f);
-        native_image_set_last_error(NATIVE_IMAGE_ERR_INVALID_HEADER);
-        return NULL;
+        return NATIVE_IMAGE_ERR_INVALID_HEADER;
     }
 
-    surface_t *image = calloc(1, sizeof(surface_t));
-    if (!image) {
-        fclose(f);
-        native_image_set_last_error(NATIVE_IMAGE_ERR_OUT_OF_MEMORY);
-        return NULL;
+    // Same row pitch as native_image_alloc, so payloads can be read straight into surfaces.
+    uint32_t stride = ALIGN(TEX_FORMAT_PIX2BYTES(header->format, header->width), 8);
+    if ((header->stride != 0) && (header->stride != stride)) {
+        return NATIVE_IMAGE_ERR_SIZE_MISMATCH;
+    }
+    header->stride = stride;
+    if (header->size != native_image_buffer_size(header->format, header->height, stride)) {
+        return NATIVE_IMAGE_ERR_SIZE_MISMATCH;
     }
 
-    *image = surface_alloc(FMT_RGBA16, header.width, header.height);
-    size_t expected_size = (size_t)image->height * (size_t)image->stride;
-    if (!image->buffer || header.size != expected_size) {
-        native_image_error_t err = !image->buffer ? NATIVE_IMAGE_ERR_BUFFER_ALLOC_FAILED : NATIVE_IMAGE_ERR_SIZE_MISMATCH;
-        if (image->buffer) {
-            surface_free(image);
+    if (header->magic == NATIVE_IMAGE_BLOCK_MAGIC) {
+        if ((header->block_rows == 0) || (header->block_rows > header->height)
+            || ((header->block_rows * stride) > NATIVE_IMAGE_MAX_BLOCK_SIZE)) {
+            return NATIVE_IMAGE_ERR_INVALID_HEADER;
         }
-        free(image);
+    }
+
+    return NATIVE_IMAGE_OK;
+}
+
+/**
+ * Read one NIM2 block: packed size and CRC32 of the unpacked bytes, then the
+ * data, stored raw when deflating did not make it smaller.
+ */
+static native_image_error_t native_image_read_block(native_image_reader_t *reader, uint8_t *dst, size_t raw_size) {
+    uint8_t raw_header[8];
+    if (fread(raw_header, sizeof(raw_header), 1, reader->file) != 1) {
+        return NATIVE_IMAGE_ERR_READ_DATA_FAILED;
+    }
+
+    size_t packed_size = native_image_read_be32(&raw_header[0]);
+    uint32_t crc = native_image_read_be32(&raw_header[4]);
+    if ((packed_size == 0) || (packed_size > raw_size)) {
+        return NATIVE_IMAGE_ERR_DECOMPRESS_FAILED;
+    }
+
+    if (packed_size == raw_size) {
+        if (fread(dst, raw_size, 1, reader->file) != 1) {
+            return NATIVE_IMAGE_ERR_READ_DATA_FAILED;
+        }
+    } else {
+        if (fread(reader->packed, packed_size, 1, reader->file) != 1) {
+            return NATIVE_IMAGE_ERR_READ_DATA_FAILED;
+        }
+        tinfl_decompressor *inflator = (tinfl_decompressor *)reader->inflator;
+        tinfl_init(inflator);
+        size_t in_size = packed_size;
+        size_t out_size = raw_size;
+        tinfl_status status = tinfl_decompress(inflator, reader->packed, &in_size, dst, dst, &out_size,
+            TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+        if ((status != TINFL_STATUS_DONE) || (out_size != raw_size)) {
+            return NATIVE_IMAGE_ERR_DECOMPRESS_FAILED;
+        }
+    }
+
+    if ((uint32_t)mz_crc32(MZ_CRC32_INIT, dst, raw_size) != crc) {
+        return NATIVE_IMAGE_ERR_CHECKSUM_MISMATCH;
+    }
+    return NATIVE_IMAGE_OK;
+}
+
+bool native_image_reader_open(native_image_reader_t *reader, const char *path, int max_width, int max_height) {
+    if (!reader || !path) {
+        native_image_set_last_error(NATIVE_IMAGE_ERR_INVALID_ARGUMENT);
+        return false;
+    }
+
+    memset(reader, 0, sizeof(*reader));
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        native_image_set_last_error(NATIVE_IMAGE_ERR_OPEN_FAILED);
+        return false;
+    }
+
+    native_image_header_t header;
+    native_image_error_t err = native_image_read_header(f, max_width, max_height, &header);
+    if (err != NATIVE_IMAGE_OK) {
         fclose(f);
         native_image_set_last_error(err);
+        return false;
+    }
+
+    reader->file = f;
+    reader->format = header.format;
+    reader->width = header.width;
+    reader->height = header.height;
+    reader->stride = header.stride;
+    reader->block_rows = header.block_rows;
+
+    int colors = native_image_palette_colors(header.format);
+    if (colors > 0) {
+        reader->palette = malloc(colors * sizeof(uint16_t));
+        if (!reader->palette) {
+            native_image_reader_close(reader);
+            native_image_set_last_error(NATIVE_IMAGE_ERR_OUT_OF_MEMORY);
+            return false;
+        }
+    }
+
+    if (header.block_rows > 0) {
+        size_t block_size = (size_t)header.block_rows * header.stride;
+        reader->block = malloc(block_size);
+        reader->packed = malloc(block_size);
+        reader->inflator = tinfl_decompressor_alloc();
+        if (!reader->block || !reader->packed || !reader->inflator) {
+            native_image_reader_close(reader);
+            native_image_set_last_error(NATIVE_IMAGE_ERR_OUT_OF_MEMORY);
+            return false;
+        }
+        // The TLUT is the first block, ahead of the rows.
+        if (colors > 0) {
+            err = native_image_read_block(reader, (uint8_t *)reader->palette, colors * sizeof(uint16_t));
+            if (err != NATIVE_IMAGE_OK) {
+                native_image_reader_close(reader);
+                native_image_set_last_error(err);
+                return false;
+            }
+        }
+    } else {
+        reader->row_buffer = malloc(header.stride);
+        if (!reader->row_buffer) {
+            native_image_reader_close(reader);
+            native_image_set_last_error(NATIVE_IMAGE_ERR_OUT_OF_MEMORY);
+            return false;
+        }
+        // The TLUT trails the pixel rows, so fetch it once before streaming rows.
+        if (colors > 0) {
+            long data_offset = ftell(f);
+            bool ok = (data_offset >= 0)
+                && (fseek(f, data_offset + ((long)header.height * header.stride), SEEK_SET) == 0)
+                && (fread(reader->palette, colors * sizeof(uint16_t), 1, f) == 1)
+                && (fseek(f, data_offset, SEEK_SET) == 0);
+            if (!ok) {
+                native_image_reader_close(reader);
+                native_image_set_last_error(NATIVE_IMAGE_ERR_READ_DATA_FAILED);
+                return false;
+            }
+        }
+    }
+
+    native_image_set_last_error(NATIVE_IMAGE_OK);
+    return true;
+}
+
+/**
+ * Read rows either expanded to RGBA16 or in the stored format, @p dst_stride
+ * bytes apart.
+ */
+static int native_image_reader_read(native_image_reader_t *reader, uint8_t *dst, size_t dst_stride, int rows, bool expand) {
+    rows = MIN(rows, reader->height - reader->next_row);
+    if (rows <= 0) {
+        return 0;
+    }
+
+    bool direct = (dst_stride == (size_t)reader->stride) && (!expand || (reader->format == FMT_RGBA16));
+    if ((reader->block_rows == 0) && direct) {
+        if (fread(dst, (size_t)rows * reader->stride, 1, reader->file) != 1) {
+            native_image_set_last_error(NATIVE_IMAGE_ERR_READ_DATA_FAILED);
+            return -1;
+        }
+        reader->next_row += rows;
+        return rows;
+    }
+
+    for (int y = 0; y < rows; y++) {
+        int row = reader->next_row + y;
+        const uint8_t *src;
+        if (reader->block_rows == 0) {
+            if (fread(reader->row_buffer, reader->stride, 1, reader->file) != 1) {
+                native_image_set_last_error(NATIVE_IMAGE_ERR_READ_DATA_FAILED);
+                return -1;
+            }
+            src = reader->row_buffer;
+        } else {
+            if (row >= (reader->block_first_row + reader->block_row_count)) {
+                int count = MIN(reader->block_rows, reader->height - row);
+                native_image_error_t err = native_image_read_block(reader, reader->block, (size_t)count * reader->stride);
+                if (err != NATIVE_IMAGE_OK) {
+                    native_image_set_last_error(err);
+                    return -1;
+                }
+                reader->block_first_row = row;
+                reader->block_row_count = count;
+            }
+            src = reader->block + ((row - reader->block_first_row) * reader->stride);
+        }
+
+        uint8_t *dst_row = dst + (y * dst_stride);
+        if (expand) {
+            native_image_expand_row(reader->format, (uint16_t *)dst_row, src, reader->width, reader->palette);
+        } else {
+            memcpy(dst_row, src, MIN((size_t)reader->stride, dst_stride));
+        }
+    }
+
+    reader->next_row += rows;
+    return rows;
+}
+
+int native_image_reader_read_rows(native_image_reader_t *reader, uint16_t *dst, size_t dst_stride, int rows) {
+    if (!reader || !reader->file || !dst) {
+        native_image_set_last_error(NATIVE_IMAGE_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+    return native_image_reader_read(reader, (uint8_t *)dst, dst_stride, rows, true);
+}
+
+void native_image_reader_close(native_image_reader_t *reader) {
+    if (!reader) {
+        return;
+    }
+    if (reader->file) {
+        fclose(reader->file);
+    }
+    free(reader->row_buffer);
+    free(reader->palette);
+    free(reader->block);
+    free(reader->packed);
+    if (reader->inflator) {
+        tinfl_decompressor_free((tinfl_decompressor *)reader->inflator);
+    }
+    memset(reader, 0, sizeof(*reader));
+}
+
+bool native_image_reader_open_sidecar(native_image_reader_t *reader, const char *source_path, const char *sidecar_extension, int max_width, int max_height) {
+    char *path = native_image_make_sidecar_path(source_path, sidecar_extension);
+    if (!path) {
+        return false;
+    }
+    bool opened = native_image_reader_open(reader, path, max_width, max_height);
+    free(path);
+    return opened;
+}
+
+surface_t *native_image_reader_alloc_surface(native_image_reader_t *reader, uint32_t load_flags) {
+    tex_format_t format = native_image_format_kept(reader->format, load_flags) ? reader->format : FMT_RGBA16;
+    surface_t *image = native_image_alloc(format, reader->width, reader->height);
+    if (!image) {
+        native_image_set_last_error(NATIVE_IMAGE_ERR_BUFFER_ALLOC_FAILED);
         return NULL;
     }
 
-    if (fread(image->buffer, expected_size, 1, f) != 1) {
-        surface_free(image);
-        free(image);
-        fclose(f);
-        native_image_set_last_error(NATIVE_IMAGE_ERR_READ_DATA_FAILED);
+    if ((format == reader->format) && (image->stride != reader->stride)) {
+        native_image_free(image);
+        native_image_set_last_error(NATIVE_IMAGE_ERR_SIZE_MISMATCH);
         return NULL;
     }
 
-    fclose(f);
-    native_image_set_last_error(NATIVE_IMAGE_OK);
+    uint16_t *palette = native_image_get_palette(image);
+    if (palette) {
+        memcpy(palette, reader->palette, native_image_palette_colors(format) * sizeof(uint16_t));
+    }
     return image;
 }
 
-surface_t *native_image_load_sidecar_rgba16(const char *source_path, const char *sidecar_extension, int max_width, int max_height) {
+int native_image_reader_read_surface(native_image_reader_t *reader, surface_t *image, int rows) {
+    if (!reader || !reader->file || !image || !image->buffer) {
+        native_image_set_last_error(NATIVE_IMAGE_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+    uint8_t *dst = (uint8_t *)image->buffer + ((size_t)reader->next_row * image->stride);
+    bool expand = (surface_get_format(image) != reader->format);
+    return native_image_reader_read(reader, dst, image->stride, rows, expand);
+}
+
+int native_image_reader_read_downscaled(native_image_reader_t *reader, image_convert_downscale_t *downscaler, uint16_t *row, surface_t *image, int rows) {
+    if (!reader || !reader->file || !downscaler || !row || !image || !image->buffer) {
+        native_image_set_last_error(NATIVE_IMAGE_ERR_INVALID_ARGUMENT);
+        return -1;
+    }
+
+    int read = 0;
+    while ((read < rows) && (reader->next_row < reader->height)) {
+        int src_y = reader->next_row;
+        if (native_image_reader_read(reader, (uint8_t *)row, reader->width * sizeof(uint16_t), 1, true) != 1) {
+            return -1;
+        }
+        image_convert_downscale_push_rgba16_row(downscaler, row, src_y, image->buffer, image->stride, false);
+        read++;
+    }
+
+    if ((read > 0) && (reader->next_row >= reader->height)) {
+        image_convert_downscale_finish(downscaler, image->buffer, image->stride, false);
+    }
+    return read;
+}
+
+/** Read a whole image from an open reader, which is closed afterwards. */
+static surface_t *native_image_load_reader(native_image_reader_t *reader, int target_width, int target_height, uint32_t load_flags) {
+    int width = reader->width;
+    int height = reader->height;
+    bool downscale = (target_width > 0) && (target_height > 0) && image_convert_fit_size(&width, &height, target_width, target_height);
+
+    surface_t *image = NULL;
+    if (!downscale) {
+        image = native_image_reader_alloc_surface(reader, load_flags);
+        if (image && (native_image_reader_read_surface(reader, image, reader->height) != reader->height)) {
+            native_image_free(image);
+            image = NULL;
+        }
+    } else {
+        image_convert_downscale_t downscaler;
+        uint16_t *row = malloc(reader->width * sizeof(uint16_t));
+        image = native_image_alloc(FMT_RGBA16, width, height);
+        if (!row || !image || !image_convert_downscale_init(&downscaler, reader->width, reader->height, width, height)) {
+            native_image_set_last_error(NATIVE_IMAGE_ERR_BUFFER_ALLOC_FAILED);
+            if (image) {
+                native_image_free(image);
+                image = NULL;
+            }
+        } else {
+            if (native_image_reader_read_downscaled(reader, &downscaler, row, image, reader->height) != reader->height) {
+                native_image_free(image);
+                image = NULL;
+            }
+            image_convert_downscale_free(&downscaler);
+        }
+        free(row);
+    }
+
+    native_image_reader_close(reader);
+    if (image) {
+        native_image_set_last_error(NATIVE_IMAGE_OK);
+    }
+    return image;
+}
+
+surface_t *native_image_load_file_fitted(const char *path, int max_width, int max_height, int target_width, int target_height, uint32_t load_flags) {
+    native_image_reader_t reader;
+    if (!native_image_reader_open(&reader, path, max_width, max_height)) {
+        return NULL;
+    }
+    return native_image_load_reader(&reader, target_width, target_height, load_flags);
+}
+
+surface_t *native_image_load_file(const char *path, int max_width, int max_height, uint32_t load_flags) {
+    return native_image_load_file_fitted(path, max_width, max_height, 0, 0, load_flags);
+}
+
+surface_t *native_image_load_rgba16_file(const char *path, int max_width, int max_height) {
+    return native_image_load_file(path, max_width, max_height, NATIVE_IMAGE_LOAD_RGBA16);
+}
+
+surface_t *native_image_load_sidecar_fitted(const char *source_path, const char *sidecar_extension, int max_width, int max_height,
+                                            int target_width, int target_height, uint32_t load_flags) {
     char *sidecar_path = native_image_make_sidecar_path(source_path, sidecar_extension);
     if (!sidecar_path) {
         return NULL;
     }
 
     surface_t *image = NULL;
-    if (file_exists(sidecar_path)) {
-        image = native_image_load_rgba16_file(sidecar_path, max_width, max_height);
+    if (metadata_index_path_exists(sidecar_path)) {
+        image = native_image_load_file_fitted(sidecar_path, max_width, max_height, target_width, target_height, load_flags);
     } else {
         native_image_set_last_error(NATIVE_IMAGE_ERR_SIDECAR_MISSING);
     }
@@ -168,13 +668,21 @@ surface_t *native_image_load_sidecar_rgba16(const char *source_path, const char
     return image;
 }
 
+surface_t *native_image_load_sidecar(const char *source_path, const char *sidecar_extension, int max_width, int max_height, uint32_t load_flags) {
+    return native_image_load_sidecar_fitted(source_path, sidecar_extension, max_width, max_height, 0, 0, load_flags);
+}
+
+surface_t *native_image_load_sidecar_rgba16(const char *source_path, const char *sidecar_extension, int max_width, int max_height) {
+    return native_image_load_sidecar(source_path, sidecar_extension, max_width, max_height, NATIVE_IMAGE_LOAD_RGBA16);
+}
+
 bool native_image_sidecar_exists(const char *source_path, const char *sidecar_extension) {
     char *sidecar_path = native_image_make_sidecar_path(source_path, sidecar_extension);
     if (!sidecar_path) {
         return false;
     }
 
-    bool exists = file_exists(sidecar_path);
+    bool exists = metadata_index_path_exists(sidecar_path);
     free(sidecar_path);
     return exists;
 }
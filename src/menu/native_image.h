@@ -3,6 +3,9 @@
 
 #include <libdragon.h>
 #include <stdbool.h>
+#include <stdio.h>
+
+#include "image_convert.h"
 
 typedef enum {
     NATIVE_IMAGE_OK = 0,
@@ -15,12 +18,145 @@ typedef enum {
     NATIVE_IMAGE_ERR_BUFFER_ALLOC_FAILED,
     NATIVE_IMAGE_ERR_SIZE_MISMATCH,
     NATIVE_IMAGE_ERR_READ_DATA_FAILED,
+    NATIVE_IMAGE_ERR_UNSUPPORTED_FORMAT,
+    NATIVE_IMAGE_ERR_DECOMPRESS_FAILED,
+    NATIVE_IMAGE_ERR_CHECKSUM_MISMATCH,
 } native_image_error_t;
 
+/** @brief Pixel format ids stored in compact native images and caches. */
+typedef enum {
+    NATIVE_IMAGE_FORMAT_RGBA16 = 0,
+    NATIVE_IMAGE_FORMAT_CI8 = 1,
+    NATIVE_IMAGE_FORMAT_CI4 = 2,
+    NATIVE_IMAGE_FORMAT_I4 = 3,
+    NATIVE_IMAGE_FORMAT_IA8 = 4,
+} native_image_format_t;
+
+/** @brief Formats a caller can draw natively; anything else is expanded to RGBA16 on load. */
+typedef enum {
+    NATIVE_IMAGE_LOAD_RGBA16 = 0,
+    NATIVE_IMAGE_LOAD_PALETTE = (1 << 0),   /**< Keep CI8/CI4, drawn with native_image_tlut_setup */
+    NATIVE_IMAGE_LOAD_INTENSITY = (1 << 1), /**< Keep I4/IA8 */
+} native_image_load_flags_t;
+
+surface_t *native_image_load_file(const char *path, int max_width, int max_height, uint32_t load_flags);
+surface_t *native_image_load_sidecar(const char *source_path, const char *sidecar_extension, int max_width, int max_height, uint32_t load_flags);
 surface_t *native_image_load_rgba16_file(const char *path, int max_width, int max_height);
+
+/**
+ * @brief Load a native image box filtered to fit inside a target size.
+ *
+ * Rows are streamed through the downscaler, so only the fitted RGBA16
+ * surface is allocated. Images that already fit, or a target of 0x0, load
+ * as native_image_load_file would.
+ */
+surface_t *native_image_load_file_fitted(const char *path, int max_width, int max_height, int target_width, int target_height, uint32_t load_flags);
+surface_t *native_image_load_sidecar_fitted(const char *source_path, const char *sidecar_extension, int max_width, int max_height,
+                                            int target_width, int target_height, uint32_t load_flags);
 surface_t *native_image_load_sidecar_rgba16(const char *source_path, const char *sidecar_extension, int max_width, int max_height);
 bool native_image_sidecar_exists(const char *source_path, const char *sidecar_extension);
 native_image_error_t native_image_get_last_error(void);
 const char *native_image_error_string(native_image_error_t err);
 
+/**
+ * @brief Allocate a surface in any supported format.
+ *
+ * CI8 and CI4 surfaces carry their full TLUT (256 or 16 RGBA16 entries)
+ * directly after the pixel rows, in the same buffer.
+ */
+surface_t *native_image_alloc(tex_format_t format, int width, int height);
+size_t native_image_buffer_size(tex_format_t format, int height, int stride);
+uint16_t *native_image_get_palette(const surface_t *image);
+int native_image_format_id(tex_format_t format); /**< native_image_format_t, or -1 if not storable */
+bool native_image_format_from_id(uint32_t id, tex_format_t *format);
+
+/**
+ * @brief Select the TLUT for drawing @p image, inside an rdpq_mode_push block.
+ */
+void native_image_tlut_setup(const surface_t *image);
+
+surface_t *native_image_expand_rgba16(const surface_t *image);
+
+/**
+ * @brief Convert an RGBA16 image to the smallest format allowed by @p load_flags.
+ *
+ * Images with 16 colours or fewer become CI4, other colour images are
+ * quantized to CI8, and grey images become I4 or IA8 when intensity formats
+ * are allowed.
+ *
+ * @return A new surface, or NULL if the image cannot be made smaller.
+ */
+surface_t *native_image_compact(const surface_t *image, uint32_t load_flags);
+
+/**
+ * @brief Incremental reader that hands out an image a few rows at a time.
+ *
+ * Rows of every stored format are expanded to RGBA16 as they are read, so
+ * callers can stream a large image into small bands instead of allocating
+ * the whole surface up front.
+ *
+ * NIM2 images are split into blocks of rows, each deflated (unless that does
+ * not help) and protected by a CRC32; a truncated or damaged file fails with
+ * an error instead of showing garbage.
+ */
+typedef struct {
+    FILE *file;
+    tex_format_t format;  /**< Stored pixel format */
+    int width;
+    int height;
+    int stride;           /**< Stored bytes per row */
+    int next_row;         /**< Next row returned by native_image_reader_read_rows */
+    uint8_t *row_buffer;
+    uint16_t *palette;    /**< TLUT of CI8/CI4 images, read when opening */
+    int block_rows;       /**< Rows per block of a NIM2 image, 0 for uncompressed images */
+    int block_first_row;  /**< First row held in block */
+    int block_row_count;  /**< Rows held in block */
+    uint8_t *block;       /**< Current block, inflated and checked */
+    uint8_t *packed;      /**< Compressed block staging */
+    void *inflator;       /**< tinfl_decompressor */
+} native_image_reader_t;
+
+bool native_image_reader_open(native_image_reader_t *reader, const char *path, int max_width, int max_height);
+
+/**
+ * @brief Read up to @p rows rows as RGBA16 into @p dst.
+ *
+ * @return Number of rows read, 0 once the image is complete, or -1 on error.
+ */
+int native_image_reader_read_rows(native_image_reader_t *reader, uint16_t *dst, size_t dst_stride, int rows);
+bool native_image_reader_open_sidecar(native_image_reader_t *reader, const char *source_path, const char *sidecar_extension, int max_width, int max_height);
+
+/**
+ * @brief Allocate the surface a reader's image loads into.
+ *
+ * The stored format is kept when @p load_flags allow it (the palette is
+ * copied in), otherwise the surface is RGBA16.
+ */
+surface_t *native_image_reader_alloc_surface(native_image_reader_t *reader, uint32_t load_flags);
+
+/**
+ * @brief Read the next @p rows rows into a surface from native_image_reader_alloc_surface.
+ *
+ * Chunked callers call this until every row is read, returning to the
+ * frame loop in between.
+ *
+ * @return Number of rows read, 0 once the image is complete, or -1 on error.
+ */
+int native_image_reader_read_surface(native_image_reader_t *reader, surface_t *image, int rows);
+/**
+ * @brief Read the next @p rows rows through a downscaler.
+ *
+ * @p row holds one RGBA16 source row, @p image is an RGBA16 surface of the
+ * downscaler's output size. The last output row is written when the final
+ * source row is read. Native images already have RGBA16 precision, so the
+ * output is not dithered and every load of an image gives the same pixels.
+ *
+ * @return Number of rows read, 0 once the image is complete, or -1 on error.
+ */
+int native_image_reader_read_downscaled(native_image_reader_t *reader, image_convert_downscale_t *downscaler, uint16_t *row, surface_t *image, int rows);
+void native_image_reader_close(native_image_reader_t *reader);
+
+void native_image_set_compact_caches(bool enabled);
+bool native_image_compact_caches_enabled(void);
+
 #endif
@@ -0,0 +1,86 @@
+/**
+ * @file patch_source.c
+ * @brief Random access reads of the source ROM for patch decoders
+ * @ingroup menu
+ */
+
+#include <string.h>
+
+#include "patch_source.h"
+#include "utils/byteswap.h"
+#include "utils/utils.h"
+
+bool patch_source_open(patch_source_t *source, const char *path, rom_endianness_t endianness) {
+    memset(source, 0, sizeof(*source));
+    source->endianness = endianness;
+    source->file = fopen(path, "rb");
+    if (!source->file) {
+        return false;
+    }
+    long size;
+    if (fseek(source->file, 0, SEEK_END) != 0 || (size = ftell(source->file)) < 0) {
+        patch_source_close(source);
+        return false;
+    }
+    source->size = (uint32_t)size;
+    return true;
+}
+
+void patch_source_close(patch_source_t *source) {
+    if (source->file) {
+        fclose(source->file);
+        source->file = NULL;
+    }
+}
+
+void patch_source_set_window(patch_source_t *source, const uint8_t *window, uint32_t offset, size_t length) {
+    source->window = length > 0 ? window : NULL;
+    source->window_offset = offset;
+    source->window_length = length;
+}
+
+bool patch_source_read(patch_source_t *source, int64_t offset, uint8_t *data, size_t length) {
+    if (offset < 0 || (uint64_t)offset + length > source->size) {
+        return false;
+    }
+
+    uint32_t position = (uint32_t)offset;
+    while (length > 0) {
+        const uint8_t *from;
+        size_t available;
+
+        if (source->window && position >= source->window_offset && position - source->window_offset < source->window_length) {
+            from = source->window + (position - source->window_offset);
+            available = source->window_length - (position - source->window_offset);
+        } else {
+            if (position < source->block_offset || position - source->block_offset >= source->block_length) {
+                // Blocks are word aligned, so they can be converted to big endian as they are.
+                uint32_t block_offset = position & ~(uint32_t)(PATCH_SOURCE_BLOCK_SIZE - 1);
+                source->block_length = 0;
+                if (fseek(source->file, (long)block_offset, SEEK_SET) != 0) {
+                    return false;
+                }
+                size_t n = fread(source->block, 1, PATCH_SOURCE_BLOCK_SIZE, source->file);
+                if (source->endianness == ENDIANNESS_BYTE_SWAP) {
+                    byteswap_16(source->block, n);
+                } else if (source->endianness == ENDIANNESS_LITTLE) {
+                    byteswap_32(source->block, n);
+                }
+                source->block_offset = block_offset;
+                source->block_length = (uint32_t)n;
+                if (position - block_offset >= n) {
+                    return false;
+                }
+            }
+            from = source->block + (position - source->block_offset);
+            available = source->block_length - (position - source->block_offset);
+        }
+
+        size_t n = MIN(length, available);
+        memcpy(data, from, n);
+        position += (uint32_t)n;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file patch_source.h
+ * @brief Random access reads of the source ROM for patch decoders
+ * @ingroup menu
+ */
+
+#ifndef PATCH_SOURCE_H__
+#define PATCH_SOURCE_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "rom_info.h"
+
+#define PATCH_SOURCE_BLOCK_SIZE (16 * 1024)
+
+/**
+ * @brief Read back patched ROM data produced by an earlier decode call.
+ *
+ * @param context Context given with the reader
+ * @param offset Target offset
+ * @param buffer Output buffer
+ * @param length Number of bytes to read
+ * @return true on success
+ */
+typedef bool patch_target_reader_t(void *context, uint32_t offset, uint8_t *buffer, size_t length);
+
+/** @brief Source ROM reader, converting to big endian (.z64) on the way. */
+typedef struct {
+    FILE *file;
+    rom_endianness_t endianness;
+    uint32_t size;
+    uint8_t block[PATCH_SOURCE_BLOCK_SIZE];
+    uint32_t block_offset;
+    uint32_t block_length;
+    const uint8_t *window;
+    uint32_t window_offset;
+    size_t window_length;
+} patch_source_t;
+
+/**
+ * @brief Open the source ROM.
+ *
+ * @param source Reader to initialize
+ * @param path Path of the source ROM
+ * @param endianness Byte order of the source ROM file
+ * @return true on success
+ */
+bool patch_source_open(patch_source_t *source, const char *path, rom_endianness_t endianness);
+
+/**
+ * @brief Close the source ROM.
+ */
+void patch_source_close(patch_source_t *source);
+
+/**
+ * @brief Serve reads in a range from memory instead of the file.
+ *
+ * @param source Reader
+ * @param window Big endian source data, must stay valid until replaced
+ * @param offset Source offset of the data
+ * @param length Length of the data, 0 to disable
+ */
+void patch_source_set_window(patch_source_t *source, const uint8_t *window, uint32_t offset, size_t length);
+
+/**
+ * @brief Read source ROM data.
+ *
+ * @param source Reader
+ * @param offset Source offset
+ * @param data Output buffer
+ * @param length Number of bytes to read
+ * @return false if the range isn't inside the source ROM or can't be read
+ */
+bool patch_source_read(patch_source_t *source, int64_t offset, uint8_t *data, size_t length);
+
+#endif /* PATCH_SOURCE_H__ */
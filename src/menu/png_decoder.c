@@ -5,9 +5,26 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <libdragon.h>
 #include <libspng/spng/spng.h>
+#include "image_convert.h"
+#include "native_image.h"
 #include "png_decoder.h"
 #include "utils/fs.h"
+#include "utils/utils.h"
+
+#define PNG_DECODER_JOB_SLOTS       (32)
+#define PNG_DECODER_ACTIVE_MAX      (2)
+#define PNG_DECODER_ROWS_PER_SLICE  (2)
+#define PNG_DECODER_NATIVE_ROWS_PER_SLICE   (16)    /* Native rows are a copy, or one NIM2 block */
+
+// Poll budget limits. The budget is the frame time left over by the rest of
+// the menu loop, so it shrinks on heavy frames and grows while idle.
+#define PNG_DECODER_FRAME_US        (16667)
+#define PNG_DECODER_FRAME_MARGIN_US (2000)
+#define PNG_DECODER_BUDGET_MIN_US   (500)
+#define PNG_DECODER_BUDGET_MAX_US   (8000)
 
 /** @brief PNG File Information Structure. */
 typedef struct {
@@ -17,64 +34,209 @@ typedef struct {
     surface_t *image; /**< Image surface */
     uint8_t *row_buffer; /**< Row buffer */
     int decoded_rows; /**< Number of decoded rows */
-    png_callback_t *callback; /**< Callback function */
-    void *callback_data; /**< Callback data */
     uint8_t *owned_png_buffer; /**< Owned PNG buffer when decoding from memory */
     size_t owned_png_buffer_size; /**< Size of owned PNG buffer */
+    bool downscale; /**< Rows are box filtered into a smaller image */
+    image_convert_downscale_t downscaler; /**< Downscaler state */
+    bool native; /**< Rows come from a native image instead of the PNG */
+    native_image_reader_t native_reader; /**< Native image reader state */
 } png_decoder_t;
 
-static png_decoder_t *decoder;
-static const int PNG_DECODER_ROWS_PER_POLL = 6;
-static void png_decoder_deinit (bool free_image);
+/** @brief Scheduler job slot state. */
+typedef enum {
+    PNG_JOB_FREE,
+    PNG_JOB_QUEUED,
+    PNG_JOB_ACTIVE,
+} png_job_state_t;
 
-static png_err_t png_decoder_start_common (int max_width, int max_height, png_callback_t *callback, void *callback_data) {
+/** @brief Scheduler job slot. */
+typedef struct {
+    png_job_state_t state;
+    png_job_t token; /**< Cancellation token, also the submission order */
+    png_decoder_priority_t priority;
+    uint32_t pass; /**< Stride scheduling pass value */
+    char *path; /**< Source path, NULL for in-memory jobs */
+    const char *native_sidecar; /**< Optional native sidecar suffix tried first */
+    uint32_t native_load_flags;
+    bool *native_served; /**< Optional output, set when the job completes */
+    uint8_t *png_data; /**< Owned PNG bytes until the job is activated */
+    size_t png_size;
+    int max_width;
+    int max_height;
+    int target_width;
+    int target_height;
+    png_callback_t *callback;
+    void *callback_data;
+    png_decoder_t *decoder; /**< Decoder state while active */
+    uint32_t decode_us; /**< Time spent decoding this job */
+} png_job_slot_t;
+
+static png_job_slot_t png_jobs[PNG_DECODER_JOB_SLOTS];
+static png_job_t png_job_next_token = 1;
+static png_job_t png_legacy_job = PNG_DECODER_JOB_NONE;
+static uint32_t png_pass_floor = 0;
+static png_decoder_stats_t png_stats = { .budget_us = PNG_DECODER_BUDGET_MIN_US };
+static uint64_t png_last_poll_end_us = 0;
+static uint32_t png_loop_us_peak = PNG_DECODER_FRAME_US;
+static bool png_dither = false;
+
+// Pass increment per decoded slice: visible boxart gets 4x the rows of prefetch work.
+static const uint32_t png_priority_stride[PNG_DECODER_PRIORITY_COUNT] = { 1, 2, 4 };
+
+static void png_decoder_free (png_decoder_t *decoder, bool free_image);
+
+static bool png_job_path_has_suffix (const char *path, const char *suffix) {
+    size_t path_length = strlen(path);
+    size_t suffix_length = strlen(suffix);
+    return (path_length >= suffix_length) && (strcmp(path + path_length - suffix_length, suffix) == 0);
+}
+
+static png_err_t png_decoder_start_common (png_decoder_t *decoder, int max_width, int max_height, int target_width, int target_height) {
     size_t image_size;
 
     if (spng_set_crc_action(decoder->ctx, SPNG_CRC_USE, SPNG_CRC_USE) != SPNG_OK) {
-        png_decoder_deinit(false);
         return PNG_ERR_INT;
     }
 
     if (spng_set_image_limits(decoder->ctx, max_width, max_height) != SPNG_OK) {
-        png_decoder_deinit(false);
         return PNG_ERR_INT;
     }
 
     if (spng_decoded_image_size(decoder->ctx, SPNG_FMT_RGB8, &image_size) != SPNG_OK) {
-        png_decoder_deinit(false);
         return PNG_ERR_BAD_FILE;
     }
 
     if (spng_decode_image(decoder->ctx, NULL, image_size, SPNG_FMT_RGB8, SPNG_DECODE_PROGRESSIVE) != SPNG_OK) {
-        png_decoder_deinit(false);
         return PNG_ERR_BAD_FILE;
     }
 
     if (spng_get_ihdr(decoder->ctx, &decoder->ihdr) != SPNG_OK) {
-        png_decoder_deinit(false);
         return PNG_ERR_BAD_FILE;
     }
 
+    // Interlaced images deliver rows out of order and are always decoded at full size.
+    int image_width = decoder->ihdr.width;
+    int image_height = decoder->ihdr.height;
+    if ((target_width > 0) && (target_height > 0) && (decoder->ihdr.interlace_method == 0) &&
+        image_convert_fit_size(&image_width, &image_height, target_width, target_height)) {
+        if (!image_convert_downscale_init(&decoder->downscaler, decoder->ihdr.width, decoder->ihdr.height, image_width, image_height)) {
+            return PNG_ERR_OUT_OF_MEM;
+        }
+        decoder->downscale = true;
+    }
+
     decoder->image = calloc(1, sizeof(surface_t));
     if (decoder->image == NULL) {
-        png_decoder_deinit(false);
         return PNG_ERR_OUT_OF_MEM;
     }
 
-    *decoder->image = surface_alloc(FMT_RGBA16, decoder->ihdr.width, decoder->ihdr.height);
+    *decoder->image = surface_alloc(FMT_RGBA16, image_width, image_height);
     if (decoder->image->buffer == NULL) {
-        png_decoder_deinit(true);
         return PNG_ERR_OUT_OF_MEM;
     }
 
     if ((decoder->row_buffer = malloc(decoder->ihdr.width * 3)) == NULL) {
-        png_decoder_deinit(true);
         return PNG_ERR_OUT_OF_MEM;
     }
 
     decoder->decoded_rows = 0;
-    decoder->callback = callback;
-    decoder->callback_data = callback_data;
+    return PNG_OK;
+}
+
+static png_err_t png_decoder_open_file (png_decoder_t **out, const char *path, int max_width, int max_height, int target_width, int target_height) {
+    png_decoder_t *decoder = calloc(1, sizeof(png_decoder_t));
+    if (decoder == NULL) {
+        return PNG_ERR_OUT_OF_MEM;
+    }
+
+    png_err_t err = PNG_OK;
+    if ((decoder->f = fopen(path, "rb")) == NULL) {
+        err = PNG_ERR_NO_FILE;
+    } else {
+        setbuf(decoder->f, NULL);
+        if ((decoder->ctx = spng_ctx_new(SPNG_CTX_IGNORE_ADLER32)) == NULL) {
+            err = PNG_ERR_OUT_OF_MEM;
+        } else if (spng_set_png_file(decoder->ctx, decoder->f) != SPNG_OK) {
+            err = PNG_ERR_INT;
+        } else {
+            err = png_decoder_start_common(decoder, max_width, max_height, target_width, target_height);
+        }
+    }
+
+    if (err != PNG_OK) {
+        png_decoder_free(decoder, true);
+        return err;
+    }
+    *out = decoder;
+    return PNG_OK;
+}
+
+static png_err_t png_decoder_open_buffer (png_decoder_t **out, uint8_t *png_data, size_t png_size, int max_width, int max_height, int target_width, int target_height) {
+    png_decoder_t *decoder = calloc(1, sizeof(png_decoder_t));
+    if (decoder == NULL) {
+        free(png_data);
+        return PNG_ERR_OUT_OF_MEM;
+    }
+
+    decoder->owned_png_buffer = png_data;
+    decoder->owned_png_buffer_size = png_size;
+
+    png_err_t err = PNG_OK;
+    if ((decoder->ctx = spng_ctx_new(SPNG_CTX_IGNORE_ADLER32)) == NULL) {
+        err = PNG_ERR_OUT_OF_MEM;
+    } else if (spng_set_png_buffer(decoder->ctx, decoder->owned_png_buffer, decoder->owned_png_buffer_size) != SPNG_OK) {
+        err = PNG_ERR_BAD_FILE;
+    } else {
+        err = png_decoder_start_common(decoder, max_width, max_height, target_width, target_height);
+    }
+
+    if (err != PNG_OK) {
+        png_decoder_free(decoder, true);
+        return err;
+    }
+    *out = decoder;
+    return PNG_OK;
+}
+
+static png_err_t png_decoder_open_native (png_decoder_t **out, const char *path, const char *sidecar, int max_width, int max_height,
+                                          int target_width, int target_height, uint32_t load_flags) {
+    png_decoder_t *decoder = calloc(1, sizeof(png_decoder_t));
+    if (decoder == NULL) {
+        return PNG_ERR_OUT_OF_MEM;
+    }
+
+    bool opened;
+    if (png_job_path_has_suffix(path, sidecar)) {
+        opened = native_image_reader_open(&decoder->native_reader, path, max_width, max_height);
+    } else {
+        opened = native_image_reader_open_sidecar(&decoder->native_reader, path, sidecar, max_width, max_height);
+    }
+    if (!opened) {
+        free(decoder);
+        return PNG_ERR_NO_FILE;
+    }
+    decoder->native = true;
+
+    // Larger sidecars stream through the downscaler like PNGs, into a fitted RGBA16 surface.
+    int image_width = decoder->native_reader.width;
+    int image_height = decoder->native_reader.height;
+    if ((target_width > 0) && (target_height > 0) && image_convert_fit_size(&image_width, &image_height, target_width, target_height)) {
+        if (!image_convert_downscale_init(&decoder->downscaler, decoder->native_reader.width, decoder->native_reader.height, image_width, image_height)) {
+            png_decoder_free(decoder, true);
+            return PNG_ERR_OUT_OF_MEM;
+        }
+        decoder->downscale = true;
+        decoder->image = native_image_alloc(FMT_RGBA16, image_width, image_height);
+        decoder->row_buffer = malloc(decoder->native_reader.width * sizeof(uint16_t));
+    } else {
+        decoder->image = native_image_reader_alloc_surface(&decoder->native_reader, load_flags);
+    }
+    if ((decoder->image == NULL) || (decoder->downscale && (decoder->row_buffer == NULL))) {
+        png_decoder_free(decoder, true);
+        return PNG_ERR_OUT_OF_MEM;
+    }
+
+    *out = decoder;
     return PNG_OK;
 }
 
@@ -150,12 +312,8 @@ static png_err_t png_decoder_decode_sync_internal (char *path, int max_width, in
         return PNG_ERR_OUT_OF_MEM;
     }
 
-    uint16_t *image_buffer = image->buffer;
-    for (size_t i = 0; i < image_size; i += 3) {
-        uint8_t r = rgb_buffer[i + 0] >> 3;
-        uint8_t g = rgb_buffer[i + 1] >> 3;
-        uint8_t b = rgb_buffer[i + 2] >> 3;
-        *image_buffer++ = (r << 11) | (g << 6) | (b << 1) | 1;
+    for (uint32_t y = 0; y < ihdr.height; y++) {
+        image_convert_rgb8_to_rgba16_row(image->buffer + (y * image->stride), rgb_buffer + (y * ihdr.width * 3), ihdr.width, y, png_dither);
     }
 
     free(rgb_buffer);
@@ -166,11 +324,12 @@ static png_err_t png_decoder_decode_sync_internal (char *path, int max_width, in
 }
 
 /**
- * @brief Deinitialize the PNG decoder.
- * 
+ * @brief Free a PNG decoder instance.
+ *
+ * @param decoder Decoder to free, may be NULL.
  * @param free_image Flag indicating whether to free the image.
  */
-static void png_decoder_deinit (bool free_image) {
+static void png_decoder_free (png_decoder_t *decoder, bool free_image) {
     if (decoder != NULL) {
         if (decoder->f != NULL) {
             fclose(decoder->f);
@@ -179,7 +338,9 @@ static void png_decoder_deinit (bool free_image) {
             spng_ctx_free(decoder->ctx);
         }
         if ((decoder->image != NULL) && free_image) {
-            surface_free(decoder->image);
+            if (decoder->image->buffer != NULL) {
+                surface_free(decoder->image);
+            }
             free(decoder->image);
         }
         if (decoder->row_buffer != NULL) {
@@ -188,152 +349,482 @@ static void png_decoder_deinit (bool free_image) {
         if (decoder->owned_png_buffer != NULL) {
             free(decoder->owned_png_buffer);
         }
+        if (decoder->downscale) {
+            image_convert_downscale_free(&decoder->downscaler);
+        }
+        if (decoder->native) {
+            native_image_reader_close(&decoder->native_reader);
+        }
         free(decoder);
-        decoder = NULL;
     }
 }
 
+static png_job_slot_t *png_job_find (png_job_t token) {
+    if (token == PNG_DECODER_JOB_NONE) {
+        return NULL;
+    }
+    for (int i = 0; i < PNG_DECODER_JOB_SLOTS; i++) {
+        if ((png_jobs[i].state != PNG_JOB_FREE) && (png_jobs[i].token == token)) {
+            return &png_jobs[i];
+        }
+    }
+    return NULL;
+}
+
+static void png_job_release (png_job_slot_t *job, bool free_image) {
+    png_decoder_free(job->decoder, free_image);
+    free(job->path);
+    free(job->png_data);
+    memset(job, 0, sizeof(*job));
+}
+
 /**
- * @brief Start decoding a PNG file.
- * 
- * @param path Path to the PNG file.
- * @param max_width Maximum width of the image.
- * @param max_height Maximum height of the image.
- * @param callback Callback function to be called upon completion.
- * @param callback_data Data to be passed to the callback function.
- * @return png_err_t Error code.
+ * @brief Finish a job and invoke its callback.
+ *
+ * The slot is released before the callback runs, so callbacks may submit or
+ * cancel jobs freely.
  */
-png_err_t png_decoder_start (char *path, int max_width, int max_height, png_callback_t *callback, void *callback_data) {
-    if (decoder != NULL) {
-        return PNG_ERR_BUSY;
+static void png_job_complete (png_job_slot_t *job, png_err_t err, surface_t *image) {
+    png_callback_t *callback = job->callback;
+    void *callback_data = job->callback_data;
+    if (png_legacy_job == job->token) {
+        png_legacy_job = PNG_DECODER_JOB_NONE;
+    }
+    if (job->native_served) {
+        *job->native_served = (image != NULL) && job->decoder && job->decoder->native;
+    }
+    if (job->decoder && (job->decoder->image == image)) {
+        job->decoder->image = NULL;
+    }
+    png_job_release(job, true);
+    if (callback) {
+        callback(err, image, callback_data);
     }
+}
 
-    decoder = calloc(1, sizeof(png_decoder_t));
-    if (decoder == NULL) {
-        return PNG_ERR_OUT_OF_MEM;
+static int png_job_active_count (void) {
+    int count = 0;
+    for (int i = 0; i < PNG_DECODER_JOB_SLOTS; i++) {
+        if (png_jobs[i].state == PNG_JOB_ACTIVE) {
+            count++;
+        }
     }
+    return count;
+}
 
-    if ((decoder->f = fopen(path, "rb")) == NULL) {
-        png_decoder_deinit(false);
-        return PNG_ERR_NO_FILE;
+static png_job_slot_t *png_job_next_queued (void) {
+    png_job_slot_t *best = NULL;
+    for (int i = 0; i < PNG_DECODER_JOB_SLOTS; i++) {
+        png_job_slot_t *job = &png_jobs[i];
+        if (job->state != PNG_JOB_QUEUED) {
+            continue;
+        }
+        if ((best == NULL) || (job->priority < best->priority) ||
+            ((job->priority == best->priority) && (job->token < best->token))) {
+            best = job;
+        }
     }
+    return best;
+}
 
-    setbuf(decoder->f, NULL);
+/**
+ * @brief Move a queued job into an active decoder slot.
+ *
+ * Jobs with a native sidecar read it in chunks when it opens, and decode
+ * the PNG otherwise.
+ *
+ * @return true when the job is now decoding, false when it completed.
+ */
+static bool png_job_activate (png_job_slot_t *job) {
+    png_err_t err = PNG_ERR_NO_FILE;
+    if (job->path && job->native_sidecar) {
+        err = png_decoder_open_native(&job->decoder, job->path, job->native_sidecar, job->max_width, job->max_height,
+            job->target_width, job->target_height, job->native_load_flags);
+    }
 
-    if ((decoder->ctx = spng_ctx_new(SPNG_CTX_IGNORE_ADLER32)) == NULL) {
-        png_decoder_deinit(false);
-        return PNG_ERR_OUT_OF_MEM;
+    if ((err != PNG_OK) && job->path) {
+        err = png_decoder_open_file(&job->decoder, job->path, job->max_width, job->max_height, job->target_width, job->target_height);
+    } else if (err != PNG_OK) {
+        uint8_t *png_data = job->png_data;
+        job->png_data = NULL;
+        err = png_decoder_open_buffer(&job->decoder, png_data, job->png_size, job->max_width, job->max_height, job->target_width, job->target_height);
+    }
+    if (err != PNG_OK) {
+        png_job_complete(job, err, NULL);
+        return false;
+    }
+
+    job->state = PNG_JOB_ACTIVE;
+    job->pass = png_pass_floor;
+    return true;
+}
+
+static void png_job_fill_active (void) {
+    int active = png_job_active_count();
+    while (active < PNG_DECODER_ACTIVE_MAX) {
+        png_job_slot_t *job = png_job_next_queued();
+        if (job == NULL) {
+            return;
+        }
+        if (png_job_activate(job)) {
+            active++;
+        }
     }
+}
+
+static png_job_slot_t *png_job_pick_active (void) {
+    png_job_slot_t *best = NULL;
+    for (int i = 0; i < PNG_DECODER_JOB_SLOTS; i++) {
+        png_job_slot_t *job = &png_jobs[i];
+        if (job->state != PNG_JOB_ACTIVE) {
+            continue;
+        }
+        if ((best == NULL) || (job->pass < best->pass) ||
+            ((job->pass == best->pass) && (job->priority < best->priority))) {
+            best = job;
+        }
+    }
+    return best;
+}
+
+/**
+ * @brief Read the next chunk of a native image job.
+ *
+ * A sidecar that turns out to be damaged falls back to decoding the PNG.
+ *
+ * @param rows_decoded Incremented by the number of rows read.
+ * @return true when the job is still active afterwards.
+ */
+static bool png_job_read_native_rows (png_job_slot_t *job, uint32_t *rows_decoded) {
+    png_decoder_t *decoder = job->decoder;
+
+    int rows;
+    if (decoder->downscale) {
+        rows = native_image_reader_read_downscaled(&decoder->native_reader, &decoder->downscaler, (uint16_t *)decoder->row_buffer,
+            decoder->image, PNG_DECODER_NATIVE_ROWS_PER_SLICE);
+    } else {
+        rows = native_image_reader_read_surface(&decoder->native_reader, decoder->image, PNG_DECODER_NATIVE_ROWS_PER_SLICE);
+    }
+    if (rows < 0) {
+        debugf("png_decoder: native image for %s failed: %s\n", job->path, native_image_error_string(native_image_get_last_error()));
+        png_decoder_free(job->decoder, true);
+        job->decoder = NULL;
+        if (!png_job_path_has_suffix(job->path, job->native_sidecar) &&
+            (png_decoder_open_file(&job->decoder, job->path, job->max_width, job->max_height, job->target_width, job->target_height) == PNG_OK)) {
+            return true;
+        }
+        png_job_complete(job, PNG_ERR_BAD_FILE, NULL);
+        return false;
+    }
+
+    decoder->decoded_rows += rows;
+    *rows_decoded += (uint32_t)rows;
+    if (decoder->decoded_rows >= decoder->native_reader.height) {
+        debugf("png_decoder: native %dx%d read in %lu us\n",
+            decoder->native_reader.width, decoder->native_reader.height, (unsigned long)job->decode_us);
+        png_job_complete(job, PNG_OK, decoder->image);
+        return false;
+    }
+    return true;
+}
 
-    if (spng_set_png_file(decoder->ctx, decoder->f) != SPNG_OK) {
-        png_decoder_deinit(false);
+/**
+ * @brief Decode up to @p rows rows of an active job.
+ *
+ * @param rows_decoded Incremented for every converted row.
+ * @return true when the job is still active afterwards.
+ */
+static bool png_job_decode_rows (png_job_slot_t *job, int rows, uint32_t *rows_decoded) {
+    png_decoder_t *decoder = job->decoder;
+
+    if (decoder->native) {
+        return png_job_read_native_rows(job, rows_decoded);
+    }
+
+    for (int row = 0; row < rows; row++) {
+        enum spng_errno err;
+        struct spng_row_info row_info;
+
+        if ((err = spng_get_row_info(decoder->ctx, &row_info)) != SPNG_OK) {
+            png_job_complete(job, PNG_ERR_BAD_FILE, NULL);
+            return false;
+        }
+
+        err = spng_decode_row(decoder->ctx, decoder->row_buffer, decoder->ihdr.width * 3);
+
+        if (err == SPNG_OK || err == SPNG_EOI) {
+            decoder->decoded_rows += 1;
+            *rows_decoded += 1;
+            if (decoder->downscale) {
+                image_convert_downscale_push_row(&decoder->downscaler, decoder->row_buffer, row_info.row_num,
+                    decoder->image->buffer, decoder->image->stride, png_dither);
+            } else {
+                image_convert_rgb8_to_rgba16_row(decoder->image->buffer + (row_info.row_num * decoder->image->stride),
+                    decoder->row_buffer, decoder->ihdr.width, row_info.row_num, png_dither);
+            }
+        }
+
+        if (err == SPNG_EOI) {
+            if (decoder->downscale) {
+                image_convert_downscale_finish(&decoder->downscaler, decoder->image->buffer, decoder->image->stride, png_dither);
+            }
+            debugf("png_decoder: %lux%lu decoded in %lu us (%lu rows/ms overall, budget %lu us)\n",
+                (unsigned long)decoder->ihdr.width, (unsigned long)decoder->ihdr.height, (unsigned long)job->decode_us,
+                (unsigned long)(png_stats.decode_us ? ((uint64_t)png_stats.rows * 1000) / png_stats.decode_us : 0),
+                (unsigned long)png_stats.budget_us);
+            png_job_complete(job, PNG_OK, decoder->image);
+            return false;
+        } else if (err != SPNG_OK) {
+            png_job_complete(job, PNG_ERR_BAD_FILE, NULL);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static png_err_t png_job_submit_common (png_job_slot_t *job, const png_decoder_job_desc_t *desc, png_job_t *job_out) {
+    job->state = PNG_JOB_QUEUED;
+    job->token = png_job_next_token++;
+    if (png_job_next_token == PNG_DECODER_JOB_NONE) {
+        png_job_next_token = 1;
+    }
+    job->priority = desc->priority;
+    job->native_sidecar = desc->native_sidecar;
+    job->native_load_flags = desc->native_load_flags;
+    job->native_served = desc->native_served;
+    job->max_width = desc->max_width;
+    job->max_height = desc->max_height;
+    job->target_width = desc->target_width;
+    job->target_height = desc->target_height;
+    job->callback = desc->callback;
+    job->callback_data = desc->callback_data;
+    if (job_out) {
+        *job_out = job->token;
+    }
+    return PNG_OK;
+}
+
+static png_job_slot_t *png_job_alloc (void) {
+    for (int i = 0; i < PNG_DECODER_JOB_SLOTS; i++) {
+        if (png_jobs[i].state == PNG_JOB_FREE) {
+            return &png_jobs[i];
+        }
+    }
+    return NULL;
+}
+
+png_err_t png_decoder_submit (const char *path, const png_decoder_job_desc_t *desc, png_job_t *job_out) {
+    if (job_out) {
+        *job_out = PNG_DECODER_JOB_NONE;
+    }
+    if ((path == NULL) || (desc == NULL) || (desc->priority >= PNG_DECODER_PRIORITY_COUNT)) {
         return PNG_ERR_INT;
     }
 
-    return png_decoder_start_common(max_width, max_height, callback, callback_data);
+    png_job_slot_t *job = png_job_alloc();
+    if (job == NULL) {
+        return PNG_ERR_BUSY;
+    }
+    if ((job->path = strdup(path)) == NULL) {
+        return PNG_ERR_OUT_OF_MEM;
+    }
+    return png_job_submit_common(job, desc, job_out);
 }
 
-png_err_t png_decoder_start_buffer_owned (uint8_t *png_data, size_t png_size, int max_width, int max_height, png_callback_t *callback, void *callback_data) {
-    if (decoder != NULL) {
+png_err_t png_decoder_submit_buffer_owned (uint8_t *png_data, size_t png_size, const png_decoder_job_desc_t *desc, png_job_t *job_out) {
+    if (job_out) {
+        *job_out = PNG_DECODER_JOB_NONE;
+    }
+    if ((desc == NULL) || (desc->priority >= PNG_DECODER_PRIORITY_COUNT)) {
         free(png_data);
-        return PNG_ERR_BUSY;
+        return PNG_ERR_INT;
     }
     if (png_data == NULL || png_size == 0) {
         free(png_data);
         return PNG_ERR_BAD_FILE;
     }
 
-    decoder = calloc(1, sizeof(png_decoder_t));
-    if (decoder == NULL) {
+    png_job_slot_t *job = png_job_alloc();
+    if (job == NULL) {
         free(png_data);
-        return PNG_ERR_OUT_OF_MEM;
+        return PNG_ERR_BUSY;
     }
+    job->png_data = png_data;
+    job->png_size = png_size;
+    return png_job_submit_common(job, desc, job_out);
+}
 
-    decoder->owned_png_buffer = png_data;
-    decoder->owned_png_buffer_size = png_size;
+bool png_decoder_cancel (png_job_t job) {
+    png_job_slot_t *slot = png_job_find(job);
+    if (slot == NULL) {
+        return false;
+    }
+    if (png_legacy_job == job) {
+        png_legacy_job = PNG_DECODER_JOB_NONE;
+    }
+    png_job_release(slot, true);
+    return true;
+}
 
-    if ((decoder->ctx = spng_ctx_new(SPNG_CTX_IGNORE_ADLER32)) == NULL) {
-        png_decoder_deinit(false);
-        return PNG_ERR_OUT_OF_MEM;
+bool png_decoder_job_pending (png_job_t job) {
+    return png_job_find(job) != NULL;
+}
+
+float png_decoder_job_progress (png_job_t job) {
+    png_job_slot_t *slot = png_job_find(job);
+    if ((slot == NULL) || (slot->decoder == NULL)) {
+        return 0.0f;
     }
+    int height = slot->decoder->native ? slot->decoder->native_reader.height : (int)slot->decoder->ihdr.height;
+    if (height == 0) {
+        return 0.0f;
+    }
+    return (float) (slot->decoder->decoded_rows) / height;
+}
 
-    if (spng_set_png_buffer(decoder->ctx, decoder->owned_png_buffer, decoder->owned_png_buffer_size) != SPNG_OK) {
-        png_decoder_deinit(false);
-        return PNG_ERR_BAD_FILE;
+/**
+ * @brief Start decoding a PNG file.
+ *
+ * @param path Path to the PNG file.
+ * @param max_width Maximum width of the image.
+ * @param max_height Maximum height of the image.
+ * @param callback Callback function to be called upon completion.
+ * @param callback_data Data to be passed to the callback function.
+ * @return png_err_t Error code.
+ */
+png_err_t png_decoder_start (char *path, int max_width, int max_height, png_callback_t *callback, void *callback_data) {
+    if (png_legacy_job != PNG_DECODER_JOB_NONE) {
+        return PNG_ERR_BUSY;
+    }
+    if (!file_exists(path)) {
+        return PNG_ERR_NO_FILE;
+    }
+
+    png_decoder_job_desc_t desc = {
+        .max_width = max_width,
+        .max_height = max_height,
+        .priority = PNG_DECODER_PRIORITY_BACKGROUND,
+        .callback = callback,
+        .callback_data = callback_data,
+    };
+    return png_decoder_submit(path, &desc, &png_legacy_job);
+}
+
+png_err_t png_decoder_start_buffer_owned (uint8_t *png_data, size_t png_size, int max_width, int max_height, png_callback_t *callback, void *callback_data) {
+    if (png_legacy_job != PNG_DECODER_JOB_NONE) {
+        free(png_data);
+        return PNG_ERR_BUSY;
     }
 
-    return png_decoder_start_common(max_width, max_height, callback, callback_data);
+    png_decoder_job_desc_t desc = {
+        .max_width = max_width,
+        .max_height = max_height,
+        .priority = PNG_DECODER_PRIORITY_BACKGROUND,
+        .callback = callback,
+        .callback_data = callback_data,
+    };
+    return png_decoder_submit_buffer_owned(png_data, png_size, &desc, &png_legacy_job);
 }
 
 /**
  * @brief Abort the PNG decoding process.
  */
 void png_decoder_abort (void) {
-    png_decoder_deinit(true);
+    png_decoder_cancel(png_legacy_job);
 }
 
 /**
  * @brief Get the progress of the PNG decoding process.
- * 
+ *
  * @return float Progress as a percentage.
  */
 float png_decoder_get_progress (void) {
-    if (!decoder) {
-        return 0.0f;
+    return png_decoder_job_progress(png_legacy_job);
+}
+
+/**
+ * @brief Update the poll budget from the time the rest of the loop took.
+ *
+ * Time between the end of the previous poll and the start of this one is
+ * work done by everything else in the menu loop. The menu loop also spins
+ * without drawing while it waits for a framebuffer, so a slowly decaying
+ * peak is tracked rather than an average, which would be dominated by the
+ * cheap spins. Whatever is left of the frame after the peak, minus a safety
+ * margin, goes to decoding.
+ */
+static void png_decoder_update_budget (uint64_t now_us) {
+    if (png_last_poll_end_us != 0) {
+        uint32_t loop_us = (uint32_t)MIN(now_us - png_last_poll_end_us, (uint64_t)PNG_DECODER_FRAME_US);
+        png_loop_us_peak = MAX(loop_us, png_loop_us_peak - (png_loop_us_peak / 16));
     }
 
-    return (float) (decoder->decoded_rows) / (decoder->ihdr.height);
+    int32_t slack_us = PNG_DECODER_FRAME_US - PNG_DECODER_FRAME_MARGIN_US - (int32_t)png_loop_us_peak;
+    png_stats.budget_us = (uint32_t)MAX(MIN(slack_us, PNG_DECODER_BUDGET_MAX_US), PNG_DECODER_BUDGET_MIN_US);
 }
 
 /**
- * @brief Poll the PNG decoder to process the next row.
+ * @brief Poll the decode scheduler.
+ *
+ * Queued jobs are activated in priority order. Rows are then decoded in
+ * small slices until the poll budget is used up, each slice going to the
+ * active job with the lowest stride pass, so higher priorities get
+ * proportionally more rows without starving prefetch work.
  */
 void png_decoder_poll (void) {
-    if (!decoder) {
-        return;
-    }
+    uint64_t start_us = get_ticks_us();
+    png_decoder_update_budget(start_us);
 
-    for (int row = 0; row < PNG_DECODER_ROWS_PER_POLL && decoder; row++) {
-        enum spng_errno err;
-        struct spng_row_info row_info;
+    png_job_fill_active();
 
-        if ((err = spng_get_row_info(decoder->ctx, &row_info)) != SPNG_OK) {
-            decoder->callback(PNG_ERR_BAD_FILE, NULL, decoder->callback_data);
-            png_decoder_deinit(true);
-            return;
+    uint64_t slice_start_us = start_us;
+    while ((slice_start_us - start_us) < png_stats.budget_us) {
+        png_job_slot_t *job = png_job_pick_active();
+        if (job == NULL) {
+            break;
         }
 
-        err = spng_decode_row(decoder->ctx, decoder->row_buffer, decoder->ihdr.width * 3);
-
-        if (err == SPNG_OK || err == SPNG_EOI) {
-            decoder->decoded_rows += 1;
-            uint16_t *image_buffer = decoder->image->buffer + (row_info.row_num * decoder->image->stride);
-            for (uint32_t i = 0; i < decoder->ihdr.width * 3; i += 3) {
-                uint8_t r = decoder->row_buffer[i + 0] >> 3;
-                uint8_t g = decoder->row_buffer[i + 1] >> 3;
-                uint8_t b = decoder->row_buffer[i + 2] >> 3;
-                *image_buffer++ = (r << 11) | (g << 6) | (b << 1) | 1;
-            }
+        png_pass_floor = job->pass;
+        png_decoder_priority_t priority = job->priority;
+        bool active = png_job_decode_rows(job, PNG_DECODER_ROWS_PER_SLICE, &png_stats.rows);
+
+        uint64_t slice_end_us = get_ticks_us();
+        png_stats.decode_us += (uint32_t)(slice_end_us - slice_start_us);
+        if (active) {
+            job->decode_us += (uint32_t)(slice_end_us - slice_start_us);
+            job->pass += png_priority_stride[priority];
+        } else {
+            png_job_fill_active();
+            slice_end_us = get_ticks_us();
         }
+        slice_start_us = slice_end_us;
+    }
 
-        if (err == SPNG_EOI) {
-            decoder->callback(PNG_OK, decoder->image, decoder->callback_data);
-            png_decoder_deinit(false);
-            return;
-        } else if (err != SPNG_OK) {
-            decoder->callback(PNG_ERR_BAD_FILE, NULL, decoder->callback_data);
-            png_decoder_deinit(true);
-            return;
-        }
+    png_last_poll_end_us = get_ticks_us();
+}
+
+void png_decoder_set_dither (bool enabled) {
+    png_dither = enabled;
+}
+
+void png_decoder_get_stats (png_decoder_stats_t *stats) {
+    if (stats) {
+        *stats = png_stats;
+        stats->rows_per_ms = png_stats.decode_us ? ((float)png_stats.rows * 1000.0f) / (float)png_stats.decode_us : 0.0f;
     }
 }
 
 bool png_decoder_is_busy (void) {
-    return (decoder != NULL);
+    for (int i = 0; i < PNG_DECODER_JOB_SLOTS; i++) {
+        if (png_jobs[i].state != PNG_JOB_FREE) {
+            return true;
+        }
+    }
+    return false;
 }
 
 png_err_t png_decoder_load (char *path, int max_width, int max_height, surface_t **out_image) {
-    if (decoder != NULL) {
+    if (png_legacy_job != PNG_DECODER_JOB_NONE) {
         return PNG_ERR_BUSY;
     }
     return png_decoder_decode_sync_internal(path, max_width, max_height, out_image);
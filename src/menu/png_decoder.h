@@ -9,6 +9,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <surface.h>
 
 /** 
@@ -36,10 +37,101 @@ typedef enum {
  */
 typedef void png_callback_t (png_err_t err, surface_t *decoded_image, void *callback_data);
 
+/** @brief Decode job priority, highest first. */
+typedef enum {
+    PNG_DECODER_PRIORITY_VISIBLE,     /**< Image currently on screen (eg. boxart) */
+    PNG_DECODER_PRIORITY_BACKGROUND,  /**< Full screen backgrounds and viewers */
+    PNG_DECODER_PRIORITY_PREFETCH,    /**< Speculative loads that may never be shown */
+    PNG_DECODER_PRIORITY_COUNT,
+} png_decoder_priority_t;
+
+/** @brief Decode job handle, doubles as the cancellation token. */
+typedef uint32_t png_job_t;
+
+/** @brief Decoder throughput statistics. */
+typedef struct {
+    uint32_t rows;          /**< Rows decoded or read from native sidecars since boot */
+    uint32_t decode_us;     /**< Time spent decoding since boot */
+    uint32_t budget_us;     /**< Current per-poll time budget */
+    float rows_per_ms;      /**< Average decode rate */
+} png_decoder_stats_t;
+
+/** @brief Handle value that never refers to a job. */
+#define PNG_DECODER_JOB_NONE    (0)
+
+/** @brief Decode job parameters. */
+typedef struct {
+    int max_width;                      /**< Maximum width of the decoded image */
+    int max_height;                     /**< Maximum height of the decoded image */
+    int target_width;                   /**< Downscale to fit this width while decoding, 0 for full size */
+    int target_height;                  /**< Downscale to fit this height while decoding, 0 for full size */
+    png_decoder_priority_t priority;    /**< Scheduling priority */
+    const char *native_sidecar;         /**< Optional native image suffix (eg. ".nimg") read in chunks instead of decoding when present, must be a static string */
+    uint32_t native_load_flags;         /**< native_image_load_flags_t: compact formats the callback accepts from the native image */
+    bool *native_served;                /**< Optional, set before the callback to whether the image came from the native image */
+    png_callback_t *callback;           /**< Callback invoked on completion, not invoked after cancellation */
+    void *callback_data;                /**< User-defined data passed to the callback */
+} png_decoder_job_desc_t;
+
+/**
+ * @brief Queue a PNG file for decoding.
+ *
+ * Jobs are activated in priority order and decoded a few rows at a time by
+ * png_decoder_poll. If @p path already ends with the native sidecar suffix
+ * the native image is loaded directly instead.
+ *
+ * @param path Path to the PNG file.
+ * @param desc Job parameters.
+ * @param job_out Optional output for the job handle.
+ * @return png_err_t PNG_ERR_BUSY when all job slots are in use.
+ */
+png_err_t png_decoder_submit (const char *path, const png_decoder_job_desc_t *desc, png_job_t *job_out);
+
+/**
+ * @brief Queue a PNG already loaded into memory for decoding.
+ *
+ * The decoder takes ownership of `png_data`, also on failure.
+ *
+ * @param png_data Owned PNG byte buffer.
+ * @param png_size Size of PNG byte buffer.
+ * @param desc Job parameters.
+ * @param job_out Optional output for the job handle.
+ * @return png_err_t PNG_ERR_BUSY when all job slots are in use.
+ */
+png_err_t png_decoder_submit_buffer_owned (uint8_t *png_data, size_t png_size, const png_decoder_job_desc_t *desc, png_job_t *job_out);
+
+/**
+ * @brief Cancel a queued or running decode job.
+ *
+ * The job callback is not invoked. Stale handles are ignored.
+ *
+ * @param job Job handle.
+ * @return true if the job was still pending.
+ */
+bool png_decoder_cancel (png_job_t job);
+
+/**
+ * @brief Check whether a decode job is queued or running.
+ *
+ * @param job Job handle.
+ * @return true until the job completes or is cancelled.
+ */
+bool png_decoder_job_pending (png_job_t job);
+
+/**
+ * @brief Get the decode progress of a job.
+ *
+ * @param job Job handle.
+ * @return float Fraction of decoded rows (0.0 to 1.0), 0.0 while queued.
+ */
+float png_decoder_job_progress (png_job_t job);
+
 /**
  * @brief Start the PNG decoding process.
  * 
- * This function starts the PNG decoding process for the specified file.
+ * This function starts the PNG decoding process for the specified file as a
+ * background priority job. Only one job started through this function or
+ * png_decoder_start_buffer_owned can be pending at a time.
  * 
  * @param path Path to the PNG file.
  * @param max_width Maximum width of the decoded image.
@@ -68,7 +160,8 @@ png_err_t png_decoder_start_buffer_owned (uint8_t *png_data, size_t png_size, in
 /**
  * @brief Abort the PNG decoding process.
  * 
- * This function aborts the ongoing PNG decoding process.
+ * This function aborts the job started by png_decoder_start or
+ * png_decoder_start_buffer_owned.
  */
 void png_decoder_abort (void);
 
@@ -85,11 +178,30 @@ float png_decoder_get_progress (void);
  * @brief Poll the PNG decoder.
  * 
  * This function polls the PNG decoder to handle any ongoing decoding tasks.
+ * Rows are decoded until a time budget is used up. The budget follows the
+ * frame time left over by the rest of the menu loop and is shared between
+ * all running jobs, weighted by priority.
  */
 void png_decoder_poll (void);
 
 /**
- * @brief Check whether a PNG decode job is currently active.
+ * @brief Enable ordered dithering for RGB8 to RGBA16 conversion.
+ *
+ * Applies to decodes started after the call.
+ *
+ * @param enabled true to dither, false to truncate.
+ */
+void png_decoder_set_dither (bool enabled);
+
+/**
+ * @brief Get decoder throughput statistics.
+ *
+ * @param stats Output statistics.
+ */
+void png_decoder_get_stats (png_decoder_stats_t *stats);
+
+/**
+ * @brief Check whether any PNG decode job is queued or running.
  *
  * @return true if decoder is busy, false otherwise.
  */
@@ -0,0 +1,1111 @@
+/**
+ * @file rom_digest.c
+ * @brief Full-ROM CRC32/MD5/SHA-1 digests and DAT identification
+ * @ingroup menu
+ */
+
+#include <malloc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#include <fatfs/ff.h>
+#include <libdragon.h>
+#include <miniz.h>
+
+#include "path.h"
+#include "rom_digest.h"
+#include "utils/byteswap.h"
+#include "utils/fs.h"
+#include "utils/hash.h"
+#include "utils/utils.h"
+
+#define ROM_DIGEST_TABLE_FILE           "menu/cache/rom_digests.cache"
+#define ROM_DIGEST_CHECKPOINT_FILE      "menu/cache/rom_digests.job"
+#define ROM_DIGEST_DAT_FILE             "menu/rom_dat.txt"
+#define ROM_DIGEST_TABLE_MAGIC          0x524F4D44 /* ROMD */
+#define ROM_DIGEST_CHECKPOINT_MAGIC     0x52444A42 /* RDJB */
+#define ROM_DIGEST_VERSION              1
+#define ROM_DIGEST_TABLE_MAX            4096
+#define ROM_DIGEST_CHUNK_SIZE           (64 * 1024)
+#define ROM_DIGEST_HASH_SLICE_SIZE      (4 * 1024)
+#define ROM_DIGEST_POLL_BUDGET_US       (4000)
+#define ROM_DIGEST_CHECKPOINT_BYTES     (4 * 1024 * 1024)
+#define ROM_DIGEST_FLUSH_FILES          (8)
+#define ROM_DIGEST_PATH_MAX             (512)
+
+static const char *rom_digest_extensions[] = { "z64", "n64", "v64", "rom", NULL };
+
+/** @brief Byte order of the ROM file relative to the big-endian .z64 layout. */
+typedef enum {
+    ROM_DIGEST_ORDER_BIG = 0,
+    ROM_DIGEST_ORDER_BYTESWAP,
+    ROM_DIGEST_ORDER_LITTLE,
+} rom_digest_order_t;
+
+typedef struct {
+    uint32_t state[4];
+    uint64_t length;
+    uint8_t block[64];
+    uint32_t used;
+} md5_ctx_t;
+
+typedef struct {
+    uint32_t state[5];
+    uint64_t length;
+    uint8_t block[64];
+    uint32_t used;
+} sha1_ctx_t;
+
+/** @brief Incremental state for all three digests. */
+typedef struct {
+    uint32_t crc32;
+    md5_ctx_t md5;
+    sha1_ctx_t sha1;
+} rom_digest_ctx_t;
+
+typedef struct __attribute__((packed)) {
+    uint64_t path_hash;
+    uint64_t size;
+    int64_t mtime;
+    uint32_t crc32;
+    uint8_t md5[ROM_DIGEST_MD5_LENGTH];
+    uint8_t sha1[ROM_DIGEST_SHA1_LENGTH];
+} rom_digest_record_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t count;
+} rom_digest_table_header_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ctx_size;
+    uint32_t path_length;
+    uint64_t size;
+    int64_t mtime;
+    uint64_t offset;
+    uint32_t order;
+    uint32_t reserved;
+    rom_digest_ctx_t ctx;
+} rom_digest_checkpoint_t;
+
+typedef struct {
+    uint32_t crc32;
+    bool has_sha1;
+    uint8_t sha1[ROM_DIGEST_SHA1_LENGTH];
+    char *name;
+} rom_digest_dat_entry_t;
+
+static char rom_digest_prefix[16];
+
+static struct {
+    bool loaded;
+    bool dirty;
+    rom_digest_record_t *records;
+    uint32_t count;
+    uint32_t capacity;
+} rom_digest_table;
+
+static struct {
+    bool loaded;
+    rom_digest_dat_entry_t *entries;
+    uint32_t count;
+} rom_digest_dat;
+
+static struct {
+    bool active;
+    char **dirs;
+    int dir_count;
+    int dir_capacity;
+    char **files;
+    int file_count;
+    int file_capacity;
+    path_t *dir_path;
+    DIR dir;
+    bool dir_open;
+    FILE *file;
+    char *path;
+    uint64_t size;
+    int64_t mtime;
+    uint64_t offset;
+    rom_digest_order_t order;
+    rom_digest_ctx_t ctx;
+    uint8_t *buffer;
+    size_t buffer_length;   /**< Bytes of the current chunk read into buffer */
+    size_t buffer_hashed;   /**< Bytes of the current chunk hashed so far */
+    uint64_t bytes_since_checkpoint;
+    int files_since_flush;
+} rom_digest_job;
+
+
+// MD5 (RFC 1321)
+
+static const uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const uint8_t md5_r[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+static inline uint32_t rotl32(uint32_t v, int n) {
+    return (v << n) | (v >> (32 - n));
+}
+
+static void md5_init(md5_ctx_t *ctx) {
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xefcdab89;
+    ctx->state[2] = 0x98badcfe;
+    ctx->state[3] = 0x10325476;
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+static void md5_block(md5_ctx_t *ctx, const uint8_t *p) {
+    uint32_t w[16];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[i * 4] | ((uint32_t)p[i * 4 + 1] << 8) | ((uint32_t)p[i * 4 + 2] << 16) | ((uint32_t)p[i * 4 + 3] << 24);
+    }
+
+    uint32_t a = ctx->state[0];
+    uint32_t b = ctx->state[1];
+    uint32_t c = ctx->state[2];
+    uint32_t d = ctx->state[3];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) & 15;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) & 15;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) & 15;
+        }
+        uint32_t t = d;
+        d = c;
+        c = b;
+        b = b + rotl32(a + f + md5_k[i] + w[g], md5_r[i]);
+        a = t;
+    }
+
+    ctx->state[0] += a;
+    ctx->state[1] += b;
+    ctx->state[2] += c;
+    ctx->state[3] += d;
+}
+
+static void md5_update(md5_ctx_t *ctx, const uint8_t *data, size_t length) {
+    ctx->length += length;
+    if (ctx->used > 0) {
+        size_t take = MIN(length, (size_t)(64 - ctx->used));
+        memcpy(ctx->block + ctx->used, data, take);
+        ctx->used += take;
+        data += take;
+        length -= take;
+        if (ctx->used < 64) {
+            return;
+        }
+        md5_block(ctx, ctx->block);
+        ctx->used = 0;
+    }
+    while (length >= 64) {
+        md5_block(ctx, data);
+        data += 64;
+        length -= 64;
+    }
+    memcpy(ctx->block, data, length);
+    ctx->used = length;
+}
+
+static void md5_final(md5_ctx_t *ctx, uint8_t out[ROM_DIGEST_MD5_LENGTH]) {
+    uint64_t bits = ctx->length * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t pad_length = (ctx->used < 56) ? (56 - ctx->used) : (120 - ctx->used);
+    for (int i = 0; i < 8; i++) {
+        pad[pad_length + i] = (uint8_t)(bits >> (i * 8));
+    }
+    md5_update(ctx, pad, pad_length + 8);
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            out[i * 4 + j] = (uint8_t)(ctx->state[i] >> (j * 8));
+        }
+    }
+}
+
+
+// SHA-1 (FIPS 180-4)
+
+static void sha1_init(sha1_ctx_t *ctx) {
+    ctx->state[0] = 0x67452301;
+    ctx->state[1] = 0xefcdab89;
+    ctx->state[2] = 0x98badcfe;
+    ctx->state[3] = 0x10325476;
+    ctx->state[4] = 0xc3d2e1f0;
+    ctx->length = 0;
+    ctx->used = 0;
+}
+
+static void sha1_block(sha1_ctx_t *ctx, const uint8_t *p) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = ((uint32_t)p[i * 4] << 24) | ((uint32_t)p[i * 4 + 1] << 16) | ((uint32_t)p[i * 4 + 2] << 8) | (uint32_t)p[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = rotl32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = ctx->state[0];
+    uint32_t b = ctx->state[1];
+    uint32_t c = ctx->state[2];
+    uint32_t d = ctx->state[3];
+    uint32_t e = ctx->state[4];
+
+    for (int i = 0; i < 80; i++) {
+        uint32_t f;
+        uint32_t k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        uint32_t t = rotl32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotl32(b, 30);
+        b = a;
+        a = t;
+    }
+
+    ctx->state[0] += a;
+    ctx->state[1] += b;
+    ctx->state[2] += c;
+    ctx->state[3] += d;
+    ctx->state[4] += e;
+}
+
+static void sha1_update(sha1_ctx_t *ctx, const uint8_t *data, size_t length) {
+    ctx->length += length;
+    if (ctx->used > 0) {
+        size_t take = MIN(length, (size_t)(64 - ctx->used));
+        memcpy(ctx->block + ctx->used, data, take);
+        ctx->used += take;
+        data += take;
+        length -= take;
+        if (ctx->used < 64) {
+            return;
+        }
+        sha1_block(ctx, ctx->block);
+        ctx->used = 0;
+    }
+    while (length >= 64) {
+        sha1_block(ctx, data);
+        data += 64;
+        length -= 64;
+    }
+    memcpy(ctx->block, data, length);
+    ctx->used = length;
+}
+
+static void sha1_final(sha1_ctx_t *ctx, uint8_t out[ROM_DIGEST_SHA1_LENGTH]) {
+    uint64_t bits = ctx->length * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t pad_length = (ctx->used < 56) ? (56 - ctx->used) : (120 - ctx->used);
+    for (int i = 0; i < 8; i++) {
+        pad[pad_length + i] = (uint8_t)(bits >> ((7 - i) * 8));
+    }
+    sha1_update(ctx, pad, pad_length + 8);
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 4; j++) {
+            out[i * 4 + j] = (uint8_t)(ctx->state[i] >> ((3 - j) * 8));
+        }
+    }
+}
+
+
+static void rom_digest_ctx_init(rom_digest_ctx_t *ctx) {
+    ctx->crc32 = MZ_CRC32_INIT;
+    md5_init(&ctx->md5);
+    sha1_init(&ctx->sha1);
+}
+
+static void rom_digest_ctx_update(rom_digest_ctx_t *ctx, const uint8_t *data, size_t length) {
+    ctx->crc32 = (uint32_t)mz_crc32(ctx->crc32, data, length);
+    md5_update(&ctx->md5, data, length);
+    sha1_update(&ctx->sha1, data, length);
+}
+
+static void rom_digest_ctx_final(rom_digest_ctx_t *ctx, rom_digest_t *digest) {
+    digest->crc32 = ctx->crc32;
+    md5_final(&ctx->md5, digest->md5);
+    sha1_final(&ctx->sha1, digest->sha1);
+}
+
+static rom_digest_order_t rom_digest_detect_order(const uint8_t *data, size_t length) {
+    if (length < 4) {
+        return ROM_DIGEST_ORDER_BIG;
+    }
+    if ((data[0] == 0x37) && (data[1] == 0x80)) {
+        return ROM_DIGEST_ORDER_BYTESWAP;
+    }
+    if ((data[0] == 0x40) && (data[1] == 0x12)) {
+        return ROM_DIGEST_ORDER_LITTLE;
+    }
+    return ROM_DIGEST_ORDER_BIG;
+}
+
+// Digests are always computed over the .z64 layout so they match DAT entries.
+static void rom_digest_normalize(uint8_t *data, size_t length, rom_digest_order_t order) {
+    if (order == ROM_DIGEST_ORDER_BYTESWAP) {
+        byteswap_16(data, length);
+    } else if (order == ROM_DIGEST_ORDER_LITTLE) {
+        byteswap_32(data, length);
+    }
+}
+
+static path_t *rom_digest_cache_path(const char *file) {
+    if (rom_digest_prefix[0] == '\0') {
+        return NULL;
+    }
+    return path_init(rom_digest_prefix, (char *)file);
+}
+
+static bool rom_digest_write_file(const char *file, const void *header, size_t header_size, const void *data, size_t data_size) {
+    path_t *target = rom_digest_cache_path(file);
+    if (!target) {
+        return false;
+    }
+    path_t *directory = path_clone(target);
+    path_pop(directory);
+    directory_create(path_get(directory));
+    path_free(directory);
+
+    char tmp_path[ROM_DIGEST_PATH_MAX];
+    if ((size_t)snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path_get(target)) >= sizeof(tmp_path)) {
+        path_free(target);
+        return false;
+    }
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        path_free(target);
+        return false;
+    }
+    bool ok = (fwrite(header, header_size, 1, f) == 1);
+    if (ok && (data_size > 0)) {
+        ok = (fwrite(data, data_size, 1, f) == 1);
+    }
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+
+    if (ok) {
+        ok = file_rename(tmp_path, path_get(target));
+    }
+    if (!ok) {
+        remove(tmp_path);
+    }
+    path_free(target);
+    return ok;
+}
+
+
+static void rom_digest_table_load(void) {
+    if (rom_digest_table.loaded || (rom_digest_prefix[0] == '\0')) {
+        return;
+    }
+    rom_digest_table.loaded = true;
+
+    path_t *table_path = rom_digest_cache_path(ROM_DIGEST_TABLE_FILE);
+    FILE *f = fopen(path_get(table_path), "rb");
+    path_free(table_path);
+    if (!f) {
+        return;
+    }
+
+    rom_digest_table_header_t header;
+    bool valid = (fread(&header, sizeof(header), 1, f) == 1) &&
+        (header.magic == ROM_DIGEST_TABLE_MAGIC) &&
+        (header.version == ROM_DIGEST_VERSION) &&
+        (header.record_size == sizeof(rom_digest_record_t)) &&
+        (header.count <= ROM_DIGEST_TABLE_MAX);
+
+    if (valid && (header.count > 0)) {
+        rom_digest_table.records = malloc(header.count * sizeof(rom_digest_record_t));
+        if (rom_digest_table.records &&
+            (fread(rom_digest_table.records, sizeof(rom_digest_record_t), header.count, f) == header.count)) {
+            rom_digest_table.count = header.count;
+            rom_digest_table.capacity = header.count;
+        } else {
+            free(rom_digest_table.records);
+            rom_digest_table.records = NULL;
+        }
+    }
+
+    fclose(f);
+}
+
+static void rom_digest_table_flush(void) {
+    if (!rom_digest_table.loaded || !rom_digest_table.dirty) {
+        return;
+    }
+    rom_digest_table_header_t header = {
+        .magic = ROM_DIGEST_TABLE_MAGIC,
+        .version = ROM_DIGEST_VERSION,
+        .record_size = sizeof(rom_digest_record_t),
+        .count = rom_digest_table.count,
+    };
+    if (rom_digest_write_file(ROM_DIGEST_TABLE_FILE, &header, sizeof(header),
+            rom_digest_table.records, rom_digest_table.count * sizeof(rom_digest_record_t))) {
+        rom_digest_table.dirty = false;
+    }
+}
+
+static rom_digest_record_t *rom_digest_table_find(const char *path, uint64_t size, int64_t mtime) {
+    rom_digest_table_load();
+
+    uint64_t path_hash = fnv1a64_str(path);
+    for (uint32_t i = 0; i < rom_digest_table.count; i++) {
+        rom_digest_record_t *record = &rom_digest_table.records[i];
+        if ((record->path_hash == path_hash) && (record->size == size) && (record->mtime == mtime)) {
+            return record;
+        }
+    }
+    return NULL;
+}
+
+static rom_digest_record_t *rom_digest_table_find_path(uint64_t path_hash) {
+    for (uint32_t i = 0; i < rom_digest_table.count; i++) {
+        if (rom_digest_table.records[i].path_hash == path_hash) {
+            return &rom_digest_table.records[i];
+        }
+    }
+    return NULL;
+}
+
+// True when a digest for this path has nowhere to go.
+static bool rom_digest_table_full(const char *path) {
+    return (rom_digest_table.count >= ROM_DIGEST_TABLE_MAX) && !rom_digest_table_find_path(fnv1a64_str(path));
+}
+
+static bool rom_digest_table_store(const char *path, uint64_t size, int64_t mtime, const rom_digest_t *digest) {
+    rom_digest_table_load();
+    if (!rom_digest_table.loaded) {
+        return false;
+    }
+
+    uint64_t path_hash = fnv1a64_str(path);
+
+    // A stale record for the same path (file replaced or modified) is reused.
+    rom_digest_record_t *slot = rom_digest_table_find_path(path_hash);
+
+    if ((slot == NULL) && (rom_digest_table.count >= rom_digest_table.capacity) && (rom_digest_table.capacity < ROM_DIGEST_TABLE_MAX)) {
+        uint32_t capacity = (rom_digest_table.capacity > 0) ? (rom_digest_table.capacity * 2) : 64;
+        capacity = MIN(capacity, (uint32_t)ROM_DIGEST_TABLE_MAX);
+        rom_digest_record_t *records = realloc(rom_digest_table.records, capacity * sizeof(rom_digest_record_t));
+        if (records) {
+            rom_digest_table.records = records;
+            rom_digest_table.capacity = capacity;
+        }
+    }
+
+    if ((slot == NULL) && (rom_digest_table.count < rom_digest_table.capacity)) {
+        slot = &rom_digest_table.records[rom_digest_table.count++];
+    }
+
+    if (slot == NULL) {
+        return false;
+    }
+
+    slot->path_hash = path_hash;
+    slot->size = size;
+    slot->mtime = mtime;
+    slot->crc32 = digest->crc32;
+    memcpy(slot->md5, digest->md5, sizeof(slot->md5));
+    memcpy(slot->sha1, digest->sha1, sizeof(slot->sha1));
+    rom_digest_table.dirty = true;
+    return true;
+}
+
+static bool rom_digest_stat(const char *path, uint64_t *size, int64_t *mtime) {
+    struct stat st;
+    if ((stat(path, &st) != 0) || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    *size = (uint64_t)st.st_size;
+    *mtime = (int64_t)st.st_mtime;
+    return true;
+}
+
+
+static int rom_digest_hex_value(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+static bool rom_digest_parse_hex(const char *text, size_t length, uint8_t *out) {
+    if (strlen(text) != length * 2) {
+        return false;
+    }
+    for (size_t i = 0; i < length; i++) {
+        int hi = rom_digest_hex_value(text[i * 2]);
+        int lo = rom_digest_hex_value(text[i * 2 + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        out[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return true;
+}
+
+static int rom_digest_dat_compare(const void *a, const void *b) {
+    uint32_t crc_a = ((const rom_digest_dat_entry_t *)a)->crc32;
+    uint32_t crc_b = ((const rom_digest_dat_entry_t *)b)->crc32;
+    return (crc_a > crc_b) - (crc_a < crc_b);
+}
+
+static bool rom_digest_dat_parse_line(char *line, rom_digest_dat_entry_t *entry) {
+    char *crc_field = line;
+    char *sha1_field = strchr(crc_field, '\t');
+    if (!sha1_field) {
+        return false;
+    }
+    *sha1_field++ = '\0';
+    char *name_field = strchr(sha1_field, '\t');
+    if (!name_field) {
+        return false;
+    }
+    *name_field++ = '\0';
+
+    uint8_t crc_bytes[4];
+    if (!rom_digest_parse_hex(crc_field, sizeof(crc_bytes), crc_bytes) || (name_field[0] == '\0')) {
+        return false;
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    entry->crc32 = ((uint32_t)crc_bytes[0] << 24) | ((uint32_t)crc_bytes[1] << 16) | ((uint32_t)crc_bytes[2] << 8) | crc_bytes[3];
+    entry->has_sha1 = rom_digest_parse_hex(sha1_field, sizeof(entry->sha1), entry->sha1);
+    entry->name = strdup(name_field);
+    return (entry->name != NULL);
+}
+
+static void rom_digest_dat_load(void) {
+    if (rom_digest_dat.loaded || (rom_digest_prefix[0] == '\0')) {
+        return;
+    }
+    rom_digest_dat.loaded = true;
+
+    path_t *dat_path = rom_digest_cache_path(ROM_DIGEST_DAT_FILE);
+    FILE *f = fopen(path_get(dat_path), "r");
+    path_free(dat_path);
+    if (!f) {
+        return;
+    }
+
+    uint32_t capacity = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), f)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '\0' || line[0] == '#') {
+            continue;
+        }
+        if (rom_digest_dat.count >= capacity) {
+            uint32_t next_capacity = (capacity > 0) ? (capacity * 2) : 256;
+            rom_digest_dat_entry_t *entries = realloc(rom_digest_dat.entries, next_capacity * sizeof(rom_digest_dat_entry_t));
+            if (!entries) {
+                break;
+            }
+            rom_digest_dat.entries = entries;
+            capacity = next_capacity;
+        }
+        if (rom_digest_dat_parse_line(line, &rom_digest_dat.entries[rom_digest_dat.count])) {
+            rom_digest_dat.count++;
+        }
+    }
+    fclose(f);
+
+    if (rom_digest_dat.count > 1) {
+        qsort(rom_digest_dat.entries, rom_digest_dat.count, sizeof(rom_digest_dat_entry_t), rom_digest_dat_compare);
+    }
+}
+
+const char *rom_digest_dat_name(const rom_digest_t *digest) {
+    if (!digest) {
+        return NULL;
+    }
+    rom_digest_dat_load();
+
+    uint32_t low = 0;
+    uint32_t high = rom_digest_dat.count;
+    while (low < high) {
+        uint32_t mid = low + ((high - low) / 2);
+        if (rom_digest_dat.entries[mid].crc32 < digest->crc32) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    // CRC32 collisions are possible; the SHA-1 column settles them when present.
+    for (uint32_t i = low; (i < rom_digest_dat.count) && (rom_digest_dat.entries[i].crc32 == digest->crc32); i++) {
+        const rom_digest_dat_entry_t *entry = &rom_digest_dat.entries[i];
+        if (!entry->has_sha1 || (memcmp(entry->sha1, digest->sha1, sizeof(entry->sha1)) == 0)) {
+            return entry->name;
+        }
+    }
+    return NULL;
+}
+
+
+void rom_digest_init(const char *storage_prefix) {
+    snprintf(rom_digest_prefix, sizeof(rom_digest_prefix), "%s", storage_prefix ? storage_prefix : "");
+}
+
+bool rom_digest_lookup(const char *path, rom_digest_t *digest) {
+    uint64_t size;
+    int64_t mtime;
+    if (!path || !digest || !rom_digest_stat(path, &size, &mtime)) {
+        return false;
+    }
+    rom_digest_record_t *record = rom_digest_table_find(path, size, mtime);
+    if (!record) {
+        return false;
+    }
+    digest->crc32 = record->crc32;
+    memcpy(digest->md5, record->md5, sizeof(digest->md5));
+    memcpy(digest->sha1, record->sha1, sizeof(digest->sha1));
+    return true;
+}
+
+bool rom_digest_compute(const char *path, rom_digest_t *digest, rom_digest_progress_callback_t *progress) {
+    uint64_t size;
+    int64_t mtime;
+    if (!path || !digest || !rom_digest_stat(path, &size, &mtime)) {
+        return false;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return false;
+    }
+    uint8_t *buffer = memalign(16, ROM_DIGEST_CHUNK_SIZE);
+    if (!buffer) {
+        fclose(f);
+        return false;
+    }
+    setbuf(f, NULL);
+
+    rom_digest_ctx_t ctx;
+    rom_digest_ctx_init(&ctx);
+    rom_digest_order_t order = ROM_DIGEST_ORDER_BIG;
+    uint64_t offset = 0;
+    bool ok = true;
+    while (offset < size) {
+        size_t length = fread(buffer, 1, ROM_DIGEST_CHUNK_SIZE, f);
+        if (length == 0) {
+            ok = false;
+            break;
+        }
+        if (offset == 0) {
+            order = rom_digest_detect_order(buffer, length);
+        }
+        rom_digest_normalize(buffer, length, order);
+        rom_digest_ctx_update(&ctx, buffer, length);
+        offset += length;
+        if (progress) {
+            progress((float)offset / (float)size);
+        }
+    }
+
+    free(buffer);
+    fclose(f);
+    if (!ok) {
+        return false;
+    }
+
+    rom_digest_ctx_final(&ctx, digest);
+    rom_digest_table_store(path, size, mtime, digest);
+    return true;
+}
+
+
+static bool rom_digest_push_string(char ***list, int *count, int *capacity, const char *value) {
+    if (*count >= *capacity) {
+        int next_capacity = (*capacity > 0) ? (*capacity * 2) : 32;
+        char **next = realloc(*list, (size_t)next_capacity * sizeof(char *));
+        if (!next) {
+            return false;
+        }
+        *list = next;
+        *capacity = next_capacity;
+    }
+    (*list)[*count] = strdup(value);
+    if (!(*list)[*count]) {
+        return false;
+    }
+    (*count)++;
+    return true;
+}
+
+static bool rom_digest_should_skip_dir(const char *name) {
+    if (!name || name[0] == '\0' || name[0] == '.') {
+        return true;
+    }
+    return strcmp(name, "menu") == 0 ||
+        strcmp(name, "ED64") == 0 ||
+        strcmp(name, "ED64P") == 0 ||
+        strcmp(name, "System Volume Information") == 0 ||
+        strcmp(name, "__MACOSX") == 0;
+}
+
+static void rom_digest_job_close_dir(void) {
+    if (rom_digest_job.dir_open) {
+        f_closedir(&rom_digest_job.dir);
+        rom_digest_job.dir_open = false;
+    }
+    path_free(rom_digest_job.dir_path);
+    rom_digest_job.dir_path = NULL;
+}
+
+// The listing is held open in FatFs directly, dir_findnext() can't be resumed
+// on a later frame once other code has listed a directory in between.
+static void rom_digest_job_open_dir(void) {
+    char *dir_string = rom_digest_job.dirs[--rom_digest_job.dir_count];
+    rom_digest_job.dir_path = path_create(dir_string);
+    free(dir_string);
+    if (!rom_digest_job.dir_path) {
+        return;
+    }
+    if (f_opendir(&rom_digest_job.dir, strip_fs_prefix(path_get(rom_digest_job.dir_path))) != FR_OK) {
+        rom_digest_job_close_dir();
+        return;
+    }
+    rom_digest_job.dir_open = true;
+}
+
+static void rom_digest_job_scan_entry(void) {
+    FILINFO info;
+    if ((f_readdir(&rom_digest_job.dir, &info) != FR_OK) || (info.fname[0] == '\0')) {
+        rom_digest_job_close_dir();
+        return;
+    }
+
+    bool is_directory = (info.fattrib & AM_DIR) != 0;
+    if (is_directory ? !rom_digest_should_skip_dir(info.fname) : file_has_extensions(info.fname, rom_digest_extensions)) {
+        path_t *child = path_clone_push(rom_digest_job.dir_path, info.fname);
+        if (child) {
+            if (is_directory) {
+                rom_digest_push_string(&rom_digest_job.dirs, &rom_digest_job.dir_count, &rom_digest_job.dir_capacity, path_get(child));
+            } else {
+                rom_digest_push_string(&rom_digest_job.files, &rom_digest_job.file_count, &rom_digest_job.file_capacity, path_get(child));
+            }
+            path_free(child);
+        }
+    }
+}
+
+static void rom_digest_job_close_file(void) {
+    if (rom_digest_job.file) {
+        fclose(rom_digest_job.file);
+        rom_digest_job.file = NULL;
+    }
+    free(rom_digest_job.path);
+    rom_digest_job.path = NULL;
+    rom_digest_job.buffer_length = 0;
+    rom_digest_job.buffer_hashed = 0;
+}
+
+static void rom_digest_job_save_checkpoint(void) {
+    if (!rom_digest_job.file || !rom_digest_job.path) {
+        return;
+    }
+
+    rom_digest_checkpoint_t checkpoint = {
+        .magic = ROM_DIGEST_CHECKPOINT_MAGIC,
+        .version = ROM_DIGEST_VERSION,
+        .ctx_size = sizeof(rom_digest_ctx_t),
+        .path_length = strlen(rom_digest_job.path),
+        .size = rom_digest_job.size,
+        .mtime = rom_digest_job.mtime,
+        .offset = rom_digest_job.offset,
+        .order = rom_digest_job.order,
+        .ctx = rom_digest_job.ctx,
+    };
+    rom_digest_write_file(ROM_DIGEST_CHECKPOINT_FILE, &checkpoint, sizeof(checkpoint), rom_digest_job.path, checkpoint.path_length);
+    rom_digest_job.bytes_since_checkpoint = 0;
+}
+
+static void rom_digest_job_remove_checkpoint(void) {
+    path_t *checkpoint_path = rom_digest_cache_path(ROM_DIGEST_CHECKPOINT_FILE);
+    if (checkpoint_path) {
+        remove(path_get(checkpoint_path));
+        path_free(checkpoint_path);
+    }
+}
+
+static bool rom_digest_job_open(const char *path, uint64_t size, int64_t mtime) {
+    rom_digest_job.file = fopen(path, "rb");
+    if (!rom_digest_job.file) {
+        return false;
+    }
+    rom_digest_job.path = strdup(path);
+    if (!rom_digest_job.path) {
+        rom_digest_job_close_file();
+        return false;
+    }
+    setbuf(rom_digest_job.file, NULL);
+    rom_digest_job.size = size;
+    rom_digest_job.mtime = mtime;
+    rom_digest_job.offset = 0;
+    rom_digest_job.order = ROM_DIGEST_ORDER_BIG;
+    rom_digest_ctx_init(&rom_digest_job.ctx);
+    return true;
+}
+
+static void rom_digest_job_resume_checkpoint(void) {
+    path_t *checkpoint_path = rom_digest_cache_path(ROM_DIGEST_CHECKPOINT_FILE);
+    if (!checkpoint_path) {
+        return;
+    }
+    FILE *f = fopen(path_get(checkpoint_path), "rb");
+    path_free(checkpoint_path);
+    if (!f) {
+        return;
+    }
+
+    rom_digest_checkpoint_t checkpoint;
+    char path[ROM_DIGEST_PATH_MAX];
+    bool valid = (fread(&checkpoint, sizeof(checkpoint), 1, f) == 1) &&
+        (checkpoint.magic == ROM_DIGEST_CHECKPOINT_MAGIC) &&
+        (checkpoint.version == ROM_DIGEST_VERSION) &&
+        (checkpoint.ctx_size == sizeof(rom_digest_ctx_t)) &&
+        (checkpoint.path_length > 0) && (checkpoint.path_length < sizeof(path)) &&
+        (fread(path, 1, checkpoint.path_length, f) == checkpoint.path_length);
+    fclose(f);
+    if (!valid) {
+        return;
+    }
+    path[checkpoint.path_length] = '\0';
+
+    // Only resume when the file is still the one that was being hashed.
+    uint64_t size;
+    int64_t mtime;
+    if (!rom_digest_stat(path, &size, &mtime) || (size != checkpoint.size) || (mtime != checkpoint.mtime) ||
+        (checkpoint.offset > size) || !rom_digest_job_open(path, size, mtime)) {
+        return;
+    }
+    if (fseek(rom_digest_job.file, (long)checkpoint.offset, SEEK_SET) != 0) {
+        rom_digest_job_close_file();
+        return;
+    }
+    rom_digest_job.offset = checkpoint.offset;
+    rom_digest_job.order = (rom_digest_order_t)checkpoint.order;
+    rom_digest_job.ctx = checkpoint.ctx;
+    debugf("ROM digest: resuming %s at %llu\n", path, (unsigned long long)checkpoint.offset);
+}
+
+// Returns false when the ROM needs hashing but the table has no room left for it.
+static bool rom_digest_job_open_next(void) {
+    char *path = rom_digest_job.files[--rom_digest_job.file_count];
+    uint64_t size;
+    int64_t mtime;
+    bool ok = true;
+    if (rom_digest_stat(path, &size, &mtime) && !rom_digest_table_find(path, size, mtime)) {
+        if (rom_digest_table_full(path)) {
+            ok = false;
+        } else {
+            rom_digest_job_open(path, size, mtime);
+        }
+    }
+    free(path);
+    return ok;
+}
+
+// One SD read of a whole chunk. The offset only moves as the chunk is hashed,
+// so a checkpoint taken part way through resumes from the first unhashed byte.
+static void rom_digest_job_read_chunk(void) {
+    size_t length = fread(rom_digest_job.buffer, 1, ROM_DIGEST_CHUNK_SIZE, rom_digest_job.file);
+    if (length == 0) {
+        debugf("ROM digest: read failed for %s\n", rom_digest_job.path);
+        rom_digest_job_close_file();
+        return;
+    }
+    if (rom_digest_job.offset == 0) {
+        rom_digest_job.order = rom_digest_detect_order(rom_digest_job.buffer, length);
+    }
+    rom_digest_job.buffer_length = length;
+    rom_digest_job.buffer_hashed = 0;
+}
+
+static void rom_digest_job_hash_slice(void) {
+    uint8_t *slice = rom_digest_job.buffer + rom_digest_job.buffer_hashed;
+    size_t length = MIN(rom_digest_job.buffer_length - rom_digest_job.buffer_hashed, (size_t)ROM_DIGEST_HASH_SLICE_SIZE);
+    rom_digest_normalize(slice, length, rom_digest_job.order);
+    rom_digest_ctx_update(&rom_digest_job.ctx, slice, length);
+    rom_digest_job.buffer_hashed += length;
+    rom_digest_job.offset += length;
+    rom_digest_job.bytes_since_checkpoint += length;
+
+    if (rom_digest_job.buffer_hashed < rom_digest_job.buffer_length) {
+        return;
+    }
+
+    if (rom_digest_job.offset < rom_digest_job.size) {
+        if (rom_digest_job.bytes_since_checkpoint >= ROM_DIGEST_CHECKPOINT_BYTES) {
+            rom_digest_job_save_checkpoint();
+        }
+        return;
+    }
+
+    rom_digest_t digest;
+    rom_digest_ctx_final(&rom_digest_job.ctx, &digest);
+    if (!rom_digest_table_store(rom_digest_job.path, rom_digest_job.size, rom_digest_job.mtime, &digest)) {
+        debugf("ROM digest: unable to store digest of %s\n", rom_digest_job.path);
+    }
+    rom_digest_job_close_file();
+    rom_digest_job.bytes_since_checkpoint = 0;
+
+    if (++rom_digest_job.files_since_flush >= ROM_DIGEST_FLUSH_FILES) {
+        rom_digest_table_flush();
+        rom_digest_job_remove_checkpoint();
+        rom_digest_job.files_since_flush = 0;
+    }
+}
+
+static void rom_digest_job_free_lists(void) {
+    for (int i = 0; i < rom_digest_job.dir_count; i++) {
+        free(rom_digest_job.dirs[i]);
+    }
+    for (int i = 0; i < rom_digest_job.file_count; i++) {
+        free(rom_digest_job.files[i]);
+    }
+    free(rom_digest_job.dirs);
+    free(rom_digest_job.files);
+    rom_digest_job.dirs = NULL;
+    rom_digest_job.files = NULL;
+    rom_digest_job.dir_count = rom_digest_job.dir_capacity = 0;
+    rom_digest_job.file_count = rom_digest_job.file_capacity = 0;
+}
+
+void rom_digest_job_start(const char *root) {
+    if (rom_digest_job.active || !root || (rom_digest_prefix[0] == '\0')) {
+        return;
+    }
+
+    rom_digest_job.buffer = memalign(16, ROM_DIGEST_CHUNK_SIZE);
+    if (!rom_digest_job.buffer) {
+        return;
+    }
+    if (!rom_digest_push_string(&rom_digest_job.dirs, &rom_digest_job.dir_count, &rom_digest_job.dir_capacity, root)) {
+        free(rom_digest_job.buffer);
+        rom_digest_job.buffer = NULL;
+        return;
+    }
+
+    rom_digest_table_load();
+    rom_digest_job_resume_checkpoint();
+    rom_digest_job.active = true;
+}
+
+void rom_digest_job_stop(void) {
+    if (!rom_digest_job.active) {
+        return;
+    }
+    rom_digest_job_save_checkpoint();
+    rom_digest_job_close_file();
+    rom_digest_job_close_dir();
+    rom_digest_job_free_lists();
+    free(rom_digest_job.buffer);
+    rom_digest_job.buffer = NULL;
+    rom_digest_job.active = false;
+    rom_digest_table_flush();
+}
+
+bool rom_digest_job_active(void) {
+    return rom_digest_job.active;
+}
+
+void rom_digest_poll(void) {
+    if (!rom_digest_job.active) {
+        return;
+    }
+
+    // Every step is a bounded slice of work: hashing ROM_DIGEST_HASH_SLICE_SIZE
+    // bytes, one directory entry or one file lookup. Reading the next
+    // ROM_DIGEST_CHUNK_SIZE chunk is one SD command that can't be split, so it
+    // is only done as the first step of a poll and the chunk is hashed over
+    // this and the following polls.
+    uint64_t start_us = get_ticks_us();
+    bool first_step = true;
+    do {
+        if (rom_digest_job.file && (rom_digest_job.buffer_hashed < rom_digest_job.buffer_length)) {
+            rom_digest_job_hash_slice();
+        } else if (rom_digest_job.file) {
+            if (!first_step) {
+                return;
+            }
+            rom_digest_job_read_chunk();
+        } else if (rom_digest_job.file_count > 0) {
+            // Hashing ROMs that can't be stored would repeat on every boot.
+            if (!rom_digest_job_open_next()) {
+                debugf("ROM digest: table full (%d digests), stopping job\n", ROM_DIGEST_TABLE_MAX);
+                rom_digest_job_stop();
+                rom_digest_job_remove_checkpoint();
+                return;
+            }
+        } else if (rom_digest_job.dir_open) {
+            rom_digest_job_scan_entry();
+        } else if (rom_digest_job.dir_count > 0) {
+            rom_digest_job_open_dir();
+        } else {
+            debugf("ROM digest: job complete, %lu digests stored\n", (unsigned long)rom_digest_table.count);
+            rom_digest_job_stop();
+            rom_digest_job_remove_checkpoint();
+            return;
+        }
+        first_step = false;
+    } while ((get_ticks_us() - start_us) < ROM_DIGEST_POLL_BUDGET_US);
+}
+
+void rom_digest_deinit(void) {
+    rom_digest_job_stop();
+    rom_digest_table_flush();
+}
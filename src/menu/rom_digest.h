@@ -0,0 +1,100 @@
+/**
+ * @file rom_digest.h
+ * @brief Full-ROM CRC32/MD5/SHA-1 digests and DAT identification
+ * @ingroup menu
+ */
+
+#ifndef ROM_DIGEST_H__
+#define ROM_DIGEST_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ROM_DIGEST_MD5_LENGTH   (16)
+#define ROM_DIGEST_SHA1_LENGTH  (20)
+
+/** @brief Digests of a whole ROM image in big-endian (.z64) byte order. */
+typedef struct {
+    uint32_t crc32;
+    uint8_t md5[ROM_DIGEST_MD5_LENGTH];
+    uint8_t sha1[ROM_DIGEST_SHA1_LENGTH];
+} rom_digest_t;
+
+/** @brief Hashing progress callback, @p progress goes from 0.0 to 1.0. */
+typedef void rom_digest_progress_callback_t (float progress);
+
+/**
+ * @brief Set the storage prefix used for the digest table and DAT file.
+ *
+ * @param storage_prefix Storage prefix (eg. "sd:/")
+ */
+void rom_digest_init(const char *storage_prefix);
+
+/**
+ * @brief Persist the digest table and the background job checkpoint.
+ */
+void rom_digest_deinit(void);
+
+/**
+ * @brief Look up the stored digest of a ROM.
+ *
+ * Entries are keyed by path, file size and modification time, so a replaced
+ * or edited ROM is never matched against stale digests.
+ *
+ * @param path Full ROM path including the storage prefix
+ * @param digest Output digest
+ * @return true when a digest for the current file contents is known
+ */
+bool rom_digest_lookup(const char *path, rom_digest_t *digest);
+
+/**
+ * @brief Hash a ROM synchronously and store the result in the digest table.
+ *
+ * @param path Full ROM path including the storage prefix
+ * @param digest Output digest
+ * @param progress Optional progress callback, called after every chunk
+ * @return true on success
+ */
+bool rom_digest_compute(const char *path, rom_digest_t *digest, rom_digest_progress_callback_t *progress);
+
+/**
+ * @brief Find the DAT entry name for a digest.
+ *
+ * The DAT table is a text file derived from a No-Intro style DAT, one
+ * `CRC32<TAB>SHA1<TAB>Name` entry per line. The SHA-1 column may be empty.
+ *
+ * @param digest Digest to identify
+ * @return Entry name, or NULL when the ROM is not in the DAT
+ */
+const char *rom_digest_dat_name(const rom_digest_t *digest);
+
+/**
+ * @brief Start the background hashing job.
+ *
+ * The job walks the directory tree below @p root and hashes every ROM that
+ * has no up-to-date digest. A checkpoint of the file in progress is saved
+ * periodically, so the job resumes where it left off after a reboot. The job
+ * stops early once the digest table is full.
+ *
+ * @param root Full directory path including the storage prefix
+ */
+void rom_digest_job_start(const char *root);
+
+/**
+ * @brief Stop the background hashing job, keeping its checkpoint.
+ */
+void rom_digest_job_stop(void);
+
+/**
+ * @brief Returns true while the background hashing job has work left.
+ */
+bool rom_digest_job_active(void);
+
+/**
+ * @brief Advance the background hashing job within a per-frame time budget.
+ *
+ * Call once per displayed frame.
+ */
+void rom_digest_poll(void);
+
+#endif /* ROM_DIGEST_H__ */
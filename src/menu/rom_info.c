@@ -7,17 +7,22 @@
 
 #include <errno.h>
 #include <ctype.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/stat.h>
 
 #include <libdragon.h>
 #include <mini.c/src/mini.h>
 
 #include "boot/cic.h"
+#include "metadata_index.h"
 #include "rom_info.h"
 #include "utils/fs.h"
+#include "utils/hash.h"
+#include "utils/utils.h"
 
 
 #define SWAP_VARS(x0, x1)       { typeof(x0) tmp = (x0); (x0) = (x1); (x1) = (tmp); }
@@ -29,6 +34,23 @@
 
 #define CLOCK_RATE_DEFAULT      (0x0000000F)
 #define ROM_STABLE_ID_CACHE_SIZE (128)
+#define ROM_HEADER_PREFIX_SIZE  (64)
+#define ROM_QUICK_DIR_CACHE_SLOTS (4)
+#define METADATA_INI_BUFFER_SIZE (64 * 1024)
+#define METADATA_FILE_NAME_MAX  (128)
+
+#define ROM_IDENTITY_CACHE_FILE     "menu/cache/rom_identity.cache"
+#define ROM_IDENTITY_CACHE_MAGIC    (0x524F4D49u) /* ROMI */
+#define ROM_IDENTITY_CACHE_VERSION  (2u)
+#define ROM_IDENTITY_CACHE_MAX      (1024)
+
+#ifndef MENU_VERSION
+#define MENU_VERSION "Unknown"
+#endif
+
+#ifndef BUILD_TIMESTAMP
+#define BUILD_TIMESTAMP "Unknown"
+#endif
 
 
 /** @brief ROM File Information Structure. */
@@ -695,6 +717,260 @@ static rom_resolved_path_cache_entry_t *rom_resolved_path_cache_alloc(const char
 }
 
 
+/**
+ * Persistent ROM identity cache
+ *
+ * Everything rom_config_load_ex() derives from the ROM file itself (the
+ * endian-corrected first 64 header bytes, the database match and the CIC
+ * detected from the IPL3) is stored per ROM in ROM_IDENTITY_CACHE_FILE,
+ * keyed by path hash + file size + mtime. A hit replaces the 4 KiB header
+ * read, the endianness fix-up, the database scan and the IPL3 hash with a
+ * single stat(). The table is loaded on first use and written back with
+ * rom_info_identity_cache_flush(). The header carries a hash of the game
+ * database and the menu build, so records derived by another build are
+ * dropped instead of outliving the detection code that produced them.
+ */
+typedef struct __attribute__((packed)) {
+    uint64_t path_hash;
+    uint64_t size;
+    int64_t mtime;
+    uint32_t last_used;
+    int32_t cic_type;
+    int32_t save_type;
+    uint16_t feat;
+    uint8_t match_type;
+    uint8_t endianness;
+    uint8_t header[ROM_HEADER_PREFIX_SIZE];
+} rom_identity_record_t;
+
+_Static_assert(offsetof(rom_header_t, ipl3) == ROM_HEADER_PREFIX_SIZE, "identity record must hold the full pre-IPL3 header");
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t count;
+    uint64_t build_hash;
+} rom_identity_cache_header_t;
+
+static struct {
+    bool loaded;
+    bool dirty;
+    char prefix[16];
+    rom_identity_record_t *records;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t tick;
+} rom_identity_cache;
+
+static uint64_t rom_identity_cache_build_hash (void) {
+    static uint64_t hash = 0;
+    if (hash != 0) {
+        return hash;
+    }
+
+    uint32_t h = FNV1A_32_OFFSET_BASIS;
+    for (const match_t *entry = database; entry->type != MATCH_TYPE_END; entry++) {
+        h = fnv1a32_u8(h, (uint8_t)entry->type);
+        if (entry->type == MATCH_TYPE_CHECK_CODE) {
+            h = fnv1a32_u64(h, entry->fields.check_code);
+        } else {
+            h = fnv1a32_str(h, entry->fields.id);
+            h = fnv1a32_u8(h, entry->fields.version);
+        }
+        h = fnv1a32_u64(h, (uint64_t)entry->data.save);
+        h = fnv1a32_u64(h, (uint64_t)entry->data.feat);
+    }
+
+    hash = ((uint64_t)h << 32) | (uint32_t)fnv1a64_str(MENU_VERSION " " BUILD_TIMESTAMP);
+    return hash;
+}
+
+static bool rom_identity_cache_prefix_from_path (const char *full_path, char *prefix, size_t prefix_size) {
+    const char *prefix_end = full_path ? strstr(full_path, ":/") : NULL;
+    if (prefix_end == NULL) {
+        return false;
+    }
+    size_t prefix_length = (size_t)(prefix_end - full_path) + 2;
+    if (prefix_length >= prefix_size) {
+        return false;
+    }
+    memcpy(prefix, full_path, prefix_length);
+    prefix[prefix_length] = '\0';
+    return true;
+}
+
+static void rom_identity_cache_load (const char *full_path) {
+    if (rom_identity_cache.loaded) {
+        return;
+    }
+    if (!rom_identity_cache_prefix_from_path(full_path, rom_identity_cache.prefix, sizeof(rom_identity_cache.prefix))) {
+        return;
+    }
+    rom_identity_cache.loaded = true;
+
+    path_t *cache_path = path_init(rom_identity_cache.prefix, ROM_IDENTITY_CACHE_FILE);
+    FILE *f = fopen(path_get(cache_path), "rb");
+    path_free(cache_path);
+    if (f == NULL) {
+        return;
+    }
+
+    rom_identity_cache_header_t header;
+    bool valid = (fread(&header, sizeof(header), 1, f) == 1) &&
+        (header.magic == ROM_IDENTITY_CACHE_MAGIC) &&
+        (header.version == ROM_IDENTITY_CACHE_VERSION) &&
+        (header.record_size == sizeof(rom_identity_record_t)) &&
+        (header.build_hash == rom_identity_cache_build_hash()) &&
+        (header.count <= ROM_IDENTITY_CACHE_MAX);
+
+    if (valid && (header.count > 0)) {
+        rom_identity_cache.records = malloc(header.count * sizeof(rom_identity_record_t));
+        if (rom_identity_cache.records &&
+            (fread(rom_identity_cache.records, sizeof(rom_identity_record_t), header.count, f) == header.count)) {
+            rom_identity_cache.count = header.count;
+            rom_identity_cache.capacity = header.count;
+            for (uint32_t i = 0; i < header.count; i++) {
+                rom_identity_cache.tick = MAX(rom_identity_cache.tick, rom_identity_cache.records[i].last_used);
+            }
+        } else {
+            free(rom_identity_cache.records);
+            rom_identity_cache.records = NULL;
+        }
+    }
+
+    fclose(f);
+}
+
+static rom_identity_record_t *rom_identity_cache_find (const char *full_path, const struct stat *st) {
+    rom_identity_cache_load(full_path);
+
+    uint64_t path_hash = fnv1a64_str(full_path);
+    for (uint32_t i = 0; i < rom_identity_cache.count; i++) {
+        rom_identity_record_t *record = &rom_identity_cache.records[i];
+        if ((record->path_hash == path_hash) &&
+            (record->size == (uint64_t)st->st_size) &&
+            (record->mtime == (int64_t)st->st_mtime)) {
+            record->last_used = ++rom_identity_cache.tick;
+            return record;
+        }
+    }
+
+    return NULL;
+}
+
+static void rom_identity_cache_store (const char *full_path, const struct stat *st, const rom_header_t *rom_header,
+                                      const rom_info_t *rom_info, const match_t *match, rom_cic_type_t cic_type) {
+    rom_identity_cache_load(full_path);
+    if (!rom_identity_cache.loaded) {
+        return;
+    }
+
+    uint64_t path_hash = fnv1a64_str(full_path);
+    rom_identity_record_t *slot = NULL;
+
+    // A stale record for the same path (file replaced or modified) is reused.
+    for (uint32_t i = 0; i < rom_identity_cache.count; i++) {
+        if (rom_identity_cache.records[i].path_hash == path_hash) {
+            slot = &rom_identity_cache.records[i];
+            break;
+        }
+    }
+
+    if ((slot == NULL) && (rom_identity_cache.count < rom_identity_cache.capacity)) {
+        slot = &rom_identity_cache.records[rom_identity_cache.count++];
+    }
+
+    if ((slot == NULL) && (rom_identity_cache.capacity < ROM_IDENTITY_CACHE_MAX)) {
+        uint32_t capacity = (rom_identity_cache.capacity > 0) ? (rom_identity_cache.capacity * 2) : 64;
+        capacity = MIN(capacity, (uint32_t)ROM_IDENTITY_CACHE_MAX);
+        rom_identity_record_t *records = realloc(rom_identity_cache.records, capacity * sizeof(rom_identity_record_t));
+        if (records != NULL) {
+            rom_identity_cache.records = records;
+            rom_identity_cache.capacity = capacity;
+            slot = &rom_identity_cache.records[rom_identity_cache.count++];
+        }
+    }
+
+    if ((slot == NULL) && (rom_identity_cache.count > 0)) {
+        slot = &rom_identity_cache.records[0];
+        for (uint32_t i = 1; i < rom_identity_cache.count; i++) {
+            if (rom_identity_cache.records[i].last_used < slot->last_used) {
+                slot = &rom_identity_cache.records[i];
+            }
+        }
+    }
+
+    if (slot == NULL) {
+        return;
+    }
+
+    memset(slot, 0, sizeof(*slot));
+    slot->path_hash = path_hash;
+    slot->size = (uint64_t)st->st_size;
+    slot->mtime = (int64_t)st->st_mtime;
+    slot->last_used = ++rom_identity_cache.tick;
+    slot->cic_type = (int32_t)cic_type;
+    slot->save_type = (int32_t)match->data.save;
+    slot->feat = (uint16_t)match->data.feat;
+    slot->match_type = (uint8_t)match->type;
+    slot->endianness = (uint8_t)rom_info->endianness;
+    memcpy(slot->header, rom_header, sizeof(slot->header));
+    rom_identity_cache.dirty = true;
+}
+
+void rom_info_identity_cache_flush (void) {
+    if (!rom_identity_cache.loaded || !rom_identity_cache.dirty) {
+        return;
+    }
+
+    path_t *cache_path = path_init(rom_identity_cache.prefix, ROM_IDENTITY_CACHE_FILE);
+    path_t *cache_directory = path_clone(cache_path);
+    path_pop(cache_directory);
+    directory_create(path_get(cache_directory));
+    path_free(cache_directory);
+
+    size_t path_length = strlen(path_get(cache_path));
+    char *tmp_path = malloc(path_length + 5);
+    if (tmp_path == NULL) {
+        path_free(cache_path);
+        return;
+    }
+    memcpy(tmp_path, path_get(cache_path), path_length);
+    memcpy(tmp_path + path_length, ".tmp", 5);
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (f == NULL) {
+        free(tmp_path);
+        path_free(cache_path);
+        return;
+    }
+
+    rom_identity_cache_header_t header = {
+        .magic = ROM_IDENTITY_CACHE_MAGIC,
+        .version = ROM_IDENTITY_CACHE_VERSION,
+        .record_size = sizeof(rom_identity_record_t),
+        .count = rom_identity_cache.count,
+        .build_hash = rom_identity_cache_build_hash(),
+    };
+    bool ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+    if (ok && (rom_identity_cache.count > 0)) {
+        ok = (fwrite(rom_identity_cache.records, sizeof(rom_identity_record_t), rom_identity_cache.count, f) == rom_identity_cache.count);
+    }
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+
+    if (ok && file_rename(tmp_path, path_get(cache_path))) {
+        rom_identity_cache.dirty = false;
+    } else {
+        remove(tmp_path);
+    }
+
+    free(tmp_path);
+    path_free(cache_path);
+}
+
 static void fix_rom_header_endianness (rom_header_t *rom_header, rom_info_t *rom_info) {
     uint8_t *raw = (uint8_t *) (rom_header);
 
@@ -864,11 +1140,13 @@ static void read_metadata_text_file_if_missing(path_t *directory, bool enabled,
         return;
     }
 
+    if (!metadata_index_file_exists(path_get(directory), filename)) {
+        return;
+    }
+
     path_t *text_path = path_clone(directory);
     path_push(text_path, (char *)filename);
-    if (file_exists(path_get(text_path))) {
-        read_text_file_to_buffer(path_get(text_path), buffer, buffer_length);
-    }
+    read_text_file_to_buffer(path_get(text_path), buffer, buffer_length);
     path_free(text_path);
 }
 
@@ -1010,239 +1288,484 @@ static bool parse_player_count_from_value(const char *value, int32_t *out_min, i
     return true;
 }
 
-static void load_rom_metadata_from_directory (path_t *directory, rom_info_t *rom_info, bool include_long_description) {
-    if ((directory == NULL) || (rom_info == NULL)) {
+/** @brief metadata.ini keys understood by the parser. */
+typedef enum {
+    METADATA_KEY_UNKNOWN = -1,
+
+    // [curated] sidecar file references, in the order their text is loaded.
+    METADATA_KEY_DESCRIPTION = 0,
+    METADATA_KEY_HOOK,
+    METADATA_KEY_WHY_PLAY,
+    METADATA_KEY_VIBE,
+    METADATA_KEY_NOTABLE,
+    METADATA_KEY_CONTEXT,
+    METADATA_KEY_PLAY_CURATOR_NOTE,
+    METADATA_KEY_TAGS,
+    METADATA_KEY_WARNINGS,
+    METADATA_KEY_MUSEUM_CARD,
+    METADATA_KEY_TRIVIA_MUSEUM,
+    METADATA_KEY_ODDITIES,
+    METADATA_KEY_DESIGN_QUIRKS,
+    METADATA_KEY_DISCOVERY_PROMPTS,
+    METADATA_KEY_CURATOR,
+    METADATA_KEY_MUSEUM,
+    METADATA_KEY_TRIVIA,
+    METADATA_KEY_RECEPTION,
+    METADATA_CURATED_KEY_COUNT,
+
+    // [meta] / [metadata] values.
+    METADATA_KEY_NAME,
+    METADATA_KEY_AUTHOR,
+    METADATA_KEY_DEVELOPER,
+    METADATA_KEY_GENRE,
+    METADATA_KEY_SERIES,
+    METADATA_KEY_MODES,
+    METADATA_KEY_PLAYERS,
+    METADATA_KEY_PLAYERS_MIN,
+    METADATA_KEY_PLAYERS_MAX,
+    METADATA_KEY_SHORT_DESC,
+    METADATA_KEY_LONG_DESC,
+    METADATA_KEY_AGE_RATING,
+    METADATA_KEY_ESRB,
+    METADATA_KEY_RELEASE_YEAR,
+} metadata_key_t;
+
+/** @brief Default sidecar file and destination field for a [curated] key. */
+typedef struct {
+    const char *default_filename;
+    size_t offset;
+    size_t length;
+} metadata_sidecar_t;
+
+#define METADATA_SIDECAR(key, filename, field) \
+    [key] = { filename, offsetof(rom_info_t, metadata.field), sizeof(((rom_info_t *)0)->metadata.field) }
+
+static const metadata_sidecar_t metadata_sidecars[METADATA_CURATED_KEY_COUNT] = {
+    METADATA_SIDECAR(METADATA_KEY_DESCRIPTION, "description.txt", long_desc),
+    METADATA_SIDECAR(METADATA_KEY_HOOK, "hook.txt", hook),
+    METADATA_SIDECAR(METADATA_KEY_WHY_PLAY, "why_play.txt", why_play),
+    METADATA_SIDECAR(METADATA_KEY_VIBE, "vibe.txt", vibe),
+    METADATA_SIDECAR(METADATA_KEY_NOTABLE, "notable.txt", notable),
+    METADATA_SIDECAR(METADATA_KEY_CONTEXT, "context.txt", context),
+    METADATA_SIDECAR(METADATA_KEY_PLAY_CURATOR_NOTE, "play_curator_note.txt", play_curator_note),
+    METADATA_SIDECAR(METADATA_KEY_TAGS, "tags.txt", tags),
+    METADATA_SIDECAR(METADATA_KEY_WARNINGS, "warnings.txt", warnings),
+    METADATA_SIDECAR(METADATA_KEY_MUSEUM_CARD, "museum_card.txt", museum_card),
+    METADATA_SIDECAR(METADATA_KEY_TRIVIA_MUSEUM, "trivia_museum.txt", trivia_museum),
+    METADATA_SIDECAR(METADATA_KEY_ODDITIES, "oddities.txt", oddities),
+    METADATA_SIDECAR(METADATA_KEY_DESIGN_QUIRKS, "design_quirks.txt", design_quirks),
+    METADATA_SIDECAR(METADATA_KEY_DISCOVERY_PROMPTS, "discovery_prompts.txt", discovery_prompts),
+    METADATA_SIDECAR(METADATA_KEY_CURATOR, "curator.txt", curator),
+    METADATA_SIDECAR(METADATA_KEY_MUSEUM, "museum.txt", museum),
+    METADATA_SIDECAR(METADATA_KEY_TRIVIA, "trivia.txt", trivia),
+    METADATA_SIDECAR(METADATA_KEY_RECEPTION, "reception.txt", reception),
+};
+
+#undef METADATA_SIDECAR
+
+// Case-insensitive key compare where '-' and '_' are interchangeable.
+static bool metadata_key_equals (const char *key, const char *literal) {
+    for (; *literal != '\0'; key++, literal++) {
+        char a = (char)tolower((unsigned char)*key);
+        char b = *literal;
+        if (a == '-') {
+            a = '_';
+        }
+        if (a != b) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Keys are dispatched on length first and first character second, so each
+// line costs at most a couple of short compares instead of a strcmp chain.
+// The caller guarantees `length` matches the literal's length.
+static metadata_key_t metadata_key_lookup_meta (const char *key, size_t length) {
+    #define KEY(literal, result)    if (metadata_key_equals(key, literal)) { return result; }
+    switch (length) {
+        case 3:
+            KEY("dev", METADATA_KEY_DEVELOPER);
+            break;
+        case 4:
+            switch (tolower((unsigned char)key[0])) {
+                case 'n': KEY("name", METADATA_KEY_NAME); break;
+                case 'm': KEY("mode", METADATA_KEY_MODES); break;
+                case 't': KEY("tags", METADATA_KEY_MODES); break;
+                case 'e': KEY("esrb", METADATA_KEY_ESRB); break;
+                case 'y': KEY("year", METADATA_KEY_RELEASE_YEAR); break;
+            }
+            break;
+        case 5:
+            switch (tolower((unsigned char)key[0])) {
+                case 't': KEY("title", METADATA_KEY_NAME); break;
+                case 'g': KEY("genre", METADATA_KEY_GENRE); break;
+                case 'm': KEY("modes", METADATA_KEY_MODES); break;
+            }
+            break;
+        case 6:
+            switch (tolower((unsigned char)key[0])) {
+                case 'a': KEY("author", METADATA_KEY_AUTHOR); break;
+                case 'g': KEY("genres", METADATA_KEY_GENRE); break;
+                case 's':
+                    KEY("studio", METADATA_KEY_DEVELOPER);
+                    KEY("series", METADATA_KEY_SERIES);
+                    break;
+            }
+            break;
+        case 7:
+            switch (tolower((unsigned char)key[0])) {
+                case 'p': KEY("players", METADATA_KEY_PLAYERS); break;
+                case 's': KEY("summary", METADATA_KEY_SHORT_DESC); break;
+            }
+            break;
+        case 8:
+            KEY("category", METADATA_KEY_GENRE);
+            break;
+        case 9:
+            switch (tolower((unsigned char)key[0])) {
+                case 'p': KEY("publisher", METADATA_KEY_AUTHOR); break;
+                case 'd': KEY("developer", METADATA_KEY_DEVELOPER); break;
+                case 'f': KEY("franchise", METADATA_KEY_SERIES); break;
+                case 'l': KEY("long_desc", METADATA_KEY_LONG_DESC); break;
+            }
+            break;
+        case 10:
+            switch (tolower((unsigned char)key[0])) {
+                case 's': KEY("short_desc", METADATA_KEY_SHORT_DESC); break;
+                case 'a': KEY("age_rating", METADATA_KEY_AGE_RATING); break;
+            }
+            break;
+        case 11:
+            switch (tolower((unsigned char)key[0])) {
+                case 'p':
+                    KEY("playercount", METADATA_KEY_PLAYERS);
+                    KEY("players_min", METADATA_KEY_PLAYERS_MIN);
+                    KEY("players_max", METADATA_KEY_PLAYERS_MAX);
+                    break;
+                case 'e': KEY("esrb_rating", METADATA_KEY_ESRB); break;
+                case 'r': KEY("releaseyear", METADATA_KEY_RELEASE_YEAR); break;
+            }
+            break;
+        case 12:
+            switch (tolower((unsigned char)key[0])) {
+                case 'p': KEY("player_count", METADATA_KEY_PLAYERS); break;
+                case 'r':
+                    KEY("release_date", METADATA_KEY_RELEASE_YEAR);
+                    KEY("release_year", METADATA_KEY_RELEASE_YEAR);
+                    break;
+            }
+            break;
+        case 15:
+            KEY("esrb_age_rating", METADATA_KEY_ESRB);
+            break;
+    }
+    #undef KEY
+    return METADATA_KEY_UNKNOWN;
+}
+
+static metadata_key_t metadata_key_lookup_curated (const char *key, size_t length) {
+    #define KEY(literal, result)    if (metadata_key_equals(key, literal)) { return result; }
+    switch (length) {
+        case 4:
+            switch (tolower((unsigned char)key[0])) {
+                case 'h': KEY("hook", METADATA_KEY_HOOK); break;
+                case 'v': KEY("vibe", METADATA_KEY_VIBE); break;
+                case 't': KEY("tags", METADATA_KEY_TAGS); break;
+            }
+            break;
+        case 6:
+            switch (tolower((unsigned char)key[0])) {
+                case 'm': KEY("museum", METADATA_KEY_MUSEUM); break;
+                case 't': KEY("trivia", METADATA_KEY_TRIVIA); break;
+            }
+            break;
+        case 7:
+            switch (tolower((unsigned char)key[0])) {
+                case 'n': KEY("notable", METADATA_KEY_NOTABLE); break;
+                case 'c':
+                    KEY("context", METADATA_KEY_CONTEXT);
+                    KEY("curator", METADATA_KEY_CURATOR);
+                    break;
+            }
+            break;
+        case 8:
+            switch (tolower((unsigned char)key[0])) {
+                case 'w':
+                    KEY("why_play", METADATA_KEY_WHY_PLAY);
+                    KEY("warnings", METADATA_KEY_WARNINGS);
+                    break;
+                case 'o': KEY("oddities", METADATA_KEY_ODDITIES); break;
+            }
+            break;
+        case 9:
+            KEY("reception", METADATA_KEY_RECEPTION);
+            break;
+        case 11:
+            switch (tolower((unsigned char)key[0])) {
+                case 'm': KEY("museum_card", METADATA_KEY_MUSEUM_CARD); break;
+                case 'd': KEY("description", METADATA_KEY_DESCRIPTION); break;
+            }
+            break;
+        case 13:
+            switch (tolower((unsigned char)key[0])) {
+                case 't': KEY("trivia_museum", METADATA_KEY_TRIVIA_MUSEUM); break;
+                case 'd': KEY("design_quirks", METADATA_KEY_DESIGN_QUIRKS); break;
+            }
+            break;
+        case 16:
+            KEY("full_description", METADATA_KEY_DESCRIPTION);
+            break;
+        case 17:
+            switch (tolower((unsigned char)key[0])) {
+                case 'p': KEY("play_curator_note", METADATA_KEY_PLAY_CURATOR_NOTE); break;
+                case 'd': KEY("discovery_prompts", METADATA_KEY_DISCOVERY_PROMPTS); break;
+            }
+            break;
+    }
+    #undef KEY
+    return METADATA_KEY_UNKNOWN;
+}
+
+static void metadata_apply_value (rom_info_t *rom_info, metadata_key_t key, const char *value) {
+    switch (key) {
+        case METADATA_KEY_NAME:
+            metadata_copy_if_empty(rom_info->metadata.name, sizeof(rom_info->metadata.name), value);
+            break;
+        case METADATA_KEY_AUTHOR:
+            metadata_copy_if_empty(rom_info->metadata.author, sizeof(rom_info->metadata.author), value);
+            break;
+        case METADATA_KEY_DEVELOPER:
+            metadata_copy_if_empty(rom_info->metadata.developer, sizeof(rom_info->metadata.developer), value);
+            break;
+        case METADATA_KEY_GENRE:
+            metadata_copy_if_empty(rom_info->metadata.genre, sizeof(rom_info->metadata.genre), value);
+            break;
+        case METADATA_KEY_SERIES:
+            metadata_copy_if_empty(rom_info->metadata.series, sizeof(rom_info->metadata.series), value);
+            break;
+        case METADATA_KEY_MODES:
+            metadata_copy_if_empty(rom_info->metadata.modes, sizeof(rom_info->metadata.modes), value);
+            break;
+        case METADATA_KEY_SHORT_DESC:
+            metadata_copy_if_empty(rom_info->metadata.short_desc, sizeof(rom_info->metadata.short_desc), value);
+            break;
+        case METADATA_KEY_PLAYERS:
+            if (rom_info->metadata.players_max < 0) {
+                int32_t players_min = -1;
+                int32_t players_max = -1;
+                if (parse_player_count_from_value(value, &players_min, &players_max)) {
+                    rom_info->metadata.players_min = players_min;
+                    rom_info->metadata.players_max = players_max;
+                }
+            }
+            break;
+        case METADATA_KEY_PLAYERS_MIN:
+            if (rom_info->metadata.players_min < 0) {
+                rom_info->metadata.players_min = (int32_t)atoi(value);
+            }
+            break;
+        case METADATA_KEY_PLAYERS_MAX:
+            if (rom_info->metadata.players_max < 0) {
+                rom_info->metadata.players_max = (int32_t)atoi(value);
+            }
+            break;
+        case METADATA_KEY_AGE_RATING:
+            if (rom_info->metadata.age_rating < 0) {
+                int32_t parsed = parse_age_rating_from_value(value);
+                if (parsed >= 0) {
+                    rom_info->metadata.age_rating = parsed;
+                }
+            }
+            break;
+        case METADATA_KEY_ESRB:
+            if (rom_info->metadata.esrb_age_rating == ROM_ESRB_AGE_RATING_NONE) {
+                rom_esrb_age_rating_t parsed = parse_esrb_age_rating_from_value(value);
+                if (parsed != ROM_ESRB_AGE_RATING_NONE) {
+                    rom_info->metadata.esrb_age_rating = parsed;
+                }
+            }
+            break;
+        case METADATA_KEY_RELEASE_YEAR:
+            if (rom_info->metadata.release_year < 0) {
+                int32_t year = parse_release_year_from_value(value);
+                if (year >= 0) {
+                    rom_info->metadata.release_year = year;
+                }
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+/** @brief metadata.ini parser state carried from line to line. */
+typedef struct {
+    bool in_meta_section;
+    bool in_curated_section;
+    char long_desc_file[METADATA_FILE_NAME_MAX];
+    char sidecar_files[METADATA_CURATED_KEY_COUNT][METADATA_FILE_NAME_MAX];
+} metadata_ini_state_t;
+
+static void metadata_parse_line (metadata_ini_state_t *state, rom_info_t *rom_info, char *line) {
+    char *cursor = trim_whitespace(line);
+    if (*cursor == '\0' || *cursor == ';' || *cursor == '#') {
         return;
     }
 
-    path_t *metadata_path = path_clone(directory);
-    path_push(metadata_path, "metadata.ini");
-    if (!file_exists(path_get(metadata_path))) {
-        path_free(metadata_path);
+    if (*cursor == '[') {
+        char *section_end = strchr(cursor, ']');
+        if (section_end == NULL) {
+            return;
+        }
+        *section_end = '\0';
+        char *section_name = trim_whitespace(cursor + 1);
+        state->in_meta_section = ((strcasecmp(section_name, "meta") == 0) || (strcasecmp(section_name, "metadata") == 0));
+        state->in_curated_section = (strcasecmp(section_name, "curated") == 0);
         return;
     }
 
-    FILE *metadata_file = fopen(path_get(metadata_path), "rb");
-    path_free(metadata_path);
-    if (metadata_file == NULL) {
+    if (!state->in_meta_section && !state->in_curated_section) {
         return;
     }
 
-    bool in_meta_section = false;
-    bool in_curated_section = false;
-    char long_desc_file[128] = {0};
-    char curated_description_file[128] = {0};
-    char hook_file[128] = {0};
-    char why_play_file[128] = {0};
-    char vibe_file[128] = {0};
-    char notable_file[128] = {0};
-    char context_file[128] = {0};
-    char play_curator_note_file[128] = {0};
-    char tags_file[128] = {0};
-    char warnings_file[128] = {0};
-    char museum_card_file[128] = {0};
-    char trivia_museum_file[128] = {0};
-    char oddities_file[128] = {0};
-    char design_quirks_file[128] = {0};
-    char discovery_prompts_file[128] = {0};
-    char curator_file[128] = {0};
-    char museum_file[128] = {0};
-    char trivia_file[128] = {0};
-    char reception_file[128] = {0};
-    char line[512];
-
-    while (fgets(line, sizeof(line), metadata_file) != NULL) {
-        char *cursor = trim_whitespace(line);
-        if (*cursor == '\0' || *cursor == ';' || *cursor == '#') {
-            continue;
-        }
+    char *equal_sign = strchr(cursor, '=');
+    if (equal_sign == NULL) {
+        return;
+    }
 
-        // Handle UTF-8 BOM on first line.
-        if ((unsigned char)cursor[0] == 0xEF && (unsigned char)cursor[1] == 0xBB && (unsigned char)cursor[2] == 0xBF) {
-            cursor += 3;
-            cursor = trim_whitespace(cursor);
-        }
+    *equal_sign = '\0';
+    char *key = trim_whitespace(cursor);
+    char *value = trim_whitespace(equal_sign + 1);
+    size_t key_length = strlen(key);
 
-        if (*cursor == '[') {
-            char *section_end = strchr(cursor, ']');
-            if (section_end == NULL) {
-                continue;
-            }
-            *section_end = '\0';
-            char *section_name = trim_whitespace(cursor + 1);
-            lowercase_ascii(section_name);
-            in_meta_section = ((strcmp(section_name, "meta") == 0) || (strcmp(section_name, "metadata") == 0));
-            in_curated_section = (strcmp(section_name, "curated") == 0);
-            continue;
+    // File names are copied out, the line buffer is reused for the next part of the file.
+    if (state->in_curated_section) {
+        metadata_key_t curated_key = metadata_key_lookup_curated(key, key_length);
+        if ((curated_key != METADATA_KEY_UNKNOWN) && (state->sidecar_files[curated_key][0] == '\0')) {
+            snprintf(state->sidecar_files[curated_key], METADATA_FILE_NAME_MAX, "%s", value);
         }
+        return;
+    }
 
-        if (!in_meta_section && !in_curated_section) {
-            continue;
+    metadata_key_t meta_key = metadata_key_lookup_meta(key, key_length);
+    if (meta_key == METADATA_KEY_LONG_DESC) {
+        if (state->long_desc_file[0] == '\0') {
+            snprintf(state->long_desc_file, sizeof(state->long_desc_file), "%s", value);
         }
+    } else if (meta_key != METADATA_KEY_UNKNOWN) {
+        metadata_apply_value(rom_info, meta_key, value);
+    }
+}
 
-        char *equal_sign = strchr(cursor, '=');
-        if (equal_sign == NULL) {
-            continue;
+static bool parse_metadata_file (const char *path, metadata_ini_state_t *state, rom_info_t *rom_info) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    // Files up to METADATA_INI_BUFFER_SIZE are parsed from a single read, larger
+    // ones are streamed through the buffer and split at line boundaries.
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+    }
+    if ((size < 0) || (fseek(file, 0, SEEK_SET) != 0)) {
+        fclose(file);
+        return false;
+    }
+    size_t capacity = MIN((size_t)size, METADATA_INI_BUFFER_SIZE);
+    char *buffer = malloc(capacity + 1);
+    if (buffer == NULL) {
+        fclose(file);
+        return false;
+    }
+
+    size_t length = 0;
+    bool first_read = true;
+    bool skip_line = false;
+
+    while (true) {
+        size_t requested = capacity - length;
+        size_t bytes_read = fread(buffer + length, 1, requested, file);
+        bool end_of_file = (bytes_read < requested) || (capacity == 0);
+        length += bytes_read;
+        buffer[length] = '\0';
+
+        char *next_line = buffer;
+        if (first_read && (length >= 3) &&
+            (unsigned char)buffer[0] == 0xEF && (unsigned char)buffer[1] == 0xBB && (unsigned char)buffer[2] == 0xBF) {
+            next_line += 3;
         }
+        first_read = false;
 
-        *equal_sign = '\0';
-        char *key = trim_whitespace(cursor);
-        char *value = trim_whitespace(equal_sign + 1);
-        lowercase_ascii(key);
-
-        if (in_curated_section) {
-            if ((strcmp(key, "hook") == 0) && (hook_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(hook_file, sizeof(hook_file), "%s", value);
-            } else if ((strcmp(key, "why_play") == 0) && (why_play_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(why_play_file, sizeof(why_play_file), "%s", value);
-            } else if ((strcmp(key, "vibe") == 0) && (vibe_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(vibe_file, sizeof(vibe_file), "%s", value);
-            } else if ((strcmp(key, "notable") == 0) && (notable_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(notable_file, sizeof(notable_file), "%s", value);
-            } else if ((strcmp(key, "context") == 0) && (context_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(context_file, sizeof(context_file), "%s", value);
-            } else if ((strcmp(key, "play_curator_note") == 0) && (play_curator_note_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(play_curator_note_file, sizeof(play_curator_note_file), "%s", value);
-            } else if ((strcmp(key, "tags") == 0) && (tags_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(tags_file, sizeof(tags_file), "%s", value);
-            } else if ((strcmp(key, "warnings") == 0) && (warnings_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(warnings_file, sizeof(warnings_file), "%s", value);
-            } else if ((strcmp(key, "museum_card") == 0) && (museum_card_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(museum_card_file, sizeof(museum_card_file), "%s", value);
-            } else if ((strcmp(key, "trivia_museum") == 0) && (trivia_museum_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(trivia_museum_file, sizeof(trivia_museum_file), "%s", value);
-            } else if ((strcmp(key, "oddities") == 0) && (oddities_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(oddities_file, sizeof(oddities_file), "%s", value);
-            } else if ((strcmp(key, "design_quirks") == 0) && (design_quirks_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(design_quirks_file, sizeof(design_quirks_file), "%s", value);
-            } else if ((strcmp(key, "discovery_prompts") == 0) && (discovery_prompts_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(discovery_prompts_file, sizeof(discovery_prompts_file), "%s", value);
-            } else if ((strcmp(key, "curator") == 0) && (curator_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(curator_file, sizeof(curator_file), "%s", value);
-            } else if ((strcmp(key, "museum") == 0) && (museum_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(museum_file, sizeof(museum_file), "%s", value);
-            } else if ((strcmp(key, "trivia") == 0) && (trivia_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(trivia_file, sizeof(trivia_file), "%s", value);
-            } else if ((strcmp(key, "reception") == 0) && (reception_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(reception_file, sizeof(reception_file), "%s", value);
-            } else if (((strcmp(key, "full_description") == 0) || (strcmp(key, "description") == 0)) &&
-                       (curated_description_file[0] == '\0') && (value[0] != '\0')) {
-                snprintf(curated_description_file, sizeof(curated_description_file), "%s", value);
+        char *line_end;
+        while ((line_end = memchr(next_line, '\n', (size_t)(buffer + length - next_line))) != NULL) {
+            *line_end = '\0';
+            if (!skip_line) {
+                metadata_parse_line(state, rom_info, next_line);
             }
-            continue;
+            skip_line = false;
+            next_line = line_end + 1;
         }
 
-        if ((strcmp(key, "name") == 0) || (strcmp(key, "title") == 0)) {
-            metadata_copy_if_empty(rom_info->metadata.name, sizeof(rom_info->metadata.name), value);
-        } else if ((strcmp(key, "author") == 0) || (strcmp(key, "publisher") == 0)) {
-            metadata_copy_if_empty(rom_info->metadata.author, sizeof(rom_info->metadata.author), value);
-        } else if ((strcmp(key, "developer") == 0) || (strcmp(key, "dev") == 0) || (strcmp(key, "studio") == 0)) {
-            metadata_copy_if_empty(rom_info->metadata.developer, sizeof(rom_info->metadata.developer), value);
-        } else if ((strcmp(key, "genre") == 0) || (strcmp(key, "genres") == 0) || (strcmp(key, "category") == 0)) {
-            metadata_copy_if_empty(rom_info->metadata.genre, sizeof(rom_info->metadata.genre), value);
-        } else if ((strcmp(key, "series") == 0) || (strcmp(key, "franchise") == 0)) {
-            metadata_copy_if_empty(rom_info->metadata.series, sizeof(rom_info->metadata.series), value);
-        } else if ((strcmp(key, "modes") == 0) || (strcmp(key, "mode") == 0) || (strcmp(key, "tags") == 0)) {
-            metadata_copy_if_empty(rom_info->metadata.modes, sizeof(rom_info->metadata.modes), value);
-        } else if (((strcmp(key, "players") == 0) ||
-                    (strcmp(key, "player-count") == 0) ||
-                    (strcmp(key, "player_count") == 0) ||
-                    (strcmp(key, "playercount") == 0)) &&
-                   (rom_info->metadata.players_max < 0)) {
-            int32_t players_min = -1;
-            int32_t players_max = -1;
-            if (parse_player_count_from_value(value, &players_min, &players_max)) {
-                rom_info->metadata.players_min = players_min;
-                rom_info->metadata.players_max = players_max;
-            }
-        } else if (((strcmp(key, "players-min") == 0) || (strcmp(key, "players_min") == 0)) &&
-                   (rom_info->metadata.players_min < 0)) {
-            rom_info->metadata.players_min = (int32_t)atoi(value);
-        } else if (((strcmp(key, "players-max") == 0) || (strcmp(key, "players_max") == 0)) &&
-                   (rom_info->metadata.players_max < 0)) {
-            rom_info->metadata.players_max = (int32_t)atoi(value);
-        } else if ((strcmp(key, "short-desc") == 0) || (strcmp(key, "short_desc") == 0) || (strcmp(key, "summary") == 0)) {
-            metadata_copy_if_empty(rom_info->metadata.short_desc, sizeof(rom_info->metadata.short_desc), value);
-        } else if ((strcmp(key, "long-desc") == 0) && (long_desc_file[0] == '\0') && (value[0] != '\0')) {
-            snprintf(long_desc_file, sizeof(long_desc_file), "%s", value);
-        } else if (((strcmp(key, "age-rating") == 0) || (strcmp(key, "age_rating") == 0)) &&
-                   (rom_info->metadata.age_rating < 0)) {
-            int32_t parsed = parse_age_rating_from_value(value);
-            if (parsed >= 0) {
-                rom_info->metadata.age_rating = parsed;
-            }
-        } else if (((strcmp(key, "esrb") == 0) ||
-                    (strcmp(key, "esrb-rating") == 0) ||
-                    (strcmp(key, "esrb_rating") == 0) ||
-                    (strcmp(key, "esrb-age-rating") == 0) ||
-                    (strcmp(key, "esrb_age_rating") == 0)) &&
-                   (rom_info->metadata.esrb_age_rating == ROM_ESRB_AGE_RATING_NONE)) {
-            rom_esrb_age_rating_t parsed = parse_esrb_age_rating_from_value(value);
-            if (parsed != ROM_ESRB_AGE_RATING_NONE) {
-                rom_info->metadata.esrb_age_rating = parsed;
-            }
-        } else if (((strcmp(key, "release-date") == 0) ||
-                    (strcmp(key, "release_date") == 0) ||
-                    (strcmp(key, "releaseyear") == 0) ||
-                    (strcmp(key, "release-year") == 0) ||
-                    (strcmp(key, "year") == 0)) &&
-                   (rom_info->metadata.release_year < 0)) {
-            int32_t year = parse_release_year_from_value(value);
-            if (year >= 0) {
-                rom_info->metadata.release_year = year;
+        size_t remaining = (size_t)(buffer + length - next_line);
+        if (end_of_file) {
+            if ((remaining > 0) && !skip_line) {
+                metadata_parse_line(state, rom_info, next_line);
             }
+            break;
         }
+
+        // A line longer than the whole buffer is dropped.
+        if (remaining == capacity) {
+            skip_line = true;
+            remaining = 0;
+        }
+        memmove(buffer, next_line, remaining);
+        length = remaining;
+    }
+
+    free(buffer);
+    fclose(file);
+    return true;
+}
+
+static void load_rom_metadata_from_directory (path_t *directory, rom_info_t *rom_info, bool include_long_description) {
+    if ((directory == NULL) || (rom_info == NULL)) {
+        return;
     }
 
-    fclose(metadata_file);
+    if (!metadata_index_file_exists(path_get(directory), "metadata.ini")) {
+        return;
+    }
+
+    metadata_ini_state_t state = {0};
+
+    path_t *metadata_path = path_clone(directory);
+    path_push(metadata_path, "metadata.ini");
+    bool parsed = parse_metadata_file(path_get(metadata_path), &state, rom_info);
+    path_free(metadata_path);
+    if (!parsed) {
+        return;
+    }
 
     if (include_long_description &&
         (rom_info->metadata.long_desc[0] == '\0') &&
-        (long_desc_file[0] != '\0')) {
+        (state.long_desc_file[0] != '\0')) {
         path_t *description_path = path_clone(directory);
-        path_push(description_path, long_desc_file);
+        path_push(description_path, state.long_desc_file);
         read_text_file_to_buffer(path_get(description_path), rom_info->metadata.long_desc,
                                  sizeof(rom_info->metadata.long_desc));
         path_free(description_path);
     }
 
     // Common metadata fallback used by our generated sets.
-    read_metadata_mapped_text_if_missing(directory, include_long_description, curated_description_file, "description.txt",
-                                         rom_info->metadata.long_desc, sizeof(rom_info->metadata.long_desc));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, hook_file, "hook.txt",
-                                         rom_info->metadata.hook, sizeof(rom_info->metadata.hook));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, why_play_file, "why_play.txt",
-                                         rom_info->metadata.why_play, sizeof(rom_info->metadata.why_play));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, vibe_file, "vibe.txt",
-                                         rom_info->metadata.vibe, sizeof(rom_info->metadata.vibe));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, notable_file, "notable.txt",
-                                         rom_info->metadata.notable, sizeof(rom_info->metadata.notable));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, context_file, "context.txt",
-                                         rom_info->metadata.context, sizeof(rom_info->metadata.context));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, play_curator_note_file, "play_curator_note.txt",
-                                         rom_info->metadata.play_curator_note, sizeof(rom_info->metadata.play_curator_note));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, tags_file, "tags.txt",
-                                         rom_info->metadata.tags, sizeof(rom_info->metadata.tags));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, warnings_file, "warnings.txt",
-                                         rom_info->metadata.warnings, sizeof(rom_info->metadata.warnings));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, museum_card_file, "museum_card.txt",
-                                         rom_info->metadata.museum_card, sizeof(rom_info->metadata.museum_card));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, trivia_museum_file, "trivia_museum.txt",
-                                         rom_info->metadata.trivia_museum, sizeof(rom_info->metadata.trivia_museum));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, oddities_file, "oddities.txt",
-                                         rom_info->metadata.oddities, sizeof(rom_info->metadata.oddities));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, design_quirks_file, "design_quirks.txt",
-                                         rom_info->metadata.design_quirks, sizeof(rom_info->metadata.design_quirks));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, discovery_prompts_file, "discovery_prompts.txt",
-                                         rom_info->metadata.discovery_prompts, sizeof(rom_info->metadata.discovery_prompts));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, curator_file, "curator.txt",
-                                         rom_info->metadata.curator, sizeof(rom_info->metadata.curator));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, museum_file, "museum.txt",
-                                         rom_info->metadata.museum, sizeof(rom_info->metadata.museum));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, trivia_file, "trivia.txt",
-                                         rom_info->metadata.trivia, sizeof(rom_info->metadata.trivia));
-    read_metadata_mapped_text_if_missing(directory, include_long_description, reception_file, "reception.txt",
-                                         rom_info->metadata.reception, sizeof(rom_info->metadata.reception));
+    for (int i = 0; i < METADATA_CURATED_KEY_COUNT; i++) {
+        const metadata_sidecar_t *sidecar = &metadata_sidecars[i];
+        read_metadata_mapped_text_if_missing(directory, include_long_description, state.sidecar_files[i], sidecar->default_filename,
+                                             (char *)rom_info + sidecar->offset, sidecar->length);
+    }
 }
 
 static void load_rom_metadata (path_t *rom_path, rom_info_t *rom_info, bool include_long_description) {
@@ -1288,8 +1811,8 @@ static void load_rom_metadata (path_t *rom_path, rom_info_t *rom_info, bool incl
     path_free(metadata_directory);
 }
 
-static void extract_rom_info (match_t *match, rom_header_t *rom_header, rom_info_t *rom_info) {
-    rom_info->cic_type = detect_cic_type(rom_header->ipl3);
+static void extract_rom_info (match_t *match, rom_header_t *rom_header, rom_cic_type_t cic_type, rom_info_t *rom_info) {
+    rom_info->cic_type = cic_type;
 
     if (match->type == MATCH_TYPE_HOMEBREW_HEADER) {
         if (rom_header->version & (1 << 0)) {
@@ -1964,23 +2487,45 @@ rom_err_t rom_config_load_ex(path_t *path, rom_info_t *rom_info, const rom_load_
     };
     const rom_load_options_t *effective = options ? options : &defaults;
 
-    if ((f = fopen(path_get(path), "rb")) == NULL) {
-        return ROM_ERR_NO_FILE;
-    }
-    setbuf(f, NULL);
-    if (fread(&rom_header, sizeof(rom_header), 1, f) != 1) {
-        fclose(f);
-        return ROM_ERR_LOAD_IO;
-    }
-    if (fclose(f)) {
-        return ROM_ERR_LOAD_IO;
-    }
+    struct stat st;
+    bool have_stat = (stat(path_get(path), &st) == 0);
+    rom_identity_record_t *identity = have_stat ? rom_identity_cache_find(path_get(path), &st) : NULL;
 
-    fix_rom_header_endianness(&rom_header, rom_info);
+    match_t match;
+    rom_cic_type_t cic_type;
 
-    match_t match = find_rom_in_database(&rom_header);
+    if (identity != NULL) {
+        memcpy(&rom_header, identity->header, sizeof(identity->header));
+        rom_info->endianness = (rom_endianness_t)identity->endianness;
+        match = (match_t) {
+            .type = (match_type_t)identity->match_type,
+            .data = { .save = (rom_save_type_t)identity->save_type, .feat = (feat_t)identity->feat },
+        };
+        cic_type = (rom_cic_type_t)identity->cic_type;
+    } else {
+        if ((f = fopen(path_get(path), "rb")) == NULL) {
+            return ROM_ERR_NO_FILE;
+        }
+        setbuf(f, NULL);
+        if (fread(&rom_header, sizeof(rom_header), 1, f) != 1) {
+            fclose(f);
+            return ROM_ERR_LOAD_IO;
+        }
+        if (fclose(f)) {
+            return ROM_ERR_LOAD_IO;
+        }
+
+        fix_rom_header_endianness(&rom_header, rom_info);
+
+        match = find_rom_in_database(&rom_header);
+        cic_type = detect_cic_type(rom_header.ipl3);
+
+        if (have_stat) {
+            rom_identity_cache_store(path_get(path), &st, &rom_header, rom_info, &match, cic_type);
+        }
+    }
 
-    extract_rom_info(&match, &rom_header, rom_info);
+    extract_rom_info(&match, &rom_header, cic_type, rom_info);
 
     if (effective->include_config) {
         load_rom_config_from_file(path, rom_info);
@@ -2004,8 +2549,7 @@ rom_err_t rom_config_load (path_t *path, rom_info_t *rom_info) {
     return rom_config_load_ex(path, rom_info, NULL);
 }
 
-rom_err_t rom_info_read_quick (const char *path, char game_code_out[4], char title_out[21]) {
-    #define ROM_HEADER_PREFIX_SIZE 64
+static rom_err_t rom_info_read_quick_prefix (const char *path, char game_code_out[4], char title_out[21]) {
     uint8_t buf[ROM_HEADER_PREFIX_SIZE];
 
     FILE *f = fopen(path, "rb");
@@ -2038,5 +2582,243 @@ rom_err_t rom_info_read_quick (const char *path, char game_code_out[4], char tit
     memcpy(game_code_out, &buf[0x3B], 4);
 
     return ROM_OK;
-    #undef ROM_HEADER_PREFIX_SIZE
+}
+
+rom_err_t rom_info_read_quick (const char *path, char game_code_out[4], char title_out[21]) {
+    return rom_info_read_quick_prefix(path, game_code_out, title_out);
+}
+
+/** @brief Batched quick read ordering record. */
+typedef struct {
+    size_t item;            /**< Index into the caller's request array */
+    size_t dir_length;      /**< Length of the directory part of the path (up to the last '/') */
+    int32_t entry_order;    /**< Position of the file inside its directory listing */
+} rom_quick_batch_order_t;
+
+static const rom_quick_header_t *rom_quick_batch_items = NULL;
+
+/** @brief Directory entry position, keyed by a hash of the lowercase file name. */
+typedef struct {
+    uint32_t name_hash;
+    int32_t entry_order;
+} rom_quick_dir_entry_t;
+
+/** @brief Entry positions of one listed directory, sorted by name hash. */
+typedef struct {
+    char *directory;
+    rom_quick_dir_entry_t *entries;
+    size_t count;
+    uint32_t last_used;
+} rom_quick_dir_cache_t;
+
+static rom_quick_dir_cache_t rom_quick_dir_cache[ROM_QUICK_DIR_CACHE_SLOTS];
+static uint32_t rom_quick_dir_cache_clock = 0;
+
+static const char *rom_quick_batch_name (const rom_quick_batch_order_t *order) {
+    const char *path = rom_quick_batch_items[order->item].path;
+    return (order->dir_length > 0) ? (path + order->dir_length + 1) : path;
+}
+
+static int rom_quick_batch_compare_dir (const rom_quick_batch_order_t *lhs, const rom_quick_batch_order_t *rhs) {
+    const char *lhs_path = rom_quick_batch_items[lhs->item].path;
+    const char *rhs_path = rom_quick_batch_items[rhs->item].path;
+    size_t common = MIN(lhs->dir_length, rhs->dir_length);
+    int result = strncmp(lhs_path, rhs_path, common);
+    if (result != 0) {
+        return result;
+    }
+    if (lhs->dir_length != rhs->dir_length) {
+        return (lhs->dir_length < rhs->dir_length) ? -1 : 1;
+    }
+    return 0;
+}
+
+static int rom_quick_batch_compare_name (const void *a, const void *b) {
+    const rom_quick_batch_order_t *lhs = (const rom_quick_batch_order_t *)a;
+    const rom_quick_batch_order_t *rhs = (const rom_quick_batch_order_t *)b;
+    int result = rom_quick_batch_compare_dir(lhs, rhs);
+    if (result != 0) {
+        return result;
+    }
+    return strcasecmp(rom_quick_batch_name(lhs), rom_quick_batch_name(rhs));
+}
+
+static int rom_quick_batch_compare_storage (const void *a, const void *b) {
+    const rom_quick_batch_order_t *lhs = (const rom_quick_batch_order_t *)a;
+    const rom_quick_batch_order_t *rhs = (const rom_quick_batch_order_t *)b;
+    int result = rom_quick_batch_compare_dir(lhs, rhs);
+    if (result != 0) {
+        return result;
+    }
+    if (lhs->entry_order != rhs->entry_order) {
+        return (lhs->entry_order < rhs->entry_order) ? -1 : 1;
+    }
+    return (lhs->item < rhs->item) ? -1 : (lhs->item > rhs->item);
+}
+
+static uint32_t rom_quick_dir_name_hash (const char *name) {
+    uint32_t hash = FNV1A_32_OFFSET_BASIS;
+    for (; *name; name++) {
+        hash = fnv1a32_u8(hash, (uint8_t)tolower((unsigned char)*name));
+    }
+    return hash;
+}
+
+static int rom_quick_dir_entry_compare (const void *a, const void *b) {
+    uint32_t lhs = ((const rom_quick_dir_entry_t *)a)->name_hash;
+    uint32_t rhs = ((const rom_quick_dir_entry_t *)b)->name_hash;
+    return (lhs < rhs) ? -1 : (lhs > rhs);
+}
+
+static void rom_quick_dir_cache_free (rom_quick_dir_cache_t *slot) {
+    free(slot->directory);
+    free(slot->entries);
+    memset(slot, 0, sizeof(*slot));
+}
+
+// Returns the entry positions of a directory, listing it only on a cache miss.
+static rom_quick_dir_cache_t *rom_quick_dir_cache_get (const char *directory) {
+    rom_quick_dir_cache_t *slot = &rom_quick_dir_cache[0];
+    rom_quick_dir_cache_clock++;
+
+    for (int i = 0; i < ROM_QUICK_DIR_CACHE_SLOTS; i++) {
+        rom_quick_dir_cache_t *candidate = &rom_quick_dir_cache[i];
+        if (candidate->directory && (strcmp(candidate->directory, directory) == 0)) {
+            candidate->last_used = rom_quick_dir_cache_clock;
+            return candidate;
+        }
+        if (candidate->last_used < slot->last_used) {
+            slot = candidate;
+        }
+    }
+
+    rom_quick_dir_cache_free(slot);
+
+    size_t capacity = 0;
+    dir_t info;
+    int result = dir_findfirst(directory, &info);
+    while (result == 0) {
+        if (slot->count == capacity) {
+            capacity = (capacity > 0) ? (capacity * 2) : 64;
+            rom_quick_dir_entry_t *entries = realloc(slot->entries, capacity * sizeof(*entries));
+            if (!entries) {
+                rom_quick_dir_cache_free(slot);
+                return NULL;
+            }
+            slot->entries = entries;
+        }
+        slot->entries[slot->count].name_hash = rom_quick_dir_name_hash(info.d_name);
+        slot->entries[slot->count].entry_order = (int32_t)slot->count;
+        slot->count++;
+        result = dir_findnext(directory, &info);
+    }
+
+    slot->directory = strdup(directory);
+    if (!slot->directory) {
+        rom_quick_dir_cache_free(slot);
+        return NULL;
+    }
+    if (slot->count > 1) {
+        qsort(slot->entries, slot->count, sizeof(*slot->entries), rom_quick_dir_entry_compare);
+    }
+    slot->last_used = rom_quick_dir_cache_clock;
+    return slot;
+}
+
+void rom_info_read_quick_batch_reset (void) {
+    for (int i = 0; i < ROM_QUICK_DIR_CACHE_SLOTS; i++) {
+        rom_quick_dir_cache_free(&rom_quick_dir_cache[i]);
+    }
+    rom_quick_dir_cache_clock = 0;
+}
+
+// Stamp each requested file of one directory with its entry position. A hash
+// collision only costs ordering, the reads themselves still use the path.
+static void rom_quick_batch_assign_entry_order (rom_quick_batch_order_t *group, size_t group_count) {
+    char directory[512];
+    const char *first_path = rom_quick_batch_items[group[0].item].path;
+    size_t dir_length = group[0].dir_length;
+
+    if ((dir_length == 0) || (dir_length + 2 > sizeof(directory))) {
+        return;
+    }
+    memcpy(directory, first_path, dir_length);
+    directory[dir_length] = '\0';
+    if (directory[dir_length - 1] == ':') {
+        // Storage root, e.g. "sd:" -> "sd:/".
+        directory[dir_length] = '/';
+        directory[dir_length + 1] = '\0';
+    }
+
+    rom_quick_dir_cache_t *listing = rom_quick_dir_cache_get(directory);
+    if (!listing || listing->count == 0) {
+        return;
+    }
+
+    for (size_t i = 0; i < group_count; i++) {
+        rom_quick_dir_entry_t key = { .name_hash = rom_quick_dir_name_hash(rom_quick_batch_name(&group[i])) };
+        rom_quick_dir_entry_t *found = bsearch(&key, listing->entries, listing->count, sizeof(*listing->entries), rom_quick_dir_entry_compare);
+        if (found) {
+            group[i].entry_order = found->entry_order;
+        }
+    }
+}
+
+size_t rom_info_read_quick_batch (rom_quick_header_t *items, size_t count) {
+    if (!items || count == 0) {
+        return 0;
+    }
+
+    rom_quick_batch_order_t *order = malloc(count * sizeof(*order));
+    size_t valid = 0;
+    for (size_t i = 0; i < count; i++) {
+        items[i].err = ROM_ERR_NO_FILE;
+        if (!items[i].path) {
+            continue;
+        }
+        if (!order) {
+            // Out of memory: fall back to caller order.
+            items[i].err = rom_info_read_quick_prefix(items[i].path, items[i].game_code, items[i].title);
+            continue;
+        }
+        const char *separator = strrchr(items[i].path, '/');
+        order[valid].item = i;
+        order[valid].dir_length = separator ? (size_t)(separator - items[i].path) : 0;
+        order[valid].entry_order = INT32_MAX;
+        valid++;
+    }
+
+    if (order) {
+        rom_quick_batch_items = items;
+
+        qsort(order, valid, sizeof(*order), rom_quick_batch_compare_name);
+        for (size_t start = 0; start < valid; ) {
+            size_t end = start + 1;
+            while ((end < valid) && (rom_quick_batch_compare_dir(&order[start], &order[end]) == 0)) {
+                end++;
+            }
+            if ((end - start) > 1) {
+                rom_quick_batch_assign_entry_order(&order[start], end - start);
+            }
+            start = end;
+        }
+        qsort(order, valid, sizeof(*order), rom_quick_batch_compare_storage);
+
+        rom_quick_batch_items = NULL;
+
+        for (size_t i = 0; i < valid; i++) {
+            rom_quick_header_t *item = &items[order[i].item];
+            item->err = rom_info_read_quick_prefix(item->path, item->game_code, item->title);
+        }
+
+        free(order);
+    }
+
+    size_t loaded = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (items[i].err == ROM_OK) {
+            loaded++;
+        }
+    }
+    return loaded;
 }
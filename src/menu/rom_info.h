@@ -268,6 +268,37 @@ rom_err_t rom_config_load(path_t *path, rom_info_t *rom_info);
  */
 rom_err_t rom_info_read_quick(const char *path, char game_code_out[4], char title_out[21]);
 
+/** @brief Batched quick header read request/result. */
+typedef struct {
+    const char *path;               /**< ROM file path string (input) */
+    rom_err_t err;                  /**< Per-ROM result, ROM_OK when the fields below are valid */
+    char game_code[4];              /**< 4-byte game code (not null-terminated) */
+    char title[21];                 /**< Null-terminated 20-char title */
+} rom_quick_header_t;
+
+/**
+ * @brief Read game_code and title for many ROMs in storage order.
+ *
+ * Same output as rom_info_read_quick(), but the requests are grouped by
+ * directory and each group is read in directory-entry order instead of the
+ * caller's (UI) order, which keeps FAT lookups sequential. Results are
+ * written back into the caller's array in place. Directory listings are
+ * cached until rom_info_read_quick_batch_reset().
+ *
+ * @param items Array of requests; only the path field needs to be set
+ * @param count Number of requests
+ * @return Number of requests that completed with ROM_OK
+ */
+size_t rom_info_read_quick_batch(rom_quick_header_t *items, size_t count);
+
+/**
+ * @brief Forget the directory listings cached by rom_info_read_quick_batch().
+ *
+ * Each directory is listed once to learn its entry order and reused by later
+ * batches. Call when a new list of ROMs is about to be read.
+ */
+void rom_info_read_quick_batch_reset(void);
+
 /**
  * @brief Load ROM information with optional config/metadata controls.
  *
@@ -278,6 +309,16 @@ rom_err_t rom_info_read_quick(const char *path, char game_code_out[4], char titl
  */
 rom_err_t rom_config_load_ex(path_t *path, rom_info_t *rom_info, const rom_load_options_t *options);
 
+/**
+ * @brief Write the persistent ROM identity cache back to storage.
+ *
+ * rom_config_load_ex() remembers the header fields, database match and CIC
+ * type of every ROM it parses, keyed by path, size and modification time,
+ * so repeat loads skip the header read and IPL3 hashing. New records are
+ * kept in memory until this is called.
+ */
+void rom_info_identity_cache_flush(void);
+
 /**
  * @brief Build a stable ROM identity string from loaded ROM information.
  *
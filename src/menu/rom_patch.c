@@ -14,18 +14,32 @@
 
 #include <mini.c/src/mini.h>
 #include <libdragon.h>
+#include <miniz.h>
 
+#include "bps_patch.h"
+#include "ips_patch.h"
 #include "path.h"
+#include "rom_digest.h"
 #include "rom_info.h"
 #include "rom_patch.h"
+#include "utils/byteswap.h"
 #include "utils/fs.h"
 #include "utils/hash.h"
+#include "utils/utils.h"
+#include "vcdiff_patch.h"
 
 #define PATCHES_DIR "menu/patches"
 #define PATCH_CACHE_DIR "menu/cache/patched"
 #define PATCH_MANIFEST_NAME "default.ini"
 #define PATCH_MAX_FILES 8
 #define PATCH_MAX_MANIFESTS 32
+#define PATCH_STREAM_MAX_DATA KiB(512)
+#define PATCH_IPS_MAX_DATA MiB(2)
+// Larger ROMs are partly written to flash on SC64, outside of the staging buffer.
+#define PATCH_STREAM_MAX_ROM_SIZE (MiB(64) - KiB(128))
+#define PATCH_CART_ROM_ADDRESS 0x10000000
+#define PATCH_DELTA_CHUNK_SIZE (64 * 1024)
+#define PATCH_COPY_CHUNK_SIZE (64 * 1024)
 
 typedef struct {
     char files[PATCH_MAX_FILES][256];
@@ -37,8 +51,24 @@ typedef struct {
     int64_t expected_rom_size;
     bool has_expected_rom_size;
     char expected_game_code[8];
+    uint32_t expected_crc32;
+    bool has_expected_crc32;
+    uint8_t expected_sha1[ROM_DIGEST_SHA1_LENGTH];
+    bool has_expected_sha1;
 } patch_manifest_t;
 
+struct rom_patch_stream_s {
+    ips_patch_t *ips;
+
+    bps_patch_t *bps;
+    vcdiff_patch_t *vcdiff;
+    uint8_t *window;
+    size_t window_size;
+    uint32_t position;
+    uint32_t source_crc;
+    bool error;
+};
+
 static void sanitize_token(const char *input, char *out, size_t out_len) {
     if (!out || out_len == 0) {
         return;
@@ -55,62 +85,18 @@ static void sanitize_token(const char *input, char *out, size_t out_len) {
     out[j] = '\0';
 }
 
-static bool read_u16_be(FILE *f, uint16_t *out) {
-    uint8_t b[2];
-    if (fread(b, 1, sizeof(b), f) != sizeof(b)) {
-        return false;
-    }
-    *out = ((uint16_t)b[0] << 8) | ((uint16_t)b[1]);
-    return true;
-}
-
-static bool read_u24_be(FILE *f, uint32_t *out) {
-    uint8_t b[3];
-    if (fread(b, 1, sizeof(b), f) != sizeof(b)) {
-        return false;
-    }
-    *out = ((uint32_t)b[0] << 16) | ((uint32_t)b[1] << 8) | ((uint32_t)b[2]);
-    return true;
-}
-
-static bool copy_file(const char *src, const char *dst) {
-    FILE *in = fopen(src, "rb");
-    if (!in) {
-        return false;
-    }
-    FILE *out = fopen(dst, "wb");
-    if (!out) {
-        fclose(in);
-        return false;
-    }
-
-    uint8_t *buf = malloc(16 * 1024);
-    if (!buf) {
-        fclose(out);
-        fclose(in);
+static bool parse_sha1_hex(const char *text, uint8_t out[ROM_DIGEST_SHA1_LENGTH]) {
+    if (!text || strlen(text) != ROM_DIGEST_SHA1_LENGTH * 2) {
         return false;
     }
-    bool ok = true;
-    while (1) {
-        size_t r = fread(buf, 1, 16 * 1024, in);
-        if (r > 0 && fwrite(buf, 1, r, out) != r) {
-            ok = false;
-            break;
-        }
-        if (r < 16 * 1024) {
-            if (ferror(in)) {
-                ok = false;
-            }
-            break;
+    for (int i = 0; i < ROM_DIGEST_SHA1_LENGTH; i++) {
+        char byte[3] = { text[i * 2], text[i * 2 + 1], '\0' };
+        if (!isxdigit((unsigned char)byte[0]) || !isxdigit((unsigned char)byte[1])) {
+            return false;
         }
+        out[i] = (uint8_t)strtoul(byte, NULL, 16);
     }
-
-    free(buf);
-    if (fclose(out) != 0) {
-        ok = false;
-    }
-    fclose(in);
-    return ok;
+    return true;
 }
 
 static bool manifest_load(const char *manifest_path, patch_manifest_t *out) {
@@ -166,6 +152,19 @@ static bool manifest_load(const char *manifest_path, patch_manifest_t *out) {
         }
     }
 
+    const char *crc32 = mini_get_string(ini, "compatibility", "expected_crc32", NULL);
+    if (crc32 && crc32[0] != '\0') {
+        char *endptr = NULL;
+        errno = 0;
+        unsigned long v = strtoul(crc32, &endptr, 16);
+        if ((errno == 0) && endptr && (*endptr == '\0') && (v <= UINT32_MAX)) {
+            out->expected_crc32 = (uint32_t)v;
+            out->has_expected_crc32 = true;
+        }
+    }
+
+    out->has_expected_sha1 = parse_sha1_hex(mini_get_string(ini, "compatibility", "expected_sha1", NULL), out->expected_sha1);
+
     snprintf(
         out->expected_game_code,
         sizeof(out->expected_game_code),
@@ -177,103 +176,402 @@ static bool manifest_load(const char *manifest_path, patch_manifest_t *out) {
     return true;
 }
 
-static bool apply_ips(const char *target_rom_path, const char *ips_path) {
-    FILE *patch = fopen(ips_path, "rb");
-    if (!patch) {
+// Reads every IPS file of the manifest into one record list, sorted by offset.
+static rom_patch_result_t ips_load(
+    const patch_manifest_t *manifest,
+    const char patch_paths[PATCH_MAX_FILES][512],
+    int64_t rom_size,
+    size_t max_data,
+    ips_patch_t **out_ips
+) {
+    ips_patch_t *ips = ips_patch_create(max_data);
+    if (!ips) {
+        return ROM_PATCH_SKIPPED;
+    }
+
+    for (int i = 0; i < manifest->files_count; i++) {
+        ips_patch_err_t err = ips_patch_add(ips, patch_paths[i], rom_size);
+        if (err != IPS_PATCH_OK) {
+            ips_patch_free(ips);
+            switch (err) {
+                case IPS_PATCH_TOO_LARGE: return ROM_PATCH_SKIPPED;
+                case IPS_PATCH_IO_ERROR: return ROM_PATCH_IO_ERROR;
+                default: return ROM_PATCH_FORMAT_ERROR;
+            }
+        }
+    }
+
+    if (!ips_patch_finish(ips)) {
+        ips_patch_free(ips);
+        return ROM_PATCH_SKIPPED;
+    }
+
+    *out_ips = ips;
+    return ROM_PATCH_OK;
+}
+
+static rom_patch_result_t stream_prepare_ips(
+    const patch_manifest_t *manifest,
+    const char patch_paths[PATCH_MAX_FILES][512],
+    const char *source_rom_path,
+    rom_patch_stream_t **out_stream
+) {
+    int64_t rom_size = file_get_size((char *)source_rom_path);
+    if (rom_size <= 0) {
+        return ROM_PATCH_IO_ERROR;
+    }
+    if (rom_size > PATCH_STREAM_MAX_ROM_SIZE) {
+        return ROM_PATCH_SKIPPED;
+    }
+
+    rom_patch_stream_t *stream = calloc(1, sizeof(rom_patch_stream_t));
+    if (!stream) {
+        return ROM_PATCH_SKIPPED;
+    }
+    rom_patch_result_t result = ips_load(manifest, patch_paths, rom_size, PATCH_STREAM_MAX_DATA, &stream->ips);
+    if (result != ROM_PATCH_OK) {
+        free(stream);
+        return result;
+    }
+    debugf("ROM patch: applying %u IPS records on load\n", (unsigned int)ips_patch_record_count(stream->ips));
+    *out_stream = stream;
+    return ROM_PATCH_OK;
+}
+
+// Copies are always written in the big-endian .z64 layout the patches are made against.
+// IPS records given in `ips` are applied to each chunk on the way, so the copy is written once.
+static bool copy_file(const char *src, const char *dst, rom_endianness_t endianness, ips_patch_t *ips) {
+    FILE *in = fopen(src, "rb");
+    if (!in) {
         return false;
     }
-    FILE *rom = fopen(target_rom_path, "rb+");
-    if (!rom) {
-        fclose(patch);
+    FILE *out = fopen(dst, "wb");
+    if (!out) {
+        fclose(in);
         return false;
     }
 
-    char magic[5];
-    if (fread(magic, 1, sizeof(magic), patch) != sizeof(magic) || memcmp(magic, "PATCH", sizeof(magic)) != 0) {
-        fclose(rom);
-        fclose(patch);
+    uint8_t *buf = malloc(PATCH_COPY_CHUNK_SIZE);
+    if (!buf) {
+        fclose(out);
+        fclose(in);
         return false;
     }
-
-    int64_t rom_size = file_get_size((char *)target_rom_path);
-    bool ok = (rom_size > 0);
-    while (ok) {
-        uint32_t offset = 0;
-        long pos_before = ftell(patch);
-        if (!read_u24_be(patch, &offset)) {
-            ok = false;
-            break;
+    bool ok = true;
+    uint32_t offset = 0;
+    while (1) {
+        size_t r = fread(buf, 1, PATCH_COPY_CHUNK_SIZE, in);
+        if (endianness == ENDIANNESS_BYTE_SWAP) {
+            byteswap_16(buf, r);
+        } else if (endianness == ENDIANNESS_LITTLE) {
+            byteswap_32(buf, r);
         }
-
-        if (offset == 0x454F46) { // "EOF"
-            break;
+        if (ips && r > 0) {
+            ips_patch_apply(ips, buf, offset, r);
         }
-
-        uint16_t size = 0;
-        if (!read_u16_be(patch, &size)) {
+        offset += (uint32_t)r;
+        if (r > 0 && fwrite(buf, 1, r, out) != r) {
             ok = false;
             break;
         }
-
-        if (size == 0) {
-            uint16_t rle_size = 0;
-            uint8_t value = 0;
-            if (!read_u16_be(patch, &rle_size) || fread(&value, 1, 1, patch) != 1) {
-                ok = false;
-                break;
-            }
-            if ((int64_t)offset + (int64_t)rle_size > rom_size) {
-                debugf("ROM patch: IPS RLE write outside ROM bounds at %lu\n", (unsigned long)pos_before);
-                ok = false;
-                break;
-            }
-            if (fseek(rom, (long)offset, SEEK_SET) != 0) {
-                ok = false;
-                break;
-            }
-            uint8_t fill[256];
-            memset(fill, value, sizeof(fill));
-            uint32_t remaining = rle_size;
-            while (remaining > 0) {
-                uint32_t chunk = remaining > sizeof(fill) ? sizeof(fill) : remaining;
-                if (fwrite(fill, 1, chunk, rom) != chunk) {
-                    ok = false;
-                    break;
-                }
-                remaining -= chunk;
-            }
-        } else {
-            if ((int64_t)offset + (int64_t)size > rom_size) {
-                debugf("ROM patch: IPS write outside ROM bounds at %lu\n", (unsigned long)pos_before);
-                ok = false;
-                break;
-            }
-            uint8_t *buf = malloc(size);
-            if (!buf) {
-                ok = false;
-                break;
-            }
-            if (fread(buf, 1, size, patch) != size) {
-                free(buf);
-                ok = false;
-                break;
-            }
-            if (fseek(rom, (long)offset, SEEK_SET) != 0 || fwrite(buf, 1, size, rom) != size) {
-                free(buf);
+        if (r < PATCH_COPY_CHUNK_SIZE) {
+            if (ferror(in)) {
                 ok = false;
-                break;
             }
-            free(buf);
+            break;
         }
     }
 
-    if (fclose(rom) != 0) {
+    free(buf);
+    if (fclose(out) != 0) {
         ok = false;
     }
-    fclose(patch);
+    fclose(in);
     return ok;
 }
 
+// Records are applied to the ROM in memory while it is copied, instead of seeking around the copy per record.
+static rom_patch_result_t write_ips_cache(
+    const patch_manifest_t *manifest,
+    const char patch_paths[PATCH_MAX_FILES][512],
+    const char *source_rom_path,
+    rom_endianness_t endianness,
+    const char *cache_rom_path
+) {
+    int64_t rom_size = file_get_size((char *)source_rom_path);
+    if (rom_size <= 0) {
+        return ROM_PATCH_IO_ERROR;
+    }
+
+    ips_patch_t *ips;
+    rom_patch_result_t result = ips_load(manifest, patch_paths, rom_size, PATCH_IPS_MAX_DATA, &ips);
+    if (result == ROM_PATCH_OK) {
+        bool ok = copy_file(source_rom_path, cache_rom_path, endianness, ips);
+        ips_patch_free(ips);
+        return ok ? ROM_PATCH_OK : ROM_PATCH_IO_ERROR;
+    }
+    if (result != ROM_PATCH_SKIPPED) {
+        return result;
+    }
+
+    // Patches too large to hold in memory are applied to the copy one record at a time.
+    if (!copy_file(source_rom_path, cache_rom_path, endianness, NULL)) {
+        return ROM_PATCH_IO_ERROR;
+    }
+    for (int i = 0; i < manifest->files_count; i++) {
+        if (!ips_patch_apply_file(cache_rom_path, patch_paths[i])) {
+            return ROM_PATCH_FORMAT_ERROR;
+        }
+    }
+    return ROM_PATCH_OK;
+}
+
+static bool delta_read_cache_file(void *context, uint32_t offset, uint8_t *buffer, size_t length) {
+    FILE *f = context;
+    bool ok = (fseek(f, (long)offset, SEEK_SET) == 0) && (fread(buffer, 1, length, f) == length);
+    return (fseek(f, 0, SEEK_END) == 0) && ok;
+}
+
+// Earlier chunks are in cart SDRAM already, the PI read waits for the write still in flight.
+static bool delta_read_cart(void *context, uint32_t offset, uint8_t *buffer, size_t length) {
+    dma_read(buffer, PATCH_CART_ROM_ADDRESS + offset, length);
+    return true;
+}
+
+static bool bps_source_matches(bps_patch_t *bps, const char *source_rom_path, bool compute, flashcart_progress_callback_t *progress) {
+    if (file_get_size((char *)source_rom_path) != (int64_t)bps_patch_source_size(bps)) {
+        debugf("ROM patch: BPS source size mismatch\n");
+        return false;
+    }
+    rom_digest_t digest;
+    if (!rom_digest_lookup(source_rom_path, &digest) && !(compute && rom_digest_compute(source_rom_path, &digest, progress))) {
+        // Checked while loading instead.
+        return !compute;
+    }
+    if (digest.crc32 != bps_patch_source_crc32(bps)) {
+        debugf("ROM patch: BPS source crc32 mismatch (rom=%08lX expected=%08lX)\n",
+            (unsigned long)digest.crc32, (unsigned long)bps_patch_source_crc32(bps));
+        return false;
+    }
+    return true;
+}
+
+static uint32_t delta_target_size(const rom_patch_stream_t *stream) {
+    return stream->bps ? bps_patch_target_size(stream->bps) : vcdiff_patch_target_size(stream->vcdiff);
+}
+
+static void delta_set_source_window(rom_patch_stream_t *stream, const uint8_t *window, uint32_t offset, size_t length) {
+    if (stream->bps) {
+        bps_patch_set_source_window(stream->bps, window, offset, length);
+    } else {
+        vcdiff_patch_set_source_window(stream->vcdiff, window, offset, length);
+    }
+}
+
+static void delta_set_target_reader(rom_patch_stream_t *stream, patch_target_reader_t *reader, void *context) {
+    if (stream->bps) {
+        bps_patch_set_target_reader(stream->bps, reader, context);
+    } else {
+        vcdiff_patch_set_target_reader(stream->vcdiff, reader, context);
+    }
+}
+
+static bool delta_decode(rom_patch_stream_t *stream, uint8_t *buffer, size_t length) {
+    return stream->bps ? bps_patch_decode(stream->bps, buffer, length) : vcdiff_patch_decode(stream->vcdiff, buffer, length);
+}
+
+static bool delta_finish(rom_patch_stream_t *stream) {
+    return stream->bps ? bps_patch_finish(stream->bps) : vcdiff_patch_finish(stream->vcdiff);
+}
+
+// BPS sources are checked against the patch up front when their digest is known (or `compute` is set).
+static rom_patch_result_t delta_open(
+    bool bps,
+    const char *patch_path,
+    const char *source_rom_path,
+    rom_endianness_t endianness,
+    bool compute,
+    flashcart_progress_callback_t *progress,
+    rom_patch_stream_t **out_stream
+) {
+    rom_patch_stream_t *stream = calloc(1, sizeof(rom_patch_stream_t));
+    if (!stream) {
+        return ROM_PATCH_IO_ERROR;
+    }
+    stream->source_crc = MZ_CRC32_INIT;
+
+    if (bps) {
+        stream->bps = bps_patch_open(patch_path, source_rom_path, endianness);
+    } else {
+        stream->vcdiff = vcdiff_patch_open(patch_path, source_rom_path, endianness);
+    }
+    if (!stream->bps && !stream->vcdiff) {
+        free(stream);
+        return ROM_PATCH_FORMAT_ERROR;
+    }
+    if (stream->bps && !bps_source_matches(stream->bps, source_rom_path, compute, progress)) {
+        rom_patch_stream_free(stream);
+        return ROM_PATCH_INCOMPATIBLE;
+    }
+
+    *out_stream = stream;
+    return ROM_PATCH_OK;
+}
+
+static rom_patch_result_t apply_delta(
+    bool bps,
+    const char *source_rom_path,
+    rom_endianness_t endianness,
+    const char *patch_path,
+    const char *target_rom_path,
+    flashcart_progress_callback_t *progress
+) {
+    rom_patch_stream_t *delta;
+    rom_patch_result_t result = delta_open(bps, patch_path, source_rom_path, endianness, true, progress, &delta);
+    if (result != ROM_PATCH_OK) {
+        return result;
+    }
+
+    FILE *out = fopen(target_rom_path, "wb+");
+    uint8_t *buf = malloc(PATCH_DELTA_CHUNK_SIZE);
+    if (!out || !buf) {
+        if (out) {
+            fclose(out);
+        }
+        free(buf);
+        rom_patch_stream_free(delta);
+        return ROM_PATCH_IO_ERROR;
+    }
+    delta_set_target_reader(delta, delta_read_cache_file, out);
+
+    uint32_t target_size = delta_target_size(delta);
+    for (uint32_t offset = 0; offset < target_size && result == ROM_PATCH_OK; offset += PATCH_DELTA_CHUNK_SIZE) {
+        size_t length = MIN((size_t)(target_size - offset), (size_t)PATCH_DELTA_CHUNK_SIZE);
+        if (!delta_decode(delta, buf, length)) {
+            result = ROM_PATCH_FORMAT_ERROR;
+        } else if (fwrite(buf, 1, length, out) != length) {
+            result = ROM_PATCH_IO_ERROR;
+        }
+    }
+    if (result == ROM_PATCH_OK && !delta_finish(delta)) {
+        result = ROM_PATCH_FORMAT_ERROR;
+    }
+
+    if (fclose(out) != 0 && result == ROM_PATCH_OK) {
+        result = ROM_PATCH_IO_ERROR;
+    }
+    free(buf);
+    rom_patch_stream_free(delta);
+    return result;
+}
+
+static rom_patch_result_t stream_prepare_delta(
+    bool bps,
+    const char *patch_path,
+    const char *source_rom_path,
+    rom_endianness_t endianness,
+    rom_patch_stream_t **out_stream
+) {
+    int64_t rom_size = file_get_size((char *)source_rom_path);
+    if (rom_size <= 0) {
+        return ROM_PATCH_IO_ERROR;
+    }
+    if (rom_size > PATCH_STREAM_MAX_ROM_SIZE) {
+        return ROM_PATCH_SKIPPED;
+    }
+
+    rom_patch_stream_t *stream;
+    rom_patch_result_t result = delta_open(bps, patch_path, source_rom_path, endianness, false, NULL, &stream);
+    if (result != ROM_PATCH_OK) {
+        return result;
+    }
+    // The load covers the source file, a larger target needs the cached copy.
+    if (delta_target_size(stream) > (uint32_t)rom_size) {
+        rom_patch_stream_free(stream);
+        return ROM_PATCH_SKIPPED;
+    }
+    delta_set_target_reader(stream, delta_read_cart, NULL);
+
+    debugf("ROM patch: applying %s patch on load\n", bps ? "BPS" : "VCDIFF");
+    *out_stream = stream;
+    return ROM_PATCH_OK;
+}
+
+// The buffer holds the source ROM at the same offset, it is kept as the decoder's source window.
+static void stream_apply_delta(rom_patch_stream_t *stream, uint8_t *buffer, uint32_t offset, size_t length) {
+    if (stream->error || offset != stream->position) {
+        stream->error = true;
+        return;
+    }
+    if (length > stream->window_size) {
+        free(stream->window);
+        stream->window = malloc(length);
+        stream->window_size = stream->window ? length : 0;
+        if (!stream->window) {
+            stream->error = true;
+            return;
+        }
+    }
+
+    if (stream->bps) {
+        uint32_t source_size = bps_patch_source_size(stream->bps);
+        if (offset < source_size) {
+            stream->source_crc = (uint32_t)mz_crc32(stream->source_crc, buffer, MIN(length, (size_t)(source_size - offset)));
+        }
+    }
+
+    memcpy(stream->window, buffer, length);
+    delta_set_source_window(stream, stream->window, offset, length);
+
+    uint32_t target_size = delta_target_size(stream);
+    size_t n = (offset < target_size) ? MIN(length, (size_t)(target_size - offset)) : 0;
+    if (n > 0 && !delta_decode(stream, buffer, n)) {
+        stream->error = true;
+    }
+    memset(buffer + n, 0, length - n);
+    stream->position += (uint32_t)length;
+}
+
+void rom_patch_stream_apply(uint8_t *buffer, uint32_t offset, size_t length, void *context) {
+    rom_patch_stream_t *stream = context;
+    if (stream->bps || stream->vcdiff) {
+        stream_apply_delta(stream, buffer, offset, length);
+    } else {
+        ips_patch_apply(stream->ips, buffer, offset, length);
+    }
+}
+
+rom_patch_result_t rom_patch_stream_finish(rom_patch_stream_t *stream) {
+    if (!stream || (!stream->bps && !stream->vcdiff)) {
+        return ROM_PATCH_OK;
+    }
+    if (stream->error) {
+        return ROM_PATCH_FORMAT_ERROR;
+    }
+    if (stream->bps) {
+        if (stream->position < bps_patch_source_size(stream->bps)) {
+            return ROM_PATCH_FORMAT_ERROR;
+        }
+        if (stream->source_crc != bps_patch_source_crc32(stream->bps)) {
+            debugf("ROM patch: BPS source crc32 mismatch (rom=%08lX expected=%08lX)\n",
+                (unsigned long)stream->source_crc, (unsigned long)bps_patch_source_crc32(stream->bps));
+            return ROM_PATCH_INCOMPATIBLE;
+        }
+    }
+    return delta_finish(stream) ? ROM_PATCH_OK : ROM_PATCH_FORMAT_ERROR;
+}
+
+void rom_patch_stream_free(rom_patch_stream_t *stream) {
+    if (!stream) {
+        return;
+    }
+    bps_patch_close(stream->bps);
+    vcdiff_patch_close(stream->vcdiff);
+    free(stream->window);
+    ips_patch_free(stream->ips);
+    free(stream);
+}
+
 static void build_patch_dirs(menu_t *menu, path_t **region_dir, path_t **global_dir) {
     char c0[2] = { menu->load.rom_info.game_code[0], '\0' };
     char c1[2] = { menu->load.rom_info.game_code[1], '\0' };
@@ -399,7 +697,8 @@ static bool resolve_manifest_path(menu_t *menu, char out_path[512], char out_nam
 static bool validate_manifest_compatibility(
     menu_t *menu,
     const patch_manifest_t *manifest,
-    const char *source_rom_path
+    const char *source_rom_path,
+    flashcart_progress_callback_t *progress
 ) {
     if (manifest->has_expected_check_code && manifest->expected_check_code != menu->load.rom_info.check_code) {
         debugf("ROM patch: check_code mismatch (rom=%016llX expected=%016llX)\n",
@@ -427,6 +726,24 @@ static bool validate_manifest_compatibility(
         }
     }
 
+    if (manifest->has_expected_crc32 || manifest->has_expected_sha1) {
+        // Full-ROM digests tell hacks, bad dumps and revisions apart where check_code cannot.
+        rom_digest_t digest;
+        if (!rom_digest_lookup(source_rom_path, &digest) && !rom_digest_compute(source_rom_path, &digest, progress)) {
+            debugf("ROM patch: unable to hash %s\n", source_rom_path);
+            return false;
+        }
+        if (manifest->has_expected_crc32 && manifest->expected_crc32 != digest.crc32) {
+            debugf("ROM patch: crc32 mismatch (rom=%08lX expected=%08lX)\n",
+                (unsigned long)digest.crc32, (unsigned long)manifest->expected_crc32);
+            return false;
+        }
+        if (manifest->has_expected_sha1 && memcmp(manifest->expected_sha1, digest.sha1, sizeof(digest.sha1)) != 0) {
+            debugf("ROM patch: sha1 mismatch\n");
+            return false;
+        }
+    }
+
     return true;
 }
 
@@ -445,6 +762,8 @@ static uint32_t build_cache_key(
     h = fnv1a32_u64(h, (uint64_t)manifest->has_expected_rom_size);
     h = fnv1a32_u64(h, (uint64_t)manifest->expected_rom_size);
     h = fnv1a32_str(h, manifest->expected_game_code);
+    h = fnv1a32_u64(h, (uint64_t)manifest->has_expected_crc32);
+    h = fnv1a32_u64(h, manifest->expected_crc32);
 
     for (int i = 0; i < manifest->files_count; i++) {
         h = fnv1a32_str(h, manifest->files[i]);
@@ -455,11 +774,13 @@ static uint32_t build_cache_key(
     return h;
 }
 
-rom_patch_result_t rom_patch_prepare_launch(
+static rom_patch_result_t prepare_launch(
     menu_t *menu,
     const char *source_rom_path,
     char *out_rom_path,
-    size_t out_rom_path_len
+    size_t out_rom_path_len,
+    rom_patch_stream_t **out_stream,
+    flashcart_progress_callback_t *progress
 ) {
     if (!menu || !source_rom_path || !out_rom_path || out_rom_path_len == 0) {
         return ROM_PATCH_IO_ERROR;
@@ -467,11 +788,6 @@ rom_patch_result_t rom_patch_prepare_launch(
 
     out_rom_path[0] = '\0';
 
-    if (menu->load.rom_info.endianness != ENDIANNESS_BIG) {
-        debugf("ROM patch: skipped, unsupported ROM endianness for safe IPS pipeline.\n");
-        return ROM_PATCH_INCOMPATIBLE;
-    }
-
     char manifest_path[512];
     char manifest_name[128];
     if (!resolve_manifest_path(menu, manifest_path, manifest_name)) {
@@ -485,13 +801,21 @@ rom_patch_result_t rom_patch_prepare_launch(
     }
 
     bool patch_type_ips = (strcasecmp(manifest.type, "ips") == 0);
+    bool patch_type_bps = (strcasecmp(manifest.type, "bps") == 0);
     bool patch_type_xdelta = (strcasecmp(manifest.type, "xdelta") == 0);
-    if (!patch_type_ips && !patch_type_xdelta) {
+    if (!patch_type_ips && !patch_type_bps && !patch_type_xdelta) {
         debugf("ROM patch: unsupported type '%s' in %s\n", manifest.type, manifest_path);
         return ROM_PATCH_INCOMPATIBLE;
     }
+    // xdelta manifests without a prepatched ROM are decoded here.
+    bool patch_type_delta = patch_type_bps || (patch_type_xdelta && manifest.prepatched_file[0] == '\0');
+    // Each delta patch is made against one exact source, so they don't stack.
+    if (patch_type_delta && manifest.files_count != 1) {
+        debugf("ROM patch: %s manifests take a single file (%s)\n", manifest.type, manifest_path);
+        return ROM_PATCH_INCOMPATIBLE;
+    }
 
-    if (!validate_manifest_compatibility(menu, &manifest, source_rom_path)) {
+    if (!validate_manifest_compatibility(menu, &manifest, source_rom_path, progress)) {
         return ROM_PATCH_INCOMPATIBLE;
     }
 
@@ -540,18 +864,22 @@ rom_patch_result_t rom_patch_prepare_launch(
     path_free(cache_dir);
 
     if (patch_type_ips) {
+        if (out_stream && !file_exists(cache_rom_path)) {
+            rom_patch_result_t result = stream_prepare_ips(&manifest, patch_paths, source_rom_path, out_stream);
+            if (result != ROM_PATCH_SKIPPED) {
+                if (result == ROM_PATCH_OK) {
+                    snprintf(out_rom_path, out_rom_path_len, "%s", source_rom_path);
+                }
+                path_free(manifest_dir);
+                return result;
+            }
+        }
         if (!file_exists(cache_rom_path)) {
-            if (!copy_file(source_rom_path, cache_rom_path)) {
+            rom_patch_result_t result = write_ips_cache(&manifest, patch_paths, source_rom_path, menu->load.rom_info.endianness, cache_rom_path);
+            if (result != ROM_PATCH_OK) {
                 remove(cache_rom_path);
                 path_free(manifest_dir);
-                return ROM_PATCH_IO_ERROR;
-            }
-            for (int i = 0; i < manifest.files_count; i++) {
-                if (!apply_ips(cache_rom_path, patch_paths[i])) {
-                    remove(cache_rom_path);
-                    path_free(manifest_dir);
-                    return ROM_PATCH_FORMAT_ERROR;
-                }
+                return result;
             }
         }
         snprintf(out_rom_path, out_rom_path_len, "%s", cache_rom_path);
@@ -559,12 +887,31 @@ rom_patch_result_t rom_patch_prepare_launch(
         return ROM_PATCH_OK;
     }
 
-    // xdelta support uses pre-generated patched ROM file.
-    if (manifest.prepatched_file[0] == '\0') {
-        debugf("ROM patch: xdelta requires 'prepatched_file' in manifest (%s)\n", manifest_path);
+    if (patch_type_delta) {
+        if (out_stream && !file_exists(cache_rom_path)) {
+            rom_patch_result_t result = stream_prepare_delta(patch_type_bps, patch_paths[0], source_rom_path, menu->load.rom_info.endianness, out_stream);
+            if (result != ROM_PATCH_SKIPPED) {
+                if (result == ROM_PATCH_OK) {
+                    snprintf(out_rom_path, out_rom_path_len, "%s", source_rom_path);
+                }
+                path_free(manifest_dir);
+                return result;
+            }
+        }
+        if (!file_exists(cache_rom_path)) {
+            rom_patch_result_t result = apply_delta(patch_type_bps, source_rom_path, menu->load.rom_info.endianness, patch_paths[0], cache_rom_path, progress);
+            if (result != ROM_PATCH_OK) {
+                remove(cache_rom_path);
+                path_free(manifest_dir);
+                return result;
+            }
+        }
+        snprintf(out_rom_path, out_rom_path_len, "%s", cache_rom_path);
         path_free(manifest_dir);
-        return ROM_PATCH_INCOMPATIBLE;
+        return ROM_PATCH_OK;
     }
+
+    // xdelta manifests can still point at a pre-generated patched ROM file.
     path_push(manifest_dir, manifest.prepatched_file);
     char prepatched_path[512];
     snprintf(prepatched_path, sizeof(prepatched_path), "%s", path_get(manifest_dir));
@@ -576,3 +923,28 @@ rom_patch_result_t rom_patch_prepare_launch(
     snprintf(out_rom_path, out_rom_path_len, "%s", prepatched_path);
     return ROM_PATCH_OK;
 }
+
+rom_patch_result_t rom_patch_prepare_launch(
+    menu_t *menu,
+    const char *source_rom_path,
+    char *out_rom_path,
+    size_t out_rom_path_len,
+    flashcart_progress_callback_t *progress
+) {
+    return prepare_launch(menu, source_rom_path, out_rom_path, out_rom_path_len, NULL, progress);
+}
+
+rom_patch_result_t rom_patch_prepare_launch_streamed(
+    menu_t *menu,
+    const char *source_rom_path,
+    char *out_rom_path,
+    size_t out_rom_path_len,
+    rom_patch_stream_t **out_stream,
+    flashcart_progress_callback_t *progress
+) {
+    if (!out_stream) {
+        return ROM_PATCH_IO_ERROR;
+    }
+    *out_stream = NULL;
+    return prepare_launch(menu, source_rom_path, out_rom_path, out_rom_path_len, out_stream, progress);
+}
@@ -9,6 +9,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "menu_state.h"
 
@@ -20,6 +21,9 @@ typedef enum {
     ROM_PATCH_FORMAT_ERROR,
 } rom_patch_result_t;
 
+/** @brief IPS records or a BPS/VCDIFF decoder, applied while the ROM is loaded. */
+typedef struct rom_patch_stream_s rom_patch_stream_t;
+
 /**
  * @brief Prepare a patched ROM for launch.
  *
@@ -27,12 +31,64 @@ typedef enum {
  * - Returns ROM_PATCH_SKIPPED when no patch manifest is found.
  * - Returns ROM_PATCH_INCOMPATIBLE when manifest constraints do not match.
  * - Returns ROM_PATCH_OK and writes `out_rom_path` when a cached/generated patch is ready.
+ *
+ * `progress` is reported while the source ROM is hashed for manifests that
+ * check its CRC32/SHA-1 and have no stored digest yet. It may be NULL.
  */
 rom_patch_result_t rom_patch_prepare_launch(
     menu_t *menu,
     const char *source_rom_path,
     char *out_rom_path,
-    size_t out_rom_path_len
+    size_t out_rom_path_len,
+    flashcart_progress_callback_t *progress
 );
 
+/**
+ * @brief Prepare a patched ROM for launch, patching on load where possible.
+ *
+ * Like rom_patch_prepare_launch(), except that an IPS, BPS or xdelta patch without a
+ * cached patched ROM is opened as `out_stream` instead of written to the cache:
+ * - `out_rom_path` is then the source ROM, still in its own byte order.
+ * - The caller passes the stream to flashcart_set_rom_patch() with
+ *   rom_patch_stream_apply(), checks rom_patch_stream_finish() after the load
+ *   and frees it.
+ * Patches that cannot be applied on load (ROMs larger than 64 MiB - 128 KiB,
+ * too much IPS data, BPS/xdelta targets larger than their source) still go through the cache, and `out_stream` is left NULL.
+ */
+rom_patch_result_t rom_patch_prepare_launch_streamed(
+    menu_t *menu,
+    const char *source_rom_path,
+    char *out_rom_path,
+    size_t out_rom_path_len,
+    rom_patch_stream_t **out_stream,
+    flashcart_progress_callback_t *progress
+);
+
+/**
+ * @brief Apply a patch stream to a piece of ROM data (flashcart_patch_callback_t).
+ *
+ * @param buffer ROM data, big endian.
+ * @param offset ROM offset of the data.
+ * @param length Length of the data.
+ * @param context The rom_patch_stream_t.
+ */
+void rom_patch_stream_apply(uint8_t *buffer, uint32_t offset, size_t length, void *context);
+
+/**
+ * @brief Verify a patch stream once the ROM is loaded.
+ *
+ * BPS checksums of the source, target and patch, and the last xdelta window
+ * checksums, are only known after every chunk went through
+ * rom_patch_stream_apply().
+ *
+ * @return ROM_PATCH_OK, ROM_PATCH_INCOMPATIBLE for the wrong source ROM, or
+ *         ROM_PATCH_FORMAT_ERROR for a damaged patch.
+ */
+rom_patch_result_t rom_patch_stream_finish(rom_patch_stream_t *stream);
+
+/**
+ * @brief Free a patch stream.
+ */
+void rom_patch_stream_free(rom_patch_stream_t *stream);
+
 #endif
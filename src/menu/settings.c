@@ -50,6 +50,14 @@ static settings_t init = {
     .background_visualizer_intensity = 1,
     .selected_row_shimmer_enabled = true,
     .rumble_enabled = false,
+    .rom_hash_job_enabled = false,
+    .image_dither_enabled = false,
+    .thumb_cache_kib = 0,
+    .thumb_cache_overlay_enabled = false,
+    .compact_image_cache_enabled = false,
+    .rom_reload_skip_enabled = false,
+    .save_reload_skip_enabled = false,
+    .rom_patch_on_load_enabled = false,
 };
 
 
@@ -152,6 +160,17 @@ void settings_load (settings_t *settings) {
     }
     settings->selected_row_shimmer_enabled = mini_get_bool(ini, "menu_beta_flag", "selected_row_shimmer_enabled", init.selected_row_shimmer_enabled);
     settings->rumble_enabled = mini_get_bool(ini, "menu_beta_flag", "rumble_enabled", init.rumble_enabled);
+    settings->rom_hash_job_enabled = mini_get_bool(ini, "menu_beta_flag", "rom_hash_job_enabled", init.rom_hash_job_enabled);
+    settings->image_dither_enabled = mini_get_bool(ini, "menu_beta_flag", "image_dither_enabled", init.image_dither_enabled);
+    settings->thumb_cache_kib = mini_get_int(ini, "menu_beta_flag", "thumb_cache_kib", init.thumb_cache_kib);
+    if (settings->thumb_cache_kib < 0 || settings->thumb_cache_kib > 4096) {
+        settings->thumb_cache_kib = init.thumb_cache_kib;
+    }
+    settings->thumb_cache_overlay_enabled = mini_get_bool(ini, "menu_beta_flag", "thumb_cache_overlay_enabled", init.thumb_cache_overlay_enabled);
+    settings->compact_image_cache_enabled = mini_get_bool(ini, "menu_beta_flag", "compact_image_cache_enabled", init.compact_image_cache_enabled);
+    settings->rom_reload_skip_enabled = mini_get_bool(ini, "menu_beta_flag", "rom_reload_skip_enabled", init.rom_reload_skip_enabled);
+    settings->save_reload_skip_enabled = mini_get_bool(ini, "menu_beta_flag", "save_reload_skip_enabled", init.save_reload_skip_enabled);
+    settings->rom_patch_on_load_enabled = mini_get_bool(ini, "menu_beta_flag", "rom_patch_on_load_enabled", init.rom_patch_on_load_enabled);
 
     mini_free(ini);
 }
@@ -206,6 +225,14 @@ void settings_save (settings_t *settings) {
     mini_set_int(ini, "menu_beta_flag", "background_visualizer_intensity", settings->background_visualizer_intensity);
     mini_set_bool(ini, "menu_beta_flag", "selected_row_shimmer_enabled", settings->selected_row_shimmer_enabled);
     // mini_set_bool(ini, "menu_beta_flag", "rumble_enabled", settings->rumble_enabled);
+    mini_set_bool(ini, "menu_beta_flag", "rom_hash_job_enabled", settings->rom_hash_job_enabled);
+    mini_set_bool(ini, "menu_beta_flag", "image_dither_enabled", settings->image_dither_enabled);
+    mini_set_int(ini, "menu_beta_flag", "thumb_cache_kib", settings->thumb_cache_kib);
+    mini_set_bool(ini, "menu_beta_flag", "thumb_cache_overlay_enabled", settings->thumb_cache_overlay_enabled);
+    mini_set_bool(ini, "menu_beta_flag", "compact_image_cache_enabled", settings->compact_image_cache_enabled);
+    mini_set_bool(ini, "menu_beta_flag", "rom_reload_skip_enabled", settings->rom_reload_skip_enabled);
+    mini_set_bool(ini, "menu_beta_flag", "save_reload_skip_enabled", settings->save_reload_skip_enabled);
+    mini_set_bool(ini, "menu_beta_flag", "rom_patch_on_load_enabled", settings->rom_patch_on_load_enabled);
 
     mini_save_safe(ini, MINI_FLAGS_SKIP_EMPTY_GROUPS);
 
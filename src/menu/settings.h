@@ -107,6 +107,30 @@ typedef struct {
     /** @brief Enable rumble feedback within the menu */
     bool rumble_enabled;
 
+    /** @brief Hash every ROM in the background for exact DAT identification */
+    bool rom_hash_job_enabled;
+
+    /** @brief Ordered dithering when decoding PNG images to 16-bit */
+    bool image_dither_enabled;
+
+    /** @brief Box art thumbnail memory cache budget in KiB, 0 for automatic */
+    int thumb_cache_kib;
+
+    /** @brief Show box art thumbnail cache counters over the grid view */
+    bool thumb_cache_overlay_enabled;
+
+    /** @brief Quantize cached thumbnails and backgrounds to palettized formats */
+    bool compact_image_cache_enabled;
+
+    /** @brief Skip copying a ROM to the cart when it is still there from the previous launch */
+    bool rom_reload_skip_enabled;
+
+    /** @brief Skip copying a save to the cart when its save memory still holds the same data */
+    bool save_reload_skip_enabled;
+
+    /** @brief Apply IPS patches while the ROM is copied to the cart instead of writing a patched copy */
+    bool rom_patch_on_load_enabled;
+
 #ifdef FEATURE_AUTOLOAD_ROM_ENABLED
     /** @brief Show progress bar when loading a ROM */
     bool loading_progress_bar_enabled;
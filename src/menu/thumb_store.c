@@ -0,0 +1,810 @@
+/**
+ * @file thumb_store.c
+ * @brief Packed on-disk store for decoded thumbnails
+ * @ingroup menu
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fatfs/ff.h>
+#include <libdragon.h>
+
+#include "native_image.h"
+#include "path.h"
+#include "thumb_store.h"
+#include "utils/fs.h"
+#include "utils/hash.h"
+#include "utils/utils.h"
+
+#define THUMB_STORE_PACK_FILE           "menu/cache/thumbs.pack"
+#define THUMB_STORE_INDEX_FILE          "menu/cache/thumbs.idx"
+#define THUMB_STORE_PACK_MAGIC          0x54485041 /* THPA */
+#define THUMB_STORE_INDEX_MAGIC         0x54484958 /* THIX */
+#define THUMB_STORE_RECORD_MAGIC        0x54485245 /* THRE */
+#define THUMB_STORE_VERSION             1
+#define THUMB_STORE_ENTRIES_MAX         1024
+#define THUMB_STORE_PACK_MAX            (32 * 1024 * 1024)
+#define THUMB_STORE_COMPACT_MIN_GARBAGE (1024 * 1024)
+#define THUMB_STORE_FLUSH_APPENDS       (8)
+#define THUMB_STORE_COPY_CHUNK          (32 * 1024)
+#define THUMB_STORE_POLL_BUDGET_US      (2000)
+#define THUMB_STORE_PATH_MAX            (512)
+#define THUMB_STORE_LEGACY_DIRECTORY    "menu/cache/thumbs"
+
+/** @brief Pack file header. The generation changes on every compaction. */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t generation;
+    uint32_t reserved;
+} thumb_store_pack_header_t;
+
+/** @brief Header in front of every image in the pack. */
+typedef struct {
+    uint32_t magic;
+    uint32_t size;
+    uint64_t key_hash;
+    uint16_t width;
+    uint16_t height;
+    uint16_t stride;
+    uint16_t format;    /**< native_image_format_t, 0 (RGBA16) in older packs */
+} thumb_store_record_header_t;
+
+/** @brief Index entry, kept sorted by key hash. */
+typedef struct {
+    uint64_t key_hash;
+    uint32_t offset;
+    uint32_t size;
+    uint16_t width;
+    uint16_t height;
+    uint16_t stride;
+    uint16_t format;
+} thumb_store_entry_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_size;
+    uint32_t generation;
+    uint32_t count;
+    uint32_t data_size;
+    uint32_t garbage_bytes;
+    uint32_t reserved;
+} thumb_store_index_header_t;
+
+static const char *thumb_store_legacy_extensions[] = { "cache", "tmp", NULL };
+
+static char thumb_store_prefix[16];
+
+static struct {
+    bool loaded;
+    bool dirty;
+    FILE *pack;
+    uint32_t generation;
+    uint32_t data_size;         /**< End of the last complete record in the pack */
+    uint32_t garbage_bytes;     /**< Bytes of records no longer referenced by the index */
+    thumb_store_entry_t *entries;
+    uint32_t count;
+    int appends_since_flush;
+    bool compact_failed;        /**< Set after a failed compaction, so a full pack doesn't retry it on every append */
+} thumb_store;
+
+/** @brief Live record to copy during a compaction. */
+typedef struct {
+    uint32_t offset;            /**< Offset in the old pack */
+    uint32_t bytes;             /**< Record header and data */
+    uint32_t new_offset;        /**< Offset in the new pack */
+} thumb_store_compact_record_t;
+
+/**
+ * @brief Compaction in progress, advanced by thumb_store_poll.
+ *
+ * Every copy step is one read of up to THUMB_STORE_COPY_CHUNK bytes from
+ * the old pack or one write of them to the new one, so a compaction never
+ * takes more than a chunk transfer out of a frame.
+ */
+static struct {
+    bool active;
+    FILE *out;
+    uint32_t generation;
+    thumb_store_compact_record_t *records;  /**< Sorted by old offset */
+    uint32_t count;
+    uint32_t index;             /**< Record being copied */
+    uint32_t copied;            /**< Bytes of that record already written */
+    uint8_t *buffer;
+    uint32_t buffered;          /**< Bytes read into the buffer and not written yet */
+    bool swapped;               /**< New pack in place, only the index is left to write */
+    uint64_t start_us;
+} thumb_store_compaction;
+
+/** @brief Removal of the bx_*.cache files the per-file thumbnail cache left behind. */
+static struct {
+    bool checked;
+    bool dir_open;
+    DIR dir;
+} thumb_store_legacy;
+
+
+static path_t *thumb_store_cache_path(const char *file) {
+    if (thumb_store_prefix[0] == '\0') {
+        return NULL;
+    }
+    return path_init(thumb_store_prefix, (char *)file);
+}
+
+static bool thumb_store_tmp_path(const char *file, char *out, size_t out_size) {
+    path_t *target = thumb_store_cache_path(file);
+    if (!target) {
+        return false;
+    }
+    bool ok = ((size_t)snprintf(out, out_size, "%s.tmp", path_get(target)) < out_size);
+    path_free(target);
+    return ok;
+}
+
+static uint32_t thumb_store_record_bytes(const thumb_store_entry_t *entry) {
+    return sizeof(thumb_store_record_header_t) + entry->size;
+}
+
+static bool thumb_store_record_valid(const thumb_store_record_header_t *header) {
+    tex_format_t format;
+    return native_image_format_from_id(header->format, &format) &&
+        (header->size == native_image_buffer_size(format, header->height, header->stride));
+}
+
+static int thumb_store_search(uint64_t key_hash, bool *found) {
+    int low = 0;
+    int high = (int)thumb_store.count;
+    while (low < high) {
+        int mid = (low + high) / 2;
+        if (thumb_store.entries[mid].key_hash < key_hash) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    *found = (low < (int)thumb_store.count) && (thumb_store.entries[low].key_hash == key_hash);
+    return low;
+}
+
+static void thumb_store_remove_at(int index) {
+    thumb_store.garbage_bytes += thumb_store_record_bytes(&thumb_store.entries[index]);
+    memmove(&thumb_store.entries[index], &thumb_store.entries[index + 1],
+        (thumb_store.count - index - 1) * sizeof(thumb_store_entry_t));
+    thumb_store.count--;
+    thumb_store.dirty = true;
+}
+
+// Drop the oldest record, which is the one at the lowest pack offset.
+static void thumb_store_evict_oldest(void) {
+    if (thumb_store.count == 0) {
+        return;
+    }
+    int oldest = 0;
+    for (uint32_t i = 1; i < thumb_store.count; i++) {
+        if (thumb_store.entries[i].offset < thumb_store.entries[oldest].offset) {
+            oldest = (int)i;
+        }
+    }
+    thumb_store_remove_at(oldest);
+}
+
+static void thumb_store_insert(const thumb_store_entry_t *entry) {
+    bool found;
+    int index = thumb_store_search(entry->key_hash, &found);
+    if (found) {
+        thumb_store.garbage_bytes += thumb_store_record_bytes(&thumb_store.entries[index]);
+        thumb_store.entries[index] = *entry;
+    } else {
+        if (thumb_store.count >= THUMB_STORE_ENTRIES_MAX) {
+            thumb_store_evict_oldest();
+            index = thumb_store_search(entry->key_hash, &found);
+        }
+        memmove(&thumb_store.entries[index + 1], &thumb_store.entries[index],
+            (thumb_store.count - index) * sizeof(thumb_store_entry_t));
+        thumb_store.entries[index] = *entry;
+        thumb_store.count++;
+    }
+    thumb_store.dirty = true;
+}
+
+static bool thumb_store_index_flush(void) {
+    if (!thumb_store.loaded || !thumb_store.dirty || !thumb_store.pack) {
+        return true;
+    }
+
+    char tmp_path[THUMB_STORE_PATH_MAX];
+    if (!thumb_store_tmp_path(THUMB_STORE_INDEX_FILE, tmp_path, sizeof(tmp_path))) {
+        return false;
+    }
+
+    thumb_store_index_header_t header = {
+        .magic = THUMB_STORE_INDEX_MAGIC,
+        .version = THUMB_STORE_VERSION,
+        .entry_size = sizeof(thumb_store_entry_t),
+        .generation = thumb_store.generation,
+        .count = thumb_store.count,
+        .data_size = thumb_store.data_size,
+        .garbage_bytes = thumb_store.garbage_bytes,
+    };
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = (fwrite(&header, sizeof(header), 1, f) == 1);
+    if (ok && (thumb_store.count > 0)) {
+        ok = (fwrite(thumb_store.entries, sizeof(thumb_store_entry_t), thumb_store.count, f) == thumb_store.count);
+    }
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+
+    path_t *index_path = thumb_store_cache_path(THUMB_STORE_INDEX_FILE);
+    if (ok) {
+        ok = file_rename(tmp_path, path_get(index_path));
+    }
+    if (!ok) {
+        remove(tmp_path);
+    }
+    path_free(index_path);
+
+    if (ok) {
+        thumb_store.dirty = false;
+        thumb_store.appends_since_flush = 0;
+    }
+    return ok;
+}
+
+static FILE *thumb_store_pack_create(const char *path, uint32_t generation) {
+    FILE *f = fopen(path, "w+b");
+    if (!f) {
+        return NULL;
+    }
+    thumb_store_pack_header_t header = {
+        .magic = THUMB_STORE_PACK_MAGIC,
+        .version = THUMB_STORE_VERSION,
+        .generation = generation,
+    };
+    if ((fwrite(&header, sizeof(header), 1, f) != 1) || (fflush(f) != 0)) {
+        fclose(f);
+        remove(path);
+        return NULL;
+    }
+    return f;
+}
+
+static void thumb_store_index_load(uint32_t pack_size) {
+    thumb_store.count = 0;
+    thumb_store.data_size = sizeof(thumb_store_pack_header_t);
+    thumb_store.garbage_bytes = 0;
+
+    path_t *index_path = thumb_store_cache_path(THUMB_STORE_INDEX_FILE);
+    FILE *f = fopen(path_get(index_path), "rb");
+    path_free(index_path);
+    if (!f) {
+        thumb_store.dirty = true;
+        return;
+    }
+
+    thumb_store_index_header_t header;
+    bool valid = (fread(&header, sizeof(header), 1, f) == 1) &&
+        (header.magic == THUMB_STORE_INDEX_MAGIC) &&
+        (header.version == THUMB_STORE_VERSION) &&
+        (header.entry_size == sizeof(thumb_store_entry_t)) &&
+        (header.generation == thumb_store.generation) &&
+        (header.count <= THUMB_STORE_ENTRIES_MAX) &&
+        (header.data_size >= sizeof(thumb_store_pack_header_t)) &&
+        (header.data_size <= pack_size);
+
+    if (valid && (header.count > 0)) {
+        valid = (fread(thumb_store.entries, sizeof(thumb_store_entry_t), header.count, f) == header.count);
+    }
+    fclose(f);
+
+    if (valid) {
+        thumb_store.count = header.count;
+        thumb_store.data_size = header.data_size;
+        thumb_store.garbage_bytes = header.garbage_bytes;
+    } else {
+        thumb_store.dirty = true;
+    }
+}
+
+// Index records appended after the last index flush, stopping at the first torn record.
+static void thumb_store_recover_tail(uint32_t pack_size) {
+    uint32_t offset = thumb_store.data_size;
+    while ((offset + sizeof(thumb_store_record_header_t)) <= pack_size) {
+        thumb_store_record_header_t header;
+        if ((fseek(thumb_store.pack, offset, SEEK_SET) != 0) ||
+            (fread(&header, sizeof(header), 1, thumb_store.pack) != 1) ||
+            (header.magic != THUMB_STORE_RECORD_MAGIC) ||
+            (header.size > (pack_size - offset - sizeof(header))) ||
+            !thumb_store_record_valid(&header)) {
+            break;
+        }
+
+        thumb_store_entry_t entry = {
+            .key_hash = header.key_hash,
+            .offset = offset,
+            .size = header.size,
+            .width = header.width,
+            .height = header.height,
+            .stride = header.stride,
+            .format = header.format,
+        };
+        thumb_store_insert(&entry);
+        offset += sizeof(header) + header.size;
+    }
+
+    if (offset != thumb_store.data_size) {
+        debugf("thumb_store: recovered %lu bytes of unindexed records\n", (unsigned long)(offset - thumb_store.data_size));
+        thumb_store.data_size = offset;
+        thumb_store.dirty = true;
+    }
+}
+
+static int thumb_store_compare_record_offset(const void *a, const void *b) {
+    uint32_t offset_a = ((const thumb_store_compact_record_t *)a)->offset;
+    uint32_t offset_b = ((const thumb_store_compact_record_t *)b)->offset;
+    return (offset_a > offset_b) - (offset_a < offset_b);
+}
+
+static void thumb_store_compact_release(void) {
+    if (thumb_store_compaction.out) {
+        fclose(thumb_store_compaction.out);
+    }
+    free(thumb_store_compaction.records);
+    free(thumb_store_compaction.buffer);
+    memset(&thumb_store_compaction, 0, sizeof(thumb_store_compaction));
+}
+
+static void thumb_store_compact_abort(void) {
+    char tmp_path[THUMB_STORE_PATH_MAX];
+    thumb_store_compact_release();
+    if (thumb_store_tmp_path(THUMB_STORE_PACK_FILE, tmp_path, sizeof(tmp_path))) {
+        remove(tmp_path);
+    }
+}
+
+/**
+ * @brief Start rewriting the pack with only the live records.
+ *
+ * The records are copied by thumb_store_poll into a new pack next to the
+ * old one, which keeps serving loads meanwhile. Appends are refused until
+ * the compaction finishes.
+ */
+static void thumb_store_compact_start(void) {
+    if (thumb_store_compaction.active || thumb_store.compact_failed || !thumb_store.pack) {
+        return;
+    }
+
+    char tmp_path[THUMB_STORE_PATH_MAX];
+    if (!thumb_store_tmp_path(THUMB_STORE_PACK_FILE, tmp_path, sizeof(tmp_path))) {
+        return;
+    }
+
+    thumb_store_compaction.generation = thumb_store.generation + 1;
+    thumb_store_compaction.buffer = malloc(THUMB_STORE_COPY_CHUNK);
+    thumb_store_compaction.records = malloc(MAX(thumb_store.count, 1u) * sizeof(thumb_store_compact_record_t));
+    thumb_store_compaction.out = thumb_store_pack_create(tmp_path, thumb_store_compaction.generation);
+    if (!thumb_store_compaction.buffer || !thumb_store_compaction.records || !thumb_store_compaction.out) {
+        thumb_store_compact_abort();
+        thumb_store.compact_failed = true;
+        return;
+    }
+
+    for (uint32_t i = 0; i < thumb_store.count; i++) {
+        thumb_store_compaction.records[i] = (thumb_store_compact_record_t) {
+            .offset = thumb_store.entries[i].offset,
+            .bytes = thumb_store_record_bytes(&thumb_store.entries[i]),
+        };
+    }
+    thumb_store_compaction.count = thumb_store.count;
+
+    // Copy in pack order so both files are read and written sequentially.
+    qsort(thumb_store_compaction.records, thumb_store_compaction.count, sizeof(thumb_store_compact_record_t), thumb_store_compare_record_offset);
+    uint32_t out_offset = sizeof(thumb_store_pack_header_t);
+    for (uint32_t i = 0; i < thumb_store_compaction.count; i++) {
+        thumb_store_compaction.records[i].new_offset = out_offset;
+        out_offset += thumb_store_compaction.records[i].bytes;
+    }
+
+    thumb_store_compaction.start_us = get_ticks_us();
+    thumb_store_compaction.active = true;
+    debugf("thumb_store: compacting %lu bytes of garbage\n", (unsigned long)thumb_store.garbage_bytes);
+}
+
+/**
+ * @brief Switch to the compacted pack.
+ *
+ * The new pack is renamed over the old one, and the index is rewritten
+ * under the new generation by the next step; if that is lost, the
+ * generation mismatch makes the next load rebuild the index by scanning
+ * the pack. Records removed while the compaction ran were still copied and
+ * count as garbage again.
+ */
+static bool thumb_store_compact_swap(void) {
+    char tmp_path[THUMB_STORE_PATH_MAX];
+    thumb_store_tmp_path(THUMB_STORE_PACK_FILE, tmp_path, sizeof(tmp_path));
+
+    path_t *pack_path = thumb_store_cache_path(THUMB_STORE_PACK_FILE);
+    fclose(thumb_store.pack);
+    thumb_store.pack = NULL;
+    bool ok = file_rename(tmp_path, path_get(pack_path));
+
+    uint32_t data_size = sizeof(thumb_store_pack_header_t);
+    if (thumb_store_compaction.count > 0) {
+        thumb_store_compact_record_t *last = &thumb_store_compaction.records[thumb_store_compaction.count - 1];
+        data_size = last->new_offset + last->bytes;
+    }
+
+    if (ok) {
+        uint32_t live_bytes = 0;
+        uint32_t kept = 0;
+        for (uint32_t i = 0; i < thumb_store.count; i++) {
+            thumb_store_compact_record_t key = { .offset = thumb_store.entries[i].offset };
+            thumb_store_compact_record_t *record = bsearch(&key, thumb_store_compaction.records, thumb_store_compaction.count,
+                sizeof(thumb_store_compact_record_t), thumb_store_compare_record_offset);
+            if (record) {
+                thumb_store.entries[kept] = thumb_store.entries[i];
+                thumb_store.entries[kept].offset = record->new_offset;
+                live_bytes += record->bytes;
+                kept++;
+            }
+        }
+        thumb_store.count = kept;
+        thumb_store.generation = thumb_store_compaction.generation;
+        thumb_store.data_size = data_size;
+        thumb_store.garbage_bytes = data_size - sizeof(thumb_store_pack_header_t) - live_bytes;
+        thumb_store.dirty = true;
+    }
+
+    if (!thumb_store.pack) {
+        thumb_store.pack = fopen(path_get(pack_path), "r+b");
+        if (thumb_store.pack) {
+            setbuf(thumb_store.pack, NULL);
+        }
+        if (!ok || !thumb_store.pack) {
+            // The old offsets no longer match whatever pack is on disk.
+            thumb_store.count = 0;
+            thumb_store.data_size = sizeof(thumb_store_pack_header_t);
+            thumb_store.garbage_bytes = 0;
+            thumb_store.dirty = true;
+        }
+    }
+    path_free(pack_path);
+
+    debugf("thumb_store: compacted to %lu bytes in %lu ms\n",
+        (unsigned long)thumb_store.data_size, (unsigned long)((get_ticks_us() - thumb_store_compaction.start_us) / 1000));
+    thumb_store_compaction.swapped = true;
+    return ok;
+}
+
+/**
+ * @brief Do the next step of a compaction.
+ *
+ * Copy reads and writes alternate, so one step costs a single transfer.
+ * Closing the new pack, swapping it in and writing the index are steps of
+ * their own.
+ */
+static void thumb_store_compact_step(void) {
+    if (thumb_store_compaction.swapped) {
+        thumb_store_compact_release();
+        thumb_store_index_flush();
+        return;
+    }
+    if (thumb_store_compaction.index >= thumb_store_compaction.count) {
+        if (thumb_store_compaction.out) {
+            bool closed = (fclose(thumb_store_compaction.out) == 0);
+            thumb_store_compaction.out = NULL;
+            if (!closed) {
+                thumb_store_compact_abort();
+                thumb_store.compact_failed = true;
+            }
+        } else if (!thumb_store_compact_swap()) {
+            thumb_store.compact_failed = true;
+        }
+        return;
+    }
+
+    thumb_store_compact_record_t *record = &thumb_store_compaction.records[thumb_store_compaction.index];
+    bool ok;
+    if (thumb_store_compaction.buffered == 0) {
+        uint32_t chunk = MIN(record->bytes - thumb_store_compaction.copied, (uint32_t)THUMB_STORE_COPY_CHUNK);
+        ok = (fseek(thumb_store.pack, record->offset + thumb_store_compaction.copied, SEEK_SET) == 0) &&
+            (fread(thumb_store_compaction.buffer, chunk, 1, thumb_store.pack) == 1);
+        thumb_store_compaction.buffered = chunk;
+    } else {
+        ok = (fwrite(thumb_store_compaction.buffer, thumb_store_compaction.buffered, 1, thumb_store_compaction.out) == 1);
+        thumb_store_compaction.copied += thumb_store_compaction.buffered;
+        thumb_store_compaction.buffered = 0;
+        if (thumb_store_compaction.copied >= record->bytes) {
+            thumb_store_compaction.index++;
+            thumb_store_compaction.copied = 0;
+        }
+    }
+
+    if (!ok) {
+        debugf("thumb_store: compaction failed, pack left as is\n");
+        thumb_store_compact_abort();
+        thumb_store.compact_failed = true;
+    }
+}
+
+static bool thumb_store_should_compact(void) {
+    return (thumb_store.garbage_bytes >= THUMB_STORE_COMPACT_MIN_GARBAGE) &&
+        ((thumb_store.garbage_bytes * 4ULL) >= thumb_store.data_size);
+}
+
+static bool thumb_store_open(void) {
+    if (thumb_store.loaded) {
+        return (thumb_store.pack != NULL);
+    }
+    if (thumb_store_prefix[0] == '\0') {
+        return false;
+    }
+    thumb_store.loaded = true;
+
+    thumb_store.entries = malloc(THUMB_STORE_ENTRIES_MAX * sizeof(thumb_store_entry_t));
+    if (!thumb_store.entries) {
+        return false;
+    }
+
+    path_t *pack_path = thumb_store_cache_path(THUMB_STORE_PACK_FILE);
+    path_t *directory = path_clone(pack_path);
+    path_pop(directory);
+    directory_create(path_get(directory));
+    path_free(directory);
+
+    thumb_store_pack_header_t header;
+    thumb_store.pack = fopen(path_get(pack_path), "r+b");
+    bool valid = thumb_store.pack &&
+        (fread(&header, sizeof(header), 1, thumb_store.pack) == 1) &&
+        (header.magic == THUMB_STORE_PACK_MAGIC) &&
+        (header.version == THUMB_STORE_VERSION);
+    if (!valid) {
+        if (thumb_store.pack) {
+            fclose(thumb_store.pack);
+        }
+        thumb_store.pack = thumb_store_pack_create(path_get(pack_path), get_ticks());
+        if (thumb_store.pack) {
+            rewind(thumb_store.pack);
+            valid = (fread(&header, sizeof(header), 1, thumb_store.pack) == 1);
+        }
+    }
+    path_free(pack_path);
+    if (!valid) {
+        if (thumb_store.pack) {
+            fclose(thumb_store.pack);
+            thumb_store.pack = NULL;
+        }
+        return false;
+    }
+    setbuf(thumb_store.pack, NULL);
+    thumb_store.generation = header.generation;
+
+    uint32_t pack_size = 0;
+    if (fseek(thumb_store.pack, 0, SEEK_END) == 0) {
+        long end = ftell(thumb_store.pack);
+        pack_size = (end > 0) ? (uint32_t)end : 0;
+    }
+
+    thumb_store_index_load(pack_size);
+    thumb_store_recover_tail(pack_size);
+
+    if (thumb_store_should_compact()) {
+        thumb_store_compact_start();
+    }
+
+    return (thumb_store.pack != NULL);
+}
+
+void thumb_store_init(const char *storage_prefix) {
+    snprintf(thumb_store_prefix, sizeof(thumb_store_prefix), "%s", storage_prefix ? storage_prefix : "");
+}
+
+void thumb_store_deinit(void) {
+    // An unfinished compaction starts over on the next boot, the garbage is still counted.
+    if (thumb_store_compaction.active) {
+        thumb_store_compact_abort();
+    }
+    if (thumb_store_legacy.dir_open) {
+        f_closedir(&thumb_store_legacy.dir);
+    }
+    memset(&thumb_store_legacy, 0, sizeof(thumb_store_legacy));
+    thumb_store_index_flush();
+    if (thumb_store.pack) {
+        fclose(thumb_store.pack);
+    }
+    free(thumb_store.entries);
+    memset(&thumb_store, 0, sizeof(thumb_store));
+}
+
+bool thumb_store_contains(const char *key) {
+    if (!key || !thumb_store_open()) {
+        return false;
+    }
+    bool found;
+    thumb_store_search(fnv1a64_str(key), &found);
+    return found;
+}
+
+surface_t *thumb_store_load(const char *key, int max_width, int max_height) {
+    if (!key || !thumb_store_open()) {
+        return NULL;
+    }
+
+    uint64_t key_hash = fnv1a64_str(key);
+    bool found;
+    int index = thumb_store_search(key_hash, &found);
+    if (!found) {
+        return NULL;
+    }
+
+    thumb_store_entry_t entry = thumb_store.entries[index];
+    tex_format_t format;
+    if ((entry.width == 0) || (entry.height == 0) || (entry.width > max_width) || (entry.height > max_height) ||
+        !native_image_format_from_id(entry.format, &format)) {
+        return NULL;
+    }
+
+    thumb_store_record_header_t header;
+    if ((fseek(thumb_store.pack, entry.offset, SEEK_SET) != 0) ||
+        (fread(&header, sizeof(header), 1, thumb_store.pack) != 1) ||
+        (header.magic != THUMB_STORE_RECORD_MAGIC) ||
+        (header.key_hash != key_hash) ||
+        (header.size != entry.size)) {
+        // Stale entry; forget it so the thumbnail is decoded and stored again.
+        thumb_store_remove_at(index);
+        return NULL;
+    }
+
+    surface_t *image = native_image_alloc(format, entry.width, entry.height);
+    if (!image) {
+        return NULL;
+    }
+    if ((image->stride != entry.stride) ||
+        (fread(image->buffer, entry.size, 1, thumb_store.pack) != 1)) {
+        surface_free(image);
+        free(image);
+        return NULL;
+    }
+    return image;
+}
+
+static bool thumb_store_append(uint64_t key_hash, const surface_t *image) {
+    thumb_store_record_header_t header = {
+        .magic = THUMB_STORE_RECORD_MAGIC,
+        .size = (uint32_t)native_image_buffer_size(surface_get_format(image), image->height, image->stride),
+        .key_hash = key_hash,
+        .width = image->width,
+        .height = image->height,
+        .stride = image->stride,
+        .format = (uint16_t)native_image_format_id(surface_get_format(image)),
+    };
+    uint32_t record_bytes = sizeof(header) + header.size;
+    if (thumb_store_compaction.active) {
+        return false;
+    }
+    if ((thumb_store.data_size + record_bytes) > THUMB_STORE_PACK_MAX) {
+        // Full: retire the oldest quarter, thumb_store_poll then reclaims its space.
+        while ((thumb_store.count > 0) && ((thumb_store.garbage_bytes * 4ULL) < THUMB_STORE_PACK_MAX)) {
+            thumb_store_evict_oldest();
+        }
+        if (thumb_store_should_compact()) {
+            thumb_store_compact_start();
+        }
+        return false;
+    }
+
+    bool ok = (fseek(thumb_store.pack, thumb_store.data_size, SEEK_SET) == 0) &&
+        (fwrite(&header, sizeof(header), 1, thumb_store.pack) == 1) &&
+        (fwrite(image->buffer, header.size, 1, thumb_store.pack) == 1) &&
+        (fflush(thumb_store.pack) == 0);
+    if (!ok) {
+        return false;
+    }
+
+    thumb_store_entry_t entry = {
+        .key_hash = key_hash,
+        .offset = thumb_store.data_size,
+        .size = header.size,
+        .width = header.width,
+        .height = header.height,
+        .stride = header.stride,
+        .format = header.format,
+    };
+    thumb_store_insert(&entry);
+    thumb_store.data_size += record_bytes;
+
+    if (++thumb_store.appends_since_flush >= THUMB_STORE_FLUSH_APPENDS) {
+        thumb_store_index_flush();
+    }
+    return true;
+}
+
+bool thumb_store_save(const char *key, const surface_t *image) {
+    if (!key || !image || !image->buffer || (native_image_format_id(surface_get_format(image)) < 0) ||
+        (image->width > UINT16_MAX) || (image->height > UINT16_MAX) || (image->stride > UINT16_MAX)) {
+        return false;
+    }
+    if (!thumb_store_open()) {
+        return false;
+    }
+
+    uint64_t key_hash = fnv1a64_str(key);
+    bool found;
+    thumb_store_search(key_hash, &found);
+    if (found) {
+        return true;
+    }
+
+    surface_t *compact = NULL;
+    if (native_image_compact_caches_enabled()) {
+        compact = native_image_compact(image, NATIVE_IMAGE_LOAD_PALETTE);
+    }
+    bool ok = thumb_store_append(key_hash, compact ? compact : image);
+    if (compact) {
+        surface_free(compact);
+        free(compact);
+    }
+    return ok;
+}
+
+/**
+ * @brief Delete one entry of the legacy thumbnail directory.
+ *
+ * The directory itself goes once it is empty, so later boots find nothing
+ * to do.
+ */
+static void thumb_store_legacy_step(void) {
+    path_t *directory = thumb_store_cache_path(THUMB_STORE_LEGACY_DIRECTORY);
+    if (!directory) {
+        thumb_store_legacy.checked = true;
+        return;
+    }
+
+    if (!thumb_store_legacy.checked) {
+        thumb_store_legacy.checked = true;
+        thumb_store_legacy.dir_open = (f_opendir(&thumb_store_legacy.dir, strip_fs_prefix(path_get(directory))) == FR_OK);
+        path_free(directory);
+        return;
+    }
+
+    FILINFO info;
+    if ((f_readdir(&thumb_store_legacy.dir, &info) != FR_OK) || (info.fname[0] == '\0')) {
+        f_closedir(&thumb_store_legacy.dir);
+        thumb_store_legacy.dir_open = false;
+        if (f_unlink(strip_fs_prefix(path_get(directory))) == FR_OK) {
+            debugf("thumb_store: removed the legacy thumbnail cache\n");
+        }
+        path_free(directory);
+        return;
+    }
+
+    if (!(info.fattrib & AM_DIR) && (strncmp(info.fname, "bx_", 3) == 0) && file_has_extensions(info.fname, thumb_store_legacy_extensions)) {
+        path_push(directory, info.fname);
+        f_unlink(strip_fs_prefix(path_get(directory)));
+    }
+    path_free(directory);
+}
+
+void thumb_store_poll(void) {
+    if (!thumb_store_compaction.active && (thumb_store_legacy.checked && !thumb_store_legacy.dir_open)) {
+        return;
+    }
+
+    uint64_t start_us = get_ticks_us();
+    do {
+        if (thumb_store_compaction.active) {
+            thumb_store_compact_step();
+        } else if (!thumb_store_legacy.checked || thumb_store_legacy.dir_open) {
+            thumb_store_legacy_step();
+        } else {
+            return;
+        }
+    } while ((get_ticks_us() - start_us) < THUMB_STORE_POLL_BUDGET_US);
+}
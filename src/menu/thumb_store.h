@@ -0,0 +1,72 @@
+/**
+ * @file thumb_store.h
+ * @brief Packed on-disk store for decoded thumbnails
+ * @ingroup menu
+ */
+
+#ifndef THUMB_STORE_H__
+#define THUMB_STORE_H__
+
+#include <stdbool.h>
+
+#include <libdragon.h>
+
+/**
+ * @brief Set the storage prefix used for the thumbnail pack and index.
+ *
+ * The store itself is opened on first use.
+ *
+ * @param storage_prefix Storage prefix (eg. "sd:/")
+ */
+void thumb_store_init(const char *storage_prefix);
+
+/**
+ * @brief Persist the index and close the pack file.
+ */
+void thumb_store_deinit(void);
+
+/**
+ * @brief Advance background work on the store.
+ *
+ * Compacts the pack a chunk at a time once enough of it is garbage, and
+ * deletes the bx_*.cache files of the old per-image cache. Call once per
+ * frame; a call does at least one step and then stops after about 2 ms.
+ */
+void thumb_store_poll(void);
+
+/**
+ * @brief Load a thumbnail.
+ *
+ * A hit costs one seek and one read of the pack file.
+ *
+ * @param key Cache key, usually the source image path
+ * @param max_width Reject stored images wider than this
+ * @param max_height Reject stored images taller than this
+ * @return Newly allocated surface owned by the caller, or NULL. Thumbnails
+ *         stored compact come back as CI8/CI4 (see native_image_get_palette).
+ */
+surface_t *thumb_store_load(const char *key, int max_width, int max_height);
+
+/**
+ * @brief Check whether a thumbnail is stored, without any SD card access.
+ *
+ * @param key Cache key
+ * @return true if the key is in the index
+ */
+bool thumb_store_contains(const char *key);
+
+/**
+ * @brief Append a thumbnail to the pack.
+ *
+ * Keys that are already stored are left untouched. RGBA16 images are
+ * quantized to CI8/CI4 first when compact caches are enabled. Nothing is
+ * stored while a compaction runs, or when the pack is full and has to be
+ * compacted first.
+ *
+ * @param key Cache key
+ * @param image Surface to store, RGBA16 or a native_image compact format
+ * @return true if the thumbnail is stored afterwards
+ */
+bool thumb_store_save(const char *key, const surface_t *image);
+
+#endif /* THUMB_STORE_H__ */
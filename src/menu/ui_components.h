@@ -265,6 +265,18 @@ void ui_components_background_free(void);
 void ui_components_background_replace_image(surface_t *image);
 void ui_components_background_replace_image_temporary(surface_t *image);
 bool ui_components_background_load_temporary_cached(const char *source_path);
+
+/**
+ * @brief Stream a native image background in 32-row bands, crossfading each band in.
+ *
+ * Accepts a .nimg path or a source with a .nimg sidecar. Bands are read and
+ * blended over the following frames from ui_components_background_draw, so
+ * the switch costs no full-image decode or second full-screen surface.
+ *
+ * @param source_path Background source path.
+ * @return false if there is no readable native image; use the cached or PNG path instead.
+ */
+bool ui_components_background_load_temporary_streamed(const char *source_path);
 void ui_components_background_save_temporary_cache(const char *source_path);
 void ui_components_background_reload_cache(void);
 
@@ -359,10 +371,23 @@ void ui_components_context_menu_draw(component_context_menu_t *cm);
  */
 typedef struct {
     bool loading; /**< Flag to indicate if the box art is loading */
-    surface_t *image; /**< Pointer to the box art image */
+    surface_t *image; /**< Pointer to the box art image, shared with the thumbnail cache when cache_entry is set */
     void *load_context; /**< Internal async load context (PNG decode callback data) */
+    void *cache_entry; /**< Internal thumbnail cache reference, NULL if the image is owned */
 } component_boxart_t;
 
+/**
+ * @brief Box art thumbnail memory cache counters.
+ */
+typedef struct {
+    uint32_t hits; /**< Lookups served from memory */
+    uint32_t misses; /**< Lookups that had to go to the SD card */
+    uint32_t evictions; /**< Entries dropped to stay within the budget */
+    uint32_t entries; /**< Images currently cached */
+    size_t bytes; /**< Pixel bytes currently cached */
+    size_t budget_bytes; /**< Byte budget for unreferenced images */
+} boxart_cache_stats_t;
+
 /**
  * @brief Initialize the box art component.
  * 
@@ -375,8 +400,17 @@ typedef struct {
 component_boxart_t *ui_components_boxart_init(const char *storage_prefix, const char *game_code, const char *rom_title, file_image_type_t current_image_view);
 component_boxart_t *ui_components_boxart_init_async(const char *storage_prefix, const char *game_code, const char *rom_title, file_image_type_t current_image_view);
 component_boxart_t *ui_components_boxart_init_memory_cached(const char *storage_prefix, const char *game_code, const char *rom_title, file_image_type_t current_image_view);
-component_boxart_t *ui_components_boxart_init_grid(const char *storage_prefix, const char *game_code, const char *rom_title);
-component_boxart_t *ui_components_boxart_init_grid_memory_cached(const char *storage_prefix, const char *game_code, const char *rom_title);
+/**
+ * @brief Initialize a box art component for a grid cell.
+ *
+ * PNG box art and native sidecars are downscaled while loading to fit the
+ * cell, so no full size surface is allocated.
+ *
+ * @param cell_width Grid cell width in pixels.
+ * @param cell_height Grid cell height in pixels.
+ */
+component_boxart_t *ui_components_boxart_init_grid(const char *storage_prefix, const char *game_code, const char *rom_title, int cell_width, int cell_height);
+component_boxart_t *ui_components_boxart_init_grid_memory_cached(const char *storage_prefix, const char *game_code, const char *rom_title, int cell_width, int cell_height);
 void ui_components_boxart_prewarm_dir(const char *storage_prefix, const char *game_code, const char *rom_title);
 
 /**
@@ -386,6 +420,23 @@ void ui_components_boxart_prewarm_dir(const char *storage_prefix, const char *ga
  */
 void ui_components_boxart_free(component_boxart_t *b);
 
+/**
+ * @brief Get the box art thumbnail memory cache counters.
+ *
+ * @param stats Receives the counters.
+ */
+void ui_components_boxart_cache_get_stats(boxart_cache_stats_t *stats);
+
+/**
+ * @brief Set the box art thumbnail memory cache budget.
+ *
+ * Images still in use by a component are never evicted, so the cache can
+ * exceed the budget while they are held.
+ *
+ * @param budget_bytes Budget in bytes, 0 for the default for this console.
+ */
+void ui_components_boxart_cache_set_budget(size_t budget_bytes);
+
 /**
  * @brief Draw the box art component.
  * 
@@ -16,10 +16,38 @@
 #include "constants.h"
 #include "utils/fs.h"
 #include "utils/hash.h"
+#include "utils/utils.h"
 
 #define CACHE_METADATA_MAGIC    (0x424B4731)
+#define CACHE_METADATA_MAGIC_FORMAT (0x424B4732) /* Followed by a native_image_format_t id */
 #define BACKGROUND_NATIVE_SIDECAR ".nimg"
 
+#define BACKGROUND_STREAM_BAND_ROWS     (32)    /* Rows per streamed band */
+#define BACKGROUND_STREAM_READ_ROWS     (8)     /* Rows per SD read */
+#define BACKGROUND_STREAM_MAX_BANDS     (4)     /* Bands fading in at the same time */
+#define BACKGROUND_STREAM_FADE_STEPS    (8)     /* Frames for a band to fade in */
+#define BACKGROUND_STREAM_BUDGET_US     (4000)  /* SD read time per frame */
+
+/**
+ * @brief A horizontal band of a streamed background, fading into the live image.
+ */
+typedef struct {
+    surface_t surface;  /**< Darkened RGBA16 pixels, BACKGROUND_STREAM_BAND_ROWS tall. */
+    int y;              /**< First image row covered by the band. */
+    int rows;           /**< Rows filled so far. */
+    int step;           /**< Fade steps applied, up to BACKGROUND_STREAM_FADE_STEPS. */
+} background_band_t;
+
+/**
+ * @brief State of a background streamed from a native image, band by band.
+ */
+typedef struct {
+    native_image_reader_t reader;   /**< Source rows. */
+    background_band_t *loading;     /**< Band being read. */
+    background_band_t *fading[BACKGROUND_STREAM_MAX_BANDS]; /**< Bands being blended in. */
+    int fading_count;               /**< Entries used in fading. */
+} background_stream_t;
+
 /**
  * @brief Structure representing the background component.
  */
@@ -27,6 +55,7 @@ typedef struct {
     char *cache_location;      /**< Path to the cache file location. */
     surface_t *image;          /**< Pointer to the loaded image surface. */
     rspq_block_t *image_display_list; /**< Display list for rendering the image. */
+    background_stream_t *stream; /**< Streamed image still fading in, or NULL. */
     bool visualizer_enabled;   /**< Draw animated visualizer instead of image. */
     int visualizer_style;      /**< Visualizer style enum. */
     int visualizer_intensity;  /**< 0=subtle,1=normal,2=full */
@@ -113,22 +142,31 @@ static surface_t *load_surface_from_cache_file(const char *cache_path) {
         return NULL;
     }
 
-    if (cache_metadata.magic != CACHE_METADATA_MAGIC || cache_metadata.width > DISPLAY_WIDTH || cache_metadata.height > DISPLAY_HEIGHT) {
+    tex_format_t format = FMT_RGBA16;
+    if (cache_metadata.magic == CACHE_METADATA_MAGIC_FORMAT) {
+        uint32_t format_id;
+        if ((fread(&format_id, sizeof(format_id), 1, f) != 1) || !native_image_format_from_id(format_id, &format)) {
+            fclose(f);
+            return NULL;
+        }
+    } else if (cache_metadata.magic != CACHE_METADATA_MAGIC) {
+        fclose(f);
+        return NULL;
+    }
+
+    if (cache_metadata.width > DISPLAY_WIDTH || cache_metadata.height > DISPLAY_HEIGHT) {
         fclose(f);
         return NULL;
     }
 
-    surface_t *image = calloc(1, sizeof(surface_t));
+    surface_t *image = native_image_alloc(format, cache_metadata.width, cache_metadata.height);
     if (!image) {
         fclose(f);
         return NULL;
     }
-    *image = surface_alloc(FMT_RGBA16, cache_metadata.width, cache_metadata.height);
 
-    if (image->buffer == NULL || cache_metadata.size != (image->height * image->stride)) {
-        if (image->buffer) {
-            surface_free(image);
-        }
+    if (cache_metadata.size != native_image_buffer_size(format, image->height, image->stride)) {
+        surface_free(image);
         free(image);
         fclose(f);
         return NULL;
@@ -154,16 +192,34 @@ static void save_surface_to_cache_file(const char *cache_path, surface_t *image)
         return;
     }
 
+    surface_t *compact = NULL;
+    if (native_image_compact_caches_enabled()) {
+        compact = native_image_compact(image, NATIVE_IMAGE_LOAD_PALETTE);
+        if (compact) {
+            image = compact;
+        }
+    }
+
+    tex_format_t format = surface_get_format(image);
     cache_metadata_t cache_metadata = {
-        .magic = CACHE_METADATA_MAGIC,
+        .magic = (format == FMT_RGBA16) ? CACHE_METADATA_MAGIC : CACHE_METADATA_MAGIC_FORMAT,
         .width = image->width,
         .height = image->height,
-        .size = (image->height * image->stride),
+        .size = native_image_buffer_size(format, image->height, image->stride),
     };
 
     fwrite(&cache_metadata, sizeof(cache_metadata), 1, f);
+    if (format != FMT_RGBA16) {
+        uint32_t format_id = native_image_format_id(format);
+        fwrite(&format_id, sizeof(format_id), 1, f);
+    }
     fwrite(image->buffer, cache_metadata.size, 1, f);
     fclose(f);
+
+    if (compact) {
+        surface_free(compact);
+        free(compact);
+    }
 }
 
 static uint8_t u8_clamp(int v) {
@@ -542,6 +598,23 @@ static void save_to_cache(component_background_t *c) {
     save_surface_to_cache_file(c->cache_location, c->image);
 }
 
+/**
+ * @brief Blend the background overlay colour into palette entries, like the multiply blender does for pixels.
+ *
+ * @param palette RGBA16 palette.
+ * @param colors Number of entries.
+ */
+static void darken_palette(uint16_t *palette, int colors) {
+    color_t overlay = BACKGROUND_OVERLAY_COLOR;
+    for (int i = 0; i < colors; i++) {
+        color_t color = color_from_packed16(palette[i]);
+        color.r = (uint8_t)(((overlay.r * overlay.a) + (color.r * (255 - overlay.a))) / 255);
+        color.g = (uint8_t)(((overlay.g * overlay.a) + (color.g * (255 - overlay.a))) / 255);
+        color.b = (uint8_t)(((overlay.b * overlay.a) + (color.b * (255 - overlay.a))) / 255);
+        palette[i] = color_to_packed16(color);
+    }
+}
+
 /**
  * @brief Prepare the background image for display (darken and center).
  *
@@ -552,16 +625,21 @@ static void prepare_background(component_background_t *c) {
         return;
     }
 
-    // Darken the image
-    rdpq_attach(c->image, NULL);
-    rdpq_mode_push();
-        rdpq_set_mode_standard();
-        rdpq_set_prim_color(BACKGROUND_OVERLAY_COLOR);
-        rdpq_mode_combiner(RDPQ_COMBINER_FLAT);
-        rdpq_mode_blender(RDPQ_BLENDER_MULTIPLY);
-        rdpq_fill_rectangle(0, 0, c->image->width, c->image->height);
-    rdpq_mode_pop();
-    rdpq_detach();
+    // Darken the image, or its palette when it can't be a render target
+    uint16_t *palette = native_image_get_palette(c->image);
+    if (palette) {
+        darken_palette(palette, (surface_get_format(c->image) == FMT_CI4) ? 16 : 256);
+    } else {
+        rdpq_attach(c->image, NULL);
+        rdpq_mode_push();
+            rdpq_set_mode_standard();
+            rdpq_set_prim_color(BACKGROUND_OVERLAY_COLOR);
+            rdpq_mode_combiner(RDPQ_COMBINER_FLAT);
+            rdpq_mode_blender(RDPQ_BLENDER_MULTIPLY);
+            rdpq_fill_rectangle(0, 0, c->image->width, c->image->height);
+        rdpq_mode_pop();
+        rdpq_detach();
+    }
 
     uint16_t image_center_x = (c->image->width / 2);
     uint16_t image_center_y = (c->image->height / 2);
@@ -601,6 +679,7 @@ static void prepare_background(component_background_t *c) {
             );
         }
         rdpq_set_mode_copy(false);
+        native_image_tlut_setup(c->image);
         rdpq_tex_blit(c->image, DISPLAY_CENTER_X - image_center_x, DISPLAY_CENTER_Y - image_center_y, NULL);
     rdpq_mode_pop();
     c->image_display_list = rspq_block_end();
@@ -615,6 +694,163 @@ static void display_list_free(void *arg) {
     rspq_block_free((rspq_block_t *) (arg));
 }
 
+/**
+ * @brief Free a streamed band once the RDP no longer reads it.
+ *
+ * @param arg Pointer to the band (background_band_t *).
+ */
+static void background_band_free(void *arg) {
+    background_band_t *band = (background_band_t *)arg;
+    surface_free(&band->surface);
+    free(band);
+}
+
+/**
+ * @brief Stop streaming, leaving whatever has faded in so far.
+ *
+ * @param c Pointer to the background component structure.
+ */
+static void background_stream_cancel(component_background_t *c) {
+    background_stream_t *stream = c->stream;
+    if (!stream) {
+        return;
+    }
+
+    native_image_reader_close(&stream->reader);
+    if (stream->loading) {
+        background_band_free(stream->loading);
+    }
+    for (int i = 0; i < stream->fading_count; i++) {
+        rdpq_call_deferred(background_band_free, stream->fading[i]);
+    }
+    free(stream);
+    c->stream = NULL;
+}
+
+/**
+ * @brief Apply one fade step of every active band to the live image.
+ *
+ * Step k of n blends the band in with alpha 1/(n-k+1), which over n steps is
+ * a linear crossfade from the old pixels; the last step copies the band exactly.
+ *
+ * @param c Pointer to the background component structure.
+ */
+static void background_stream_fade(component_background_t *c) {
+    background_stream_t *stream = c->stream;
+    if (stream->fading_count == 0) {
+        return;
+    }
+
+    rdpq_attach(c->image, NULL);
+    rdpq_mode_push();
+    int kept = 0;
+    for (int i = 0; i < stream->fading_count; i++) {
+        background_band_t *band = stream->fading[i];
+        band->step++;
+        if (band->step >= BACKGROUND_STREAM_FADE_STEPS) {
+            rdpq_set_mode_copy(false);
+        } else {
+            rdpq_set_mode_standard();
+            rdpq_set_prim_color(RGBA32(0xFF, 0xFF, 0xFF, 255 / (BACKGROUND_STREAM_FADE_STEPS - band->step + 1)));
+            rdpq_mode_combiner(RDPQ_COMBINER1((0, 0, 0, TEX0), (0, 0, 0, PRIM)));
+            rdpq_mode_blender(RDPQ_BLENDER_MULTIPLY);
+        }
+        rdpq_tex_blit(&band->surface, 0, band->y, &(rdpq_blitparms_t){ .height = band->rows });
+        if (band->step >= BACKGROUND_STREAM_FADE_STEPS) {
+            rdpq_call_deferred(background_band_free, band);
+        } else {
+            stream->fading[kept++] = band;
+        }
+    }
+    stream->fading_count = kept;
+    rdpq_mode_pop();
+    rdpq_detach();
+}
+
+/**
+ * @brief Darken a freshly read band and queue it for fading in.
+ *
+ * @param stream Pointer to the stream state.
+ */
+static void background_stream_queue_band(background_stream_t *stream) {
+    background_band_t *band = stream->loading;
+    stream->loading = NULL;
+
+    rdpq_attach(&band->surface, NULL);
+    rdpq_mode_push();
+        rdpq_set_mode_standard();
+        rdpq_set_prim_color(BACKGROUND_OVERLAY_COLOR);
+        rdpq_mode_combiner(RDPQ_COMBINER_FLAT);
+        rdpq_mode_blender(RDPQ_BLENDER_MULTIPLY);
+        rdpq_fill_rectangle(0, 0, band->surface.width, band->rows);
+    rdpq_mode_pop();
+    rdpq_detach();
+
+    stream->fading[stream->fading_count++] = band;
+}
+
+/**
+ * @brief Advance a streamed background by one frame.
+ *
+ * Reads rows for at most BACKGROUND_STREAM_BUDGET_US, so a full-screen image
+ * arrives over a few frames without stalling input or audio.
+ *
+ * @param c Pointer to the background component structure.
+ */
+static void background_stream_update(component_background_t *c) {
+    background_stream_t *stream = c->stream;
+    if (!stream) {
+        return;
+    }
+
+    background_stream_fade(c);
+
+    native_image_reader_t *reader = &stream->reader;
+    uint64_t start_us = get_ticks_us();
+    while ((reader->next_row < reader->height) && (stream->fading_count < BACKGROUND_STREAM_MAX_BANDS)) {
+        if ((get_ticks_us() - start_us) >= BACKGROUND_STREAM_BUDGET_US) {
+            break;
+        }
+
+        if (!stream->loading) {
+            background_band_t *band = calloc(1, sizeof(background_band_t));
+            if (band) {
+                band->surface = surface_alloc(FMT_RGBA16, reader->width, BACKGROUND_STREAM_BAND_ROWS);
+                if (!band->surface.buffer) {
+                    free(band);
+                    band = NULL;
+                }
+            }
+            if (!band) {
+                debugf("Background stream: band allocation failed\n");
+                background_stream_cancel(c);
+                return;
+            }
+            band->y = reader->next_row;
+            stream->loading = band;
+        }
+
+        background_band_t *band = stream->loading;
+        uint16_t *dst = (uint16_t *)((uint8_t *)band->surface.buffer + (band->rows * band->surface.stride));
+        int rows = MIN(BACKGROUND_STREAM_READ_ROWS, BACKGROUND_STREAM_BAND_ROWS - band->rows);
+        rows = native_image_reader_read_rows(reader, dst, band->surface.stride, rows);
+        if (rows <= 0) {
+            debugf("Background stream: %s\n", native_image_error_string(native_image_get_last_error()));
+            background_stream_cancel(c);
+            return;
+        }
+        band->rows += rows;
+
+        if ((band->rows == BACKGROUND_STREAM_BAND_ROWS) || (reader->next_row == reader->height)) {
+            background_stream_queue_band(stream);
+        }
+    }
+
+    if ((reader->next_row == reader->height) && !stream->loading && (stream->fading_count == 0)) {
+        background_stream_cancel(c);
+    }
+}
+
 /**
  * @brief Initialize the background component and load from cache.
  *
@@ -634,6 +870,7 @@ void ui_components_background_init(char *cache_location) {
  */
 void ui_components_background_free(void) {
     if (background) {
+        background_stream_cancel(background);
         if (background->image) {
             surface_free(background->image);
             free(background->image);
@@ -661,6 +898,8 @@ void ui_components_background_replace_image(surface_t *image) {
         return;
     }
 
+    background_stream_cancel(background);
+
     if (background->image) {
         surface_free(background->image);
         free(background->image);
@@ -682,6 +921,8 @@ void ui_components_background_replace_image_temporary(surface_t *image) {
         return;
     }
 
+    background_stream_cancel(background);
+
     if (background->image) {
         surface_free(background->image);
         free(background->image);
@@ -711,9 +952,9 @@ bool ui_components_background_load_temporary_cached(const char *source_path) {
     bool loaded_from_cache = (image != NULL);
     if (!image) {
         if (string_ends_with(source_path, BACKGROUND_NATIVE_SIDECAR)) {
-            image = native_image_load_rgba16_file(source_path, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+            image = native_image_load_file(source_path, DISPLAY_WIDTH, DISPLAY_HEIGHT, NATIVE_IMAGE_LOAD_PALETTE);
         } else {
-            image = native_image_load_sidecar_rgba16(source_path, BACKGROUND_NATIVE_SIDECAR, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+            image = native_image_load_sidecar(source_path, BACKGROUND_NATIVE_SIDECAR, DISPLAY_WIDTH, DISPLAY_HEIGHT, NATIVE_IMAGE_LOAD_PALETTE);
         }
         if (!image) {
             free(cache_path);
@@ -729,6 +970,57 @@ bool ui_components_background_load_temporary_cached(const char *source_path) {
     return true;
 }
 
+bool ui_components_background_load_temporary_streamed(const char *source_path) {
+    if (!background || !source_path) {
+        return false;
+    }
+
+    char *path = NULL;
+    if (string_ends_with(source_path, BACKGROUND_NATIVE_SIDECAR)) {
+        path = strdup(source_path);
+    } else if (native_image_sidecar_exists(source_path, BACKGROUND_NATIVE_SIDECAR)) {
+        path = malloc(strlen(source_path) + strlen(BACKGROUND_NATIVE_SIDECAR) + 1);
+        if (path) {
+            sprintf(path, "%s%s", source_path, BACKGROUND_NATIVE_SIDECAR);
+        }
+    }
+    if (!path) {
+        return false;
+    }
+
+    background_stream_t *stream = calloc(1, sizeof(background_stream_t));
+    if (!stream) {
+        free(path);
+        return false;
+    }
+    bool opened = native_image_reader_open(&stream->reader, path, DISPLAY_WIDTH, DISPLAY_HEIGHT);
+    free(path);
+    if (!opened) {
+        free(stream);
+        return false;
+    }
+
+    // Fade over the current image when it has the same shape, otherwise fade in from black.
+    surface_t *current = background->image;
+    bool reuse = current && (surface_get_format(current) == FMT_RGBA16)
+        && (current->width == stream->reader.width) && (current->height == stream->reader.height);
+    if (reuse) {
+        background_stream_cancel(background);
+    } else {
+        surface_t *image = native_image_alloc(FMT_RGBA16, stream->reader.width, stream->reader.height);
+        if (!image) {
+            native_image_reader_close(&stream->reader);
+            free(stream);
+            return false;
+        }
+        memset(image->buffer, 0, (size_t)image->height * image->stride);
+        ui_components_background_replace_image_temporary(image);
+    }
+
+    background->stream = stream;
+    return true;
+}
+
 void ui_components_background_save_temporary_cache(const char *source_path) {
     if (!background || !background->cache_location || !source_path || !background->image) {
         return;
@@ -747,6 +1039,8 @@ void ui_components_background_reload_cache(void) {
         return;
     }
 
+    background_stream_cancel(background);
+
     if (background->image) {
         surface_free(background->image);
         free(background->image);
@@ -798,6 +1092,10 @@ void ui_components_background_set_visualizer_intensity(int intensity) {
  * @brief Draw the background image or clear the screen if not available.
  */
 void ui_components_background_draw(void) {
+    if (background) {
+        background_stream_update(background);
+    }
+
     if (background && background->visualizer_enabled) {
         background->vis_frame_tick = (background->vis_frame_tick + 1) & 0x7FFFFFFFu;
     }
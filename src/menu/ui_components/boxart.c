@@ -7,12 +7,13 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
-#include <inttypes.h>
 
 #include "../ui_components.h"
+#include "../metadata_index.h"
 #include "../native_image.h"
 #include "../path.h"
 #include "../png_decoder.h"
+#include "../thumb_store.h"
 #include "constants.h"
 #include "utils/fs.h"
 #include "utils/hash.h"
@@ -20,40 +21,39 @@
 #define OLD_BOXART_DIRECTORY       "menu/boxart"
 #define METADATA_BASE_DIRECTORY    "menu/metadata"
 #define HOMEBREW_ID_SUBDIRECTORY   "homebrew"
-#define BOXART_CACHE_DIR           "menu/cache/thumbs"
-#define BOXART_CACHE_MAGIC         (0x42584154) /* BXAT */
-#define BOXART_THUMB_CACHE_ENTRIES (16)
-#define BOXART_LOAD_QUEUE_MAX      (24)
 #define BOXART_NATIVE_SIDECAR      ".nimg"
-
-typedef struct {
-    uint32_t magic;
-    uint32_t width;
-    uint32_t height;
-    uint32_t size;
-} boxart_cache_metadata_t;
-
-typedef struct {
-    bool valid;
+#define BOXART_THUMB_CACHE_BUCKETS (64)
+#define BOXART_THUMB_CACHE_BUDGET  (512 * 1024)
+#define BOXART_THUMB_CACHE_BUDGET_EXPANDED (2 * 1024 * 1024)
+
+/** @brief Shared decoded thumbnail, owned by the cache and referenced by components. */
+typedef struct boxart_thumb_cache_entry_s {
+    struct boxart_thumb_cache_entry_s *hash_next;
+    struct boxart_thumb_cache_entry_s *lru_prev; /**< More recently used neighbour */
+    struct boxart_thumb_cache_entry_s *lru_next; /**< Less recently used neighbour */
     uint64_t key_hash;
-    uint32_t last_used_tick;
     char *key_path;
     surface_t *image;
+    size_t bytes;
+    uint32_t refcount;
 } boxart_thumb_cache_entry_t;
 
 typedef struct {
     component_boxart_t *component;
     char *cache_key;
-    char *cache_path;
+    png_job_t job;
+    bool native_served;     /**< Set by the decoder when the image came from the native sidecar */
 } boxart_load_context_t;
 
-static boxart_thumb_cache_entry_t g_boxart_thumb_cache[BOXART_THUMB_CACHE_ENTRIES];
-static uint32_t g_boxart_thumb_cache_tick = 1;
-static boxart_load_context_t *g_boxart_active_load_ctx = NULL;
-static boxart_load_context_t *g_boxart_load_queue[BOXART_LOAD_QUEUE_MAX];
-static int g_boxart_load_queue_count = 0;
+static struct {
+    boxart_thumb_cache_entry_t *buckets[BOXART_THUMB_CACHE_BUCKETS];
+    boxart_thumb_cache_entry_t *lru_head;
+    boxart_thumb_cache_entry_t *lru_tail;
+    size_t bytes;
+    size_t budget;
+    boxart_cache_stats_t stats;
+} g_boxart_thumb_cache;
 
-static void boxart_queue_pump(void);
 static void png_decoder_callback(png_err_t err, surface_t *decoded_image, void *callback_data);
 
 /* Cache resolved boxart directory paths to avoid repeated SD stat cascades.
@@ -111,27 +111,6 @@ static bool string_ends_with(const char *s, const char *suffix) {
 }
 
 
-static surface_t *surface_clone_rgba16(surface_t *src) {
-    if (!src || !src->buffer) {
-        return NULL;
-    }
-
-    surface_t *dst = calloc(1, sizeof(surface_t));
-    if (!dst) {
-        return NULL;
-    }
-
-    *dst = surface_alloc(FMT_RGBA16, src->width, src->height);
-    if (!dst->buffer) {
-        free(dst);
-        return NULL;
-    }
-
-    size_t size = (size_t)src->height * (size_t)src->stride;
-    memcpy(dst->buffer, src->buffer, size);
-    return dst;
-}
-
 static void surface_free_owned(surface_t **image) {
     if (image && *image) {
         surface_free(*image);
@@ -140,197 +119,163 @@ static void surface_free_owned(surface_t **image) {
     }
 }
 
-static void boxart_thumb_cache_entry_clear(boxart_thumb_cache_entry_t *entry) {
-    if (!entry) {
-        return;
+static size_t boxart_thumb_cache_budget(void) {
+    if (g_boxart_thumb_cache.budget == 0) {
+        g_boxart_thumb_cache.budget = is_memory_expanded() ? BOXART_THUMB_CACHE_BUDGET_EXPANDED : BOXART_THUMB_CACHE_BUDGET;
     }
-    free(entry->key_path);
-    entry->key_path = NULL;
-    surface_free_owned(&entry->image);
-    memset(entry, 0, sizeof(*entry));
+    return g_boxart_thumb_cache.budget;
 }
 
-static boxart_thumb_cache_entry_t *boxart_thumb_cache_find(const char *key_path) {
-    if (!key_path) {
-        return NULL;
+static void boxart_thumb_cache_lru_unlink(boxart_thumb_cache_entry_t *entry) {
+    if (entry->lru_prev) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        g_boxart_thumb_cache.lru_head = entry->lru_next;
     }
-
-    uint64_t key_hash = fnv1a64_str(key_path);
-    for (int i = 0; i < BOXART_THUMB_CACHE_ENTRIES; i++) {
-        boxart_thumb_cache_entry_t *entry = &g_boxart_thumb_cache[i];
-        if (!entry->valid || entry->key_hash != key_hash || !entry->key_path) {
-            continue;
-        }
-        if (strcmp(entry->key_path, key_path) == 0) {
-            entry->last_used_tick = ++g_boxart_thumb_cache_tick;
-            return entry;
-        }
+    if (entry->lru_next) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        g_boxart_thumb_cache.lru_tail = entry->lru_prev;
     }
-
-    return NULL;
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
 }
 
-static boxart_thumb_cache_entry_t *boxart_thumb_cache_evict_target(void) {
-    boxart_thumb_cache_entry_t *oldest = &g_boxart_thumb_cache[0];
-    for (int i = 0; i < BOXART_THUMB_CACHE_ENTRIES; i++) {
-        if (!g_boxart_thumb_cache[i].valid) {
-            return &g_boxart_thumb_cache[i];
-        }
-        if (g_boxart_thumb_cache[i].last_used_tick < oldest->last_used_tick) {
-            oldest = &g_boxart_thumb_cache[i];
-        }
+static void boxart_thumb_cache_lru_push_front(boxart_thumb_cache_entry_t *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = g_boxart_thumb_cache.lru_head;
+    if (g_boxart_thumb_cache.lru_head) {
+        g_boxart_thumb_cache.lru_head->lru_prev = entry;
+    } else {
+        g_boxart_thumb_cache.lru_tail = entry;
     }
-    return oldest;
+    g_boxart_thumb_cache.lru_head = entry;
 }
 
-static bool boxart_thumb_cache_put(const char *key_path, surface_t *image) {
-    if (!key_path || !image || !image->buffer) {
-        return false;
+static void boxart_thumb_cache_destroy(boxart_thumb_cache_entry_t *entry) {
+    boxart_thumb_cache_entry_t **link = &g_boxart_thumb_cache.buckets[entry->key_hash % BOXART_THUMB_CACHE_BUCKETS];
+    while (*link && *link != entry) {
+        link = &(*link)->hash_next;
     }
-
-    boxart_thumb_cache_entry_t *entry = boxart_thumb_cache_find(key_path);
-    if (!entry) {
-        entry = boxart_thumb_cache_evict_target();
-        boxart_thumb_cache_entry_clear(entry);
-        entry->key_path = strdup(key_path);
-        if (!entry->key_path) {
-            return false;
-        }
-        entry->key_hash = fnv1a64_str(key_path);
-        entry->valid = true;
-    } else {
-        surface_free_owned(&entry->image);
+    if (*link) {
+        *link = entry->hash_next;
     }
-
-    entry->image = surface_clone_rgba16(image);
-    if (!entry->image) {
-        boxart_thumb_cache_entry_clear(entry);
-        return false;
-    }
-    entry->last_used_tick = ++g_boxart_thumb_cache_tick;
-    return true;
+    boxart_thumb_cache_lru_unlink(entry);
+    g_boxart_thumb_cache.bytes -= entry->bytes;
+    g_boxart_thumb_cache.stats.entries--;
+    free(entry->key_path);
+    surface_free_owned(&entry->image);
+    free(entry);
 }
 
-static surface_t *boxart_thumb_cache_get_clone(const char *key_path) {
-    boxart_thumb_cache_entry_t *entry = boxart_thumb_cache_find(key_path);
-    if (!entry || !entry->image) {
-        return NULL;
+// Evict unreferenced entries, least recently used first, until the cache fits its budget.
+static void boxart_thumb_cache_trim(void) {
+    size_t budget = boxart_thumb_cache_budget();
+    boxart_thumb_cache_entry_t *entry = g_boxart_thumb_cache.lru_tail;
+    while (entry && (g_boxart_thumb_cache.bytes > budget)) {
+        boxart_thumb_cache_entry_t *prev = entry->lru_prev;
+        if (entry->refcount == 0) {
+            boxart_thumb_cache_destroy(entry);
+            g_boxart_thumb_cache.stats.evictions++;
+        }
+        entry = prev;
     }
-    return surface_clone_rgba16(entry->image);
 }
 
-static char *boxart_thumb_cache_file_path(const char *storage_prefix, const char *key_path) {
-    if (!storage_prefix || !key_path) {
+static boxart_thumb_cache_entry_t *boxart_thumb_cache_find(const char *key_path) {
+    if (!key_path) {
         return NULL;
     }
 
-    path_t *cache_dir = path_init(storage_prefix, BOXART_CACHE_DIR);
-    if (!cache_dir) {
-        return NULL;
+    uint64_t key_hash = fnv1a64_str(key_path);
+    boxart_thumb_cache_entry_t *entry = g_boxart_thumb_cache.buckets[key_hash % BOXART_THUMB_CACHE_BUCKETS];
+    for (; entry; entry = entry->hash_next) {
+        if ((entry->key_hash == key_hash) && (strcmp(entry->key_path, key_path) == 0)) {
+            boxart_thumb_cache_lru_unlink(entry);
+            boxart_thumb_cache_lru_push_front(entry);
+            return entry;
+        }
     }
-    directory_create(path_get(cache_dir));
-
-    uint64_t hash = fnv1a64_str(key_path);
-    char file_name[32];
-    snprintf(file_name, sizeof(file_name), "bx_%016" PRIx64 ".cache", hash);
-    path_push(cache_dir, file_name);
-
-    char *out = strdup(path_get(cache_dir));
-    path_free(cache_dir);
-    return out;
+    return NULL;
 }
 
-static surface_t *boxart_thumb_cache_load_disk_clone(const char *storage_prefix, const char *key_path) {
-    char *cache_path = boxart_thumb_cache_file_path(storage_prefix, key_path);
-    if (!cache_path) {
-        return NULL;
+static boxart_thumb_cache_entry_t *boxart_thumb_cache_acquire(const char *key_path) {
+    boxart_thumb_cache_entry_t *entry = boxart_thumb_cache_find(key_path);
+    if (entry) {
+        entry->refcount++;
+        g_boxart_thumb_cache.stats.hits++;
+    } else {
+        g_boxart_thumb_cache.stats.misses++;
     }
+    return entry;
+}
 
-    FILE *f = fopen(cache_path, "rb");
-    free(cache_path);
-    if (!f) {
-        return NULL;
+static void boxart_thumb_cache_release(boxart_thumb_cache_entry_t *entry) {
+    if (entry && entry->refcount > 0) {
+        entry->refcount--;
+        if (entry->refcount == 0) {
+            boxart_thumb_cache_trim();
+        }
     }
+}
 
-    boxart_cache_metadata_t meta = {0};
-    if (fread(&meta, sizeof(meta), 1, f) != 1) {
-        fclose(f);
+/**
+ * @brief Hand a decoded image to the cache and take a reference to it.
+ *
+ * If another load already cached the same key, @p image is freed and the
+ * existing entry is returned. On failure the caller keeps ownership.
+ */
+static boxart_thumb_cache_entry_t *boxart_thumb_cache_insert(const char *key_path, surface_t *image) {
+    if (!key_path || !image || !image->buffer) {
         return NULL;
     }
 
-    bool invalid = (meta.magic != BOXART_CACHE_MAGIC)
-        || (meta.width == 0) || (meta.height == 0)
-        || (meta.width > BOXART_WIDTH_MAX) || (meta.height > BOXART_HEIGHT_MAX);
-    if (invalid) {
-        fclose(f);
-        return NULL;
+    boxart_thumb_cache_entry_t *entry = boxart_thumb_cache_find(key_path);
+    if (entry) {
+        surface_free_owned(&image);
+        entry->refcount++;
+        return entry;
     }
 
-    surface_t *image = calloc(1, sizeof(surface_t));
-    if (!image) {
-        fclose(f);
+    entry = calloc(1, sizeof(*entry));
+    if (!entry) {
         return NULL;
     }
-    *image = surface_alloc(FMT_RGBA16, meta.width, meta.height);
-    if (!image->buffer || meta.size != (uint32_t)(image->height * image->stride)) {
-        surface_free_owned(&image);
-        fclose(f);
+    entry->key_path = strdup(key_path);
+    if (!entry->key_path) {
+        free(entry);
         return NULL;
     }
+    entry->key_hash = fnv1a64_str(key_path);
+    entry->image = image;
+    entry->bytes = native_image_buffer_size(surface_get_format(image), image->height, image->stride);
+    entry->refcount = 1;
 
-    if (fread(image->buffer, meta.size, 1, f) != 1) {
-        surface_free_owned(&image);
-        fclose(f);
-        return NULL;
-    }
-    fclose(f);
+    boxart_thumb_cache_entry_t **bucket = &g_boxart_thumb_cache.buckets[entry->key_hash % BOXART_THUMB_CACHE_BUCKETS];
+    entry->hash_next = *bucket;
+    *bucket = entry;
+    boxart_thumb_cache_lru_push_front(entry);
+    g_boxart_thumb_cache.bytes += entry->bytes;
+    g_boxart_thumb_cache.stats.entries++;
 
-    // Populate memory cache for subsequent nearby accesses.
-    boxart_thumb_cache_put(key_path, image);
-    return image;
+    boxart_thumb_cache_trim();
+    return entry;
 }
 
-static void boxart_thumb_cache_save_disk(const char *cache_path, surface_t *image) {
-    if (!cache_path || !image || !image->buffer) {
-        return;
-    }
-    if (file_exists((char *)cache_path)) {
-        return; // Conservative SD behavior: write once on cache miss only.
-    }
-
-    size_t path_len = strlen(cache_path);
-    char *tmp_path = malloc(path_len + 5);
-    if (!tmp_path) {
-        return;
-    }
-    memcpy(tmp_path, cache_path, path_len);
-    memcpy(tmp_path + path_len, ".tmp", 5);
-
-    FILE *f = fopen(tmp_path, "wb");
-    if (!f) {
-        free(tmp_path);
-        return;
-    }
-
-    boxart_cache_metadata_t meta = {
-        .magic = BOXART_CACHE_MAGIC,
-        .width = image->width,
-        .height = image->height,
-        .size = (uint32_t)(image->height * image->stride),
-    };
-    bool ok = (fwrite(&meta, sizeof(meta), 1, f) == 1) &&
-              (fwrite(image->buffer, meta.size, 1, f) == 1);
-
-    if (fclose(f) != 0) {
-        ok = false;
-    }
+static void boxart_attach_entry(component_boxart_t *b, boxart_thumb_cache_entry_t *entry) {
+    b->cache_entry = entry;
+    b->image = entry->image;
+}
 
-    if (ok) {
-        file_rename(tmp_path, cache_path);
+// Give a freshly loaded image to the component, shared through the cache when possible.
+static void boxart_attach_image(component_boxart_t *b, const char *key_path, surface_t *image) {
+    boxart_thumb_cache_entry_t *entry = boxart_thumb_cache_insert(key_path, image);
+    if (entry) {
+        boxart_attach_entry(b, entry);
     } else {
-        remove(tmp_path);
+        b->cache_entry = NULL;
+        b->image = image;
     }
-    free(tmp_path);
 }
 
 static void boxart_load_context_free(boxart_load_context_t *ctx) {
@@ -338,124 +283,9 @@ static void boxart_load_context_free(boxart_load_context_t *ctx) {
         return;
     }
     free(ctx->cache_key);
-    free(ctx->cache_path);
     free(ctx);
 }
 
-static bool boxart_queue_remove(boxart_load_context_t *ctx) {
-    if (!ctx) {
-        return false;
-    }
-    for (int i = 0; i < g_boxart_load_queue_count; i++) {
-        if (g_boxart_load_queue[i] != ctx) {
-            continue;
-        }
-        for (int j = i; j < (g_boxart_load_queue_count - 1); j++) {
-            g_boxart_load_queue[j] = g_boxart_load_queue[j + 1];
-        }
-        g_boxart_load_queue[g_boxart_load_queue_count - 1] = NULL;
-        g_boxart_load_queue_count--;
-        return true;
-    }
-    return false;
-}
-
-static bool boxart_queue_enqueue(boxart_load_context_t *ctx) {
-    if (!ctx) {
-        return false;
-    }
-    if (g_boxart_load_queue_count >= BOXART_LOAD_QUEUE_MAX) {
-        return false;
-    }
-
-    // Avoid duplicate queue entries for the same context.
-    for (int i = 0; i < g_boxart_load_queue_count; i++) {
-        if (g_boxart_load_queue[i] == ctx) {
-            return true;
-        }
-    }
-
-    g_boxart_load_queue[g_boxart_load_queue_count++] = ctx;
-    return true;
-}
-
-static void boxart_complete_context_with_image(boxart_load_context_t *ctx, surface_t *image) {
-    if (!ctx || !ctx->component) {
-        if (image) {
-            surface_free(image);
-            free(image);
-        }
-        boxart_load_context_free(ctx);
-        return;
-    }
-
-    component_boxart_t *b = ctx->component;
-    b->loading = false;
-    b->load_context = NULL;
-    b->image = image;
-    boxart_load_context_free(ctx);
-}
-
-static void boxart_queue_pump(void) {
-    if (g_boxart_active_load_ctx != NULL || png_decoder_is_busy()) {
-        return;
-    }
-
-    while (g_boxart_load_queue_count > 0) {
-        boxart_load_context_t *ctx = g_boxart_load_queue[0];
-        for (int i = 1; i < g_boxart_load_queue_count; i++) {
-            g_boxart_load_queue[i - 1] = g_boxart_load_queue[i];
-        }
-        g_boxart_load_queue[--g_boxart_load_queue_count] = NULL;
-
-        if (!ctx) {
-            continue;
-        }
-
-        if (!ctx->component) {
-            boxart_load_context_free(ctx);
-            continue;
-        }
-
-        // Queue is FIFO and conservative; if decoder unexpectedly busy, put it back at head and stop.
-        if (png_decoder_is_busy()) {
-            boxart_queue_enqueue(ctx);
-            break;
-        }
-
-        // Try memory cache only (no SD I/O during draw).
-        surface_t *cached = boxart_thumb_cache_get_clone(ctx->cache_key);
-        if (cached) {
-            boxart_complete_context_with_image(ctx, cached);
-            continue;
-        }
-
-        surface_t *native = NULL;
-        if (string_ends_with(ctx->cache_key, BOXART_NATIVE_SIDECAR)) {
-            native = native_image_load_rgba16_file(ctx->cache_key, BOXART_WIDTH_MAX, BOXART_HEIGHT_MAX);
-        } else {
-            native = native_image_load_sidecar_rgba16(ctx->cache_key, BOXART_NATIVE_SIDECAR, BOXART_WIDTH_MAX, BOXART_HEIGHT_MAX);
-        }
-        if (native) {
-            boxart_thumb_cache_put(ctx->cache_key, native);
-            boxart_complete_context_with_image(ctx, native);
-            continue;
-        }
-
-        if (png_decoder_start(ctx->cache_key, BOXART_WIDTH_MAX, BOXART_HEIGHT_MAX, png_decoder_callback, ctx) == PNG_OK) {
-            g_boxart_active_load_ctx = ctx;
-            break;
-        }
-
-        // If decode could not start (eg. transient), fail closed for this component rather than wedging queue.
-        if (ctx->component) {
-            ctx->component->loading = false;
-            ctx->component->load_context = NULL;
-        }
-        boxart_load_context_free(ctx);
-    }
-}
-
 static bool resolve_metadata_boxart_directory (path_t *path, const char *game_code, char *resolved_path, size_t resolved_path_size) {
     if ((path == NULL) || (game_code == NULL)) {
         return false;
@@ -466,7 +296,7 @@ static bool resolve_metadata_boxart_directory (path_t *path, const char *game_co
     // 1) exact region match
     snprintf(candidate, sizeof(candidate), "%c/%c/%c/%c", game_code[0], game_code[1], game_code[2], game_code[3]);
     path_push(path, candidate);
-    if (directory_exists(path_get(path))) {
+    if (metadata_index_directory_exists(path_get(path))) {
         if ((resolved_path != NULL) && (resolved_path_size > 0)) {
             snprintf(resolved_path, resolved_path_size, "%s", candidate);
         }
@@ -482,7 +312,7 @@ static bool resolve_metadata_boxart_directory (path_t *path, const char *game_co
         }
         snprintf(candidate, sizeof(candidate), "%c/%c/%c/%c", game_code[0], game_code[1], game_code[2], fallback_regions[i]);
         path_push(path, candidate);
-        if (directory_exists(path_get(path))) {
+        if (metadata_index_directory_exists(path_get(path))) {
             if ((resolved_path != NULL) && (resolved_path_size > 0)) {
                 snprintf(resolved_path, resolved_path_size, "%s", candidate);
             }
@@ -494,7 +324,7 @@ static bool resolve_metadata_boxart_directory (path_t *path, const char *game_co
     // 3) region-agnostic metadata directory
     snprintf(candidate, sizeof(candidate), "%c/%c/%c", game_code[0], game_code[1], game_code[2]);
     path_push(path, candidate);
-    if (directory_exists(path_get(path))) {
+    if (metadata_index_directory_exists(path_get(path))) {
         if ((resolved_path != NULL) && (resolved_path_size > 0)) {
             snprintf(resolved_path, resolved_path_size, "%s", candidate);
         }
@@ -525,7 +355,7 @@ static bool resolve_boxart_directory(const char *storage_prefix, const char *gam
         char boxart_path[48];
         snprintf(boxart_path, sizeof(boxart_path), HOMEBREW_ID_SUBDIRECTORY"/%s", safe_title);
         path_push(path, boxart_path);
-        if (directory_exists(path_get(path))) {
+        if (metadata_index_directory_exists(path_get(path))) {
             *path_out = path;
             return true;
         }
@@ -562,7 +392,7 @@ static bool resolve_boxart_directory(const char *storage_prefix, const char *gam
         }
     }
 
-    if (dir_found && !directory_exists(path_get(path))) {
+    if (dir_found && !metadata_index_directory_exists(path_get(path))) {
         dir_found = false;
     }
 
@@ -603,7 +433,7 @@ static bool resolve_boxart_image_path(const char *storage_prefix, const char *ga
     }
 
     bool found = false;
-    if (file_exists(path_get(path)) || native_image_sidecar_exists(path_get(path), BOXART_NATIVE_SIDECAR)) {
+    if (metadata_index_path_exists(path_get(path)) || native_image_sidecar_exists(path_get(path), BOXART_NATIVE_SIDECAR)) {
         *resolved_image_path_out = strdup(path_get(path));
         found = (*resolved_image_path_out != NULL);
     }
@@ -624,9 +454,6 @@ static bool resolve_boxart_image_path(const char *storage_prefix, const char *ga
 static void png_decoder_callback(png_err_t err, surface_t *decoded_image, void *callback_data) {
     boxart_load_context_t *ctx = (boxart_load_context_t *)callback_data;
     component_boxart_t *b = ctx ? ctx->component : NULL;
-    if (g_boxart_active_load_ctx == ctx) {
-        g_boxart_active_load_ctx = NULL;
-    }
     if (!b) {
         if (decoded_image) {
             surface_free(decoded_image);
@@ -639,27 +466,30 @@ static void png_decoder_callback(png_err_t err, surface_t *decoded_image, void *
     b->load_context = NULL;
 
     if (err == PNG_OK && decoded_image != NULL) {
-        if (ctx->cache_key) {
-            boxart_thumb_cache_put(ctx->cache_key, decoded_image);
-        }
-        if (ctx->cache_path) {
-            boxart_thumb_cache_save_disk(ctx->cache_path, decoded_image);
-        }
-        b->image = surface_clone_rgba16(decoded_image);
-        if (!b->image) {
-            b->image = decoded_image;
-            decoded_image = NULL;
+        // Native sidecars are already stored on the SD card, only decoded PNGs go into the pack.
+        if (ctx->cache_key && !ctx->native_served) {
+            thumb_store_save(ctx->cache_key, decoded_image);
         }
+        boxart_attach_image(b, ctx->cache_key, decoded_image);
     } else {
         b->image = NULL;
+        surface_free_owned(&decoded_image);
     }
 
-    if (decoded_image) {
-        surface_free(decoded_image);
-        free(decoded_image);
-    }
     boxart_load_context_free(ctx);
-    boxart_queue_pump();
+}
+
+static char *boxart_cache_key_create(const char *image_path, int target_width, int target_height) {
+    if (target_width <= 0 || target_height <= 0) {
+        return strdup(image_path);
+    }
+    // Downscaled decodes get their own memory and disk cache entries.
+    size_t key_size = strlen(image_path) + 24;
+    char *key = malloc(key_size);
+    if (key) {
+        snprintf(key, key_size, "%s#%dx%d", image_path, target_width, target_height);
+    }
+    return key;
 }
 
 /**
@@ -671,12 +501,13 @@ static void png_decoder_callback(png_err_t err, surface_t *decoded_image, void *
  * @param game_code The 4-character game code.
  * @param rom_title Title of the ROM (may be NULL). If used, it is sanitized for filesystem safety.
  * @param current_image_view The current image view type (front, back, etc.).
+ * @param target_width Load PNGs and native sidecars downscaled to fit this width, 0 for full size.
+ * @param target_height Load PNGs and native sidecars downscaled to fit this height, 0 for full size.
  * @return Pointer to the initialized boxart component, or NULL on failure.
  */
 static component_boxart_t *ui_components_boxart_init_with_options(const char *storage_prefix, const char *game_code, const char *rom_title,
-                                                                  file_image_type_t current_image_view, bool memory_cache_only, bool async_only) {
-    boxart_queue_pump();
-
+                                                                  file_image_type_t current_image_view, bool memory_cache_only, bool async_only,
+                                                                  int target_width, int target_height) {
     component_boxart_t *b = calloc(1, sizeof(component_boxart_t));
     if (b == NULL) {
         return NULL;
@@ -688,62 +519,79 @@ static component_boxart_t *ui_components_boxart_init_with_options(const char *st
         return NULL;
     }
 
-    b->image = boxart_thumb_cache_get_clone(resolved_image_path);
-    if (b->image) {
-        b->loading = false;
+    char *cache_key = boxart_cache_key_create(resolved_image_path, target_width, target_height);
+    if (!cache_key) {
         free(resolved_image_path);
-        return b;
+        free(b);
+        return NULL;
     }
 
-    if (memory_cache_only) {
+    boxart_thumb_cache_entry_t *cached = boxart_thumb_cache_acquire(cache_key);
+    if (cached) {
+        boxart_attach_entry(b, cached);
+    }
+    if (b->image || memory_cache_only) {
+        b->loading = false;
         free(resolved_image_path);
-        free(b);
-        return NULL;
+        free(cache_key);
+        if (!b->image) {
+            free(b);
+            return NULL;
+        }
+        return b;
     }
 
+    surface_t *native = NULL;
     if (!async_only) {
-        surface_t *native = NULL;
         if (string_ends_with(resolved_image_path, BOXART_NATIVE_SIDECAR)) {
-            native = native_image_load_rgba16_file(resolved_image_path, BOXART_WIDTH_MAX, BOXART_HEIGHT_MAX);
+            native = native_image_load_file_fitted(resolved_image_path, BOXART_WIDTH_MAX, BOXART_HEIGHT_MAX,
+                target_width, target_height, NATIVE_IMAGE_LOAD_PALETTE);
         } else {
-            native = native_image_load_sidecar_rgba16(resolved_image_path, BOXART_NATIVE_SIDECAR, BOXART_WIDTH_MAX, BOXART_HEIGHT_MAX);
-        }
-        if (native) {
-            boxart_thumb_cache_put(resolved_image_path, native);
-            b->image = native;
-            b->loading = false;
-            free(resolved_image_path);
-            return b;
-        }
-
-        b->image = boxart_thumb_cache_load_disk_clone(storage_prefix, resolved_image_path);
-        if (b->image) {
-            b->loading = false;
-            free(resolved_image_path);
-            return b;
+            native = native_image_load_sidecar_fitted(resolved_image_path, BOXART_NATIVE_SIDECAR, BOXART_WIDTH_MAX, BOXART_HEIGHT_MAX,
+                target_width, target_height, NATIVE_IMAGE_LOAD_PALETTE);
         }
     }
+    // Async loads check the pack too: a hit is one read, where the job would decode the PNG again.
+    if (!native) {
+        native = thumb_store_load(cache_key, BOXART_WIDTH_MAX, BOXART_HEIGHT_MAX);
+    }
+    if (native) {
+        boxart_attach_image(b, cache_key, native);
+        b->loading = false;
+        free(resolved_image_path);
+        free(cache_key);
+        return b;
+    }
 
     boxart_load_context_t *ctx = calloc(1, sizeof(*ctx));
     if (!ctx) {
         free(resolved_image_path);
+        free(cache_key);
         free(b);
         return NULL;
     }
     ctx->component = b;
-    ctx->cache_key = resolved_image_path;
-    ctx->cache_path = boxart_thumb_cache_file_path(storage_prefix, resolved_image_path);
+    ctx->cache_key = cache_key;
 
     b->loading = true;
     b->load_context = ctx;
 
-    if (!png_decoder_is_busy() &&
-        png_decoder_start(ctx->cache_key, BOXART_WIDTH_MAX, BOXART_HEIGHT_MAX, png_decoder_callback, ctx) == PNG_OK) {
-        g_boxart_active_load_ctx = ctx;
-        return b;
-    }
-
-    if (boxart_queue_enqueue(ctx)) {
+    // The native sidecar is tried when the job starts, so async loads don't probe for it here.
+    png_decoder_job_desc_t desc = {
+        .max_width = BOXART_WIDTH_MAX,
+        .max_height = BOXART_HEIGHT_MAX,
+        .target_width = target_width,
+        .target_height = target_height,
+        .priority = PNG_DECODER_PRIORITY_VISIBLE,
+        .native_sidecar = BOXART_NATIVE_SIDECAR,
+        .native_load_flags = NATIVE_IMAGE_LOAD_PALETTE,
+        .native_served = &ctx->native_served,
+        .callback = png_decoder_callback,
+        .callback_data = ctx,
+    };
+    png_err_t err = png_decoder_submit(resolved_image_path, &desc, &ctx->job);
+    free(resolved_image_path);
+    if (err == PNG_OK) {
         return b;
     }
 
@@ -755,23 +603,23 @@ static component_boxart_t *ui_components_boxart_init_with_options(const char *st
 }
 
 component_boxart_t *ui_components_boxart_init(const char *storage_prefix, const char *game_code, const char *rom_title, file_image_type_t current_image_view) {
-    return ui_components_boxart_init_with_options(storage_prefix, game_code, rom_title, current_image_view, false, false);
+    return ui_components_boxart_init_with_options(storage_prefix, game_code, rom_title, current_image_view, false, false, 0, 0);
 }
 
 component_boxart_t *ui_components_boxart_init_async(const char *storage_prefix, const char *game_code, const char *rom_title, file_image_type_t current_image_view) {
-    return ui_components_boxart_init_with_options(storage_prefix, game_code, rom_title, current_image_view, false, true);
+    return ui_components_boxart_init_with_options(storage_prefix, game_code, rom_title, current_image_view, false, true, 0, 0);
 }
 
 component_boxart_t *ui_components_boxart_init_memory_cached(const char *storage_prefix, const char *game_code, const char *rom_title, file_image_type_t current_image_view) {
-    return ui_components_boxart_init_with_options(storage_prefix, game_code, rom_title, current_image_view, true, false);
+    return ui_components_boxart_init_with_options(storage_prefix, game_code, rom_title, current_image_view, true, false, 0, 0);
 }
 
-component_boxart_t *ui_components_boxart_init_grid(const char *storage_prefix, const char *game_code, const char *rom_title) {
-    return ui_components_boxart_init_with_options(storage_prefix, game_code, rom_title, IMAGE_BOXART_FRONT, false, false);
+component_boxart_t *ui_components_boxart_init_grid(const char *storage_prefix, const char *game_code, const char *rom_title, int cell_width, int cell_height) {
+    return ui_components_boxart_init_with_options(storage_prefix, game_code, rom_title, IMAGE_BOXART_FRONT, false, false, cell_width, cell_height);
 }
 
-component_boxart_t *ui_components_boxart_init_grid_memory_cached(const char *storage_prefix, const char *game_code, const char *rom_title) {
-    return ui_components_boxart_init_with_options(storage_prefix, game_code, rom_title, IMAGE_BOXART_FRONT, true, false);
+component_boxart_t *ui_components_boxart_init_grid_memory_cached(const char *storage_prefix, const char *game_code, const char *rom_title, int cell_width, int cell_height) {
+    return ui_components_boxart_init_with_options(storage_prefix, game_code, rom_title, IMAGE_BOXART_FRONT, true, false, cell_width, cell_height);
 }
 
 void ui_components_boxart_prewarm_dir(const char *storage_prefix, const char *game_code, const char *rom_title) {
@@ -780,6 +628,17 @@ void ui_components_boxart_prewarm_dir(const char *storage_prefix, const char *ga
     path_free(path);
 }
 
+void ui_components_boxart_cache_get_stats(boxart_cache_stats_t *stats) {
+    *stats = g_boxart_thumb_cache.stats;
+    stats->bytes = g_boxart_thumb_cache.bytes;
+    stats->budget_bytes = boxart_thumb_cache_budget();
+}
+
+void ui_components_boxart_cache_set_budget(size_t budget_bytes) {
+    g_boxart_thumb_cache.budget = budget_bytes;
+    boxart_thumb_cache_trim();
+}
+
 /**
  * @brief Free the boxart component and its resources.
  *
@@ -789,21 +648,18 @@ void ui_components_boxart_free(component_boxart_t *b) {
     if (b) {
         if (b->loading) {
             boxart_load_context_t *ctx = (boxart_load_context_t *)b->load_context;
-            if (ctx != NULL && g_boxart_active_load_ctx == ctx) {
-                g_boxart_active_load_ctx = NULL;
-                png_decoder_abort();
-            } else if (ctx != NULL) {
-                boxart_queue_remove(ctx);
+            if (ctx != NULL) {
+                png_decoder_cancel(ctx->job);
             }
             boxart_load_context_free(ctx);
             b->load_context = NULL;
         }
-        if (b->image) {
-            surface_free(b->image);
-            free(b->image);
+        if (b->cache_entry) {
+            boxart_thumb_cache_release((boxart_thumb_cache_entry_t *)b->cache_entry);
+        } else {
+            surface_free_owned(&b->image);
         }
         free(b);
-        boxart_queue_pump();
     }
 }
 
@@ -815,13 +671,12 @@ void ui_components_boxart_free(component_boxart_t *b) {
  * @param b Pointer to the boxart component.
  */
 void ui_components_boxart_draw(component_boxart_t *b) {
-    boxart_queue_pump();
-
     int box_x = BOXART_X;
     int box_y = BOXART_Y;
     if (b && b->image && b->image->width <= BOXART_WIDTH_MAX && b->image->height <= BOXART_HEIGHT_MAX) {
         rdpq_mode_push();
             rdpq_set_mode_copy(false);
+            native_image_tlut_setup(b->image);
             if (b->image->height == BOXART_HEIGHT_MAX) {
                 box_x = BOXART_X_JP;
                 box_y = BOXART_Y_JP;
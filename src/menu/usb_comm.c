@@ -13,6 +13,7 @@
 
 #include <usb.h>
 
+#include "metadata_index.h"
 #include "usb_comm.h"
 #include "utils/utils.h"
 
@@ -151,6 +152,8 @@ static void command_receive_file (menu_t *menu) {
         return usb_comm_send_error("Couldn't flush data to the file\n");
     }
 
+    metadata_index_invalidate();
+
     if (usb_comm_get_char() != '\0') {
         return usb_comm_send_error("Invalid token at the end of data stream\n");
     }
@@ -0,0 +1,591 @@
+/**
+ * @file vcdiff_patch.c
+ * @brief Streaming VCDIFF (xdelta3) patch decoder
+ * @ingroup menu
+ *
+ * Implements RFC 3284 with the default code table, plus the Adler-32 window
+ * checksum xdelta3 adds. Sections are read through small buffers straight
+ * from the patch file, so memory use doesn't depend on the window size.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libdragon.h>
+#include <miniz.h>
+
+#include "vcdiff_patch.h"
+#include "utils/utils.h"
+
+#define VCDIFF_SECTION_BUFFER_SIZE  (4 * 1024)
+
+#define VCD_DECOMPRESS  (0x01)
+#define VCD_CODETABLE   (0x02)
+#define VCD_APPHEADER   (0x04)
+
+#define VCD_SOURCE      (0x01)
+#define VCD_TARGET      (0x02)
+#define VCD_ADLER32     (0x04)
+
+#define VCDIFF_NEAR_SIZE    (4)
+#define VCDIFF_SAME_SIZE    (3)
+
+typedef enum {
+    VCDIFF_NOOP,
+    VCDIFF_ADD,
+    VCDIFF_RUN,
+    VCDIFF_COPY,
+} vcdiff_inst_type_t;
+
+typedef struct {
+    uint8_t type;
+    uint8_t size;
+    uint8_t mode;
+} vcdiff_inst_t;
+
+typedef struct {
+    vcdiff_inst_t inst[2];
+} vcdiff_code_t;
+
+typedef struct {
+    uint32_t position;
+    uint32_t end;
+    uint8_t buffer[VCDIFF_SECTION_BUFFER_SIZE];
+    uint32_t buffer_offset;
+    uint32_t buffer_length;
+} vcdiff_section_t;
+
+struct vcdiff_patch_s {
+    FILE *patch;
+    uint32_t patch_size;
+    uint32_t first_window;
+    uint32_t next_window;
+
+    patch_source_t source;
+    patch_target_reader_t *target_reader;
+    void *target_context;
+
+    uint32_t target_size;
+    uint32_t output_offset;
+
+    bool in_window;
+    uint8_t win_indicator;
+    uint32_t segment_size;
+    uint32_t segment_position;
+    uint32_t window_start;
+    uint32_t window_length;
+    uint32_t window_produced;
+    uint32_t checksum;
+    uint32_t adler;
+    vcdiff_section_t data;
+    vcdiff_section_t inst;
+    vcdiff_section_t addr;
+    uint32_t near[VCDIFF_NEAR_SIZE];
+    int next_slot;
+    uint32_t same[VCDIFF_SAME_SIZE * 256];
+
+    uint8_t type;
+    uint32_t remaining;
+    uint32_t address;
+    uint8_t run_byte;
+    bool has_pending;
+    vcdiff_inst_t pending;
+    bool error;
+};
+
+static vcdiff_code_t code_table[256];
+static bool code_table_ready = false;
+
+// RFC 3284 section 5.6.
+static void build_code_table(void) {
+    int i = 0;
+    code_table[i++] = (vcdiff_code_t) { { { VCDIFF_RUN, 0, 0 }, { VCDIFF_NOOP, 0, 0 } } };
+    for (int size = 0; size <= 17; size++) {
+        code_table[i++] = (vcdiff_code_t) { { { VCDIFF_ADD, size, 0 }, { VCDIFF_NOOP, 0, 0 } } };
+    }
+    for (int mode = 0; mode <= 8; mode++) {
+        code_table[i++] = (vcdiff_code_t) { { { VCDIFF_COPY, 0, mode }, { VCDIFF_NOOP, 0, 0 } } };
+        for (int size = 4; size <= 18; size++) {
+            code_table[i++] = (vcdiff_code_t) { { { VCDIFF_COPY, size, mode }, { VCDIFF_NOOP, 0, 0 } } };
+        }
+    }
+    for (int mode = 0; mode <= 5; mode++) {
+        for (int add_size = 1; add_size <= 4; add_size++) {
+            for (int copy_size = 4; copy_size <= 6; copy_size++) {
+                code_table[i++] = (vcdiff_code_t) { { { VCDIFF_ADD, add_size, 0 }, { VCDIFF_COPY, copy_size, mode } } };
+            }
+        }
+    }
+    for (int mode = 6; mode <= 8; mode++) {
+        for (int add_size = 1; add_size <= 4; add_size++) {
+            code_table[i++] = (vcdiff_code_t) { { { VCDIFF_ADD, add_size, 0 }, { VCDIFF_COPY, 4, mode } } };
+        }
+    }
+    for (int mode = 0; mode <= 8; mode++) {
+        code_table[i++] = (vcdiff_code_t) { { { VCDIFF_COPY, 4, mode }, { VCDIFF_ADD, 1, 0 } } };
+    }
+    code_table_ready = true;
+}
+
+static void section_init(vcdiff_section_t *section, uint32_t position, uint32_t length) {
+    section->position = position;
+    section->end = position + length;
+    section->buffer_offset = position;
+    section->buffer_length = 0;
+}
+
+static bool section_read(vcdiff_patch_t *vcdiff, vcdiff_section_t *section, uint8_t *data, size_t length) {
+    if (length > section->end - section->position) {
+        return false;
+    }
+    while (length > 0) {
+        if (section->position == section->buffer_offset + section->buffer_length) {
+            size_t n = MIN((size_t)(section->end - section->position), (size_t)VCDIFF_SECTION_BUFFER_SIZE);
+            if (fseek(vcdiff->patch, (long)section->position, SEEK_SET) != 0 || fread(section->buffer, 1, n, vcdiff->patch) != n) {
+                return false;
+            }
+            section->buffer_offset = section->position;
+            section->buffer_length = (uint32_t)n;
+        }
+        uint32_t index = section->position - section->buffer_offset;
+        size_t n = MIN(length, (size_t)(section->buffer_length - index));
+        memcpy(data, section->buffer + index, n);
+        section->position += (uint32_t)n;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+static bool section_read_byte(vcdiff_patch_t *vcdiff, vcdiff_section_t *section, uint8_t *value) {
+    return section_read(vcdiff, section, value, 1);
+}
+
+static bool section_read_int(vcdiff_patch_t *vcdiff, vcdiff_section_t *section, uint32_t *value) {
+    uint64_t result = 0;
+    for (int i = 0; i < 5; i++) {
+        uint8_t x;
+        if (!section_read_byte(vcdiff, section, &x)) {
+            return false;
+        }
+        result = (result << 7) | (x & 0x7F);
+        if (!(x & 0x80)) {
+            if (result > UINT32_MAX) {
+                return false;
+            }
+            *value = (uint32_t)result;
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool read_window_header(vcdiff_patch_t *vcdiff, vcdiff_section_t *header) {
+    uint8_t delta_indicator;
+    uint32_t delta_length;
+    uint32_t data_length;
+    uint32_t inst_length;
+    uint32_t addr_length;
+
+    vcdiff->segment_size = 0;
+    vcdiff->segment_position = 0;
+    vcdiff->checksum = 0;
+
+    if (!section_read_byte(vcdiff, header, &vcdiff->win_indicator)) {
+        return false;
+    }
+    if ((vcdiff->win_indicator & VCD_SOURCE) && (vcdiff->win_indicator & VCD_TARGET)) {
+        return false;
+    }
+    if (vcdiff->win_indicator & (VCD_SOURCE | VCD_TARGET)) {
+        if (!section_read_int(vcdiff, header, &vcdiff->segment_size) || !section_read_int(vcdiff, header, &vcdiff->segment_position)) {
+            return false;
+        }
+    }
+    if (!section_read_int(vcdiff, header, &delta_length)) {
+        return false;
+    }
+    uint32_t delta_start = header->position;
+    if (
+        delta_length > vcdiff->patch_size - delta_start ||
+        !section_read_int(vcdiff, header, &vcdiff->window_length) ||
+        !section_read_byte(vcdiff, header, &delta_indicator) ||
+        !section_read_int(vcdiff, header, &data_length) ||
+        !section_read_int(vcdiff, header, &inst_length) ||
+        !section_read_int(vcdiff, header, &addr_length)
+    ) {
+        return false;
+    }
+    if (delta_indicator != 0) {
+        debugf("VCDIFF patch: compressed sections are not supported, create the patch with -S none\n");
+        return false;
+    }
+    if (vcdiff->win_indicator & VCD_ADLER32) {
+        uint8_t checksum[4];
+        if (!section_read(vcdiff, header, checksum, sizeof(checksum))) {
+            return false;
+        }
+        vcdiff->checksum = ((uint32_t)checksum[0] << 24) | ((uint32_t)checksum[1] << 16) | ((uint32_t)checksum[2] << 8) | checksum[3];
+    }
+
+    uint32_t sections = header->position;
+    uint64_t sections_end = (uint64_t)sections + data_length + inst_length + addr_length;
+    if (sections_end != (uint64_t)delta_start + delta_length) {
+        return false;
+    }
+    section_init(&vcdiff->data, sections, data_length);
+    section_init(&vcdiff->inst, sections + data_length, inst_length);
+    section_init(&vcdiff->addr, sections + data_length + inst_length, addr_length);
+    vcdiff->next_window = (uint32_t)sections_end;
+    return true;
+}
+
+static bool window_begin(vcdiff_patch_t *vcdiff) {
+    vcdiff_section_t *header = &vcdiff->data;
+    section_init(header, vcdiff->next_window, vcdiff->patch_size - vcdiff->next_window);
+    if (!read_window_header(vcdiff, header)) {
+        return false;
+    }
+    if (vcdiff->window_length > vcdiff->target_size - vcdiff->output_offset) {
+        return false;
+    }
+    if (vcdiff->win_indicator & VCD_TARGET) {
+        if ((uint64_t)vcdiff->segment_position + vcdiff->segment_size > vcdiff->output_offset) {
+            return false;
+        }
+    } else if (vcdiff->win_indicator & VCD_SOURCE) {
+        if ((uint64_t)vcdiff->segment_position + vcdiff->segment_size > vcdiff->source.size) {
+            return false;
+        }
+    }
+
+    vcdiff->in_window = true;
+    vcdiff->window_start = vcdiff->output_offset;
+    vcdiff->window_produced = 0;
+    vcdiff->adler = MZ_ADLER32_INIT;
+    memset(vcdiff->near, 0, sizeof(vcdiff->near));
+    memset(vcdiff->same, 0, sizeof(vcdiff->same));
+    vcdiff->next_slot = 0;
+    vcdiff->remaining = 0;
+    vcdiff->has_pending = false;
+    return true;
+}
+
+static bool window_end(vcdiff_patch_t *vcdiff) {
+    vcdiff->in_window = false;
+    if (
+        vcdiff->remaining != 0 ||
+        vcdiff->has_pending ||
+        vcdiff->data.position != vcdiff->data.end ||
+        vcdiff->inst.position != vcdiff->inst.end ||
+        vcdiff->addr.position != vcdiff->addr.end
+    ) {
+        debugf("VCDIFF patch: window at %lu doesn't add up\n", (unsigned long)vcdiff->window_start);
+        return false;
+    }
+    if ((vcdiff->win_indicator & VCD_ADLER32) && vcdiff->adler != vcdiff->checksum) {
+        debugf("VCDIFF patch: adler32 mismatch in window at %lu\n", (unsigned long)vcdiff->window_start);
+        return false;
+    }
+    return true;
+}
+
+static bool decode_address(vcdiff_patch_t *vcdiff, uint8_t mode, uint32_t *address) {
+    uint32_t here = vcdiff->segment_size + vcdiff->window_produced;
+    uint32_t value;
+    uint32_t result;
+
+    if (mode == 0) {
+        if (!section_read_int(vcdiff, &vcdiff->addr, &value)) {
+            return false;
+        }
+        result = value;
+    } else if (mode == 1) {
+        if (!section_read_int(vcdiff, &vcdiff->addr, &value) || value > here) {
+            return false;
+        }
+        result = here - value;
+    } else if (mode < 2 + VCDIFF_NEAR_SIZE) {
+        if (!section_read_int(vcdiff, &vcdiff->addr, &value)) {
+            return false;
+        }
+        result = vcdiff->near[mode - 2] + value;
+    } else if (mode < 2 + VCDIFF_NEAR_SIZE + VCDIFF_SAME_SIZE) {
+        uint8_t index;
+        if (!section_read_byte(vcdiff, &vcdiff->addr, &index)) {
+            return false;
+        }
+        result = vcdiff->same[(mode - (2 + VCDIFF_NEAR_SIZE)) * 256 + index];
+    } else {
+        return false;
+    }
+
+    vcdiff->near[vcdiff->next_slot] = result;
+    vcdiff->next_slot = (vcdiff->next_slot + 1) % VCDIFF_NEAR_SIZE;
+    vcdiff->same[result % (VCDIFF_SAME_SIZE * 256)] = result;
+
+    if (result >= here) {
+        return false;
+    }
+    *address = result;
+    return true;
+}
+
+static bool start_instruction(vcdiff_patch_t *vcdiff, vcdiff_inst_t inst) {
+    uint32_t size = inst.size;
+    if (size == 0 && !section_read_int(vcdiff, &vcdiff->inst, &size)) {
+        return false;
+    }
+    if (size > vcdiff->window_length - vcdiff->window_produced) {
+        return false;
+    }
+    vcdiff->type = inst.type;
+    vcdiff->remaining = size;
+
+    switch (inst.type) {
+        case VCDIFF_RUN:
+            return section_read_byte(vcdiff, &vcdiff->data, &vcdiff->run_byte);
+        case VCDIFF_COPY:
+            return decode_address(vcdiff, inst.mode, &vcdiff->address);
+        default:
+            return true;
+    }
+}
+
+static bool next_instruction(vcdiff_patch_t *vcdiff) {
+    if (vcdiff->has_pending) {
+        vcdiff->has_pending = false;
+        return start_instruction(vcdiff, vcdiff->pending);
+    }
+
+    uint8_t opcode;
+    if (!section_read_byte(vcdiff, &vcdiff->inst, &opcode)) {
+        return false;
+    }
+    const vcdiff_code_t *code = &code_table[opcode];
+    if (code->inst[1].type != VCDIFF_NOOP) {
+        vcdiff->pending = code->inst[1];
+        vcdiff->has_pending = true;
+    }
+    if (code->inst[0].type == VCDIFF_NOOP) {
+        vcdiff->remaining = 0;
+        return true;
+    }
+    return start_instruction(vcdiff, code->inst[0]);
+}
+
+// Copies can overlap their own output (runs), so bytes produced by this call are copied one at a time.
+static bool copy(vcdiff_patch_t *vcdiff, uint8_t *buffer, uint32_t start, size_t produced, size_t length) {
+    while (length > 0) {
+        size_t n;
+        bool in_segment = (vcdiff->address < vcdiff->segment_size);
+        if (in_segment && !(vcdiff->win_indicator & VCD_TARGET)) {
+            n = MIN(length, (size_t)(vcdiff->segment_size - vcdiff->address));
+            if (!patch_source_read(&vcdiff->source, vcdiff->segment_position + vcdiff->address, buffer + produced, n)) {
+                return false;
+            }
+        } else {
+            // Target segments and the window itself are both earlier target data, possibly from this call.
+            uint32_t from;
+            size_t limit;
+            if (in_segment) {
+                from = vcdiff->segment_position + vcdiff->address;
+                limit = vcdiff->segment_size - vcdiff->address;
+            } else {
+                from = vcdiff->window_start + (vcdiff->address - vcdiff->segment_size);
+                limit = length;
+            }
+            if (from < start) {
+                n = MIN(MIN(length, limit), (size_t)(start - from));
+                if (!vcdiff->target_reader || !vcdiff->target_reader(vcdiff->target_context, from, buffer + produced, n)) {
+                    return false;
+                }
+            } else {
+                n = MIN(length, limit);
+                uint8_t *src = buffer + (from - start);
+                uint8_t *dst = buffer + produced;
+                for (size_t i = 0; i < n; i++) {
+                    dst[i] = src[i];
+                }
+            }
+        }
+        vcdiff->address += (uint32_t)n;
+        produced += n;
+        length -= n;
+    }
+    return true;
+}
+
+vcdiff_patch_t *vcdiff_patch_open(const char *patch_path, const char *source_path, rom_endianness_t endianness) {
+    if (!code_table_ready) {
+        build_code_table();
+    }
+
+    vcdiff_patch_t *vcdiff = calloc(1, sizeof(vcdiff_patch_t));
+    if (!vcdiff) {
+        return NULL;
+    }
+
+    vcdiff->patch = fopen(patch_path, "rb");
+    if (!vcdiff->patch || !patch_source_open(&vcdiff->source, source_path, endianness)) {
+        vcdiff_patch_close(vcdiff);
+        return NULL;
+    }
+    long patch_size;
+    if (fseek(vcdiff->patch, 0, SEEK_END) != 0 || (patch_size = ftell(vcdiff->patch)) < 5) {
+        vcdiff_patch_close(vcdiff);
+        return NULL;
+    }
+    vcdiff->patch_size = (uint32_t)patch_size;
+
+    vcdiff_section_t *header = &vcdiff->data;
+    section_init(header, 0, vcdiff->patch_size);
+    uint8_t magic[5];
+    if (!section_read(vcdiff, header, magic, sizeof(magic)) || memcmp(magic, "\xD6\xC3\xC4", 3) != 0 || magic[3] != 0) {
+        debugf("VCDIFF patch: %s is not a VCDIFF file\n", patch_path);
+        vcdiff_patch_close(vcdiff);
+        return NULL;
+    }
+    uint8_t hdr_indicator = magic[4];
+    if (hdr_indicator & (VCD_DECOMPRESS | VCD_CODETABLE)) {
+        debugf("VCDIFF patch: secondary compression and custom code tables are not supported, create the patch with -S none\n");
+        vcdiff_patch_close(vcdiff);
+        return NULL;
+    }
+    if (hdr_indicator & VCD_APPHEADER) {
+        // xdelta3 keeps the original file names here.
+        uint32_t length;
+        if (!section_read_int(vcdiff, header, &length) || length > vcdiff->patch_size - header->position) {
+            vcdiff_patch_close(vcdiff);
+            return NULL;
+        }
+        header->position += length;
+    }
+    vcdiff->first_window = header->position;
+
+    // Window headers give the target size, which the format doesn't store anywhere else.
+    uint64_t target_size = 0;
+    vcdiff->next_window = vcdiff->first_window;
+    while (vcdiff->next_window < vcdiff->patch_size) {
+        section_init(header, vcdiff->next_window, vcdiff->patch_size - vcdiff->next_window);
+        if (!read_window_header(vcdiff, header)) {
+            debugf("VCDIFF patch: invalid window header in %s\n", patch_path);
+            vcdiff_patch_close(vcdiff);
+            return NULL;
+        }
+        target_size += vcdiff->window_length;
+        if (target_size > UINT32_MAX) {
+            vcdiff_patch_close(vcdiff);
+            return NULL;
+        }
+    }
+    vcdiff->target_size = (uint32_t)target_size;
+    vcdiff->next_window = vcdiff->first_window;
+
+    return vcdiff;
+}
+
+void vcdiff_patch_close(vcdiff_patch_t *vcdiff) {
+    if (!vcdiff) {
+        return;
+    }
+    if (vcdiff->patch) {
+        fclose(vcdiff->patch);
+    }
+    patch_source_close(&vcdiff->source);
+    free(vcdiff);
+}
+
+uint32_t vcdiff_patch_target_size(const vcdiff_patch_t *vcdiff) {
+    return vcdiff->target_size;
+}
+
+void vcdiff_patch_set_source_window(vcdiff_patch_t *vcdiff, const uint8_t *window, uint32_t offset, size_t length) {
+    patch_source_set_window(&vcdiff->source, window, offset, length);
+}
+
+void vcdiff_patch_set_target_reader(vcdiff_patch_t *vcdiff, patch_target_reader_t *reader, void *context) {
+    vcdiff->target_reader = reader;
+    vcdiff->target_context = context;
+}
+
+bool vcdiff_patch_decode(vcdiff_patch_t *vcdiff, uint8_t *buffer, size_t length) {
+    if (vcdiff->error || length > vcdiff->target_size - vcdiff->output_offset) {
+        vcdiff->error = true;
+        return false;
+    }
+
+    uint32_t start = vcdiff->output_offset;
+    size_t produced = 0;
+    while (produced < length) {
+        if (!vcdiff->in_window) {
+            if (!window_begin(vcdiff)) {
+                vcdiff->error = true;
+                return false;
+            }
+            if (vcdiff->window_length == 0) {
+                if (!window_end(vcdiff)) {
+                    vcdiff->error = true;
+                    return false;
+                }
+                continue;
+            }
+        }
+
+        if (vcdiff->remaining == 0) {
+            if (!next_instruction(vcdiff)) {
+                vcdiff->error = true;
+                return false;
+            }
+            continue;
+        }
+
+        size_t n = MIN((size_t)vcdiff->remaining, length - produced);
+        bool ok = true;
+        switch (vcdiff->type) {
+            case VCDIFF_ADD:
+                ok = section_read(vcdiff, &vcdiff->data, buffer + produced, n);
+                break;
+            case VCDIFF_RUN:
+                memset(buffer + produced, vcdiff->run_byte, n);
+                break;
+            case VCDIFF_COPY:
+                ok = copy(vcdiff, buffer, start, produced, n);
+                break;
+            default:
+                ok = false;
+                break;
+        }
+        if (!ok) {
+            vcdiff->error = true;
+            return false;
+        }
+
+        vcdiff->adler = (uint32_t)mz_adler32(vcdiff->adler, buffer + produced, n);
+        produced += n;
+        vcdiff->output_offset += (uint32_t)n;
+        vcdiff->window_produced += (uint32_t)n;
+        vcdiff->remaining -= (uint32_t)n;
+
+        if (vcdiff->window_produced == vcdiff->window_length && !window_end(vcdiff)) {
+            vcdiff->error = true;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool vcdiff_patch_finish(vcdiff_patch_t *vcdiff) {
+    if (vcdiff->error || vcdiff->in_window || vcdiff->output_offset != vcdiff->target_size) {
+        return false;
+    }
+    // Only empty windows can be left once the whole target is out.
+    while (vcdiff->next_window < vcdiff->patch_size) {
+        if (!window_begin(vcdiff) || vcdiff->window_length != 0 || !window_end(vcdiff)) {
+            return false;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file vcdiff_patch.h
+ * @brief Streaming VCDIFF (xdelta3) patch decoder
+ * @ingroup menu
+ */
+
+#ifndef VCDIFF_PATCH_H__
+#define VCDIFF_PATCH_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "patch_source.h"
+#include "rom_info.h"
+
+/** @brief Decoder state of an open VCDIFF patch. */
+typedef struct vcdiff_patch_s vcdiff_patch_t;
+
+/**
+ * @brief Open a VCDIFF patch and its source ROM.
+ *
+ * Walks the window headers once to size the target. Patches with secondary
+ * compression (xdelta3 -S) or a custom code table are rejected.
+ *
+ * @param patch_path Path of the .xdelta/.vcdiff file
+ * @param source_path Path of the source ROM
+ * @param endianness Byte order of the source ROM file
+ * @return Decoder, or NULL if a file can't be read or the patch isn't supported
+ */
+vcdiff_patch_t *vcdiff_patch_open(const char *patch_path, const char *source_path, rom_endianness_t endianness);
+
+/**
+ * @brief Close a VCDIFF patch.
+ */
+void vcdiff_patch_close(vcdiff_patch_t *vcdiff);
+
+/** @brief Size of the patched ROM. */
+uint32_t vcdiff_patch_target_size(const vcdiff_patch_t *vcdiff);
+
+/**
+ * @brief Serve source reads in a range from memory instead of the source file.
+ *
+ * @param vcdiff Decoder
+ * @param window Big endian source data, must stay valid until replaced
+ * @param offset Source offset of the data
+ * @param length Length of the data, 0 to disable
+ */
+void vcdiff_patch_set_source_window(vcdiff_patch_t *vcdiff, const uint8_t *window, uint32_t offset, size_t length);
+
+/**
+ * @brief Set where target data from earlier decode calls is read back from.
+ *
+ * Needed for copies that reach further back than the current
+ * vcdiff_patch_decode call.
+ */
+void vcdiff_patch_set_target_reader(vcdiff_patch_t *vcdiff, patch_target_reader_t *reader, void *context);
+
+/**
+ * @brief Produce the next bytes of the patched ROM.
+ *
+ * Windows carrying an xdelta3 Adler-32 checksum are verified as they end.
+ *
+ * @param vcdiff Decoder
+ * @param buffer Output buffer
+ * @param length Number of bytes, the target must have that many left
+ * @return true on success, false on malformed patches or read errors
+ */
+bool vcdiff_patch_decode(vcdiff_patch_t *vcdiff, uint8_t *buffer, size_t length);
+
+/**
+ * @brief Check that every window was decoded.
+ *
+ * @return true if the patched ROM is complete
+ */
+bool vcdiff_patch_finish(vcdiff_patch_t *vcdiff);
+
+#endif /* VCDIFF_PATCH_H__ */
@@ -14,7 +14,10 @@
 #include "../cart_load.h"
 #include "../disk_pairing.h"
 #include "../fonts.h"
+#include "../metadata_index.h"
+#include "../native_image.h"
 #include "../png_decoder.h"
+#include "../rom_digest.h"
 #include "../rom_info.h"
 #include "../ui_components/constants.h"
 #include "../virtual_pak.h"
@@ -941,6 +944,7 @@ typedef struct {
     char series_contains[64];
     char modes_contains[96];
     char description_contains[128];
+    char dat_contains[96];
     bool filter_year;
     int year_min;
     int year_max;
@@ -1308,6 +1312,7 @@ static int prewarm_total = 0;
 static void playlist_grid_prewarm_start(menu_t *menu) {
     prewarm_next_index = -1;
     prewarm_total = 0;
+    rom_info_read_quick_batch_reset();
     if (!menu || !menu->browser.playlist || menu->browser.entries <= 0) {
         return;
     }
@@ -1320,11 +1325,61 @@ static void playlist_grid_prewarm_start(menu_t *menu) {
 }
 
 #define PREWARM_PER_FRAME 2
+#define PREWARM_HEADER_BATCH 8
+
+// Read the headers of the next few unattempted entries in one batch so the
+// SD accesses happen in directory order rather than playlist order.
+static void playlist_grid_prewarm_read_headers(menu_t *menu, int start_index) {
+    rom_quick_header_t batch[PREWARM_HEADER_BATCH];
+    int batch_entry[PREWARM_HEADER_BATCH];
+    int batch_count = 0;
+
+    for (int i = start_index; i < prewarm_total && i < playlist_grid_meta_index_count && batch_count < PREWARM_HEADER_BATCH; i++) {
+        playlist_grid_meta_index_entry_t *idx = &playlist_grid_meta_index[i];
+        if (idx->attempted) {
+            continue;
+        }
+        entry_t *entry = &menu->browser.list[i];
+        idx->attempted = true;
+        idx->loaded = false;
+        if (!entry->path || entry->type != ENTRY_TYPE_ROM) {
+            continue;
+        }
+        memset(&batch[batch_count], 0, sizeof(batch[batch_count]));
+        batch[batch_count].path = entry->path;
+        batch_entry[batch_count] = i;
+        batch_count++;
+    }
+
+    if (batch_count == 0) {
+        return;
+    }
+
+    rom_info_read_quick_batch(batch, (size_t)batch_count);
+
+    for (int i = 0; i < batch_count; i++) {
+        if (batch[i].err != ROM_OK) {
+            continue;
+        }
+        playlist_grid_meta_index_entry_t *idx = &playlist_grid_meta_index[batch_entry[i]];
+        idx->loaded = true;
+        memcpy(idx->game_code, batch[i].game_code, 4);
+        memcpy(idx->rom_title, batch[i].title, 21);
+    }
+}
 
 static void playlist_grid_prewarm_tick(menu_t *menu) {
     if (prewarm_next_index < 0 || prewarm_next_index >= prewarm_total) {
         return;
     }
+    playlist_grid_meta_index_reset_for_current_list(menu);
+    if (!playlist_grid_meta_index) {
+        prewarm_next_index = -1;
+        return;
+    }
+    if (!playlist_grid_meta_index[prewarm_next_index].attempted) {
+        playlist_grid_prewarm_read_headers(menu, prewarm_next_index);
+    }
     char gc[4], title[21];
     for (int i = 0; i < PREWARM_PER_FRAME && prewarm_next_index < prewarm_total; i++, prewarm_next_index++) {
         if (playlist_grid_get_boxart_meta_by_index(menu, prewarm_next_index, gc, title)) {
@@ -1361,6 +1416,14 @@ static const char *browser_grid_display_name(const char *name, char *buffer, siz
 }
 
 // Register entry→slot mapping in the reverse lookup table.
+// Cell size of the 4x3 grid laid out by browser_playlist_grid_draw; thumbnails are decoded to fit it.
+static void playlist_grid_cell_size(int *cell_width, int *cell_height) {
+    const int area_w = (VISIBLE_AREA_X1 - BORDER_THICKNESS - 2) - (VISIBLE_AREA_X0 + BORDER_THICKNESS + 2);
+    const int grid_y = VISIBLE_AREA_Y0 + TAB_HEIGHT + BORDER_THICKNESS + 2 + 14 + 2;
+    *cell_width = (area_w - (3 * 4)) / 4;
+    *cell_height = ((LAYOUT_ACTIONS_SEPARATOR_Y - grid_y) - (2 * 4)) / 3;
+}
+
 static void playlist_grid_slot_register(int entry_index, int slot_index) {
     if (entry_index >= 0 && entry_index < PLAYLIST_GRID_MAX_ENTRIES) {
         playlist_grid_entry_to_slot[entry_index] = (int8_t)slot_index;
@@ -1401,7 +1464,9 @@ static int playlist_grid_slot_prepare(menu_t *menu, int entry_index, bool memory
             slot->entry_index = entry_index;
             slot->entry_path = strdup(entry->path);
             slot->last_used_frame = playlist_grid_frame_counter;
-            slot->boxart = ui_components_boxart_init_grid_memory_cached(menu->storage_prefix, game_code, safe_title);
+            int cell_width, cell_height;
+            playlist_grid_cell_size(&cell_width, &cell_height);
+            slot->boxart = ui_components_boxart_init_grid_memory_cached(menu->storage_prefix, game_code, safe_title, cell_width, cell_height);
             playlist_grid_slot_register(entry_index, si);
             return si;
         }
@@ -1423,7 +1488,9 @@ static int playlist_grid_slot_prepare(menu_t *menu, int entry_index, bool memory
         if (slot->boxart) {
             ui_components_boxart_free(slot->boxart);
         }
-        slot->boxart = ui_components_boxart_init_grid(menu->storage_prefix, game_code, safe_title);
+        int cell_width, cell_height;
+        playlist_grid_cell_size(&cell_width, &cell_height);
+        slot->boxart = ui_components_boxart_init_grid(menu->storage_prefix, game_code, safe_title, cell_width, cell_height);
     }
     slot->boxart_resolved = true;
     return si;
@@ -2148,6 +2215,7 @@ static void browser_playlist_grid_draw(menu_t *menu) {
                 rdpq_set_mode_standard();
                 rdpq_mode_combiner(RDPQ_COMBINER_TEX);
                 rdpq_mode_filter(FILTER_BILINEAR);
+                native_image_tlut_setup(img);
                 rdpq_set_scissor(x0, y0, x1, y0 + tile_h);
                 rdpq_tex_blit(img, draw_x, draw_y, &(rdpq_blitparms_t){
                     .scale_x = s,
@@ -2208,6 +2276,16 @@ static void browser_playlist_grid_draw(menu_t *menu) {
         (entries + page_size - 1) / page_size
     );
     rdpq_set_scissor(0, 0, screen_w, screen_h);
+
+    if (menu->settings.thumb_cache_overlay_enabled) {
+        boxart_cache_stats_t stats;
+        ui_components_boxart_cache_get_stats(&stats);
+        rdpq_text_printf(&(rdpq_textparms_t){ .width = area_w, .height = 12, .align = ALIGN_RIGHT },
+                         FNT_DEFAULT, x0_area, LAYOUT_ACTIONS_SEPARATOR_Y - 12,
+                         "^%02Xthumbs %lu/%lu/%lu  %u/%u KiB", STL_GRAY,
+                         (unsigned long)stats.hits, (unsigned long)stats.misses, (unsigned long)stats.evictions,
+                         (unsigned int)(stats.bytes / 1024), (unsigned int)(stats.budget_bytes / 1024));
+    }
 }
 
 static void browser_playlist_grid_prepare(menu_t *menu, bool defer_work) {
@@ -2594,6 +2672,14 @@ static bool smart_playlist_matches(menu_t *menu, const smart_playlist_query_t *q
             return false;
         }
     }
+    if (query->dat_contains[0] != '\0') {
+        // Only ROMs already hashed by the background digest job can match.
+        rom_digest_t digest;
+        const char *dat_name = rom_digest_lookup(rom_path, &digest) ? rom_digest_dat_name(&digest) : NULL;
+        if (!dat_name || !string_contains_ignore_case(dat_name, query->dat_contains)) {
+            return false;
+        }
+    }
     if (query->filter_year) {
         if (rom_info->metadata.release_year < query->year_min || rom_info->metadata.release_year > query->year_max) {
             return false;
@@ -3160,6 +3246,12 @@ static void playlist_parse_directive(menu_t *menu, path_t *playlist_dir, const c
         return;
     }
 
+    if (strcasecmp(key, "FILTER_DAT") == 0 || strcasecmp(key, "DAT") == 0) {
+        snprintf(smart_query->dat_contains, sizeof(smart_query->dat_contains), "%s", value);
+        smart_query->enabled = true;
+        return;
+    }
+
     if (strcasecmp(key, "FILTER_YEAR") == 0 || strcasecmp(key, "YEAR") == 0) {
         if (smart_playlist_parse_range(value, &smart_query->year_min, &smart_query->year_max)) {
             smart_query->filter_year = true;
@@ -3344,6 +3436,12 @@ static void browser_apply_playlist_overrides_deferred(menu_t *menu) {
 
     if (playlist_override.background_deferred && playlist_override.background_path) {
         uint64_t start_us = get_ticks_us();
+        if (ui_components_background_load_temporary_streamed(playlist_override.background_path)) {
+            playlist_override.background_applied = true;
+            playlist_override.background_deferred = false;
+            debugf("Playlist perf: background streaming path=%s\n", playlist_override.background_path);
+            return;
+        }
         if (ui_components_background_load_temporary_cached(playlist_override.background_path)) {
             playlist_override.background_applied = true;
             playlist_override.background_deferred = false;
@@ -4424,6 +4522,7 @@ static void delete_entry (menu_t *menu, void *arg) {
     }
 
     path_free(path);
+    metadata_index_invalidate();
 
     if (reload_directory(menu)) {
         menu->browser.valid = false;
@@ -4884,6 +4983,8 @@ static void draw (menu_t *menu, surface_t *d) {
 }
 
 void view_browser_init (menu_t *menu) {
+    // Files may have been added or removed since the listings were cached.
+    metadata_index_invalidate();
     playlist_recent_init(menu);
     browser_virtual_pak_recovery_active = virtual_pak_has_pending_sync();
     browser_virtual_pak_recovery_failed = false;
@@ -1,6 +1,7 @@
 #include <miniz.h>
 #include <miniz_zip.h>
 #include <sys/utime.h>
+#include "../metadata_index.h"
 #include "../sound.h"
 
 #include "utils/fs.h"
@@ -52,6 +53,7 @@ static void extract(menu_t *menu) {
             }
             fclose(file);
             utime(path_get(path), &mtime);
+            metadata_index_invalidate();
             menu->browser.select_file = path_clone(path);
             menu->next_mode = MENU_MODE_BROWSER;
         } else {
@@ -1,7 +1,6 @@
 #include <stdlib.h>
 #include "../sound.h"
 
-#include "../native_image.h"
 #include "../png_decoder.h"
 #include "views.h"
 
@@ -9,6 +8,7 @@
 
 
 static bool show_message;
+static png_job_t image_job = PNG_DECODER_JOB_NONE;
 static bool image_loading;
 static bool image_set_as_background;
 static surface_t *image;
@@ -28,6 +28,7 @@ static char *convert_error_message (png_err_t err) {
 static void image_callback (png_err_t err, surface_t *decoded_image, void *callback_data) {
     menu_t *menu = (menu_t *) (callback_data);
 
+    image_job = PNG_DECODER_JOB_NONE;
     image_loading = false;
     image = decoded_image;
 
@@ -63,7 +64,7 @@ static void draw (menu_t *menu, surface_t *d) {
 
         ui_components_background_draw();
 
-        ui_components_loader_draw(png_decoder_get_progress(), "Loading image...");
+        ui_components_loader_draw(png_decoder_job_progress(image_job), "Loading image...");
     } else {
         rdpq_attach_clear(d, NULL);
 
@@ -91,7 +92,8 @@ static void draw (menu_t *menu, surface_t *d) {
 
 static void deinit (menu_t *menu) {
     if (image_loading) {
-        png_decoder_abort();
+        png_decoder_cancel(image_job);
+        image_job = PNG_DECODER_JOB_NONE;
     }
 
     if (image) {
@@ -113,14 +115,19 @@ void view_image_viewer_init (menu_t *menu) {
 
     path_t *path = path_clone_push(menu->browser.directory, menu->browser.entry->name);
 
-    image = native_image_load_sidecar_rgba16(path_get(path), IMAGE_NATIVE_SIDECAR, 640, 480);
-    if (image) {
+    // A native sidecar is read in chunks by the decoder instead of the PNG.
+    png_decoder_job_desc_t desc = {
+        .max_width = 640,
+        .max_height = 480,
+        .priority = PNG_DECODER_PRIORITY_BACKGROUND,
+        .native_sidecar = IMAGE_NATIVE_SIDECAR,
+        .callback = image_callback,
+        .callback_data = menu,
+    };
+    png_err_t err = png_decoder_submit(path_get(path), &desc, &image_job);
+    if (err != PNG_OK) {
         image_loading = false;
-    } else {
-        png_err_t err = png_decoder_start(path_get(path), 640, 480, image_callback, menu);
-        if (err != PNG_OK) {
-            menu_show_error(menu, convert_error_message(err));
-        }
+        menu_show_error(menu, convert_error_message(err));
     }
 
     path_free(path);
@@ -2,6 +2,7 @@
 #include "../cart_load.h"
 #include "../combo_disk_flow.h"
 #include "../datel_codes.h"
+#include "../metadata_index.h"
 #include "../playtime.h"
 #include "../rom_info.h"
 #include "../sound.h"
@@ -53,6 +54,9 @@ static char cached_last_played_buf[64];
 static char cached_recent_sessions_buf[512];
 static char cached_save_health_buf[128];
 static char cached_save_modified_buf[64];
+static char cached_rom_layout_buf[96];
+static char *cached_rom_layout_path = NULL;
+static bool rom_layout_pending = false;
 static bool cached_has_manual = false;
 
 static void refresh_display_cache(menu_t *menu);
@@ -72,7 +76,7 @@ static bool resolve_metadata_directory_for_rom (path_t *path, const char game_co
 
     snprintf(candidate, sizeof(candidate), "%c/%c/%c/%c", game_code[0], game_code[1], game_code[2], game_code[3]);
     path_push(path, candidate);
-    if (directory_exists(path_get(path))) {
+    if (metadata_index_directory_exists(path_get(path))) {
         if (resolved && resolved_size > 0) {
             snprintf(resolved, resolved_size, "%s", candidate);
         }
@@ -87,7 +91,7 @@ static bool resolve_metadata_directory_for_rom (path_t *path, const char game_co
         }
         snprintf(candidate, sizeof(candidate), "%c/%c/%c/%c", game_code[0], game_code[1], game_code[2], fallback_regions[i]);
         path_push(path, candidate);
-        if (directory_exists(path_get(path))) {
+        if (metadata_index_directory_exists(path_get(path))) {
             if (resolved && resolved_size > 0) {
                 snprintf(resolved, resolved_size, "%s", candidate);
             }
@@ -98,7 +102,7 @@ static bool resolve_metadata_directory_for_rom (path_t *path, const char game_co
 
     snprintf(candidate, sizeof(candidate), "%c/%c/%c", game_code[0], game_code[1], game_code[2]);
     path_push(path, candidate);
-    if (directory_exists(path_get(path))) {
+    if (metadata_index_directory_exists(path_get(path))) {
         if (resolved && resolved_size > 0) {
             snprintf(resolved, resolved_size, "%s", candidate);
         }
@@ -134,7 +138,7 @@ static bool resolve_metadata_directory_for_current_rom(menu_t *menu, char *resol
 
                 snprintf(game_code_path, sizeof(game_code_path), "homebrew/%s", safe_title);
                 path_push(path, game_code_path);
-                metadata_directory_available = directory_exists(path_get(path));
+                metadata_directory_available = metadata_index_directory_exists(path_get(path));
                 path_pop(path);
             } else {
                 metadata_directory_available = resolve_metadata_directory_for_rom(
@@ -210,7 +214,7 @@ static bool resolve_manual_directory_for_current_rom (menu_t *menu, path_t **out
     if (subdirectory && subdirectory[0] != '\0') {
         path_push(metadata_directory, (char *)subdirectory);
     }
-    if (!directory_exists(path_get(metadata_directory))) {
+    if (!metadata_index_directory_exists(path_get(metadata_directory))) {
         path_free(metadata_directory);
         return false;
     }
@@ -292,7 +296,7 @@ static void scan_metadata_images(menu_t *menu) {
 
         for (uint16_t i = 0; i < metadata_image_filename_cache_length; i++) {
             path_push(path, filenames[i]);
-            metadata_image_available[i] = file_exists(path_get(path))
+            metadata_image_available[i] = metadata_index_path_exists(path_get(path))
                 || native_image_sidecar_exists(path_get(path), ".nimg");
             path_pop(path);
         }
@@ -1049,6 +1053,20 @@ static void format_save_last_modified(char *out, size_t out_len, const char *sav
     }
 }
 
+static void format_rom_layout (char *out, size_t out_len, char *rom_path) {
+    int fragments = flashcart_get_file_fragments(rom_path);
+
+    if (fragments < 0) {
+        snprintf(out, out_len, "Unknown");
+    } else if (fragments <= 1) {
+        snprintf(out, out_len, "Contiguous");
+    } else if (fragments <= FLASHCART_FAST_LOAD_MAX_FRAGMENTS) {
+        snprintf(out, out_len, "%d fragments", fragments);
+    } else {
+        snprintf(out, out_len, "%d fragments (defragment SD for faster loading)", fragments);
+    }
+}
+
 static void format_recent_sessions (char *out, size_t out_len, const playtime_entry_t *pt) {
     if (out_len == 0) {
         return;
@@ -1249,6 +1267,7 @@ static void rebuild_details_layout(menu_t *menu) {
         "Save file:\t\t%s\n"
         "Save health:\t\t%s\n"
         "Save modified:\t\t%s\n"
+        "ROM layout:\t\t%s\n"
         "Playtime:\t\t%s\n"
         "Last session:\t\t%s\n"
         "Last played:\t\t%s\n"
@@ -1266,6 +1285,7 @@ static void rebuild_details_layout(menu_t *menu) {
         save_path,
         cached_save_health_buf,
         cached_save_modified_buf,
+        cached_rom_layout_buf,
         cached_total_buf,
         cached_last_session_buf,
         cached_last_played_buf,
@@ -1302,6 +1322,16 @@ static void rebuild_details_layout(menu_t *menu) {
     }
 }
 
+static void update_rom_layout (menu_t *menu) {
+    rom_layout_pending = false;
+    format_rom_layout(cached_rom_layout_buf, sizeof(cached_rom_layout_buf), path_get(menu->load.rom_path));
+    free(cached_rom_layout_path);
+    cached_rom_layout_path = strdup(path_get(menu->load.rom_path));
+    if (rom_display_data_valid) {
+        rebuild_details_layout(menu);
+    }
+}
+
 static void refresh_display_cache(menu_t *menu) {
     if (!menu) {
         return;
@@ -1332,6 +1362,12 @@ static void refresh_display_cache(menu_t *menu) {
         snprintf(cached_save_modified_buf, sizeof(cached_save_modified_buf), "N/A");
     }
 
+    // Counting fragments walks the whole cluster chain, so it's done once per ROM after the view is shown.
+    if (!cached_rom_layout_path || (strcmp(cached_rom_layout_path, path_get(menu->load.rom_path)) != 0)) {
+        snprintf(cached_rom_layout_buf, sizeof(cached_rom_layout_buf), "Checking...");
+        rom_layout_pending = true;
+    }
+
     {
         path_t *manual_dir = NULL;
         cached_has_manual = resolve_manual_directory_for_current_rom(menu, &manual_dir, NULL);
@@ -1677,6 +1713,8 @@ void view_load_rom_display (menu_t *menu, surface_t *display) {
     if (menu->load_pending.rom_file) {
         menu->load_pending.rom_file = false;
         load(menu);
+    } else if (rom_layout_pending && (menu->mode == MENU_MODE_LOAD_ROM) && menu->load.rom_path) {
+        update_rom_layout(menu);
     }
 
     if (menu->next_mode != MENU_MODE_LOAD_ROM && menu->next_mode != MENU_MODE_DATEL_CODE_EDITOR) {
@@ -32,6 +32,9 @@ static int manual_align_up (int value, int alignment) {
 }
 
 static bool manual_show_ui;
+static png_job_t manual_page_job = PNG_DECODER_JOB_NONE;
+static png_job_t manual_prefetch_job = PNG_DECODER_JOB_NONE;
+static int manual_prefetch_target_page = -1;
 
 static void manual_reset_pan (menu_t *menu) {
     menu->manual.pan_x = 0.0f;
@@ -47,6 +50,8 @@ static void manual_free_current_image (menu_t *menu) {
 }
 
 static void manual_free_prefetch_image (menu_t *menu) {
+    png_decoder_cancel(manual_prefetch_job);
+    manual_prefetch_job = PNG_DECODER_JOB_NONE;
     if (menu->manual.prefetch_image) {
         surface_free(menu->manual.prefetch_image);
         free(menu->manual.prefetch_image);
@@ -56,13 +61,14 @@ static void manual_free_prefetch_image (menu_t *menu) {
     menu->manual.prefetch_loading = false;
 }
 
+static void manual_cancel_page_load (menu_t *menu) {
+    png_decoder_cancel(manual_page_job);
+    manual_page_job = PNG_DECODER_JOB_NONE;
+    menu->manual.page_loading = false;
+}
+
 static void manual_deinit (menu_t *menu) {
-    if (menu->manual.page_loading) {
-        png_decoder_abort();
-    }
-    if (menu->manual.prefetch_loading) {
-        png_decoder_abort();
-    }
+    manual_cancel_page_load(menu);
     manual_free_current_image(menu);
     manual_free_prefetch_image(menu);
     if (menu->manual.pages_directory) {
@@ -158,6 +164,22 @@ static float manual_get_base_scale_for_size (int page_width, int page_height) {
     return base_scale;
 }
 
+static void manual_page_callback (png_err_t err, surface_t *decoded_image, void *callback_data) {
+    menu_t *menu = (menu_t *)callback_data;
+    manual_page_job = PNG_DECODER_JOB_NONE;
+    menu->manual.page_loading = false;
+
+    if (err != PNG_OK || !decoded_image) {
+        debugf("manual: page %d load failed: %d (native: %s)\n", menu->manual.current_page + 1, (int)err,
+            native_image_error_string(native_image_get_last_error()));
+        menu_show_error(menu, "Manual page load failed");
+        return;
+    }
+
+    menu->manual.image = decoded_image;
+    menu->manual.loaded_page = menu->manual.current_page;
+}
+
 static bool manual_start_page_load (menu_t *menu) {
     if (!menu->manual.pages_directory || menu->manual.page_count <= 0) {
         return false;
@@ -179,32 +201,29 @@ static bool manual_start_page_load (menu_t *menu) {
         return false;
     }
 
-    if (menu->manual.page_loading) {
-        png_decoder_abort();
-        menu->manual.page_loading = false;
-    }
-    if (menu->manual.prefetch_loading) {
-        png_decoder_abort();
-        menu->manual.prefetch_loading = false;
-    }
-
+    manual_cancel_page_load(menu);
     manual_free_current_image(menu);
     menu->manual.loaded_page = -1;
     menu->manual.loaded_zoom_asset = use_zoom_asset;
     manual_free_prefetch_image(menu);
 
-    menu->manual.image = native_image_load_sidecar_rgba16(page_path, MANUAL_NATIVE_SIDECAR, MANUAL_MAX_PAGE_WIDTH, MANUAL_MAX_PAGE_HEIGHT);
-    if (!menu->manual.image) {
-        native_image_error_t native_err = native_image_get_last_error();
-        char errbuf[96];
-        snprintf(errbuf, sizeof(errbuf), "Manual page load failed: %s", native_image_error_string(native_err));
-        debugf("manual: native load failed for %s: %s\n", page_path, native_image_error_string(native_err));
-        menu_show_error(menu, errbuf);
+    // Pages are read a chunk per frame, so audio and input keep running during a page turn.
+    png_decoder_job_desc_t desc = {
+        .max_width = MANUAL_MAX_PAGE_WIDTH,
+        .max_height = MANUAL_MAX_PAGE_HEIGHT,
+        .priority = PNG_DECODER_PRIORITY_VISIBLE,
+        .native_sidecar = MANUAL_NATIVE_SIDECAR,
+        .callback = manual_page_callback,
+        .callback_data = menu,
+    };
+    png_err_t err = png_decoder_submit(page_path, &desc, &manual_page_job);
+    if (err != PNG_OK) {
+        debugf("manual: page load submit failed for %s: %d\n", page_path, (int)err);
+        menu_show_error(menu, "Manual page load failed");
         return false;
     }
 
-    menu->manual.loaded_page = menu->manual.current_page;
-    menu->manual.page_loading = false;
+    menu->manual.page_loading = true;
     return true;
 }
 
@@ -212,11 +231,30 @@ static bool manual_allow_speculative_prefetch (void) {
     return is_memory_expanded();
 }
 
+static void manual_prefetch_callback (png_err_t err, surface_t *decoded_image, void *callback_data) {
+    menu_t *menu = (menu_t *)callback_data;
+    manual_prefetch_job = PNG_DECODER_JOB_NONE;
+    menu->manual.prefetch_loading = false;
+
+    if (err != PNG_OK || !decoded_image) {
+        return;
+    }
+    if (manual_prefetch_target_page == menu->manual.current_page) {
+        // Page was flipped to while prefetching and is loading on its own.
+        surface_free(decoded_image);
+        free(decoded_image);
+        return;
+    }
+
+    menu->manual.prefetch_image = decoded_image;
+    menu->manual.prefetched_page = manual_prefetch_target_page;
+}
+
 static void manual_maybe_start_prefetch (menu_t *menu) {
     if (!manual_allow_speculative_prefetch()) {
         return;
     }
-    if (menu->manual.page_loading || menu->manual.prefetch_loading || png_decoder_is_busy()) {
+    if (menu->manual.page_loading || menu->manual.prefetch_loading) {
         return;
     }
     if (!menu->manual.image || menu->manual.zoom_level > 1) {
@@ -233,15 +271,20 @@ static void manual_maybe_start_prefetch (menu_t *menu) {
         return;
     }
 
-    surface_t *native_image = native_image_load_sidecar_rgba16(page_path, MANUAL_NATIVE_SIDECAR, MANUAL_MAX_PAGE_WIDTH, MANUAL_MAX_PAGE_HEIGHT);
-    if (!native_image) {
-        return;
-    }
-
     manual_free_prefetch_image(menu);
-    menu->manual.prefetch_image = native_image;
-    menu->manual.prefetched_page = target_page;
-    menu->manual.prefetch_loading = false;
+
+    png_decoder_job_desc_t desc = {
+        .max_width = MANUAL_MAX_PAGE_WIDTH,
+        .max_height = MANUAL_MAX_PAGE_HEIGHT,
+        .priority = PNG_DECODER_PRIORITY_PREFETCH,
+        .native_sidecar = MANUAL_NATIVE_SIDECAR,
+        .callback = manual_prefetch_callback,
+        .callback_data = menu,
+    };
+    if (png_decoder_submit(page_path, &desc, &manual_prefetch_job) == PNG_OK) {
+        manual_prefetch_target_page = target_page;
+        menu->manual.prefetch_loading = true;
+    }
 }
 
 static void manual_clamp_pan (menu_t *menu) {
@@ -547,7 +590,7 @@ static void draw (menu_t *menu, surface_t *display) {
     ui_components_background_draw();
 
     if (menu->manual.page_loading) {
-        ui_components_loader_draw(png_decoder_get_progress(), "Loading manual page...");
+        ui_components_loader_draw(png_decoder_job_progress(manual_page_job), "Loading manual page...");
     } else if (menu->manual.image) {
         draw_full_page(menu, display);
     } else {
@@ -0,0 +1,63 @@
+#ifndef UTILS_BYTESWAP_H
+#define UTILS_BYTESWAP_H
+
+/**
+ * @file byteswap.h
+ * @brief In-place ROM byte order conversion to the big-endian .z64 layout.
+ * @ingroup utils
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Swap the bytes of every 16-bit halfword (.v64 to .z64).
+ *
+ * Works a 32-bit word at a time when @p data is word aligned.
+ *
+ * @param data Buffer to convert.
+ * @param length Buffer length, a trailing odd byte is left untouched.
+ */
+static inline void byteswap_16(void *data, size_t length) {
+    uint8_t *p = (uint8_t *)data;
+    size_t i = 0;
+    if (((uintptr_t)p & 3) == 0) {
+        uint32_t *w = (uint32_t *)p;
+        for (; i + 4 <= length; i += 4, w++) {
+            uint32_t v = *w;
+            *w = ((v & 0x00FF00FFu) << 8) | ((v >> 8) & 0x00FF00FFu);
+        }
+    }
+    for (; i + 2 <= length; i += 2) {
+        uint8_t t = p[i];
+        p[i] = p[i + 1];
+        p[i + 1] = t;
+    }
+}
+
+/**
+ * @brief Reverse the bytes of every 32-bit word (.n64 to .z64).
+ *
+ * @param data Buffer to convert.
+ * @param length Buffer length, up to three trailing bytes are left untouched.
+ */
+static inline void byteswap_32(void *data, size_t length) {
+    uint8_t *p = (uint8_t *)data;
+    size_t i = 0;
+    if (((uintptr_t)p & 3) == 0) {
+        uint32_t *w = (uint32_t *)p;
+        for (; i + 4 <= length; i += 4, w++) {
+            *w = __builtin_bswap32(*w);
+        }
+    }
+    for (; i + 4 <= length; i += 4) {
+        uint8_t t0 = p[i];
+        uint8_t t1 = p[i + 1];
+        p[i] = p[i + 3];
+        p[i + 1] = p[i + 2];
+        p[i + 2] = t1;
+        p[i + 3] = t0;
+    }
+}
+
+#endif // UTILS_BYTESWAP_H
@@ -32,6 +32,21 @@ Usage:
   tools/sc64/menu_assets.sh bg-native-batch <dir>
     Create `.nimg` sidecars beside background images in a directory.
 
+  tools/sc64/menu_assets.sh nimg-compact <input.nimg> <output.nimg> [auto|ci8|ci4|i4|ia8]
+    Re-encode an RGBA16 `.nimg` as a compact palettized (CI8/CI4) or intensity (I4/IA8) image.
+
+  tools/sc64/menu_assets.sh nimg-compact-batch <dir> [auto|ci8|ci4|i4|ia8]
+    Recursively re-encode RGBA16 `.nimg` files in place.
+
+  tools/sc64/menu_assets.sh nimg-pack <input.nimg> <output.nimg> [block_rows]
+    Convert a `.nimg` to v2 (NIM2): deflated row blocks with a CRC32 each (default 16 rows per block).
+
+  tools/sc64/menu_assets.sh nimg-pack-batch <dir> [block_rows]
+    Recursively convert `.nimg` files to v2 in place.
+
+  tools/sc64/menu_assets.sh nimg-bench <file.nimg> [more...]
+    Compare raw vs v2 load time for the given images, using SD_MIBPS, INFLATE_MIBPS and CRC_MIBPS.
+
   tools/sc64/menu_assets.sh screensaver <input> <output.png>
     Convert logo image to <=180x96 PNG (aspect preserved, transparent pad).
 
@@ -66,6 +81,8 @@ Usage:
     Rewrite #SC64_BACKGROUND=...png/.jpg directives to direct .nimg paths.
 
 Notes:
+  - nimg-bench models console time from SD_MIBPS (default 2.0), INFLATE_MIBPS (default 3.0)
+    and CRC_MIBPS (default 8.0); measure these on hardware and override as needed.
   - Set AUDIOCONV64_BIN to override audioconv64 location.
   - Set FFMPEG_BIN to override ffmpeg path.
 EOF
@@ -163,6 +180,278 @@ print(f"processed {count} background sidecars ({skipped} skipped)")
 PY
 }
 
+convert_nimg_compact() {
+  python3 - "$@" <<'PY'
+from pathlib import Path
+import struct
+import sys
+
+MAGIC_RGBA16 = 0x4E494D47  # NIMG
+MAGIC_COMPACT = 0x4E494D43  # NIMC
+FORMATS = {"ci8": (1, 8), "ci4": (2, 4), "i4": (3, 4), "ia8": (4, 8)}
+
+
+def align8(value: int) -> int:
+    return (value + 7) & ~7
+
+
+def read_rgba16(path: Path):
+    data = path.read_bytes()
+    magic, width, height, size = struct.unpack(">IIII", data[:16])
+    if magic != MAGIC_RGBA16:
+        return None
+    stride = align8(width * 2)
+    if size != stride * height or len(data) < 16 + size:
+        raise SystemExit(f"{path}: bad RGBA16 payload")
+    rows = []
+    for y in range(height):
+        row = data[16 + y * stride:16 + y * stride + width * 2]
+        rows.append(list(struct.unpack(f">{width}H", row)))
+    return width, height, rows
+
+
+def median_cut(hist: dict, max_colors: int):
+    # Same split rule as the menu: largest box by pixel count, widest channel, median by count.
+    boxes = [sorted(hist.items())]
+    while len(boxes) < max_colors:
+        candidates = [b for b in boxes if len(b) >= 2]
+        if not candidates:
+            break
+        box = max(candidates, key=lambda b: sum(c for _, c in b))
+        boxes.remove(box)
+        shift = max((10, 5, 0), key=lambda s: max((k >> s) & 31 for k, _ in box) - min((k >> s) & 31 for k, _ in box))
+        box.sort(key=lambda kc: (kc[0] >> shift) & 31)
+        half = sum(c for _, c in box) // 2
+        total = 0
+        split = 1
+        for i in range(len(box) - 1):
+            total += box[i][1]
+            split = i + 1
+            if total >= half:
+                break
+        boxes += [box[:split], box[split:]]
+    return boxes
+
+
+def encode_ci(width, height, rows, bits):
+    hist = {}
+    transparent = False
+    for row in rows:
+        for p in row:
+            if p & 1:
+                hist[p >> 1] = hist.get(p >> 1, 0) + 1
+            else:
+                transparent = True
+    first = 1 if transparent else 0
+    boxes = median_cut(hist, (1 << bits) - first)
+    palette = [0] * (1 << bits)
+    lookup = {}
+    for i, box in enumerate(boxes):
+        weight = sum(c for _, c in box)
+        avg = [(sum(((k >> s) & 31) * c for k, c in box) + weight // 2) // weight for s in (10, 5, 0)]
+        palette[first + i] = (avg[0] << 11) | (avg[1] << 6) | (avg[2] << 1) | 1
+        for k, _ in box:
+            lookup[k] = first + i
+    indices = [[lookup[p >> 1] if p & 1 else 0 for p in row] for row in rows]
+    return indices, palette
+
+
+def pack(width, height, indices, bits):
+    stride = align8((width * bits + 7) // 8)
+    out = bytearray(stride * height)
+    for y, row in enumerate(indices):
+        base = y * stride
+        for x, v in enumerate(row):
+            if bits == 8:
+                out[base + x] = v
+            elif x & 1:
+                out[base + (x >> 1)] |= v
+            else:
+                out[base + (x >> 1)] = v << 4
+    return stride, bytes(out)
+
+
+def is_gray(rows):
+    for row in rows:
+        for p in row:
+            if p & 1 and not (((p >> 11) & 31) == ((p >> 6) & 31) == ((p >> 1) & 31)):
+                return False
+    return True
+
+
+def compact(src: Path, dst: Path, fmt: str) -> bool:
+    image = read_rgba16(src)
+    if image is None:
+        return False
+    width, height, rows = image
+    has_alpha = any(not (p & 1) for row in rows for p in row)
+    if fmt == "auto":
+        if is_gray(rows):
+            fmt = "ia8" if has_alpha else "i4"
+        else:
+            colors = {p >> 1 for row in rows for p in row if p & 1}
+            fmt = "ci4" if len(colors) + (1 if has_alpha else 0) <= 16 else "ci8"
+    format_id, bits = FORMATS[fmt]
+    palette = []
+    if fmt in ("ci8", "ci4"):
+        indices, palette = encode_ci(width, height, rows, bits)
+    elif fmt == "i4":
+        indices = [[(p >> 12) & 15 for p in row] for row in rows]
+    else:
+        indices = [[(((p >> 12) & 15) << 4) | 15 if p & 1 else 0 for p in row] for row in rows]
+    stride, pixels = pack(width, height, indices, bits)
+    payload = pixels + struct.pack(f">{len(palette)}H", *palette)
+    header = struct.pack(">IIIIII", MAGIC_COMPACT, width, height, len(payload), format_id, stride)
+    dst.write_bytes(header + payload)
+    print(f"{dst}: {fmt} {len(payload)} bytes (was {align8(width * 2) * height})")
+    return True
+
+
+mode = sys.argv[1]
+fmt = sys.argv[-1] if sys.argv[-1] in FORMATS or sys.argv[-1] == "auto" else "auto"
+if mode == "one":
+    if not compact(Path(sys.argv[2]), Path(sys.argv[3]), fmt):
+        raise SystemExit(f"{sys.argv[2]}: not an RGBA16 .nimg")
+else:
+    count = 0
+    for src in sorted(Path(sys.argv[2]).rglob("*.nimg")):
+        if compact(src, src, fmt):
+            count += 1
+    print(f"compacted {count} native images")
+PY
+}
+
+convert_nimg_pack() {
+  python3 - "$@" <<'PY'
+from pathlib import Path
+import os
+import struct
+import sys
+import time
+import zlib
+
+MAGIC_RGBA16 = 0x4E494D47  # NIMG
+MAGIC_COMPACT = 0x4E494D43  # NIMC
+MAGIC_BLOCK = 0x4E494D32  # NIM2
+PALETTE_COLORS = {1: 256, 2: 16}
+BITS = {0: 16, 1: 8, 2: 4, 3: 4, 4: 8}
+
+
+def align8(value: int) -> int:
+    return (value + 7) & ~7
+
+
+def read_image(path: Path):
+    return parse_image(path.read_bytes(), path)
+
+
+def parse_image(data: bytes, path):
+    """Return (width, height, format id, stride, pixel rows, palette bytes, block rows)."""
+    magic, width, height, size = struct.unpack(">IIII", data[:16])
+    if magic == MAGIC_RGBA16:
+        fmt, offset, block_rows = 0, 16, 0
+    elif magic == MAGIC_COMPACT:
+        fmt, _ = struct.unpack(">II", data[16:24])
+        offset, block_rows = 24, 0
+    elif magic == MAGIC_BLOCK:
+        fmt, _, block_rows, _ = struct.unpack(">IIII", data[16:32])
+        offset = 32
+    else:
+        raise SystemExit(f"{path}: not a native image")
+    stride = align8((width * BITS[fmt] + 7) // 8)
+    palette_size = PALETTE_COLORS.get(fmt, 0) * 2
+    if magic != MAGIC_BLOCK:
+        pixels = data[offset:offset + height * stride]
+        palette = data[offset + height * stride:offset + size]
+        return width, height, fmt, stride, pixels, palette, 0
+
+    def block(pos, raw_size):
+        packed_size, crc = struct.unpack(">II", data[pos:pos + 8])
+        raw = data[pos + 8:pos + 8 + packed_size]
+        if packed_size != raw_size:
+            raw = zlib.decompress(raw, -15)
+        if zlib.crc32(raw) != crc:
+            raise SystemExit(f"{path}: block checksum mismatch")
+        return raw, pos + 8 + packed_size
+
+    pos = offset
+    palette = b""
+    if palette_size:
+        palette, pos = block(pos, palette_size)
+    rows = bytearray()
+    for y in range(0, height, block_rows):
+        raw, pos = block(pos, min(block_rows, height - y) * stride)
+        rows += raw
+    return width, height, fmt, stride, bytes(rows), palette, block_rows
+
+
+def pack_block(raw: bytes):
+    """Return the encoded block and whether it is deflated (blocks that don't shrink are stored)."""
+    packer = zlib.compressobj(9, zlib.DEFLATED, -15)
+    packed = packer.compress(raw) + packer.flush()
+    deflated = len(packed) < len(raw)
+    if not deflated:
+        packed = raw
+    return struct.pack(">II", len(packed), zlib.crc32(raw)) + packed, deflated
+
+
+def encode_v2(image, block_rows: int):
+    """Return the NIM2 file and the number of payload bytes that need inflating."""
+    width, height, fmt, stride, pixels, palette, _ = image
+    block_rows = max(1, min(block_rows, height, (64 * 1024) // stride))
+    size = len(pixels) + len(palette)
+    out = bytearray(struct.pack(">IIIIIIII", MAGIC_BLOCK, width, height, size, fmt, stride, block_rows, 0))
+    blocks = [palette] if palette else []
+    blocks += [pixels[y * stride:min(y + block_rows, height) * stride] for y in range(0, height, block_rows)]
+    inflated = 0
+    for raw in blocks:
+        encoded, deflated = pack_block(raw)
+        out += encoded
+        inflated += len(raw) if deflated else 0
+    return bytes(out), inflated
+
+
+def pack(src: Path, dst: Path, block_rows: int):
+    image = read_image(src)
+    encoded, _ = encode_v2(image, block_rows)
+    raw_size = len(image[4]) + len(image[5])
+    dst.write_bytes(encoded)
+    print(f"{dst}: {len(encoded)} bytes (payload {raw_size}, {100 * len(encoded) / raw_size:.0f}%)")
+
+
+def bench(paths):
+    sd = float(os.environ.get("SD_MIBPS", "2.0")) * 1024 * 1024
+    inflate = float(os.environ.get("INFLATE_MIBPS", "3.0")) * 1024 * 1024
+    crc = float(os.environ.get("CRC_MIBPS", "8.0")) * 1024 * 1024
+    print(f"model: SD {sd / 1048576:.1f} MiB/s, inflate {inflate / 1048576:.1f} MiB/s, crc {crc / 1048576:.1f} MiB/s")
+    for path in paths:
+        image = read_image(Path(path))
+        encoded, inflated = encode_v2(image, image[6] or 16)
+        raw_size = len(image[4]) + len(image[5])
+        start = time.perf_counter()
+        decoded = parse_image(encoded, path)[4]
+        host_ms = (time.perf_counter() - start) * 1000
+        assert decoded == image[4], "round trip mismatch"
+        raw_ms = raw_size / sd * 1000
+        # Stored blocks skip inflate but are still checksummed.
+        packed_ms = (len(encoded) / sd + inflated / inflate + raw_size / crc) * 1000
+        print(f"{path}: raw {raw_size} B {raw_ms:.1f} ms | v2 {len(encoded)} B {packed_ms:.1f} ms | host decode {host_ms:.1f} ms")
+
+
+mode = sys.argv[1]
+if mode == "one":
+    pack(Path(sys.argv[2]), Path(sys.argv[3]), int(sys.argv[4]) if len(sys.argv) > 4 else 16)
+elif mode == "batch":
+    count = 0
+    for src in sorted(Path(sys.argv[2]).rglob("*.nimg")):
+        pack(src, src, int(sys.argv[3]) if len(sys.argv) > 3 else 16)
+        count += 1
+    print(f"packed {count} native images")
+else:
+    bench(sys.argv[2:])
+PY
+}
+
 convert_screensaver() {
   local input="$1"
   local output="$2"
@@ -509,6 +798,11 @@ main() {
     bg) [[ $# -eq 2 ]] || die "usage: $0 bg <input> <output.png>"; convert_bg "$1" "$2" ;;
     bg-native) [[ $# -eq 2 ]] || die "usage: $0 bg-native <input> <output.nimg>"; convert_bg_native "$1" "$2" ;;
     bg-native-batch) [[ $# -eq 1 ]] || die "usage: $0 bg-native-batch <dir>"; convert_bg_native_batch "$1" ;;
+    nimg-compact) [[ $# -ge 2 && $# -le 3 ]] || die "usage: $0 nimg-compact <input.nimg> <output.nimg> [auto|ci8|ci4|i4|ia8]"; need_file "$1"; convert_nimg_compact one "$@" ;;
+    nimg-pack) [[ $# -ge 2 && $# -le 3 ]] || die "usage: $0 nimg-pack <input.nimg> <output.nimg> [block_rows]"; need_file "$1"; convert_nimg_pack one "$@" ;;
+    nimg-pack-batch) [[ $# -ge 1 && $# -le 2 ]] || die "usage: $0 nimg-pack-batch <dir> [block_rows]"; [[ -d "$1" ]] || die "directory not found: $1"; convert_nimg_pack batch "$@" ;;
+    nimg-bench) [[ $# -ge 1 ]] || die "usage: $0 nimg-bench <file.nimg> [more...]"; convert_nimg_pack bench "$@" ;;
+    nimg-compact-batch) [[ $# -ge 1 && $# -le 2 ]] || die "usage: $0 nimg-compact-batch <dir> [auto|ci8|ci4|i4|ia8]"; [[ -d "$1" ]] || die "directory not found: $1"; convert_nimg_compact batch "$@" ;;
     screensaver) [[ $# -eq 2 ]] || die "usage: $0 screensaver <input> <output.png>"; convert_screensaver "$1" "$2" ;;
     screensaver-native) [[ $# -eq 2 ]] || die "usage: $0 screensaver-native <input> <output.nimg>"; convert_screensaver_native "$1" "$2" ;;
     screensaver-native-batch) [[ $# -eq 1 ]] || die "usage: $0 screensaver-native-batch <dir>"; convert_screensaver_native_batch "$1" ;;
@@ -0,0 +1,285 @@
+/**
+ * @file header_bench.c
+ * @brief Host benchmark of batched ROM header reads on a simulated card
+ * @ingroup menu
+ *
+ * Writes ROMs into a few directories and reads their headers in playlist
+ * (title) order, one by one with rom_info_read_quick() and in batches with
+ * rom_info_read_quick_batch(). The simulated card lays the files of each
+ * directory out in listing order, so a header read that goes back in its
+ * directory, or to another directory, counts as a seek. Checks both paths
+ * return the same headers, and prints the opens, seeks and directory
+ * listings each took.
+ *
+ *   header_bench <work dir> [ROMs per directory]
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <libdragon.h>
+
+typedef struct {
+    unsigned long opens;
+    unsigned long seeks;
+    unsigned long listings;
+} card_stats_t;
+
+typedef struct {
+    char path[64];
+    int directory;
+    int entry;
+    char game_code[4];
+    char title[21];
+} card_file_t;
+
+#define DIRECTORIES         (4)
+#define MAX_FILES           (DIRECTORIES * 256)
+#define BATCH_SIZE          (8)     /* As the grid prewarm reads them */
+
+static card_file_t card_files[MAX_FILES];
+static int card_files_count;
+static card_stats_t card_stats;
+static int card_directory = -1;
+static int card_entry = -1;
+
+
+static FILE *counted_fopen (const char *path, const char *mode) {
+    card_stats.opens += 1;
+    for (int i = 0; i < card_files_count; i++) {
+        const card_file_t *file = &card_files[i];
+        if (!strcmp(file->path, path)) {
+            if ((file->directory != card_directory) || (file->entry <= card_entry)) {
+                card_stats.seeks += 1;
+            }
+            card_directory = file->directory;
+            card_entry = file->entry;
+            break;
+        }
+    }
+    return fopen(path, mode);
+}
+
+static int counted_dir_findfirst (const char *const path, dir_t *dir) {
+    card_stats.listings += 1;
+    return dir_findfirst(path, dir);
+}
+
+#define fopen(path, mode)               counted_fopen(path, mode)
+#define dir_findfirst(path, dir)        counted_dir_findfirst(path, dir)
+
+#include "menu/rom_info.c"
+
+#undef fopen
+#undef dir_findfirst
+
+static const char *directories[DIRECTORIES] = {
+    "sd:/roms/a",
+    "sd:/roms/b",
+    "sd:/roms/c",
+    "sd:/roms/d",
+};
+
+static uint32_t rng_state = 0x4E3634;
+
+static uint32_t rng_next (void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static bool make_directories (const char *path) {
+    char partial[512];
+
+    for (size_t i = 1; path[i] != '\0'; i++) {
+        if (path[i] == '/') {
+            snprintf(partial, sizeof(partial), "%.*s", (int) (i), path);
+            if (mkdir(partial, 0755) && (errno != EEXIST)) {
+                return false;
+            }
+        }
+    }
+    return (mkdir(path, 0755) == 0) || (errno == EEXIST);
+}
+
+/* The header is written in host byte order, which is how rom_info.c reads it on the host */
+static bool write_rom (const char *path, const card_file_t *header) {
+    uint8_t rom[4096] = {0};
+    uint32_t pi_config = PI_CONFIG_BIG_ENDIAN;
+
+    memcpy(&rom[0x00], &pi_config, sizeof(pi_config));
+    memcpy(&rom[0x20], header->title, 20);
+    memcpy(&rom[0x3B], header->game_code, 4);
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    fwrite(rom, 1, sizeof(rom), f);
+    return (fclose(f) == 0);
+}
+
+/* The card lays out each directory's files in the order the directory lists them */
+static bool map_card (int per_directory) {
+    dir_t info;
+    char path[64];
+
+    for (int d = 0; d < DIRECTORIES; d++) {
+        int entry = 0;
+        for (int result = dir_findfirst(directories[d], &info); result == 0; result = dir_findnext(directories[d], &info)) {
+            snprintf(path, sizeof(path), "%s/%.40s", directories[d], info.d_name);
+            for (int i = 0; i < per_directory; i++) {
+                card_file_t *file = &card_files[(d * per_directory) + i];
+                if (!strcmp(file->path, path)) {
+                    file->entry = entry++;
+                    break;
+                }
+            }
+        }
+        if (entry != per_directory) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void card_reset (void) {
+    memset(&card_stats, 0, sizeof(card_stats));
+    card_directory = -1;
+    card_entry = -1;
+}
+
+static void print_result (const char *name) {
+    printf("%-16s %8lu %8lu %8lu\n", name, card_stats.opens, card_stats.seeks, card_stats.listings);
+}
+
+static int compare_titles (const void *a, const void *b) {
+    const rom_quick_header_t *lhs = a;
+    const rom_quick_header_t *rhs = b;
+    return strcmp(lhs->title, rhs->title);
+}
+
+static int check_results (const char *name, const rom_quick_header_t *items, const rom_quick_header_t *expected, size_t count) {
+    int failures = 0;
+    for (size_t i = 0; i < count; i++) {
+        if ((items[i].err != ROM_OK) || memcmp(items[i].game_code, expected[i].game_code, 4) || strcmp(items[i].title, expected[i].title)) {
+            printf("FAIL %s: %s read as '%.4s' '%s'\n", name, items[i].path, items[i].game_code, items[i].title);
+            failures += 1;
+        }
+    }
+    return failures;
+}
+
+int main (int argc, char *argv[]) {
+    static rom_quick_header_t expected[MAX_FILES];
+    static rom_quick_header_t items[MAX_FILES];
+    int failures = 0;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <work dir> [ROMs per directory]\n", argv[0]);
+        return 2;
+    }
+
+    int per_directory = (argc > 2) ? atoi(argv[2]) : 64;
+    if ((per_directory <= 0) || ((per_directory * DIRECTORIES) > MAX_FILES)) {
+        fprintf(stderr, "error: up to %d ROMs per directory\n", MAX_FILES / DIRECTORIES);
+        return 2;
+    }
+
+    if (!make_directories(argv[1]) || chdir(argv[1])) {
+        fprintf(stderr, "error: cannot set up %s\n", argv[1]);
+        return 1;
+    }
+
+    for (int d = 0; d < DIRECTORIES; d++) {
+        if (!make_directories(directories[d])) {
+            fprintf(stderr, "error: cannot create %s\n", directories[d]);
+            return 1;
+        }
+        for (int i = 0; i < per_directory; i++) {
+            card_file_t *file = &card_files[card_files_count++];
+            snprintf(file->path, sizeof(file->path), "%s/rom %03d.z64", directories[d], i);
+            snprintf(file->title, sizeof(file->title), "GAME %08lX %c%03u", (unsigned long) (rng_next()), 'A' + d, (unsigned) (i) % 1000);
+            file->directory = d;
+            file->game_code[0] = 'N';
+            for (int c = 1; c < 4; c++) {
+                file->game_code[c] = 'A' + (rng_next() % 26);
+            }
+            if (!write_rom(file->path, file)) {
+                fprintf(stderr, "error: cannot write %s\n", file->path);
+                return 1;
+            }
+        }
+    }
+
+    if (!map_card(per_directory)) {
+        fprintf(stderr, "error: cannot list the ROM directories\n");
+        return 1;
+    }
+
+    // Playlist order: sorted by title, which jumps between directories and entries.
+    size_t count = (size_t) (card_files_count);
+    for (size_t i = 0; i < count; i++) {
+        expected[i].path = card_files[i].path;
+        expected[i].err = ROM_OK;
+        memcpy(expected[i].game_code, card_files[i].game_code, 4);
+        memcpy(expected[i].title, card_files[i].title, sizeof(expected[i].title));
+    }
+    qsort(expected, count, sizeof(expected[0]), compare_titles);
+
+    printf("%d directories, %zu ROMs\n", DIRECTORIES, count);
+    printf("%-16s %8s %8s %8s\n", "path", "opens", "seeks", "listings");
+
+    card_reset();
+    for (size_t i = 0; i < count; i++) {
+        items[i] = (rom_quick_header_t) { .path = expected[i].path };
+        items[i].err = rom_info_read_quick(items[i].path, items[i].game_code, items[i].title);
+    }
+    print_result("per file");
+    failures += check_results("per file", items, expected, count);
+    card_stats_t per_file = card_stats;
+
+    card_reset();
+    rom_info_read_quick_batch_reset();
+    for (size_t i = 0; i < count; i++) {
+        items[i] = (rom_quick_header_t) { .path = expected[i].path };
+    }
+    for (size_t start = 0; start < count; start += BATCH_SIZE) {
+        rom_info_read_quick_batch(&items[start], MIN((size_t) (BATCH_SIZE), count - start));
+    }
+    print_result("batches of 8");
+    failures += check_results("batches of 8", items, expected, count);
+    if (card_stats.seeks > per_file.seeks) {
+        printf("FAIL batches of 8: more seeks than per file reads\n");
+        failures += 1;
+    }
+    if (card_stats.listings > DIRECTORIES) {
+        printf("FAIL batches of 8: listed a directory more than once\n");
+        failures += 1;
+    }
+
+    card_reset();
+    rom_info_read_quick_batch_reset();
+    for (size_t i = 0; i < count; i++) {
+        items[i] = (rom_quick_header_t) { .path = expected[i].path };
+    }
+    rom_info_read_quick_batch(items, count);
+    print_result("one batch");
+    failures += check_results("one batch", items, expected, count);
+    if (card_stats.seeks != DIRECTORIES) {
+        printf("FAIL one batch: %lu seeks, expected one per directory\n", card_stats.seeks);
+        failures += 1;
+    }
+
+    if (failures) {
+        printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
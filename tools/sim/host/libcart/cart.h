@@ -0,0 +1,24 @@
+/**
+ * @file cart.h
+ * @brief Host stand-in for the parts of libcart used by the flashcart load path
+ *
+ * The functions are implemented in sim_pi.c, on top of the simulated cart.
+ */
+
+#ifndef HOST_LIBCART_CART_H__
+#define HOST_LIBCART_CART_H__
+
+#include <stdint.h>
+
+#define CART_NULL   (-1)
+#define CART_CI     (0)
+#define CART_EDX    (1)
+#define CART_ED     (2)
+#define CART_SC     (3)
+
+extern int cart_type;
+extern int cart_card_byteswap;
+
+int cart_card_rd_cart (uint64_t cart, uint32_t lba, uint32_t count);
+
+#endif /* HOST_LIBCART_CART_H__ */
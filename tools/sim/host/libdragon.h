@@ -0,0 +1,44 @@
+/**
+ * @file libdragon.h
+ * @brief Host stand-in for the parts of libdragon used by the host tools
+ *
+ * The PI and boot functions are implemented in sim_pi.c, on top of the
+ * simulated cart, the directory functions in host_fs.c.
+ */
+
+#ifndef HOST_LIBDRAGON_H__
+#define HOST_LIBDRAGON_H__
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define debugf(...)     fprintf(stderr, __VA_ARGS__)
+
+void dma_read_async (void *ram_address, unsigned long pi_address, unsigned long len);
+void dma_write_raw_async (const void *ram_address, unsigned long pi_address, unsigned long len);
+void dma_wait (void);
+void data_cache_hit_writeback (volatile const void *addr, unsigned long length);
+void data_cache_hit_writeback_invalidate (volatile void *addr, unsigned long length);
+void io_write (uint32_t pi_address, uint32_t data);
+
+#define DT_REG  (1)
+#define DT_DIR  (2)
+
+typedef struct {
+    char d_name[256];
+    int d_type;
+    int64_t d_size;
+} dir_t;
+
+int dir_findfirst (const char *const path, dir_t *dir);
+int dir_findnext (const char *const path, dir_t *dir);
+
+bool sys_bbplayer (void);
+int bbfs_init (void);
+bool debug_init_sdfs (const char *prefix, int npart);
+bool debug_init_isviewer (void);
+bool debug_init_usblog (void);
+
+#endif /* HOST_LIBDRAGON_H__ */
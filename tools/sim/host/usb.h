@@ -0,0 +1,9 @@
+/**
+ * @file usb.h
+ * @brief Host stand-in for the USB library, nothing from it is used by the load path
+ */
+
+#ifndef HOST_USB_H__
+#define HOST_USB_H__
+
+#endif /* HOST_USB_H__ */
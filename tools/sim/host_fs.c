@@ -0,0 +1,89 @@
+/**
+ * @file host_fs.c
+ * @brief Host stand-ins for the libdragon directory and FatFs calls of the menu code
+ * @ingroup menu
+ *
+ * The host tests keep their "sd:/" tree in a directory called "sd:" inside
+ * the working directory, so menu paths can be opened as they are. Only one
+ * directory listing can be in progress at a time.
+ */
+
+#include <dirent.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/* libdragon numbers the entry types differently, only its values are used here */
+#undef DT_REG
+#undef DT_DIR
+
+#include <fatfs/ff.h>
+#include <libdragon.h>
+
+
+static DIR *listing;
+static char listing_path[512];
+
+
+static int dir_fill (dir_t *dir) {
+    struct dirent *entry;
+    struct stat st;
+    char path[1024];
+
+    while ((entry = readdir(listing)) != NULL) {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..")) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", listing_path, entry->d_name);
+        if (stat(path, &st)) {
+            continue;
+        }
+        snprintf(dir->d_name, sizeof(dir->d_name), "%s", entry->d_name);
+        dir->d_type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+        dir->d_size = st.st_size;
+        return 0;
+    }
+
+    closedir(listing);
+    listing = NULL;
+    return -1;
+}
+
+int dir_findfirst (const char *const path, dir_t *dir) {
+    if (listing) {
+        closedir(listing);
+    }
+    snprintf(listing_path, sizeof(listing_path), "%s", path);
+    if (!(listing = opendir(path))) {
+        return -1;
+    }
+    return dir_fill(dir);
+}
+
+int dir_findnext (const char *const path, dir_t *dir) {
+    if (!listing) {
+        return -1;
+    }
+    return dir_fill(dir);
+}
+
+/* utils/fs.c renames and deletes through FatFs, which sees the volume root as "/" */
+static void host_path (char *out, size_t length, const TCHAR *path) {
+    snprintf(out, length, "sd:%s", path);
+}
+
+FRESULT f_rename (const TCHAR *path_old, const TCHAR *path_new) {
+    char old_path[512];
+    char new_path[512];
+
+    host_path(old_path, sizeof(old_path), path_old);
+    host_path(new_path, sizeof(new_path), path_new);
+    return rename(old_path, new_path) ? FR_DENIED : FR_OK;
+}
+
+FRESULT f_unlink (const TCHAR *path) {
+    char host[512];
+
+    host_path(host, sizeof(host), path);
+    return remove(host) ? FR_NO_FILE : FR_OK;
+}
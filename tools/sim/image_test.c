@@ -0,0 +1,309 @@
+/**
+ * @file image_test.c
+ * @brief Host golden image tests for the image_convert downscaler
+ * @ingroup menu
+ *
+ * Runs against the images in image_vectors/, see mkgolden.py there. Also
+ * checks the RGB8 to RGBA16 row kernel against its reference implementation
+ * and prints how long each takes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "acutest/acutest.h"
+#include "menu/image_convert.h"
+
+#ifndef IMAGE_VECTORS_DIR
+#define IMAGE_VECTORS_DIR "image_vectors"
+#endif
+
+#define VECTOR(name)    (IMAGE_VECTORS_DIR "/" name)
+
+/* Output rows are written this many pixels apart, to catch stride mistakes */
+#define STRIDE_PADDING  (3)
+
+/* Widest PNG row the menu decodes, the kernel is timed on rows this long */
+#define KERNEL_MAX_WIDTH    (640)
+#define KERNEL_ROWS         (2000)
+#define KERNEL_ITERATIONS   (20000)
+
+
+typedef struct {
+    const char *path;
+    int box_width;      /**< Box passed to image_convert_fit_size */
+    int box_height;
+    int width;          /**< Size of the golden image */
+    int height;
+    bool dither;
+} golden_t;
+
+static const golden_t boxart_goldens[] = {
+    { VECTOR("boxart_64x64.rgba16"), 64, 80, 64, 64, false },
+    { VECTOR("boxart_64x64_dither.rgba16"), 64, 80, 64, 64, true },
+    { VECTOR("boxart_100x100.rgba16"), 100, 100, 100, 100, false },
+    { VECTOR("boxart_100x100_dither.rgba16"), 100, 100, 100, 100, true },
+    { VECTOR("boxart_37x37.rgba16"), 37, 53, 37, 37, false },
+    { VECTOR("boxart_37x37_dither.rgba16"), 37, 53, 37, 37, true },
+};
+
+static const golden_t wide_goldens[] = {
+    { VECTOR("wide_50x22.rgba16"), 50, 50, 50, 22, false },
+    { VECTOR("wide_50x22_dither.rgba16"), 50, 50, 50, 22, true },
+    { VECTOR("wide_208x96.rgba16"), 210, 96, 208, 96, false },
+    { VECTOR("wide_208x96_dither.rgba16"), 210, 96, 208, 96, true },
+};
+
+static const golden_t native_goldens[] = {
+    { VECTOR("native_64x60.rgba16"), 64, 80, 64, 60, false },
+    { VECTOR("native_45x42.rgba16"), 45, 45, 45, 42, false },
+};
+
+
+static uint8_t *load_file (const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *size = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(*size);
+    if (data && fread(data, 1, *size, f) != *size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+/* Binary PPM as written by mkgolden.py: "P6\n<w> <h>\n255\n" then RGB8 pixels */
+static uint8_t *load_ppm (const char *path, int *width, int *height) {
+    size_t size;
+    int header = 0;
+    uint8_t *data = load_file(path, &size);
+    if (!data || (sscanf((const char *)data, "P6 %d %d 255%n", width, height, &header) != 2) || (header == 0)) {
+        free(data);
+        return NULL;
+    }
+    header += 1;
+    if (size != ((size_t)header + ((size_t)*width * *height * 3))) {
+        free(data);
+        return NULL;
+    }
+    memmove(data, data + header, size - header);
+    return data;
+}
+
+/* Big endian RGBA16 to host order, which is what image_convert writes on the host */
+static uint16_t *load_rgba16 (const char *path, size_t *pixels) {
+    size_t size;
+    uint8_t *data = load_file(path, &size);
+    if (!data) {
+        return NULL;
+    }
+    *pixels = size / 2;
+    uint16_t *out = malloc(*pixels * sizeof(uint16_t));
+    for (size_t i = 0; out && (i < *pixels); i++) {
+        out[i] = (uint16_t)((data[i * 2] << 8) | data[(i * 2) + 1]);
+    }
+    free(data);
+    return out;
+}
+
+static int count_mismatches (const uint16_t *output, size_t stride, const uint16_t *golden, int width, int height) {
+    int mismatches = 0;
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint16_t got = output[(y * stride) + x];
+            uint16_t want = golden[(y * width) + x];
+            if ((got != want) && (mismatches++ == 0)) {
+                TEST_MSG("first mismatch at %d,%d: 0x%04X, expected 0x%04X", x, y, got, want);
+            }
+        }
+    }
+    return mismatches;
+}
+
+/**
+ * Downscale @p source into every golden image, one source row at a time.
+ * RGB8 sources are @p width * 3 bytes per row, RGBA16 sources @p width pixels.
+ */
+static void check_goldens (const void *source, bool rgba16, int width, int height, const golden_t *goldens, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const golden_t *golden = &goldens[i];
+        TEST_CASE(golden->path);
+
+        int fit_width = width;
+        int fit_height = height;
+        TEST_CHECK(image_convert_fit_size(&fit_width, &fit_height, golden->box_width, golden->box_height));
+        TEST_CHECK(fit_width == golden->width && fit_height == golden->height);
+
+        size_t golden_pixels;
+        uint16_t *expected = load_rgba16(golden->path, &golden_pixels);
+        TEST_ASSERT(expected != NULL);
+        TEST_ASSERT(golden_pixels == ((size_t)golden->width * golden->height));
+
+        size_t stride = golden->width + STRIDE_PADDING;
+        size_t stride_bytes = stride * sizeof(uint16_t);
+        uint16_t *output = calloc(stride * golden->height, sizeof(uint16_t));
+        TEST_ASSERT(output != NULL);
+
+        image_convert_downscale_t ds;
+        TEST_ASSERT(image_convert_downscale_init(&ds, width, height, golden->width, golden->height));
+        for (int y = 0; y < height; y++) {
+            if (rgba16) {
+                const uint16_t *row = (const uint16_t *)source + ((size_t)y * width);
+                image_convert_downscale_push_rgba16_row(&ds, row, y, output, stride_bytes, golden->dither);
+            } else {
+                const uint8_t *row = (const uint8_t *)source + ((size_t)y * width * 3);
+                image_convert_downscale_push_row(&ds, row, y, output, stride_bytes, golden->dither);
+            }
+        }
+        image_convert_downscale_finish(&ds, output, stride_bytes, golden->dither);
+        image_convert_downscale_free(&ds);
+
+        TEST_CHECK(count_mismatches(output, stride, expected, golden->width, golden->height) == 0);
+
+        free(output);
+        free(expected);
+    }
+}
+
+static void check_rgb8_goldens (const char *source_path, const golden_t *goldens, size_t count) {
+    int width, height;
+    uint8_t *source = load_ppm(source_path, &width, &height);
+    TEST_ASSERT(source != NULL);
+    check_goldens(source, false, width, height, goldens, count);
+    free(source);
+}
+
+
+static void test_downscale_boxart (void) {
+    check_rgb8_goldens(VECTOR("boxart.ppm"), boxart_goldens, sizeof(boxart_goldens) / sizeof(boxart_goldens[0]));
+}
+
+static void test_downscale_wide (void) {
+    check_rgb8_goldens(VECTOR("wide.ppm"), wide_goldens, sizeof(wide_goldens) / sizeof(wide_goldens[0]));
+}
+
+static void test_downscale_rgba16 (void) {
+    size_t pixels;
+    uint16_t *source = load_rgba16(VECTOR("native.rgba16"), &pixels);
+    TEST_ASSERT(source != NULL);
+    TEST_ASSERT(pixels == (150 * 142));
+    check_goldens(source, true, 150, 142, native_goldens, sizeof(native_goldens) / sizeof(native_goldens[0]));
+    free(source);
+}
+
+static void test_downscale_fit_size (void) {
+    int width = 40;
+    int height = 30;
+    TEST_CHECK(!image_convert_fit_size(&width, &height, 64, 80));
+    TEST_CHECK(width == 40 && height == 30);
+
+    image_convert_downscale_t ds;
+    TEST_CHECK(!image_convert_downscale_init(&ds, 40, 30, 41, 30));
+    TEST_CHECK(!image_convert_downscale_init(&ds, 40, 30, 0, 30));
+}
+
+static uint32_t rng_next (uint32_t *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 17;
+    *state ^= *state << 5;
+    return *state;
+}
+
+static double now_us (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000.0) + (ts.tv_nsec / 1000.0);
+}
+
+static void test_rgba16_kernel (void) {
+    // One spare byte/pixel in front, so rows can start unaligned.
+    uint8_t *src = malloc((KERNEL_MAX_WIDTH * 3) + 1);
+    uint16_t *dst = malloc((KERNEL_MAX_WIDTH + 1) * sizeof(uint16_t));
+    uint16_t *expected = malloc(KERNEL_MAX_WIDTH * sizeof(uint16_t));
+    TEST_ASSERT(src != NULL && dst != NULL && expected != NULL);
+
+    uint32_t state = 0x4E3634;
+    int mismatches = 0;
+    char first_mismatch[128] = "";
+    for (int row = 0; row < KERNEL_ROWS; row++) {
+        int width = (row < KERNEL_MAX_WIDTH) ? (row + 1) : (1 + (int)(rng_next(&state) % KERNEL_MAX_WIDTH));
+        int src_offset = row & 1;
+        int dst_offset = (row >> 1) & 1;
+        bool dither = (row >> 2) & 1;
+        int y = (row >> 3) & 3;
+
+        // Mostly extremes, where the dither add saturates, and random bytes in between.
+        for (int i = 0; i < width * 3; i++) {
+            uint32_t r = rng_next(&state);
+            src[src_offset + i] = ((r & 3) == 0) ? 0xFF : (((r & 3) == 1) ? 0x00 : (uint8_t)(r >> 8));
+        }
+
+        image_convert_rgb8_to_rgba16_row_reference(expected, src + src_offset, width, y, dither);
+        image_convert_rgb8_to_rgba16_row(dst + dst_offset, src + src_offset, width, y, dither);
+        if (memcmp(dst + dst_offset, expected, width * sizeof(uint16_t)) != 0) {
+            if (mismatches++ == 0) {
+                snprintf(first_mismatch, sizeof(first_mismatch), "width %d, src offset %d, dst offset %d, dither %d, y %d",
+                    width, src_offset, dst_offset, dither, y);
+            }
+        }
+    }
+    TEST_CHECK(mismatches == 0);
+    TEST_MSG("%d of %d rows differ, first: %s", mismatches, KERNEL_ROWS, first_mismatch);
+
+    free(expected);
+    free(dst);
+    free(src);
+}
+
+static void test_rgba16_kernel_speed (void) {
+    uint8_t *src = malloc(KERNEL_MAX_WIDTH * 3);
+    uint16_t *dst = malloc(KERNEL_MAX_WIDTH * sizeof(uint16_t));
+    TEST_ASSERT(src != NULL && dst != NULL);
+
+    uint32_t state = 0x4E3634;
+    for (int i = 0; i < KERNEL_MAX_WIDTH * 3; i++) {
+        src[i] = (uint8_t)rng_next(&state);
+    }
+
+    for (int dither = 0; dither < 2; dither++) {
+        double start = now_us();
+        for (int n = 0; n < KERNEL_ITERATIONS; n++) {
+            image_convert_rgb8_to_rgba16_row_reference(dst, src, KERNEL_MAX_WIDTH, n, dither);
+            __asm__ volatile("" : : "r"(dst) : "memory");
+        }
+        double reference_us = (now_us() - start) / KERNEL_ITERATIONS;
+
+        start = now_us();
+        for (int n = 0; n < KERNEL_ITERATIONS; n++) {
+            image_convert_rgb8_to_rgba16_row(dst, src, KERNEL_MAX_WIDTH, n, dither);
+            __asm__ volatile("" : : "r"(dst) : "memory");
+        }
+        double kernel_us = (now_us() - start) / KERNEL_ITERATIONS;
+
+        // Timing depends on the host and build flags, so it's reported but not checked.
+        printf("\n  %d pixel row%s: kernel %.3f us, reference %.3f us (%.2fx)",
+            KERNEL_MAX_WIDTH, dither ? ", dithered" : "", kernel_us, reference_us, reference_us / kernel_us);
+    }
+    printf("\n");
+
+    free(dst);
+    free(src);
+}
+
+
+TEST_LIST = {
+    { "downscale/boxart", test_downscale_boxart },
+    { "downscale/wide", test_downscale_wide },
+    { "downscale/rgba16", test_downscale_rgba16 },
+    { "downscale/fit-size", test_downscale_fit_size },
+    { "rgba16/kernel", test_rgba16_kernel },
+    { "rgba16/kernel-speed", test_rgba16_kernel_speed },
+    { NULL, NULL }
+};
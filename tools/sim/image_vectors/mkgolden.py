@@ -0,0 +1,115 @@
+#!/usr/bin/env python3
+"""
+Regenerate the golden images used by tools/sim/image_test.c.
+
+The box filter and RGBA16 conversion here are written from their
+description in src/menu/image_convert.h, one output pixel at a time, and
+don't share code with the streaming C version. Output is deterministic.
+
+  <name>.ppm                   RGB8 source image (binary PPM)
+  <name>.rgba16                RGBA16 source image, big endian, 5551
+  <name>_<w>x<h>[_dither].rgba16
+                               golden downscale of <name> fitted to <w>x<h>
+"""
+
+from __future__ import annotations
+
+import random
+import struct
+from pathlib import Path
+
+BAYER4 = [
+    [0, 4, 1, 5],
+    [6, 2, 7, 3],
+    [1, 5, 0, 4],
+    [7, 3, 6, 2],
+]
+
+# Source name, size, boxes to fit into (the grid cell sizes used by the menu and awkward ratios)
+RGB8_SOURCES = [
+    ("boxart", 158, 158, [(64, 80), (100, 100), (37, 53)]),
+    ("wide", 211, 97, [(50, 50), (210, 96)]),
+]
+RGBA16_SOURCES = [
+    ("native", 150, 142, [(64, 80), (45, 45)]),
+]
+
+
+def make_rgb8(rng: random.Random, width: int, height: int) -> list:
+    # Gradients with noise and a few hard edges, so rounding and column mapping both show up.
+    pixels = []
+    for y in range(height):
+        for x in range(width):
+            r = (x * 255) // max(1, width - 1)
+            g = (y * 255) // max(1, height - 1)
+            b = 255 if ((x // 9) + (y // 7)) % 2 else 0
+            noise = rng.randint(-24, 24)
+            pixels.append(tuple(max(0, min(255, c + noise)) for c in (r, g, b)))
+    return pixels
+
+
+def fit_size(width: int, height: int, max_width: int, max_height: int) -> tuple[int, int]:
+    if width <= max_width and height <= max_height:
+        return width, height
+    if max_width * height <= max_height * width:
+        return max_width, max(1, (height * max_width) // width)
+    return max(1, (width * max_height) // height), max_height
+
+
+def rgba16(r: int, g: int, b: int, t: int) -> int:
+    r, g, b = (min(255, c + t) for c in (r, g, b))
+    return ((r >> 3) << 11) | ((g >> 3) << 6) | ((b >> 3) << 1) | 1
+
+
+def widen(pixel: int) -> tuple[int, int, int]:
+    channels = ((pixel >> 11) & 0x1F, (pixel >> 6) & 0x1F, (pixel >> 1) & 0x1F)
+    return tuple((c << 3) | (c >> 2) for c in channels)
+
+
+def downscale(pixels: list, width: int, height: int, dst_width: int, dst_height: int, dither: bool) -> list:
+    out = []
+    for dy in range(dst_height):
+        rows = [y for y in range(height) if (y * dst_height) // height == dy]
+        for dx in range(dst_width):
+            cols = [x for x in range(width) if (x * dst_width) // width == dx]
+            count = len(rows) * len(cols)
+            sums = [0, 0, 0]
+            for y in rows:
+                for x in cols:
+                    for c in range(3):
+                        sums[c] += pixels[y * width + x][c]
+            r, g, b = ((s + count // 2) // count for s in sums)
+            out.append(rgba16(r, g, b, BAYER4[dy & 3][dx & 3] if dither else 0))
+    return out
+
+
+def write_rgba16(path: Path, pixels: list) -> None:
+    path.write_bytes(b"".join(struct.pack(">H", p) for p in pixels))
+
+
+def main() -> None:
+    out_dir = Path(__file__).resolve().parent
+    rng = random.Random(0x4E3634)
+
+    for name, width, height, boxes in RGB8_SOURCES:
+        pixels = make_rgb8(rng, width, height)
+        header = b"P6\n%d %d\n255\n" % (width, height)
+        (out_dir / f"{name}.ppm").write_bytes(header + bytes(c for p in pixels for c in p))
+        for box in boxes:
+            dst_width, dst_height = fit_size(width, height, *box)
+            for dither in (False, True):
+                suffix = "_dither" if dither else ""
+                golden = downscale(pixels, width, height, dst_width, dst_height, dither)
+                write_rgba16(out_dir / f"{name}_{dst_width}x{dst_height}{suffix}.rgba16", golden)
+
+    for name, width, height, boxes in RGBA16_SOURCES:
+        source = [rgba16(*p, 0) for p in make_rgb8(rng, width, height)]
+        write_rgba16(out_dir / f"{name}.rgba16", source)
+        for box in boxes:
+            dst_width, dst_height = fit_size(width, height, *box)
+            golden = downscale([widen(p) for p in source], width, height, dst_width, dst_height, False)
+            write_rgba16(out_dir / f"{name}_{dst_width}x{dst_height}.rgba16", golden)
+
+
+if __name__ == "__main__":
+    main()
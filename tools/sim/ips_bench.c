@@ -0,0 +1,247 @@
+/**
+ * @file ips_bench.c
+ * @brief Host benchmark of the IPS patch cache write
+ * @ingroup menu
+ *
+ * Writes a ROM and an IPS patch with many small records, then builds the
+ * patched copy the two ways rom_patch.c can: record by record on the copy
+ * (ips_patch_apply_file), and with the records applied to each chunk while
+ * the ROM is copied (ips_patch_apply). Checks both copies match, and prints
+ * the time and stdio calls each took.
+ *
+ *   ips_bench <work dir> [ROM MiB] [records]
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+typedef struct {
+    unsigned long fopen;
+    unsigned long fseek;
+    unsigned long fread;
+    unsigned long fwrite;
+} stdio_calls_t;
+
+static stdio_calls_t calls;
+
+static FILE *counted_fopen (const char *path, const char *mode) {
+    calls.fopen += 1;
+    return fopen(path, mode);
+}
+
+static int counted_fseek (FILE *f, long offset, int whence) {
+    calls.fseek += 1;
+    return fseek(f, offset, whence);
+}
+
+static size_t counted_fread (void *ptr, size_t size, size_t count, FILE *f) {
+    calls.fread += 1;
+    return fread(ptr, size, count, f);
+}
+
+static size_t counted_fwrite (const void *ptr, size_t size, size_t count, FILE *f) {
+    calls.fwrite += 1;
+    return fwrite(ptr, size, count, f);
+}
+
+#define fopen(path, mode)               counted_fopen(path, mode)
+#define fseek(f, offset, whence)        counted_fseek(f, offset, whence)
+#define fread(ptr, size, count, f)      counted_fread(ptr, size, count, f)
+#define fwrite(ptr, size, count, f)     counted_fwrite(ptr, size, count, f)
+
+#include "menu/ips_patch.c"
+
+/* Same limits as the cache write in rom_patch.c */
+#define COPY_CHUNK_SIZE     (64 * 1024)
+#define IPS_MAX_DATA        (2 * 1024 * 1024)
+#define IPS_MAX_ROM_SIZE    (16 * 1024 * 1024)
+
+
+static uint32_t rng_state = 0x4E3634;
+
+static uint32_t rng_next (void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static double now_s (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1000000000.0);
+}
+
+static bool write_rom (const char *path, size_t rom_size) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    uint8_t *buf = malloc(COPY_CHUNK_SIZE);
+    bool ok = (buf != NULL);
+    for (size_t offset = 0; ok && offset < rom_size; offset += COPY_CHUNK_SIZE) {
+        for (size_t i = 0; i < COPY_CHUNK_SIZE; i++) {
+            buf[i] = (uint8_t) (rng_next());
+        }
+        ok = (fwrite(buf, 1, COPY_CHUNK_SIZE, f) == COPY_CHUNK_SIZE);
+    }
+    free(buf);
+    return (fclose(f) == 0) && ok;
+}
+
+static bool write_ips (const char *path, size_t rom_size, int records) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    fputs("PATCH", f);
+    for (int i = 0; i < records; i++) {
+        uint32_t length = 1 + (rng_next() % 24);
+        uint32_t offset = rng_next() % (uint32_t) (rom_size - length);
+        if (offset == IPS_EOF_MARKER) {
+            offset += 1;
+        }
+        uint8_t header[8] = { offset >> 16, offset >> 8, offset };
+        if ((rng_next() % 4) == 0) {
+            header[5] = length >> 8;
+            header[6] = length;
+            header[7] = (uint8_t) (rng_next());
+            fwrite(header, 1, 8, f);
+        } else {
+            header[3] = length >> 8;
+            header[4] = length;
+            fwrite(header, 1, 5, f);
+            for (uint32_t j = 0; j < length; j++) {
+                fputc((int) (rng_next() & 0xFF), f);
+            }
+        }
+    }
+    fputs("EOF", f);
+    return (fclose(f) == 0);
+}
+
+static bool copy_rom (const char *src, const char *dst, ips_patch_t *ips) {
+    FILE *in = fopen(src, "rb");
+    FILE *out = fopen(dst, "wb");
+    uint8_t *buf = malloc(COPY_CHUNK_SIZE);
+    bool ok = in && out && buf;
+    uint32_t offset = 0;
+    while (ok) {
+        size_t r = fread(buf, 1, COPY_CHUNK_SIZE, in);
+        if (ips && r > 0) {
+            ips_patch_apply(ips, buf, offset, r);
+        }
+        offset += (uint32_t) (r);
+        if (r > 0 && fwrite(buf, 1, r, out) != r) {
+            ok = false;
+        }
+        if (r < COPY_CHUNK_SIZE) {
+            break;
+        }
+    }
+    free(buf);
+    if (out && fclose(out) != 0) {
+        ok = false;
+    }
+    if (in) {
+        fclose(in);
+    }
+    return ok;
+}
+
+static bool files_equal (const char *a, const char *b) {
+    FILE *fa = fopen(a, "rb");
+    FILE *fb = fopen(b, "rb");
+    bool equal = fa && fb;
+    int ca, cb;
+    while (equal) {
+        ca = fgetc(fa);
+        cb = fgetc(fb);
+        equal = (ca == cb);
+        if (ca == EOF) {
+            break;
+        }
+    }
+    if (fa) {
+        fclose(fa);
+    }
+    if (fb) {
+        fclose(fb);
+    }
+    return equal;
+}
+
+static void print_result (const char *name, double seconds) {
+    printf("%-14s %9.3f %8lu %8lu %8lu %8lu\n", name, seconds, calls.fopen, calls.fseek, calls.fread, calls.fwrite);
+}
+
+int main (int argc, char *argv[]) {
+    char rom_path[512];
+    char ips_path[512];
+    char legacy_path[512];
+    char coalesced_path[512];
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <work dir> [ROM MiB] [records]\n", argv[0]);
+        return 2;
+    }
+
+    size_t rom_size = (size_t) ((argc > 2) ? atoi(argv[2]) : 16) * 1024 * 1024;
+    int records = (argc > 3) ? atoi(argv[3]) : 40000;
+    if (rom_size == 0 || rom_size > IPS_MAX_ROM_SIZE || records <= 0) {
+        fprintf(stderr, "error: IPS reaches up to 16 MiB, and needs at least one record\n");
+        return 2;
+    }
+
+    if (mkdir(argv[1], 0755) && (errno != EEXIST)) {
+        fprintf(stderr, "error: cannot create %s\n", argv[1]);
+        return 1;
+    }
+    snprintf(rom_path, sizeof(rom_path), "%s/rom.z64", argv[1]);
+    snprintf(ips_path, sizeof(ips_path), "%s/patch.ips", argv[1]);
+    snprintf(legacy_path, sizeof(legacy_path), "%s/legacy.z64", argv[1]);
+    snprintf(coalesced_path, sizeof(coalesced_path), "%s/coalesced.z64", argv[1]);
+
+    if (!write_rom(rom_path, rom_size) || !write_ips(ips_path, rom_size, records)) {
+        fprintf(stderr, "error: cannot write %s\n", argv[1]);
+        return 1;
+    }
+
+    printf("%zu MiB ROM, %d IPS records\n", rom_size / (1024 * 1024), records);
+    printf("%-14s %9s %8s %8s %8s %8s\n", "path", "seconds", "fopen", "fseek", "fread", "fwrite");
+
+    memset(&calls, 0, sizeof(calls));
+    double start = now_s();
+    bool ok = copy_rom(rom_path, legacy_path, NULL) && ips_patch_apply_file(legacy_path, ips_path);
+    print_result("record/record", now_s() - start);
+    if (!ok) {
+        fprintf(stderr, "error: record by record apply failed\n");
+        return 1;
+    }
+
+    memset(&calls, 0, sizeof(calls));
+    start = now_s();
+    ips_patch_t *ips = ips_patch_create(IPS_MAX_DATA);
+    ok = ips && (ips_patch_add(ips, ips_path, (int64_t) (rom_size)) == IPS_PATCH_OK) && ips_patch_finish(ips) &&
+        copy_rom(rom_path, coalesced_path, ips);
+    print_result("coalesced", now_s() - start);
+    ips_patch_free(ips);
+    if (!ok) {
+        fprintf(stderr, "error: coalesced apply failed\n");
+        return 1;
+    }
+
+    if (!files_equal(legacy_path, coalesced_path)) {
+        printf("FAIL: patched copies differ\n");
+        return 1;
+    }
+
+    remove(rom_path);
+    remove(legacy_path);
+    remove(coalesced_path);
+    return 0;
+}
@@ -0,0 +1,238 @@
+/**
+ * @file metadata_bench.c
+ * @brief Host benchmark and regression check for the metadata.ini parser
+ * @ingroup menu
+ *
+ * Loads the samples in metadata_samples/ through rom_info.c, as they are and
+ * padded past the parser buffer, checks the parsed fields and times the
+ * single read parser against line by line fgets parsing.
+ *
+ *   metadata_bench <samples dir> <work dir> [iterations]
+ */
+
+#include <errno.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "menu/rom_info.c"
+
+
+typedef struct {
+    const char *sample;
+    const char *game_code;
+    const char *name;
+    const char *genre;
+    int32_t release_year;
+    int32_t players_max;
+    const char *sidecar;
+    const char *hook;
+} metadata_sample_t;
+
+typedef enum {
+    VARIANT_PLAIN,
+    VARIANT_PADDED,
+    VARIANT_LONG_LINE,
+    __VARIANT_END
+} metadata_variant_t;
+
+static const metadata_sample_t samples[] = {
+    { "wave_race_64.ini", "NWRE", "Wave Race 64", "Racing", 1996, 2, NULL, "" },
+    { "mario_kart_64.ini", "NKTE", "Mario Kart 64", "Racing", 1996, 4, "hook.txt", "Race the whole family." },
+    { "star_fox_64.ini", "NFXE", "Star Fox 64", "Shooter", 1997, 4, "starfox_hook.txt", "Do a barrel roll." },
+};
+
+static const char *variant_names[__VARIANT_END] = {
+    "plain",
+    "padded",
+    "long line",
+};
+
+/* More than one parser buffer of comments, so the sample is split across reads */
+#define PADDING_SIZE        (METADATA_INI_BUFFER_SIZE + (METADATA_INI_BUFFER_SIZE / 2) + 7)
+#define LONG_LINE_SIZE      (METADATA_INI_BUFFER_SIZE + 100)
+
+
+static double now_us (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000000.0) + (ts.tv_nsec / 1000.0);
+}
+
+static bool make_directories (const char *path) {
+    char partial[512];
+
+    for (size_t i = 1; path[i] != '\0'; i++) {
+        if (path[i] == '/') {
+            snprintf(partial, sizeof(partial), "%.*s", (int) (i), path);
+            if (mkdir(partial, 0755) && (errno != EEXIST)) {
+                return false;
+            }
+        }
+    }
+    return (mkdir(path, 0755) == 0) || (errno == EEXIST);
+}
+
+static bool write_text (const char *path, const char *text) {
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        return false;
+    }
+    fputs(text, f);
+    return (fclose(f) == 0);
+}
+
+static bool write_sample (const char *samples_dir, const metadata_sample_t *sample, metadata_variant_t variant, const char *directory) {
+    char path[1024];
+
+    snprintf(path, sizeof(path), "%s/%s", samples_dir, sample->sample);
+    FILE *in = fopen(path, "rb");
+    snprintf(path, sizeof(path), "%s/metadata.ini", directory);
+    FILE *out = fopen(path, "wb");
+    if (!in || !out) {
+        if (in) {
+            fclose(in);
+        }
+        if (out) {
+            fclose(out);
+        }
+        return false;
+    }
+
+    if (variant == VARIANT_PADDED) {
+        for (size_t written = 0; written < PADDING_SIZE; written += 32) {
+            fputs("; padding to push the keys out\n", out);
+        }
+    } else if (variant == VARIANT_LONG_LINE) {
+        // A value that doesn't fit the buffer is dropped, the sample's own values win
+        fputs("[metadata]\nname=", out);
+        for (size_t i = 0; i < LONG_LINE_SIZE; i++) {
+            fputc('x', out);
+        }
+        fputs("\n", out);
+    }
+
+    int c;
+    while ((c = fgetc(in)) != EOF) {
+        fputc(c, out);
+    }
+
+    fclose(in);
+    return (fclose(out) == 0);
+}
+
+static void metadata_reset (rom_info_t *rom_info) {
+    memset(&rom_info->metadata, 0, sizeof(rom_info->metadata));
+    rom_info->metadata.esrb_age_rating = ROM_ESRB_AGE_RATING_NONE;
+    rom_info->metadata.age_rating = -1;
+    rom_info->metadata.release_year = -1;
+    rom_info->metadata.players_min = -1;
+    rom_info->metadata.players_max = -1;
+}
+
+static bool check_sample (const metadata_sample_t *sample, const rom_info_t *rom_info) {
+    return
+        !strcmp(rom_info->metadata.name, sample->name) &&
+        !strcmp(rom_info->metadata.genre, sample->genre) &&
+        (rom_info->metadata.release_year == sample->release_year) &&
+        (rom_info->metadata.players_max == sample->players_max) &&
+        !strcmp(rom_info->metadata.hook, sample->hook);
+}
+
+/* The pre-buffer parser read the file with fgets into a 512 byte line */
+static void parse_metadata_file_fgets (const char *path, rom_info_t *rom_info) {
+    metadata_ini_state_t state = {0};
+    char line[512];
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return;
+    }
+    while (fgets(line, sizeof(line), file) != NULL) {
+        metadata_parse_line(&state, rom_info, line);
+    }
+    fclose(file);
+}
+
+int main (int argc, char *argv[]) {
+    rom_info_t rom_info;
+    char samples_dir[512];
+    char directory[512];
+    char path[600];
+    int failures = 0;
+
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <samples dir> <work dir> [iterations]\n", argv[0]);
+        return 2;
+    }
+
+    int iterations = (argc > 3) ? atoi(argv[3]) : 2000;
+
+    if (!realpath(argv[1], samples_dir) || !make_directories(argv[2]) || chdir(argv[2])) {
+        fprintf(stderr, "error: cannot set up %s\n", argv[2]);
+        return 1;
+    }
+
+    printf("%-18s %-10s %8s %12s %12s\n", "sample", "variant", "bytes", "buffered us", "fgets us");
+
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        const metadata_sample_t *sample = &samples[i];
+
+        for (metadata_variant_t variant = 0; variant < __VARIANT_END; variant++) {
+            snprintf(directory, sizeof(directory), "sd:/menu/metadata/%c/%c/%c/%c",
+                sample->game_code[0], sample->game_code[1], sample->game_code[2], sample->game_code[3]);
+
+            if (!make_directories(directory) || !write_sample(samples_dir, sample, variant, directory)) {
+                fprintf(stderr, "error: cannot write %s\n", directory);
+                return 1;
+            }
+            if (sample->sidecar) {
+                snprintf(path, sizeof(path), "%s/%s", directory, sample->sidecar);
+                write_text(path, sample->hook);
+            }
+            metadata_index_invalidate();
+
+            path_t *rom_path = path_init("sd:/", "roms/game.z64");
+            memcpy(rom_info.game_code, sample->game_code, 4);
+
+            metadata_reset(&rom_info);
+            load_rom_metadata(rom_path, &rom_info, true);
+            if (!check_sample(sample, &rom_info)) {
+                printf("FAIL %s (%s): name '%.32s' genre '%s' year %ld players %ld hook '%s'\n",
+                    sample->sample, variant_names[variant], rom_info.metadata.name, rom_info.metadata.genre,
+                    (long) (rom_info.metadata.release_year), (long) (rom_info.metadata.players_max), rom_info.metadata.hook);
+                failures += 1;
+            }
+
+            snprintf(path, sizeof(path), "%s/metadata.ini", directory);
+            struct stat st;
+            stat(path, &st);
+
+            double start = now_us();
+            for (int n = 0; n < iterations; n++) {
+                metadata_ini_state_t state = {0};
+                metadata_reset(&rom_info);
+                parse_metadata_file(path, &state, &rom_info);
+            }
+            double buffered_us = (now_us() - start) / iterations;
+
+            start = now_us();
+            for (int n = 0; n < iterations; n++) {
+                metadata_reset(&rom_info);
+                parse_metadata_file_fgets(path, &rom_info);
+            }
+            double fgets_us = (now_us() - start) / iterations;
+
+            printf("%-18s %-10s %8lld %12.2f %12.2f\n", sample->sample, variant_names[variant], (long long) (st.st_size), buffered_us, fgets_us);
+
+            path_free(rom_path);
+        }
+    }
+
+    if (failures) {
+        printf("%d sample(s) parsed wrong\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
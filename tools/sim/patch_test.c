@@ -0,0 +1,467 @@
+/**
+ * @file patch_test.c
+ * @brief Host regression tests for the BPS, VCDIFF and IPS patch code
+ * @ingroup menu
+ *
+ * Runs against the vectors in patch_vectors/, see mkvectors.py there.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <miniz.h>
+
+#include "acutest/acutest.h"
+#include "menu/bps_patch.h"
+#include "menu/ips_patch.h"
+#include "menu/vcdiff_patch.h"
+
+#ifndef PATCH_VECTORS_DIR
+#define PATCH_VECTORS_DIR "patch_vectors"
+#endif
+
+#define VECTOR(name)    (PATCH_VECTORS_DIR "/" name)
+
+/* The IPS vectors apply to source.z64 repeated, see mkvectors.py */
+#define IPS_SOURCE_REPEAT   (3)
+#define IPS_MAX_DATA        (1024 * 1024)
+
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t produced;
+} test_output_t;
+
+static const size_t chunk_sizes[] = { 1, 777, 64 * 1024 };
+
+
+static uint8_t *load_file (const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    *size = (size_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t *data = malloc(*size);
+    if (data && fread(data, 1, *size, f) != *size) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    return data;
+}
+
+static bool read_output (void *context, uint32_t offset, uint8_t *buffer, size_t length) {
+    test_output_t *output = (test_output_t *)context;
+    if ((offset + length) > output->produced) {
+        return false;
+    }
+    memcpy(buffer, output->data + offset, length);
+    return true;
+}
+
+static bool bps_decode_all (bps_patch_t *bps, test_output_t *output, size_t chunk_size) {
+    while (output->produced < output->size) {
+        size_t length = output->size - output->produced;
+        if (length > chunk_size) {
+            length = chunk_size;
+        }
+        if (!bps_patch_decode(bps, output->data + output->produced, length)) {
+            return false;
+        }
+        output->produced += length;
+    }
+    return bps_patch_finish(bps);
+}
+
+static bool vcdiff_decode_all (vcdiff_patch_t *vcdiff, test_output_t *output, size_t chunk_size) {
+    while (output->produced < output->size) {
+        size_t length = output->size - output->produced;
+        if (length > chunk_size) {
+            length = chunk_size;
+        }
+        if (!vcdiff_patch_decode(vcdiff, output->data + output->produced, length)) {
+            return false;
+        }
+        output->produced += length;
+    }
+    return vcdiff_patch_finish(vcdiff);
+}
+
+static void check_bps (const char *patch_path, const char *source_path, rom_endianness_t endianness) {
+    size_t source_size, target_size;
+    uint8_t *source = load_file(VECTOR("source.z64"), &source_size);
+    uint8_t *target = load_file(VECTOR("bps_target.z64"), &target_size);
+    TEST_ASSERT(source != NULL && target != NULL);
+
+    for (size_t i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++) {
+        TEST_CASE_("chunk size %zu", chunk_sizes[i]);
+
+        bps_patch_t *bps = bps_patch_open(patch_path, source_path, endianness);
+        TEST_ASSERT(bps != NULL);
+        TEST_CHECK(bps_patch_source_size(bps) == source_size);
+        TEST_CHECK(bps_patch_target_size(bps) == target_size);
+        TEST_CHECK(bps_patch_source_crc32(bps) == mz_crc32(MZ_CRC32_INIT, source, source_size));
+
+        test_output_t output = { .data = calloc(1, target_size), .size = target_size };
+        bps_patch_set_target_reader(bps, read_output, &output);
+        TEST_CHECK(bps_decode_all(bps, &output, chunk_sizes[i]));
+        TEST_CHECK(memcmp(output.data, target, target_size) == 0);
+
+        free(output.data);
+        bps_patch_close(bps);
+    }
+
+    free(target);
+    free(source);
+}
+
+static void check_vcdiff (const char *patch_path, const char *source_path, const char *target_path, rom_endianness_t endianness) {
+    size_t target_size;
+    uint8_t *target = load_file(target_path, &target_size);
+    TEST_ASSERT(target != NULL);
+
+    for (size_t i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++) {
+        TEST_CASE_("chunk size %zu", chunk_sizes[i]);
+
+        vcdiff_patch_t *vcdiff = vcdiff_patch_open(patch_path, source_path, endianness);
+        TEST_ASSERT(vcdiff != NULL);
+        TEST_CHECK(vcdiff_patch_target_size(vcdiff) == target_size);
+
+        test_output_t output = { .data = calloc(1, target_size), .size = target_size };
+        vcdiff_patch_set_target_reader(vcdiff, read_output, &output);
+        TEST_CHECK(vcdiff_decode_all(vcdiff, &output, chunk_sizes[i]));
+        TEST_CHECK(memcmp(output.data, target, target_size) == 0);
+
+        free(output.data);
+        vcdiff_patch_close(vcdiff);
+    }
+
+    free(target);
+}
+
+static bool bps_fails (const char *patch_path, const char *source_path) {
+    bps_patch_t *bps = bps_patch_open(patch_path, source_path, ENDIANNESS_BIG);
+    if (!bps) {
+        return true;
+    }
+    test_output_t output = { .data = calloc(1, bps_patch_target_size(bps)), .size = bps_patch_target_size(bps) };
+    bps_patch_set_target_reader(bps, read_output, &output);
+    bool failed = !bps_decode_all(bps, &output, 777);
+    free(output.data);
+    bps_patch_close(bps);
+    return failed;
+}
+
+static bool vcdiff_fails (const char *patch_path, const char *source_path) {
+    vcdiff_patch_t *vcdiff = vcdiff_patch_open(patch_path, source_path, ENDIANNESS_BIG);
+    if (!vcdiff) {
+        return true;
+    }
+    test_output_t output = { .data = calloc(1, vcdiff_patch_target_size(vcdiff)), .size = vcdiff_patch_target_size(vcdiff) };
+    vcdiff_patch_set_target_reader(vcdiff, read_output, &output);
+    bool failed = !vcdiff_decode_all(vcdiff, &output, 777);
+    free(output.data);
+    vcdiff_patch_close(vcdiff);
+    return failed;
+}
+
+static uint8_t *load_ips_rom (size_t *size) {
+    size_t source_size;
+    uint8_t *source = load_file(VECTOR("source.z64"), &source_size);
+    if (!source) {
+        return NULL;
+    }
+    *size = source_size * IPS_SOURCE_REPEAT;
+    uint8_t *rom = malloc(*size);
+    for (size_t i = 0; rom && i < IPS_SOURCE_REPEAT; i++) {
+        memcpy(rom + (i * source_size), source, source_size);
+    }
+    free(source);
+    return rom;
+}
+
+static ips_patch_t *ips_open (const char *paths[], size_t count, size_t rom_size) {
+    ips_patch_t *ips = ips_patch_create(IPS_MAX_DATA);
+    for (size_t i = 0; ips && i < count; i++) {
+        if (ips_patch_add(ips, paths[i], (int64_t)rom_size) != IPS_PATCH_OK) {
+            ips_patch_free(ips);
+            return NULL;
+        }
+    }
+    if (ips && !ips_patch_finish(ips)) {
+        ips_patch_free(ips);
+        return NULL;
+    }
+    return ips;
+}
+
+/* The record by record path, applied to a copy of the ROM on disk */
+static uint8_t *ips_apply_files (const char *paths[], size_t count, const uint8_t *rom, size_t rom_size) {
+    char path[] = "/tmp/ips_testXXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        return NULL;
+    }
+    close(fd);
+
+    uint8_t *result = NULL;
+    FILE *f = fopen(path, "wb");
+    bool ok = f && (fwrite(rom, 1, rom_size, f) == rom_size);
+    if (f && fclose(f) != 0) {
+        ok = false;
+    }
+    for (size_t i = 0; ok && i < count; i++) {
+        ok = ips_patch_apply_file(path, paths[i]);
+    }
+    if (ok) {
+        size_t size;
+        result = load_file(path, &size);
+        if (result && size != rom_size) {
+            free(result);
+            result = NULL;
+        }
+    }
+    remove(path);
+    return result;
+}
+
+static void check_ips (const char *paths[], size_t count, const char *target_path) {
+    size_t rom_size, target_size;
+    uint8_t *rom = load_ips_rom(&rom_size);
+    uint8_t *target = load_file(target_path, &target_size);
+    TEST_ASSERT(rom != NULL && target != NULL);
+    TEST_ASSERT(rom_size == target_size);
+
+    ips_patch_t *ips = ips_open(paths, count, rom_size);
+    TEST_ASSERT(ips != NULL);
+
+    uint8_t *output = malloc(rom_size);
+    for (size_t i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++) {
+        TEST_CASE_("chunk size %zu", chunk_sizes[i]);
+
+        memcpy(output, rom, rom_size);
+        for (size_t offset = 0; offset < rom_size; offset += chunk_sizes[i]) {
+            size_t length = rom_size - offset;
+            if (length > chunk_sizes[i]) {
+                length = chunk_sizes[i];
+            }
+            ips_patch_apply(ips, output + offset, (uint32_t)offset, length);
+        }
+        TEST_CHECK(memcmp(output, target, rom_size) == 0);
+    }
+
+    // Chunks don't have to come in order, the stream is applied as the loader reads.
+    TEST_CASE("backwards");
+    memcpy(output, rom, rom_size);
+    for (size_t end = rom_size; end > 0; ) {
+        size_t length = (end > 777) ? 777 : end;
+        end -= length;
+        ips_patch_apply(ips, output + end, (uint32_t)end, length);
+    }
+    TEST_CHECK(memcmp(output, target, rom_size) == 0);
+
+    TEST_CASE("record by record");
+    uint8_t *applied = ips_apply_files(paths, count, rom, rom_size);
+    TEST_CHECK(applied != NULL && memcmp(applied, target, rom_size) == 0);
+
+    free(applied);
+    free(output);
+    ips_patch_free(ips);
+    free(target);
+    free(rom);
+}
+
+
+static void test_bps_z64 (void) {
+    check_bps(VECTOR("patch.bps"), VECTOR("source.z64"), ENDIANNESS_BIG);
+}
+
+static void test_bps_v64 (void) {
+    check_bps(VECTOR("patch.bps"), VECTOR("source.v64"), ENDIANNESS_BYTE_SWAP);
+}
+
+static void test_bps_source_window (void) {
+    size_t source_size, target_size;
+    uint8_t *source = load_file(VECTOR("source.z64"), &source_size);
+    uint8_t *target = load_file(VECTOR("bps_target.z64"), &target_size);
+    TEST_ASSERT(source != NULL && target != NULL);
+
+    // The window takes precedence over the (wrong) file for the whole source.
+    bps_patch_t *bps = bps_patch_open(VECTOR("patch.bps"), VECTOR("source_wrong.z64"), ENDIANNESS_BIG);
+    TEST_ASSERT(bps != NULL);
+    bps_patch_set_source_window(bps, source, 0, source_size);
+
+    test_output_t output = { .data = calloc(1, target_size), .size = target_size };
+    bps_patch_set_target_reader(bps, read_output, &output);
+    TEST_CHECK(bps_decode_all(bps, &output, 777));
+    TEST_CHECK(memcmp(output.data, target, target_size) == 0);
+
+    free(output.data);
+    bps_patch_close(bps);
+    free(target);
+    free(source);
+}
+
+static void test_bps_corrupt (void) {
+    TEST_CHECK(bps_fails(VECTOR("patch_corrupt.bps"), VECTOR("source.z64")));
+}
+
+static void test_bps_wrong_source (void) {
+    size_t source_size;
+    uint8_t *source = load_file(VECTOR("source_wrong.z64"), &source_size);
+    TEST_ASSERT(source != NULL);
+
+    bps_patch_t *bps = bps_patch_open(VECTOR("patch.bps"), VECTOR("source_wrong.z64"), ENDIANNESS_BIG);
+    TEST_ASSERT(bps != NULL);
+    TEST_CHECK(bps_patch_source_crc32(bps) != mz_crc32(MZ_CRC32_INIT, source, source_size));
+    bps_patch_close(bps);
+    free(source);
+
+    TEST_CHECK(bps_fails(VECTOR("patch.bps"), VECTOR("source_wrong.z64")));
+}
+
+static void test_bps_missing_source (void) {
+    TEST_CHECK(bps_patch_open(VECTOR("patch.bps"), VECTOR("missing.z64"), ENDIANNESS_BIG) == NULL);
+}
+
+static void test_vcdiff_z64 (void) {
+    check_vcdiff(VECTOR("patch.xdelta"), VECTOR("source.z64"), VECTOR("vcdiff_target.z64"), ENDIANNESS_BIG);
+}
+
+static void test_vcdiff_v64 (void) {
+    check_vcdiff(VECTOR("patch.xdelta"), VECTOR("source.v64"), VECTOR("vcdiff_target.z64"), ENDIANNESS_BYTE_SWAP);
+}
+
+static void test_vcdiff_xdelta3 (void) {
+    check_vcdiff(VECTOR("patch_xdelta3.xdelta"), VECTOR("source.z64"), VECTOR("xdelta3_target.z64"), ENDIANNESS_BIG);
+    check_vcdiff(VECTOR("patch_xdelta3.xdelta"), VECTOR("source.v64"), VECTOR("xdelta3_target.z64"), ENDIANNESS_BYTE_SWAP);
+}
+
+static void test_vcdiff_xdelta3_wrong_source (void) {
+    TEST_CHECK(vcdiff_fails(VECTOR("patch_xdelta3.xdelta"), VECTOR("source_wrong.z64")));
+}
+
+static void test_vcdiff_corrupt (void) {
+    TEST_CHECK(vcdiff_fails(VECTOR("patch_corrupt.xdelta"), VECTOR("source.z64")));
+}
+
+static void test_vcdiff_truncated (void) {
+    TEST_CHECK(vcdiff_fails(VECTOR("patch_truncated.xdelta"), VECTOR("source.z64")));
+}
+
+static void test_vcdiff_wrong_source (void) {
+    TEST_CHECK(vcdiff_fails(VECTOR("patch.xdelta"), VECTOR("source_wrong.z64")));
+}
+
+static void test_vcdiff_not_a_patch (void) {
+    TEST_CHECK(vcdiff_patch_open(VECTOR("patch.bps"), VECTOR("source.z64"), ENDIANNESS_BIG) == NULL);
+    TEST_CHECK(bps_patch_open(VECTOR("patch.xdelta"), VECTOR("source.z64"), ENDIANNESS_BIG) == NULL);
+}
+
+static void test_ips_overlap (void) {
+    const char *paths[] = { VECTOR("patch_ips_a.ips") };
+    check_ips(paths, 1, VECTOR("ips_target_a.z64"));
+}
+
+static void test_ips_stacked (void) {
+    const char *paths[] = { VECTOR("patch_ips_a.ips"), VECTOR("patch_ips_b.ips") };
+    check_ips(paths, 2, VECTOR("ips_target_ab.z64"));
+}
+
+static void test_ips_disjoint (void) {
+    const char *paths[] = { VECTOR("patch_ips_disjoint.ips") };
+    size_t rom_size;
+    uint8_t *rom = load_ips_rom(&rom_size);
+    TEST_ASSERT(rom != NULL);
+
+    // The record by record path is the reference here, the records never need sorting by patch order.
+    uint8_t *target = ips_apply_files(paths, 1, rom, rom_size);
+    TEST_ASSERT(target != NULL);
+    TEST_CHECK(memcmp(target, rom, rom_size) != 0);
+
+    ips_patch_t *ips = ips_open(paths, 1, rom_size);
+    TEST_ASSERT(ips != NULL);
+    for (size_t i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++) {
+        TEST_CASE_("chunk size %zu", chunk_sizes[i]);
+
+        uint8_t *output = malloc(rom_size);
+        memcpy(output, rom, rom_size);
+        for (size_t offset = 0; offset < rom_size; offset += chunk_sizes[i]) {
+            size_t length = rom_size - offset;
+            if (length > chunk_sizes[i]) {
+                length = chunk_sizes[i];
+            }
+            ips_patch_apply(ips, output + offset, (uint32_t)offset, length);
+        }
+        TEST_CHECK(memcmp(output, target, rom_size) == 0);
+        free(output);
+    }
+
+    ips_patch_free(ips);
+    free(target);
+    free(rom);
+}
+
+static void test_ips_errors (void) {
+    size_t rom_size;
+    uint8_t *rom = load_ips_rom(&rom_size);
+    TEST_ASSERT(rom != NULL);
+
+    ips_patch_t *ips = ips_patch_create(IPS_MAX_DATA);
+    TEST_ASSERT(ips != NULL);
+    TEST_CHECK(ips_patch_add(ips, VECTOR("patch_ips_outside.ips"), (int64_t)rom_size) == IPS_PATCH_FORMAT_ERROR);
+    TEST_CHECK(ips_patch_add(ips, VECTOR("patch_ips_truncated.ips"), (int64_t)rom_size) == IPS_PATCH_FORMAT_ERROR);
+    TEST_CHECK(ips_patch_add(ips, VECTOR("patch.bps"), (int64_t)rom_size) == IPS_PATCH_FORMAT_ERROR);
+    TEST_CHECK(ips_patch_add(ips, VECTOR("missing.ips"), (int64_t)rom_size) == IPS_PATCH_IO_ERROR);
+    ips_patch_free(ips);
+
+    const char *outside[] = { VECTOR("patch_ips_outside.ips") };
+    const char *truncated[] = { VECTOR("patch_ips_truncated.ips") };
+    TEST_CHECK(ips_apply_files(outside, 1, rom, rom_size) == NULL);
+    TEST_CHECK(ips_apply_files(truncated, 1, rom, rom_size) == NULL);
+
+    free(rom);
+}
+
+static void test_ips_too_large (void) {
+    size_t patch_size;
+    uint8_t *patch = load_file(VECTOR("patch_ips_a.ips"), &patch_size);
+    TEST_ASSERT(patch != NULL);
+    free(patch);
+
+    // Stacked files count against the limit together.
+    ips_patch_t *ips = ips_patch_create(patch_size + 16);
+    TEST_ASSERT(ips != NULL);
+    TEST_CHECK(ips_patch_add(ips, VECTOR("patch_ips_a.ips"), 1024 * 1024) == IPS_PATCH_OK);
+    TEST_CHECK(ips_patch_add(ips, VECTOR("patch_ips_b.ips"), 1024 * 1024) == IPS_PATCH_TOO_LARGE);
+    ips_patch_free(ips);
+}
+
+
+TEST_LIST = {
+    { "bps/z64", test_bps_z64 },
+    { "bps/v64", test_bps_v64 },
+    { "bps/source-window", test_bps_source_window },
+    { "bps/corrupt", test_bps_corrupt },
+    { "bps/wrong-source", test_bps_wrong_source },
+    { "bps/missing-source", test_bps_missing_source },
+    { "vcdiff/z64", test_vcdiff_z64 },
+    { "vcdiff/v64", test_vcdiff_v64 },
+    { "vcdiff/xdelta3", test_vcdiff_xdelta3 },
+    { "vcdiff/xdelta3-wrong-source", test_vcdiff_xdelta3_wrong_source },
+    { "vcdiff/corrupt", test_vcdiff_corrupt },
+    { "vcdiff/truncated", test_vcdiff_truncated },
+    { "vcdiff/wrong-source", test_vcdiff_wrong_source },
+    { "vcdiff/not-a-patch", test_vcdiff_not_a_patch },
+    { "ips/overlap", test_ips_overlap },
+    { "ips/stacked", test_ips_stacked },
+    { "ips/disjoint", test_ips_disjoint },
+    { "ips/errors", test_ips_errors },
+    { "ips/too-large", test_ips_too_large },
+    { NULL, NULL }
+};
@@ -0,0 +1,533 @@
+#!/usr/bin/env python3
+"""
+Regenerate the BPS, VCDIFF and IPS test vectors used by tools/sim/patch_test.c.
+
+The encoders here are written from the specs (BPS by byuu, RFC 3284 plus the
+xdelta3 Adler-32 window checksum) and don't share code with the decoders in
+src/menu, so a matching bug on both sides is unlikely. Output is deterministic.
+
+  source.z64 / source.v64      source ROM, big endian and byte swapped
+  source_wrong.z64             source ROM with every byte inverted
+  bps_target.z64, patch.bps    BPS patch using every action, and its result
+  patch_corrupt.bps            one literal byte flipped
+  vcdiff_target.z64, patch.xdelta
+                               VCDIFF patch using every instruction and address mode
+  patch_corrupt.xdelta         one ADD byte flipped
+  patch_truncated.xdelta       last window cut short
+  xdelta3_target.z64, patch_xdelta3.xdelta
+                               ROM hack style edits of source.z64, laid out
+                               the way `xdelta3 -e -S none` writes them
+
+patch_xdelta3.xdelta is meant to be the output of
+
+  xdelta3 -e -S none -s source.z64 xdelta3_target.z64 patch_xdelta3.xdelta
+
+and may be replaced by it. The tool wasn't available when the vector was
+first committed, so make_xdelta3 encodes it by hand following xdelta3's
+encoder: no secondary compression, a "target//source/" application header,
+a single window with VCD_SOURCE | VCD_ADLER32 whose source segment spans
+only the referenced bytes, the RFC 3284 code table with double instructions
+where one fits, and addresses encoded in the cheapest mode with the SAME
+cache tried first. With xdelta3 at hand, check the vector with
+
+  xdelta3 -d -s source.z64 patch_xdelta3.xdelta out.z64 && cmp out.z64 xdelta3_target.z64
+
+The IPS vectors apply to source.z64 repeated IPS_SOURCE_REPEAT times, which
+reaches past the 64 KiB chunks the menu copies ROMs in:
+
+  patch_ips_a.ips, ips_target_a.z64
+                               records and RLE runs that overlap each other and
+                               the chunk boundary, in no particular order
+  patch_ips_b.ips, ips_target_ab.z64
+                               stacked on top of patch_ips_a.ips, rewriting
+                               some of its bytes
+  patch_ips_disjoint.ips       records that don't overlap, checked against the
+                               menu's record by record path
+  patch_ips_outside.ips        a record past the end of the ROM
+  patch_ips_truncated.ips      cut off in the middle of a record
+"""
+
+from __future__ import annotations
+
+import random
+import struct
+import zlib
+from pathlib import Path
+
+SOURCE_SIZE = 24 * 1024
+TARGET_SIZE = 32 * 1024
+IPS_SOURCE_REPEAT = 3
+IPS_CHUNK_SIZE = 64 * 1024
+
+
+def bps_number(value: int) -> bytes:
+    out = bytearray()
+    while True:
+        x = value & 0x7F
+        value >>= 7
+        if value == 0:
+            out.append(0x80 | x)
+            return bytes(out)
+        out.append(x)
+        value -= 1
+
+
+def bps_offset(delta: int) -> bytes:
+    return bps_number((abs(delta) << 1) | (1 if delta < 0 else 0))
+
+
+def make_bps(rng: random.Random, source: bytes, target_size: int) -> tuple[bytes, bytes, int]:
+    target = bytearray()
+    actions = bytearray()
+    literal_offsets = []
+    source_relative = 0
+    target_relative = 0
+    used = set()
+    while len(target) < target_size:
+        length = min(target_size - len(target), rng.choice([1, 2, 7, 100, 1000, 3000]))
+        kind = rng.randrange(4)
+        output_offset = len(target)
+        if kind == 0 and output_offset + length <= len(source):
+            actions += bps_number(((length - 1) << 2) | 0)
+            target += source[output_offset:output_offset + length]
+        elif kind == 2:
+            length = min(length, len(source))
+            offset = rng.randrange(len(source) - length + 1)
+            actions += bps_number(((length - 1) << 2) | 2) + bps_offset(offset - source_relative)
+            target += source[offset:offset + length]
+            source_relative = offset + length
+        elif kind == 3 and output_offset > 0:
+            # Overlapping copies (offset just behind the output) repeat a pattern.
+            offset = rng.choice([output_offset - 1, max(0, output_offset - 2), rng.randrange(output_offset)])
+            actions += bps_number(((length - 1) << 2) | 3) + bps_offset(offset - target_relative)
+            for i in range(length):
+                target.append(target[offset + i])
+            target_relative = offset + length
+        else:
+            kind = 1
+            data = bytes(rng.getrandbits(8) for _ in range(length))
+            actions += bps_number(((length - 1) << 2) | 1)
+            literal_offsets.append(len(actions))
+            actions += data
+            target += data
+        used.add(kind)
+    assert used == {0, 1, 2, 3}
+
+    metadata = b"<vectors/>\n"
+    header = b"BPS1" + bps_number(len(source)) + bps_number(len(target)) + bps_number(len(metadata)) + metadata
+    patch = header + bytes(actions)
+    patch += struct.pack("<II", zlib.crc32(source), zlib.crc32(bytes(target)))
+    patch += struct.pack("<I", zlib.crc32(patch))
+    corrupt_offset = len(header) + literal_offsets[len(literal_offsets) // 2]
+    return bytes(target), patch, corrupt_offset
+
+
+VCD_NOOP, VCD_ADD, VCD_RUN, VCD_COPY = 0, 1, 2, 3
+
+
+def vcdiff_code_table() -> list:
+    table = [((VCD_RUN, 0, 0), (VCD_NOOP, 0, 0))]
+    table += [((VCD_ADD, size, 0), (VCD_NOOP, 0, 0)) for size in range(18)]
+    for mode in range(9):
+        table.append(((VCD_COPY, 0, mode), (VCD_NOOP, 0, 0)))
+        table += [((VCD_COPY, size, mode), (VCD_NOOP, 0, 0)) for size in range(4, 19)]
+    for mode in range(6):
+        for add_size in range(1, 5):
+            for copy_size in range(4, 7):
+                table.append(((VCD_ADD, add_size, 0), (VCD_COPY, copy_size, mode)))
+    for mode in range(6, 9):
+        for add_size in range(1, 5):
+            table.append(((VCD_ADD, add_size, 0), (VCD_COPY, 4, mode)))
+    for mode in range(9):
+        table.append(((VCD_COPY, 4, mode), (VCD_ADD, 1, 0)))
+    assert len(table) == 256
+    return table
+
+
+VCD_SINGLE = {}
+VCD_DOUBLE = {}
+for _code, (_first, _second) in enumerate(vcdiff_code_table()):
+    if _second[0] == VCD_NOOP:
+        VCD_SINGLE.setdefault(_first, _code)
+    else:
+        VCD_DOUBLE.setdefault((_first, _second), _code)
+
+
+def vcdiff_int(value: int) -> bytes:
+    out = [value & 0x7F]
+    value >>= 7
+    while value:
+        out.append(0x80 | (value & 0x7F))
+        value >>= 7
+    return bytes(reversed(out))
+
+
+def vcdiff_window(rng, source, target, length, segment, segment_size, segment_position, stats):
+    near = [0] * 4
+    near_slot = 0
+    same = [0] * (3 * 256)
+    instructions = []
+    data = bytearray()
+    addresses = bytearray()
+    data_offsets = []
+    out = bytearray()
+
+    def fetch(address):
+        if address < segment_size:
+            return (source if segment == "S" else target)[segment_position + address]
+        return out[address - segment_size]
+
+    def add(size):
+        payload = bytes(rng.getrandbits(8) for _ in range(size))
+        instructions.append((VCD_ADD, size, 0))
+        data_offsets.append(len(data))
+        data.extend(payload)
+        out.extend(payload)
+
+    while len(out) < length:
+        left = length - len(out)
+        here = segment_size + len(out)
+        size = min(left, rng.choice([1, 2, 3, 4, 5, 6, 7, 17, 18, 19, rng.randint(1, 3000)]))
+        kind = rng.random()
+        if kind < 0.25 or here == 0:
+            add(size)
+        elif kind < 0.35:
+            value = rng.getrandbits(8)
+            instructions.append((VCD_RUN, size, 0))
+            data.append(value)
+            out.extend(bytes([value]) * size)
+        elif size < 4:
+            add(size)
+        else:
+            pick = rng.random()
+            if pick < 0.3:
+                address = near[rng.randrange(4)] + rng.randint(0, 50)
+            elif pick < 0.5:
+                cached = [a for a in same if a > 0]
+                address = rng.choice(cached) if cached and rng.random() < 0.7 else rng.randrange(here)
+            elif pick < 0.7 and here > 1:
+                address = here - rng.randint(1, min(here, 40))
+            else:
+                address = rng.randrange(here)
+            if address >= here:
+                address = rng.randrange(here)
+            modes = [0, 1] + [2 + i for i in range(4) if address >= near[i]]
+            mode = rng.choice(modes)
+            if same[address % len(same)] == address and rng.random() < 0.5:
+                mode = 6 + (address % len(same)) // 256
+            if mode == 0:
+                addresses += vcdiff_int(address)
+            elif mode == 1:
+                addresses += vcdiff_int(here - address)
+            elif mode < 6:
+                addresses += vcdiff_int(address - near[mode - 2])
+            else:
+                addresses.append(address % 256)
+            near[near_slot] = address
+            near_slot = (near_slot + 1) % 4
+            same[address % len(same)] = address
+            instructions.append((VCD_COPY, size, mode))
+            stats["modes"].add(mode)
+            if segment == "S" and address < segment_size:
+                stats["source_copies"] += 1
+            for i in range(size):
+                out.append(fetch(address + i))
+
+    codes = bytearray()
+    i = 0
+    while i < len(instructions):
+        kind, size, mode = instructions[i]
+        if i + 1 < len(instructions):
+            key = (instructions[i], instructions[i + 1])
+            if key in VCD_DOUBLE and rng.random() < 0.9:
+                codes.append(VCD_DOUBLE[key])
+                i += 2
+                continue
+        if instructions[i] in VCD_SINGLE and rng.random() < 0.8:
+            codes.append(VCD_SINGLE[instructions[i]])
+        else:
+            codes.append(VCD_SINGLE[(kind, 0, mode)])
+            codes += vcdiff_int(size)
+        i += 1
+    return bytes(data), bytes(codes), bytes(addresses), bytes(out), data_offsets
+
+
+def make_vcdiff(rng: random.Random, source: bytes, target_size: int) -> tuple[bytes, bytes, int, int]:
+    target = bytearray()
+    app_header = b"vcdiff_target.z64//source.z64/"
+    patch = bytearray(b"\xD6\xC3\xC4\x00") + b"\x04" + vcdiff_int(len(app_header)) + app_header
+    stats = {"modes": set(), "source_copies": 0}
+    corrupt_offset = None
+    last_window = 0
+    while len(target) < target_size:
+        length = min(target_size - len(target), rng.choice([rng.randint(1, 200), rng.randint(1000, 12000)]))
+        pick = rng.random()
+        if pick < 0.6:
+            segment = "S"
+            segment_position = rng.randrange(len(source))
+            segment_size = rng.randint(1, len(source) - segment_position)
+        elif pick < 0.8 and len(target) > 0:
+            segment = "T"
+            segment_position = rng.randrange(len(target))
+            segment_size = rng.randint(1, len(target) - segment_position)
+        else:
+            segment = None
+            segment_position = segment_size = 0
+        data, codes, addresses, out, data_offsets = vcdiff_window(
+            rng, source, target, length, segment, segment_size, segment_position, stats
+        )
+        target += out
+        window = bytearray([(1 if segment == "S" else 2 if segment == "T" else 0) | 4])
+        if segment:
+            window += vcdiff_int(segment_size) + vcdiff_int(segment_position)
+        body_header = (
+            vcdiff_int(length) + b"\x00" + vcdiff_int(len(data)) + vcdiff_int(len(codes))
+            + vcdiff_int(len(addresses)) + zlib.adler32(out).to_bytes(4, "big")
+        )
+        body = body_header + data + codes + addresses
+        window += vcdiff_int(len(body))
+        last_window = len(patch)
+        if corrupt_offset is None and data_offsets and len(target) > target_size // 3:
+            corrupt_offset = len(patch) + len(window) + len(body_header) + data_offsets[len(data_offsets) // 2]
+        patch += window + body
+    assert stats["modes"] == set(range(9)) and stats["source_copies"] > 0 and corrupt_offset is not None
+    return bytes(target), bytes(patch), corrupt_offset, last_window
+
+
+def make_xdelta3(rng: random.Random, source: bytes) -> tuple[bytes, bytes]:
+    # Edits a ROM hack makes, as (kind, argument) operations building the target.
+    ops = [
+        ("copy_source", (0x00, 0x10)),
+        ("add", bytes(rng.getrandbits(8) for _ in range(8))),        # header checksums
+        ("copy_source", (0x18, 0x08)),
+        ("add", b"XDELTA3 VECTOR      "),                             # internal name
+        ("copy_source", (0x34, 0xFCC)),
+    ]
+    for offset in range(0x1000, 0x1800, 0x100):                      # single byte pokes
+        ops += [("add", bytes([source[offset] ^ 0x20])), ("copy_source", (offset + 1, 0xFF))]
+    ops += [
+        ("add", bytes(rng.getrandbits(8) for _ in range(300))),      # new code
+        ("copy_source", (0x4000, 0x800)),                            # moved block
+        ("run", (0xFF, 500)),                                        # padding
+        ("copy_source", (0x1800, 0x2000)),
+        ("copy_target", (0x0800, 0x400)),                            # repeated earlier output
+        ("add", bytes(rng.getrandbits(8) for _ in range(8))),
+        ("copy_pattern", (8, 0xFF8)),                                # repeating pattern, overlapping copy
+        ("copy_source", (0x5000, 0x600)),
+    ]
+
+    source_low = min(arg[0] for kind, arg in ops if kind == "copy_source")
+    source_high = max(arg[0] + arg[1] for kind, arg in ops if kind == "copy_source")
+    segment_size = source_high - source_low
+
+    target = bytearray()
+    instructions = []
+    data = bytearray()
+    addresses = bytearray()
+    near = [0] * 4
+    near_slot = 0
+    same = [0] * (3 * 256)
+
+    def address(value: int) -> int:
+        nonlocal near_slot
+        here = segment_size + len(target)
+        if same[value % len(same)] == value:
+            mode = 6 + (value % len(same)) // 256
+            encoded = bytes([value % 256])
+        else:
+            best, mode = value, 0
+            if here - value < best:
+                best, mode = here - value, 1
+            for i in range(4):
+                if 0 <= value - near[i] < best:
+                    best, mode = value - near[i], 2 + i
+            encoded = vcdiff_int(best)
+        addresses.extend(encoded)
+        near[near_slot] = value
+        near_slot = (near_slot + 1) % 4
+        same[value % len(same)] = value
+        return mode
+
+    for kind, arg in ops:
+        if kind == "add":
+            instructions.append((VCD_ADD, len(arg), 0))
+            data.extend(arg)
+            target.extend(arg)
+        elif kind == "run":
+            value, size = arg
+            instructions.append((VCD_RUN, size, 0))
+            data.append(value)
+            target.extend(bytes([value]) * size)
+        else:
+            if kind == "copy_source":
+                offset, size = arg
+                mode = address(offset - source_low)
+                chunk = source[offset:offset + size]
+            elif kind == "copy_target":
+                offset, size = arg
+                mode = address(segment_size + offset)
+                chunk = target[offset:offset + size]
+            else:
+                distance, size = arg
+                offset = len(target) - distance
+                mode = address(segment_size + offset)
+                chunk = bytearray()
+                for i in range(size):
+                    chunk.append((target + chunk)[offset + i])
+            instructions.append((VCD_COPY, size, mode))
+            target.extend(chunk)
+
+    codes = bytearray()
+    i = 0
+    while i < len(instructions):
+        if i + 1 < len(instructions) and (instructions[i], instructions[i + 1]) in VCD_DOUBLE:
+            codes.append(VCD_DOUBLE[(instructions[i], instructions[i + 1])])
+            i += 2
+            continue
+        kind, size, mode = instructions[i]
+        if instructions[i] in VCD_SINGLE:
+            codes.append(VCD_SINGLE[instructions[i]])
+        else:
+            codes.append(VCD_SINGLE[(kind, 0, mode)])
+            codes += vcdiff_int(size)
+        i += 1
+
+    app_header = b"xdelta3_target.z64//source.z64/"
+    patch = bytearray(b"\xD6\xC3\xC4\x00") + b"\x04" + vcdiff_int(len(app_header)) + app_header
+    body = (
+        vcdiff_int(len(target)) + b"\x00" + vcdiff_int(len(data)) + vcdiff_int(len(codes))
+        + vcdiff_int(len(addresses)) + zlib.adler32(bytes(target)).to_bytes(4, "big")
+        + data + codes + addresses
+    )
+    patch += b"\x05" + vcdiff_int(segment_size) + vcdiff_int(source_low) + vcdiff_int(len(body)) + body
+    return bytes(target), bytes(patch)
+
+
+def ips_record(offset: int, data: bytes) -> bytes:
+    return struct.pack(">I", offset)[1:] + struct.pack(">H", len(data)) + data
+
+
+def ips_rle(offset: int, length: int, value: int) -> bytes:
+    return struct.pack(">I", offset)[1:] + struct.pack(">HHB", 0, length, value)
+
+
+def ips_file(records: list[bytes]) -> bytes:
+    return b"PATCH" + b"".join(records) + b"EOF"
+
+
+def ips_apply(rom: bytearray, records: list[tuple[int, int, bytes | int]]) -> None:
+    for offset, length, data in records:
+        rom[offset:offset + length] = bytes([data]) * length if isinstance(data, int) else data
+
+
+def make_ips_records(rng: random.Random, rom_size: int, fixed: list, count: int) -> tuple[bytes, list]:
+    """Encodes the fixed records and `count` random ones, shuffled; returns the file and the records in file order."""
+    records = list(fixed)
+    for _ in range(count):
+        length = rng.randint(1, 24)
+        offset = rng.randrange(rom_size - length)
+        if rng.randrange(4) == 0:
+            records.append((offset, length, rng.getrandbits(8)))
+        else:
+            records.append((offset, length, bytes(rng.getrandbits(8) for _ in range(length))))
+    rng.shuffle(records)
+    encoded = [ips_rle(o, n, d) if isinstance(d, int) else ips_record(o, d) for o, n, d in records]
+    return ips_file(encoded), records
+
+
+def make_ips(rng: random.Random, source: bytes) -> dict[str, bytes]:
+    rom = source * IPS_SOURCE_REPEAT
+    boundary = IPS_CHUNK_SIZE
+    assert len(rom) > boundary
+
+    def data(length: int) -> bytes:
+        return bytes(rng.getrandbits(8) for _ in range(length))
+
+    patch_a, records_a = make_ips_records(rng, len(rom), [
+        (0x100, 16, data(16)),
+        (0x108, 16, data(16)),                                  # overlaps the one above
+        (0x200, 0x40, 0xAA),
+        (0x1F0, 0x20, data(0x20)),                              # starts before the RLE run, ends inside it
+        (boundary - 0x100, 0x200, data(0x200)),                 # spans the chunk boundary
+        (boundary - 0x10, 0x30, 0x55),                          # RLE run inside the one above
+        (boundary, 1, data(1)),
+        (len(rom) - 4, 4, data(4)),                             # last bytes of the ROM
+        (0x300, 0, 0x77),                                       # empty RLE run
+    ], 300)
+    patch_b, records_b = make_ips_records(rng, len(rom), [
+        (0x100, 4, data(4)),
+        (boundary - 8, 16, data(16)),
+        (0x1F8, 8, 0x11),
+    ], 100)
+
+    target_a = bytearray(rom)
+    ips_apply(target_a, records_a)
+    target_ab = bytearray(target_a)
+    ips_apply(target_ab, records_b)
+
+    disjoint = [(boundary - 0x40, 0x80, data(0x80))]           # spans the chunk boundary
+    for start, end in ((0, boundary - 0x40), (boundary + 0x40, len(rom))):
+        offset = start
+        while True:
+            offset += rng.randint(1, 700)
+            length = rng.randint(1, 600)
+            if offset + length > end:
+                break
+            disjoint.append((offset, length, rng.getrandbits(8) if rng.randrange(4) == 0 else data(length)))
+            offset += length
+    disjoint.append((boundary, 0, 0))                           # empty RLE run, doesn't count as an overlap
+    rng.shuffle(disjoint)
+    patch_disjoint = ips_file([ips_rle(o, n, d) if isinstance(d, int) else ips_record(o, d) for o, n, d in disjoint])
+
+    patch_outside = ips_file([ips_record(0x40, data(4)), ips_record(len(rom) - 2, data(4))])
+    truncated = ips_file([ips_record(0x40, data(4)), ips_record(0x80, data(32))])
+
+    return {
+        "patch_ips_a.ips": patch_a,
+        "ips_target_a.z64": bytes(target_a),
+        "patch_ips_b.ips": patch_b,
+        "ips_target_ab.z64": bytes(target_ab),
+        "patch_ips_disjoint.ips": patch_disjoint,
+        "patch_ips_outside.ips": patch_outside,
+        "patch_ips_truncated.ips": truncated[:-20],
+    }
+
+
+def flip(data: bytes, offset: int) -> bytes:
+    out = bytearray(data)
+    out[offset] ^= 0x5A
+    return bytes(out)
+
+
+def main() -> None:
+    out_dir = Path(__file__).resolve().parent
+    rng = random.Random(0x4E3634)
+
+    source = bytes(rng.getrandbits(8) for _ in range(SOURCE_SIZE))
+    swapped = bytearray(source)
+    swapped[0::2], swapped[1::2] = source[1::2], source[0::2]
+    (out_dir / "source.z64").write_bytes(source)
+    (out_dir / "source.v64").write_bytes(bytes(swapped))
+    (out_dir / "source_wrong.z64").write_bytes(bytes(b ^ 0xFF for b in source))
+
+    target, patch, corrupt_offset = make_bps(rng, source, TARGET_SIZE)
+    (out_dir / "bps_target.z64").write_bytes(target)
+    (out_dir / "patch.bps").write_bytes(patch)
+    (out_dir / "patch_corrupt.bps").write_bytes(flip(patch, corrupt_offset))
+
+    target, patch, corrupt_offset, last_window = make_vcdiff(rng, source, TARGET_SIZE)
+    (out_dir / "vcdiff_target.z64").write_bytes(target)
+    (out_dir / "patch.xdelta").write_bytes(patch)
+    (out_dir / "patch_corrupt.xdelta").write_bytes(flip(patch, corrupt_offset))
+    (out_dir / "patch_truncated.xdelta").write_bytes(patch[:last_window + (len(patch) - last_window) // 2])
+
+    target, patch = make_xdelta3(rng, source)
+    (out_dir / "xdelta3_target.z64").write_bytes(target)
+    (out_dir / "patch_xdelta3.xdelta").write_bytes(patch)
+
+    for name, content in make_ips(rng, source).items():
+        (out_dir / name).write_bytes(content)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,288 @@
+/**
+ * @file sim_bench.c
+ * @brief Host-side load path benchmark using the simulated flashcart
+ * @ingroup flashcart
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <fatfs/ff.h>
+
+#include "flashcart/flashcart.h"
+#include "flashcart/sim/sim.h"
+#include "utils/fs.h"
+#include "sim_diskio.h"
+
+
+typedef struct {
+    uint32_t offset;
+    uint32_t next;
+    size_t buffers;
+    bool in_order;
+} bench_patch_t;
+
+
+static const struct {
+    const char *name;
+    flashcart_save_type_t type;
+    size_t size;
+} save_types[] = {
+    { "eeprom4k", FLASHCART_SAVE_TYPE_EEPROM_4KBIT, 512 },
+    { "eeprom16k", FLASHCART_SAVE_TYPE_EEPROM_16KBIT, 2048 },
+    { "sram", FLASHCART_SAVE_TYPE_SRAM_256KBIT, 32768 },
+    { "sram-banked", FLASHCART_SAVE_TYPE_SRAM_BANKED, 98304 },
+    { "sram1m", FLASHCART_SAVE_TYPE_SRAM_1MBIT, 131072 },
+    { "flashram", FLASHCART_SAVE_TYPE_FLASHRAM_1MBIT, 131072 },
+};
+
+
+static uint32_t env_rate (const char *name, uint32_t fallback) {
+    const char *value = getenv(name);
+    if (!value || !*value) {
+        return fallback;
+    }
+    return (uint32_t) (strtod(value, NULL) * 1024.0 * 1024.0);
+}
+
+static double now_ms (void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1000.0) + (ts.tv_nsec / 1000000.0);
+}
+
+static const char *byte_order_name (flashcart_byte_order_t byte_order) {
+    switch (byte_order) {
+        case FLASHCART_BYTE_ORDER_BYTE_SWAPPED: return "byte swapped";
+        case FLASHCART_BYTE_ORDER_LITTLE: return "little endian";
+        default: return "big endian";
+    }
+}
+
+static const char *error_name (flashcart_err_t err) {
+    switch (err) {
+        case FLASHCART_OK: return "ok";
+        case FLASHCART_ERR_ARGS: return "bad arguments";
+        case FLASHCART_ERR_LOAD: return "load error";
+        case FLASHCART_ERR_INT: return "internal error";
+        case FLASHCART_ERR_FUNCTION_NOT_SUPPORTED: return "not supported";
+        default: return "error";
+    }
+}
+
+static void report (const char *what, flashcart_err_t err, double wall_ms) {
+    sim_stats_t stats;
+
+    sim_get_stats(&stats);
+
+    printf(
+        "%-10s %-14s sd %9llu B %8.1f ms | pi %9llu B %8.1f ms | total %8.1f ms | host %7.1f ms\n",
+        what,
+        error_name(err),
+        (unsigned long long) (stats.sd_bytes), stats.sd_us / 1000.0,
+        (unsigned long long) (stats.pi_bytes), stats.pi_us / 1000.0,
+        (stats.sd_us + stats.pi_us) / 1000.0,
+        wall_ms
+    );
+
+    sim_reset_stats();
+}
+
+/*
+ * Same allocation rule as flashcart_load_save, done through FatFs so it lands in the image.
+ * flashcart_load_save itself checks the file with stdio, which doesn't reach the image here.
+ */
+static bool prepare_save (char *save_path, size_t size) {
+    FIL fil;
+    UINT bw;
+    uint8_t fill[512];
+
+    if (f_open(&fil, save_path, FA_WRITE | FA_OPEN_ALWAYS) != FR_OK) {
+        return false;
+    }
+    if (f_size(&fil) == size) {
+        return (f_close(&fil) == FR_OK);
+    }
+
+    memset(fill, 0xFF, sizeof(fill));
+    f_truncate(&fil);
+    for (size_t offset = 0; offset < size; offset += sizeof(fill)) {
+        if ((f_write(&fil, fill, sizeof(fill), &bw) != FR_OK) || (bw != sizeof(fill))) {
+            f_close(&fil);
+            return false;
+        }
+    }
+
+    return (f_close(&fil) == FR_OK);
+}
+
+/* Same detection as rom_info, from the first word of the header */
+static flashcart_byte_order_t rom_byte_order (char *rom_path) {
+    FIL fil;
+    UINT br;
+    uint8_t header[4] = { 0 };
+
+    if (f_open(&fil, strip_fs_prefix(rom_path), FA_READ) == FR_OK) {
+        f_read(&fil, header, sizeof(header), &br);
+        f_close(&fil);
+    }
+
+    if ((header[0] == 0x37) && (header[1] == 0x80)) {
+        return FLASHCART_BYTE_ORDER_BYTE_SWAPPED;
+    }
+    if ((header[0] == 0x40) && (header[1] == 0x12)) {
+        return FLASHCART_BYTE_ORDER_LITTLE;
+    }
+    return FLASHCART_BYTE_ORDER_BIG;
+}
+
+/* Inverts one byte of the ROM and checks the load hands out every buffer once, in order */
+static void bench_patch_apply (uint8_t *buffer, uint32_t offset, size_t length, void *context) {
+    bench_patch_t *patch = (bench_patch_t *) (context);
+
+    patch->in_order &= (offset == patch->next);
+    patch->next = offset + length;
+    patch->buffers += 1;
+
+    if ((patch->offset >= offset) && ((patch->offset - offset) < length)) {
+        buffer[patch->offset - offset] ^= 0xFF;
+    }
+}
+
+static bool dump_region (const char *host_path, sim_region_t region, size_t size) {
+    size_t region_size;
+    uint8_t *data = sim_get_region(region, &region_size);
+    FILE *f = fopen(host_path, "wb");
+
+    if (!f) {
+        return false;
+    }
+    size_t length = (size < region_size) ? size : region_size;
+    bool ok = (fwrite(data, 1, length, f) == length);
+
+    return (fclose(f) == 0) && ok;
+}
+
+int main (int argc, char *argv[]) {
+    FATFS fs;
+    const char *storage_prefix;
+    flashcart_err_t err;
+    double start;
+    int result = 0;
+
+    if (argc < 3) {
+        fprintf(stderr,
+            "usage: %s <sd.img> <rom path> [<save path> <save type>] [<ipl path>]\n"
+            "  paths are inside the image, eg. sd:/roms/game.z64\n"
+            "  save types: eeprom4k eeprom16k sram sram-banked sram1m flashram\n"
+            "  env: SIM_SD_MIBPS, SIM_PI_MIBPS (0 = free), SIM_DUMP_ROM=<host file>,\n"
+            "       SIM_PATCH=<ROM offset> (invert that byte through the ROM patch hook)\n",
+            argv[0]
+        );
+        return 2;
+    }
+
+    if (!sim_diskio_open(argv[1])) {
+        fprintf(stderr, "error: cannot open image %s\n", argv[1]);
+        return 1;
+    }
+    if (f_mount(&fs, "", 1) != FR_OK) {
+        fprintf(stderr, "error: cannot mount FAT volume in %s\n", argv[1]);
+        return 1;
+    }
+
+    sim_config_t config = {
+        .sd_bytes_per_second = env_rate("SIM_SD_MIBPS", 20 * 1024 * 1024),
+        .pi_bytes_per_second = env_rate("SIM_PI_MIBPS", 5 * 1024 * 1024),
+    };
+    sim_set_config(&config);
+
+    if ((err = flashcart_init(&storage_prefix)) != FLASHCART_OK) {
+        fprintf(stderr, "error: %s\n", error_name(err));
+        return 1;
+    }
+
+    flashcart_byte_order_t byte_order = rom_byte_order(argv[2]);
+    printf("%-10s %s\n", "byte order", byte_order_name(byte_order));
+
+    const char *patch_offset = getenv("SIM_PATCH");
+    bench_patch_t patch = {
+        .offset = patch_offset ? (uint32_t) (strtoul(patch_offset, NULL, 0)) : 0,
+        .in_order = true,
+    };
+    if (patch_offset) {
+        flashcart_set_rom_patch(bench_patch_apply, &patch);
+    }
+
+    sim_reset_stats();
+    start = now_ms();
+    err = flashcart_load_rom(argv[2], byte_order, NULL);
+    report("rom", err, now_ms() - start);
+
+    if (patch_offset) {
+        printf("%-10s %zu buffers, %s\n", "patch", patch.buffers, patch.in_order ? "in order" : "out of order");
+        if (!patch.in_order || (patch.buffers == 0)) {
+            result = 1;
+        }
+    }
+
+    const char *dump_path = getenv("SIM_DUMP_ROM");
+    if ((err == FLASHCART_OK) && dump_path) {
+        FILINFO info;
+        if ((f_stat(strip_fs_prefix(argv[2]), &info) != FR_OK) ||
+            !dump_region(dump_path, SIM_REGION_SDRAM, info.fsize)) {
+            fprintf(stderr, "error: cannot dump ROM to %s\n", dump_path);
+        }
+    }
+
+    if (argc >= 5) {
+        size_t i;
+        for (i = 0; i < sizeof(save_types) / sizeof(save_types[0]); i++) {
+            if (!strcmp(argv[4], save_types[i].name)) {
+                break;
+            }
+        }
+        if (i == sizeof(save_types) / sizeof(save_types[0])) {
+            fprintf(stderr, "error: unknown save type %s\n", argv[4]);
+            return 2;
+        }
+
+        flashcart_t *cart = sim_get_flashcart();
+
+        start = now_ms();
+        if (!prepare_save(strip_fs_prefix(argv[3]), save_types[i].size)) {
+            err = FLASHCART_ERR_LOAD;
+        } else if ((err = cart->set_save_type(save_types[i].type)) == FLASHCART_OK) {
+            if ((err = cart->load_save(argv[3])) == FLASHCART_OK) {
+                err = cart->set_save_writeback(argv[3]);
+            }
+        }
+        report("save", err, now_ms() - start);
+
+        start = now_ms();
+        err = (err == FLASHCART_OK) ? sim_flush_save() : err;
+        report("writeback", err, now_ms() - start);
+
+        /* A game saving changes a few bytes, only their sector goes back to the SD card */
+        if (err == FLASHCART_OK) {
+            sim_get_region(SIM_REGION_SAVE, NULL)[0] ^= 0xFF;
+            start = now_ms();
+            err = sim_flush_save();
+            report("save edit", err, now_ms() - start);
+        }
+    }
+
+    if (argc >= 6) {
+        start = now_ms();
+        err = flashcart_load_64dd_ipl(argv[5], NULL);
+        report("64dd ipl", err, now_ms() - start);
+    }
+
+    flashcart_deinit();
+    f_unmount("");
+    sim_diskio_close();
+
+    return result;
+}
@@ -0,0 +1,117 @@
+/**
+ * @file sim_diskio.c
+ * @brief FatFs disk I/O backed by an SD card image file
+ * @ingroup flashcart
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <fatfs/ff.h>
+#include <fatfs/diskio.h>
+#include <libcart/cart.h>
+
+#include "flashcart/sim/sim.h"
+#include "sim_diskio.h"
+
+#define SECTOR_SIZE     (512)
+
+
+static FILE *image;
+
+
+bool sim_diskio_open (const char *image_path) {
+    if (image) {
+        fclose(image);
+    }
+    image = fopen(image_path, "r+b");
+    return (image != NULL);
+}
+
+void sim_diskio_close (void) {
+    if (image) {
+        fclose(image);
+        image = NULL;
+    }
+}
+
+DSTATUS disk_status (BYTE pdrv) {
+    return ((pdrv == 0) && image) ? 0 : STA_NOINIT;
+}
+
+DSTATUS disk_initialize (BYTE pdrv) {
+    return disk_status(pdrv);
+}
+
+DRESULT disk_read (BYTE pdrv, BYTE *buff, LBA_t sector, UINT count) {
+    if (disk_status(pdrv)) {
+        return RES_NOTRDY;
+    }
+    // NOTE: Like on the console, f_read into a cart address (fatfs_load_direct without
+    //       the multi-sector fast path) makes the cart load the sectors itself
+    uintptr_t address = (uintptr_t) (buff);
+    if ((address <= UINT32_MAX) && sim_map_pi_address(address, (size_t) (count) * SECTOR_SIZE)) {
+        return cart_card_rd_cart(address, sector, count) ? RES_ERROR : RES_OK;
+    }
+    if (fseeko(image, (off_t) (sector) * SECTOR_SIZE, SEEK_SET)) {
+        return RES_ERROR;
+    }
+    if (fread(buff, SECTOR_SIZE, count, image) != count) {
+        return RES_ERROR;
+    }
+    sim_add_transfer((size_t) (count) * SECTOR_SIZE, 0);
+    return RES_OK;
+}
+
+DRESULT disk_write (BYTE pdrv, const BYTE *buff, LBA_t sector, UINT count) {
+    if (disk_status(pdrv)) {
+        return RES_NOTRDY;
+    }
+    if (fseeko(image, (off_t) (sector) * SECTOR_SIZE, SEEK_SET)) {
+        return RES_ERROR;
+    }
+    if (fwrite(buff, SECTOR_SIZE, count, image) != count) {
+        return RES_ERROR;
+    }
+    sim_add_transfer((size_t) (count) * SECTOR_SIZE, 0);
+    return RES_OK;
+}
+
+DRESULT disk_ioctl (BYTE pdrv, BYTE cmd, void *buff) {
+    if (disk_status(pdrv)) {
+        return RES_NOTRDY;
+    }
+    switch (cmd) {
+        case CTRL_SYNC:
+            return fflush(image) ? RES_ERROR : RES_OK;
+        case GET_SECTOR_SIZE:
+            *(WORD *) (buff) = SECTOR_SIZE;
+            return RES_OK;
+        case GET_BLOCK_SIZE:
+            *(DWORD *) (buff) = 1;
+            return RES_OK;
+        case GET_SECTOR_COUNT:
+            if (fseeko(image, 0, SEEK_END)) {
+                return RES_ERROR;
+            }
+            *(LBA_t *) (buff) = (LBA_t) (ftello(image) / SECTOR_SIZE);
+            return RES_OK;
+        default:
+            return RES_PARERR;
+    }
+}
+
+DWORD get_fattime (void) {
+    time_t now = time(NULL);
+    struct tm *t = localtime(&now);
+
+    return (
+        ((DWORD) (t->tm_year - 80) << 25) |
+        ((DWORD) (t->tm_mon + 1) << 21) |
+        ((DWORD) (t->tm_mday) << 16) |
+        ((DWORD) (t->tm_hour) << 11) |
+        ((DWORD) (t->tm_min) << 5) |
+        ((DWORD) (t->tm_sec) >> 1)
+    );
+}
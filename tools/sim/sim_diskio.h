@@ -0,0 +1,28 @@
+/**
+ * @file sim_diskio.h
+ * @brief FatFs disk I/O backed by an SD card image file
+ * @ingroup flashcart
+ */
+
+#ifndef SIM_DISKIO_H__
+#define SIM_DISKIO_H__
+
+#include <stdbool.h>
+
+/**
+ * @brief Use an image file as FatFs drive 0.
+ *
+ * The image must hold a bare FAT/exFAT volume or an MBR partitioned disk,
+ * eg. one made with `mkfs.vfat -C sd.img 65536` and filled with mtools.
+ *
+ * @param image_path Path to the image file
+ * @return true if the image could be opened for reading and writing
+ */
+bool sim_diskio_open(const char *image_path);
+
+/**
+ * @brief Close the image file.
+ */
+void sim_diskio_close(void);
+
+#endif /* SIM_DISKIO_H__ */
@@ -0,0 +1,129 @@
+/**
+ * @file sim_pi.c
+ * @brief Host stand-ins for the libdragon and libcart calls of the flashcart load path
+ * @ingroup flashcart
+ *
+ * PI DMA and the cart's own SD to SDRAM transfer land in the simulated cart
+ * memory, so flashcart.c and flashcart_utils.c run unmodified on the host.
+ * The simulated cart answers for a SummerCart64, whose memory layout it uses.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <fatfs/ff.h>
+#include <fatfs/diskio.h>
+#include <libcart/cart.h>
+#include <libdragon.h>
+
+#include "flashcart/sim/sim.h"
+#include "flashcart/64drive/64drive.h"
+#include "flashcart/ed64/ed64_vseries.h"
+#include "flashcart/ed64/ed64_xseries.h"
+#include "flashcart/sc64/sc64.h"
+#include "utils/byteswap.h"
+
+#define SECTOR_SIZE     (512)
+
+
+int cart_type = CART_SC;
+int cart_card_byteswap = 0;
+
+
+/**
+ * @brief Read SD card sectors straight into cart memory.
+ *
+ * The transfer stays inside the cart, only the SD card side is charged.
+ *
+ * @param cart PI address to load to.
+ * @param lba First sector.
+ * @param count Number of sectors.
+ * @return int 0 on success, -1 on error.
+ */
+int cart_card_rd_cart (uint64_t cart, uint32_t lba, uint32_t count) {
+    size_t length = (size_t) (count) * SECTOR_SIZE;
+    uint8_t *dst = sim_map_pi_address((uint32_t) (cart), length);
+
+    if (!dst || (disk_read(0, dst, lba, count) != RES_OK)) {
+        return -1;
+    }
+
+    if (cart_card_byteswap) {
+        byteswap_16(dst, length);
+    }
+
+    return 0;
+}
+
+void dma_read_async (void *ram_address, unsigned long pi_address, unsigned long len) {
+    uint8_t *src = sim_map_pi_address(pi_address, len);
+
+    assert(src != NULL);
+    memcpy(ram_address, src, len);
+    sim_add_transfer(0, len);
+}
+
+void dma_write_raw_async (const void *ram_address, unsigned long pi_address, unsigned long len) {
+    uint8_t *dst = sim_map_pi_address(pi_address, len);
+
+    assert(dst != NULL);
+    memcpy(dst, ram_address, len);
+    sim_add_transfer(0, len);
+}
+
+void dma_wait (void) {
+}
+
+void data_cache_hit_writeback (volatile const void *addr, unsigned long length) {
+}
+
+void data_cache_hit_writeback_invalidate (volatile void *addr, unsigned long length) {
+}
+
+void io_write (uint32_t pi_address, uint32_t data) {
+    uint8_t *dst = sim_map_pi_address(pi_address, sizeof(data));
+
+    assert(dst != NULL);
+    for (int i = 0; i < 4; i++) {
+        dst[i] = (uint8_t) (data >> (24 - (i * 8)));
+    }
+    sim_add_transfer(0, sizeof(data));
+}
+
+bool sys_bbplayer (void) {
+    return false;
+}
+
+int bbfs_init (void) {
+    return -1;
+}
+
+/* The bench mounts the image itself before flashcart_init */
+bool debug_init_sdfs (const char *prefix, int npart) {
+    return true;
+}
+
+bool debug_init_isviewer (void) {
+    return false;
+}
+
+bool debug_init_usblog (void) {
+    return false;
+}
+
+flashcart_t *sc64_get_flashcart (void) {
+    return sim_get_flashcart();
+}
+
+flashcart_t *d64_get_flashcart (void) {
+    return NULL;
+}
+
+flashcart_t *ed64_vseries_get_flashcart (void) {
+    return NULL;
+}
+
+flashcart_t *ed64_xseries_get_flashcart (void) {
+    return NULL;
+}